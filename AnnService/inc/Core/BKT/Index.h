@@ -21,6 +21,7 @@
 #include "inc/Helper/ThreadPool.h"
 #include "inc/Core/Common/IQuantizer.h"
 
+#include <atomic>
 #include <functional>
 #include <shared_mutex>
 
@@ -37,22 +38,29 @@ namespace SPTAG
         template<typename T>
         class Index : public VectorIndex
         {
+            // Holds one count of running operations from Raise until it goes out of scope, also when they throw.
+            class InFlightCount {
+            public:
+                InFlightCount(std::atomic<int>& p_count) : m_count(p_count), m_raised(false) {}
+                ~InFlightCount() { if (m_raised) m_count--; }
+                void Raise() { m_count++; m_raised = true; }
+            private:
+                std::atomic<int>& m_count;
+                bool m_raised;
+            };
+
             class RebuildJob : public Helper::ThreadPool::Job {
             public:
                 RebuildJob(COMMON::Dataset<T>* p_data, COMMON::BKTree* p_tree, COMMON::RelativeNeighborhoodGraph* p_graph, 
-                    DistCalcMethod p_distMethod) : m_data(p_data), m_tree(p_tree), m_graph(p_graph), m_distMethod(p_distMethod) {}
+                    DistCalcMethod p_distMethod, std::atomic<int>* p_running) : m_data(p_data), m_tree(p_tree), m_graph(p_graph), m_distMethod(p_distMethod), m_running(p_running) { (*m_running)++; }
+                ~RebuildJob() { (*m_running)--; }
                 void exec(IAbortOperation* p_abort) {
                     COMMON::BKTree newTrees(*m_tree);
                     newTrees.BuildTrees<T>(*m_data, m_distMethod, 1, nullptr, nullptr, false, p_abort);
 
-                    std::unique_lock<std::shared_timed_mutex> lock(*(m_tree->m_lock));
-                    const std::unordered_map<SizeType, SizeType>* idmap = &(m_tree->GetSampleMap());
-                    for (auto iter = idmap->begin(); iter != idmap->end(); iter++) {
-                        if (iter->first < 0)
-                        {
-                            (*m_graph)[-1 - iter->first][m_graph->m_iNeighborhoodSize - 1] = -1;
-                        }
-                    }
+                    // Searches check every back-pointer against the trees they hold, so the graph is fixed up after the
+                    // new trees are published and without stopping them.
+                    std::unique_lock<std::mutex> lock = m_tree->m_epoch->LockWriters();
                     m_tree->SwapTree(newTrees);
 
                     const std::unordered_map<SizeType, SizeType>* newidmap = &(m_tree->GetSampleMap());
@@ -62,17 +70,28 @@ namespace SPTAG
                             (*m_graph)[-1 - iter->first][m_graph->m_iNeighborhoodSize - 1] = -2 - iter->second;
                         }
                     }
+                    const std::unordered_map<SizeType, SizeType>* idmap = &(newTrees.GetSampleMap());
+                    for (auto iter = idmap->begin(); iter != idmap->end(); iter++) {
+                        if (iter->first < 0 && newidmap->find(iter->first) == newidmap->end())
+                        {
+                            (*m_graph)[-1 - iter->first][m_graph->m_iNeighborhoodSize - 1] = -1;
+                        }
+                    }
                 }
             private:
                 COMMON::Dataset<T>* m_data;
                 COMMON::BKTree* m_tree;
                 COMMON::RelativeNeighborhoodGraph* m_graph;
                 DistCalcMethod m_distMethod;
+                std::atomic<int>* m_running;
             };
 
         private:
             // data points
             COMMON::Dataset<T> m_pSamples;
+
+            // Full-precision rows behind quantized samples, kept for reranking when the quantizer was trained in BuildIndex.
+            COMMON::Dataset<std::uint8_t> m_pFullSamples;
         
             // BKT structures. 
             COMMON::BKTree m_pTrees;
@@ -84,13 +103,37 @@ namespace SPTAG
             std::string m_sGraphFilename;
             std::string m_sDataPointsFilename;
             std::string m_sDeleteDataPointsFilename;
+            std::string m_sVertexMapFilename;
+            std::string m_sFullVectorFilename;
 
             int m_addCountForRebuild;
+            int m_iAddThreads;
             float m_fDeletePercentageForRefine;
+            bool m_bCompactGraph;
+            bool m_bCompactGraphDeltaCoding;
+            bool m_bReorderGraph;
+            int m_iScalarQuantizerBits;
+            int m_iRerankCandidates;
+            bool m_bNumaReplicas;
+            HugePagePolicy m_hugePagePolicy;
+            bool m_bMapIndexFiles;
+            bool m_bPrefaultIndexFiles;
+            int m_iLoadThreads;
+            int m_iLoadChunkMB;
+            bool m_bOnlineRefine;
+            // Only set while ReorderGraph is on: the id callers know for each stored vertex, and the reverse.
+            // Vertices added after the last reorder lie past their end and keep their own id.
+            std::vector<SizeType> m_externalIDs;
+            std::vector<SizeType> m_internalIDs;
             std::mutex m_dataAddLock; // protect data and graph
             std::shared_timed_mutex m_dataDeleteLock;
             COMMON::Labelset m_deletedID;
 
+            // AddIndex calls still linking their vectors, and tree rebuilds still reading the samples. Declared
+            // before the thread pool, which drops its queued rebuilds when it is destroyed.
+            std::atomic<int> m_addsInFlight;
+            std::atomic<int> m_rebuildsRunning;
+
             Helper::ThreadPool m_threadPool;
             int m_iNumberOfThreads;
 
@@ -103,7 +146,26 @@ namespace SPTAG
             int m_iNumberOfInitialDynamicPivots;
             int m_iNumberOfOtherDynamicPivots;
             int m_iHashTableExp;
+            VisitedSetType m_visitedSetType;
+            int m_iBatchSearchSize;
             std::unique_ptr<SPTAG::COMMON::IWorkSpaceFactory<SPTAG::COMMON::WorkSpace>> m_workSpaceFactory;
+            mutable COMMON::WorkSpacePool<COMMON::WorkSpace> m_batchWorkSpaces;
+
+            // One read-only copy of the index per NUMA node, searched instead of this one while it is published.
+            // Only touched through std::atomic_load/atomic_store; a search keeps its own reference to the set,
+            // so replacing or dropping it never frees a copy that is still being searched.
+            typedef std::vector<std::shared_ptr<Index<T>>> NumaReplicaSet;
+            std::shared_ptr<const NumaReplicaSet> m_numaReplicas;
+
+            // Vectors added since the last ingest throughput report, and when that report was made.
+            std::atomic<std::uint64_t> m_ingestVectors;
+            std::atomic<std::int64_t> m_ingestReportTime;
+
+            // Set while CompactIndex builds the compacted copy; the deletes made meanwhile are logged for it to replay.
+            std::mutex m_compactionLock;
+            std::atomic<bool> m_compacting;
+            std::mutex m_compactionLogLock;
+            std::vector<SizeType> m_compactionDeletes;
 
         public:
             Index()
@@ -115,9 +177,15 @@ namespace SPTAG
 #undef DefineBKTParameter
 
                 m_pSamples.SetName("Vector");
+                m_pFullSamples.SetName("FullVector");
                 m_fComputeDistance = std::function<float(const T*, const T*, DimensionType)>(COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod));
                 m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() : 1;
                 m_workSpaceFactory = std::make_unique<SPTAG::COMMON::ThreadLocalWorkSpaceFactory<SPTAG::COMMON::WorkSpace>>();
+                m_ingestVectors = 0;
+                m_ingestReportTime = 0;
+                m_addsInFlight = 0;
+                m_rebuildsRunning = 0;
+                m_compacting = false;
             }
 
             ~Index() {}
@@ -143,11 +211,12 @@ namespace SPTAG
             }
             inline float ComputeDistance(const void* pX, const void* pY) const { return m_fComputeDistance((const T*)pX, (const T*)pY, m_pSamples.C()); }
             inline float GetDistance(const void* target, const SizeType idx) const {
-                return ComputeDistance(target, m_pSamples.At(idx));
+                return ComputeDistance(target, m_pSamples.At(ToInternalID(idx)));
             }
-            inline const void* GetSample(const SizeType idx) const { return (void*)m_pSamples[idx]; }
-            inline bool ContainSample(const SizeType idx) const { return idx >= 0 && idx < m_deletedID.R() && !m_deletedID.Contains(idx); }
-            inline bool NeedRefine() const { return m_deletedID.Count() > (size_t)(GetNumSamples() * m_fDeletePercentageForRefine); }
+            inline const void* GetSample(const SizeType idx) const { return (void*)m_pSamples[ToInternalID(idx)]; }
+            inline const void* GetVertexSample(const SizeType vertex) const { return (void*)m_pSamples[vertex]; }
+            inline bool ContainSample(const SizeType idx) const { return idx >= 0 && idx < m_deletedID.R() && !m_deletedID.Contains(ToInternalID(idx)); }
+            inline bool NeedRefine() const { return !m_pGraph.IsCompact() && m_deletedID.Count() > (size_t)(GetNumSamples() * m_fDeletePercentageForRefine); }
             std::shared_ptr<std::vector<std::uint64_t>> BufferSize() const
             {
                 std::shared_ptr<std::vector<std::uint64_t>> buffersize(new std::vector<std::uint64_t>);
@@ -155,6 +224,8 @@ namespace SPTAG
                 buffersize->push_back(m_pTrees.BufferSize());
                 buffersize->push_back(m_pGraph.BufferSize());
                 buffersize->push_back(m_deletedID.BufferSize());
+                if (m_bReorderGraph) buffersize->push_back(sizeof(SizeType) + sizeof(DimensionType) + sizeof(SizeType) * GetNumSamples());
+                if (m_iRerankCandidates > 0) buffersize->push_back(m_pFullSamples.BufferSize());
                 return std::move(buffersize);
             }
 
@@ -165,6 +236,8 @@ namespace SPTAG
                 files->push_back(m_sBKTFilename);
                 files->push_back(m_sGraphFilename);
                 files->push_back(m_sDeleteDataPointsFilename);
+                if (m_bReorderGraph) files->push_back(m_sVertexMapFilename);
+                if (m_iRerankCandidates > 0) files->push_back(m_sFullVectorFilename);
                 return std::move(files);
             }
 
@@ -177,6 +250,8 @@ namespace SPTAG
 
             ErrorCode BuildIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, bool p_normalized = false, bool p_shareOwnership = false);
             ErrorCode SearchIndex(QueryResult &p_query, bool p_searchDeleted = false) const;
+            ErrorCode SearchIndexBatch(QueryResult* p_queries, int p_queryCount, bool p_searchDeleted = false) const;
+            ErrorCode SearchIndexStaged(QueryResult& p_query, int p_stageCheck, std::function<void(QueryResult&)> p_onStage, bool p_searchDeleted = false) const;
 
             std::shared_ptr<ResultIterator> GetIterator(const void* p_target, bool p_searchDeleted = false) const;
             ErrorCode SearchIndexIterativeNext(QueryResult& p_query, COMMON::WorkSpace* workSpace, int p_batch, int& resultCount, bool p_isFirst, bool p_searchDeleted) const;
@@ -196,6 +271,10 @@ namespace SPTAG
 
             ErrorCode RefineIndex(const std::vector<std::shared_ptr<Helper::DiskIO>>& p_indexStreams, IAbortOperation* p_abort);
             ErrorCode RefineIndex(std::shared_ptr<VectorIndex>& p_newIndex);
+            ErrorCode CompactIndex(std::vector<SizeType>& p_idMap, IAbortOperation* p_abort = nullptr);
+            ErrorCode BuildQuantizedIndex(std::shared_ptr<VectorSet> p_vectorSet, bool p_normalized);
+            ErrorCode AddQuantizedIndex(std::shared_ptr<VectorSet> p_vectorSet, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex, bool p_normalized);
+
             ErrorCode SetWorkSpaceFactory(std::unique_ptr<SPTAG::COMMON::IWorkSpaceFactory<SPTAG::COMMON::IWorkSpace>> up_workSpaceFactory)
             {
                 SPTAG::COMMON::IWorkSpaceFactory<SPTAG::COMMON::IWorkSpace>* raw_generic_ptr = up_workSpaceFactory.release();
@@ -217,6 +296,89 @@ namespace SPTAG
 
 
         private:
+            // Converts the graph between fixed-size and compact rows and between input and traversal order
+            // to match the CompactGraph and ReorderGraph settings.
+            ErrorCode ApplyGraphFormat();
+
+            // Call with m_dataAddLock held: waits for the adds still linking their vectors and for the tree
+            // rebuilds they queued, which write graph rows by their current ids.
+            void WaitForGraphWriters();
+
+            // Backs the vectors, graph and deletes allocated from now on with the pages HugePages asks for.
+            void ApplyHugePages();
+
+            // Permutes vectors, graph, trees and deletes so that vertex i becomes the former vertex indices[i].
+            ErrorCode ReorderVertices(const std::vector<SizeType>& indices);
+
+            ErrorCode LoadVertexMap(const COMMON::Dataset<SizeType>& p_vertexMap);
+
+            // The full-precision vectors follow the vertex map in the index streams.
+            inline size_t FullVectorStream() const { return m_bReorderGraph ? 5 : 4; }
+
+            // Adds put their full-precision rows in first, so there is one for every vector a search can return.
+            inline bool Reranks() const { return m_iRerankCandidates > 0 && m_pQuantizer && m_pFullSamples.R() >= GetNumSamples(); }
+
+            // AddIndex that also takes the full-precision rows of the vectors. Without them an index that keeps
+            // such rows stores the reconstruction of the codes instead.
+            ErrorCode AddIndexRows(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex, bool p_normalized, const std::uint8_t* p_fullRows);
+            ErrorCode AddFullRows(const void* p_codes, SizeType p_vectorNum, const std::uint8_t* p_fullRows);
+
+            // Rescores the quantized candidates against the full-precision vectors and keeps the best of them in p_query.
+            template <typename R>
+            void Rerank(QueryResult& p_query, const COMMON::QueryResultSet<T>& p_candidates) const;
+
+            inline SizeType ToInternalID(SizeType p_id) const
+            {
+                return (p_id < 0 || p_id >= (SizeType)m_internalIDs.size()) ? p_id : m_internalIDs[p_id];
+            }
+
+            inline SizeType ToExternalID(SizeType p_id) const
+            {
+                return (p_id < 0 || p_id >= (SizeType)m_externalIDs.size()) ? p_id : m_externalIDs[p_id];
+            }
+
+            // Metadata is kept by caller id, so refining it takes the vertices in that id space.
+            std::vector<SizeType> ToExternalIDs(const std::vector<SizeType>& p_ids) const
+            {
+                std::vector<SizeType> ids(p_ids.size());
+                for (size_t i = 0; i < p_ids.size(); i++) ids[i] = ToExternalID(p_ids[i]);
+                return ids;
+            }
+
+            // Turns the first p_resultNum result ids into caller ids and attaches their metadata.
+            void FinishResults(QueryResult& p_query, int p_resultNum) const;
+
+            void AttachMetadata(QueryResult& p_query, int p_resultNum) const;
+
+            // SaveIndexData without taking the data locks.
+            ErrorCode WriteIndexData(const std::vector<std::shared_ptr<Helper::DiskIO>>& p_indexStreams);
+
+            // Copies the index to every NUMA node when NumaReplicas is on and drops the copies otherwise.
+            // Searches that start meanwhile go to this index; the ones already in the old copies finish there.
+            ErrorCode UpdateNumaReplicas();
+
+            inline std::shared_ptr<const NumaReplicaSet> NumaReplicas() const { return std::atomic_load(&m_numaReplicas); }
+
+            // Loads one copy from the serialized index streams on the calling thread.
+            ErrorCode LoadNumaReplica(const std::vector<ByteArray>& p_indexBlobs, std::shared_ptr<Index<T>>& p_replica) const;
+
+            // Sends searches back to this index once it changes, as the copies are never updated.
+            void InvalidateNumaReplicas();
+
+            // Counts added vectors and logs the ingest rate at most once per c_ingestReportSeconds.
+            void ReportIngest(SizeType p_added);
+            static const int c_ingestReportSeconds = 10;
+            // Adds left for CompactIndex to replay under the locks, and the batch size of the replay.
+            static const SizeType c_compactionTail = 1024;
+
+            // Compacts this index, or only hands the compacted copy of a snapshot to p_copy when it is given.
+            ErrorCode RunCompaction(std::vector<SizeType>& p_idMap, std::unique_ptr<Index<T>>* p_copy, IAbortOperation* p_abort);
+            // Builds the compacted copy of the first p_snapshot vectors off to the side.
+            ErrorCode BuildCompactedCopy(SizeType p_snapshot, std::vector<SizeType>& p_idMap, std::unique_ptr<Index<T>>& p_copy, IAbortOperation* p_abort);
+            // Replays the adds made since p_snapshot into p_copy and swaps it in.
+            ErrorCode SwapInCompaction(SizeType p_snapshot, std::vector<SizeType>& p_idMap, Index<T>* p_copy);
+            // Adds vectors [p_begin, p_end) of this index to p_target, extending p_idMap with their ids there.
+            ErrorCode ReplayAdds(Index<T>* p_target, SizeType p_begin, SizeType p_end, std::vector<SizeType>& p_idMap);
 
             int SearchIndexIterative(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, bool p_isFirst, int batch, bool p_searchDeleted, bool p_searchDuplicated) const;
 
@@ -224,10 +386,29 @@ namespace SPTAG
             int SearchIterative(COMMON::QueryResultSet<T>& p_query,
                 COMMON::WorkSpace& p_space, bool p_isFirst, int batch) const;
 
+            // The kernel behind m_fComputeDistance, or nullptr when distances go through the quantizer.
+            inline COMMON::DistanceCalcReturn<T> DistanceKernel() const { return m_pQuantizer ? nullptr : COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod, GetFeatureDim()); }
+
             void SearchIndex(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted, bool p_searchDuplicated, std::function<bool(const ByteArray&)> filterFunc = nullptr) const;
             
-            template <bool(*notDeleted)(const COMMON::Labelset&, SizeType), bool(*isDup)(COMMON::QueryResultSet<T>&, SizeType, float), bool(*checkFilter)(const std::shared_ptr<MetadataSet>&, SizeType, std::function<bool(const ByteArray&)>)>
-            void Search(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, std::function<bool(const ByteArray&)> filterFunc) const;
+            template <bool(*notDeleted)(const COMMON::Labelset&, SizeType), bool(*isDup)(COMMON::QueryResultSet<T>&, SizeType, float), bool(*checkFilter)(const std::shared_ptr<MetadataSet>&, SizeType, std::function<bool(const ByteArray&)>), typename Dist>
+            void Search(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, const std::function<bool(const ByteArray&)>& filterFunc, const Dist& fComputeDistance) const;
+
+            template <typename Dist>
+            void ScoreNeighbors(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, const SizeType* node, const Dist& fComputeDistance) const;
+
+            void ScoreNeighbors(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, const SizeType* node, const COMMON::QuantizerBatchDistance<T>& fComputeDistance) const;
+
+            template <bool(*notDeleted)(const COMMON::Labelset&, SizeType), bool(*isDup)(COMMON::QueryResultSet<T>&, SizeType, float), bool(*checkFilter)(const std::shared_ptr<MetadataSet>&, SizeType, std::function<bool(const ByteArray&)>), typename Dist>
+            bool ExpandNode(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, const NodeDistPair& gnode, const SizeType* node, const std::function<bool(const ByteArray&)>& filterFunc, const Dist& fComputeDistance, const COMMON::BKTree::ReadView& p_trees) const;
+
+            // Walks a group of queries through the graph together, interleaving one expansion per query so that
+            // the graph rows and vectors prefetched for one query land in cache while the others are being expanded.
+            template <bool(*notDeleted)(const COMMON::Labelset&, SizeType), bool(*isDup)(COMMON::QueryResultSet<T>&, SizeType, float), typename Dist>
+            void SearchBatch(COMMON::QueryResultSet<T>** p_queries, COMMON::WorkSpace** p_spaces, int p_count, const Dist& fComputeDistance) const;
+
+            template <bool(*notDeleted)(const COMMON::Labelset&, SizeType)>
+            void SearchStaged(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, int p_stageCheck, std::function<void(QueryResult&)>& p_onStage) const;
         };
     } // namespace BKT
 } // namespace SPTAG
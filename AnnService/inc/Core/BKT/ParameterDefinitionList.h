@@ -8,6 +8,8 @@ DefineBKTParameter(m_sBKTFilename, std::string, std::string("tree.bin"), "TreeFi
 DefineBKTParameter(m_sGraphFilename, std::string, std::string("graph.bin"), "GraphFilePath")
 DefineBKTParameter(m_sDataPointsFilename, std::string, std::string("vectors.bin"), "VectorFilePath")
 DefineBKTParameter(m_sDeleteDataPointsFilename, std::string, std::string("deletes.bin"), "DeleteVectorFilePath")
+DefineBKTParameter(m_sVertexMapFilename, std::string, std::string("vertexmap.bin"), "VertexMapFilePath")
+DefineBKTParameter(m_sFullVectorFilename, std::string, std::string("fullvectors.bin"), "FullVectorFilePath")
 
 DefineBKTParameter(m_pTrees.m_bfs, int, 0L, "EnableBfs")
 DefineBKTParameter(m_pTrees.m_iTreeNumber, int, 1L, "BKTNumber")
@@ -36,17 +38,32 @@ DefineBKTParameter(m_pGraph.m_iGPURefineDepth, int, 30, "GPURefineDepth") // Dep
 DefineBKTParameter(m_pGraph.m_iGPULeafSize, int, 500, "GPULeafSize")
 DefineBKTParameter(m_pGraph.m_iheadNumGPUs, int, 1, "HeadNumGPUs")
 DefineBKTParameter(m_pGraph.m_iTPTBalanceFactor, int, 2, "TPTBalanceFactor")
+DefineBKTParameter(m_bCompactGraph, bool, false, "CompactGraph") // Keep the graph in read-only variable-length rows
+DefineBKTParameter(m_bCompactGraphDeltaCoding, bool, true, "CompactGraphDeltaCoding") // Allow 16/24-bit neighbor ids in compact rows
+DefineBKTParameter(m_bReorderGraph, bool, false, "ReorderGraph") // Store vectors and graph rows in BKT traversal order, keeping the original ids visible
+DefineBKTParameter(m_iScalarQuantizerBits, int, 0L, "ScalarQuantizerBits") // Train a 4 or 8-bit scalar quantizer when a BYTE index is built from full-precision vectors
+DefineBKTParameter(m_iRerankCandidates, int, 0L, "RerankCandidates") // Keep the full-precision vectors of a quantized build and rescore this many candidates with them
+DefineBKTParameter(m_bNumaReplicas, bool, false, "NumaReplicas") // Copy the read-only index to every NUMA node and serve each search from the copy local to its thread
+DefineBKTParameter(m_hugePagePolicy, HugePagePolicy, HugePagePolicy::None, "HugePages") // Back vectors, graph and deletes with Transparent, Huge2MB or Huge1GB pages
+DefineBKTParameter(m_bMapIndexFiles, bool, false, "MapIndexFiles") // Load from a folder by mapping the vector, tree, graph and delete files copy-on-write instead of reading them
+DefineBKTParameter(m_bPrefaultIndexFiles, bool, false, "PrefaultIndexFiles") // Read the mapped files in at load time rather than on first access
+DefineBKTParameter(m_iLoadThreads, int, 0L, "LoadThreads") // When not mapping, read the index data files whole with this many threads using unbuffered chunk reads
+DefineBKTParameter(m_iLoadChunkMB, int, 64L, "LoadChunkMB") // Chunk size of those reads
+DefineBKTParameter(m_bOnlineRefine, bool, false, "OnlineRefine") // When a save needs a refine, build the refined copy from a snapshot without holding the locks and save it; the ids of this index do not change
 
 DefineBKTParameter(m_iNumberOfThreads, int, 1L, "NumberOfThreads")
 DefineBKTParameter(m_iDistCalcMethod, SPTAG::DistCalcMethod, SPTAG::DistCalcMethod::Cosine, "DistCalcMethod")
 
 DefineBKTParameter(m_fDeletePercentageForRefine, float, 0.4F, "DeletePercentageForRefine")
 DefineBKTParameter(m_addCountForRebuild, int, 1000, "AddCountForRebuild")
+DefineBKTParameter(m_iAddThreads, int, 1L, "AddThreads") // Threads that link the vectors of one AddIndex call into the graph
 DefineBKTParameter(m_iMaxCheck, int, 8192L, "MaxCheck")
 DefineBKTParameter(m_iThresholdOfNumberOfContinuousNoBetterPropagation, int, 3L, "ThresholdOfNumberOfContinuousNoBetterPropagation")
 DefineBKTParameter(m_iNumberOfInitialDynamicPivots, int, 50L, "NumberOfInitialDynamicPivots")
 DefineBKTParameter(m_iNumberOfOtherDynamicPivots, int, 4L, "NumberOfOtherDynamicPivots")
 DefineBKTParameter(m_iHashTableExp, int, 2L, "HashTableExponent")
+DefineBKTParameter(m_visitedSetType, VisitedSetType, VisitedSetType::Auto, "VisitedSet") // Hash, Epoch, or Auto to pick the epoch array for small indexes
+DefineBKTParameter(m_iBatchSearchSize, int, 8L, "BatchSearchSize")
 DefineBKTParameter(m_iDataBlockSize, int, 1024 * 1024, "DataBlockSize")
 DefineBKTParameter(m_iDataCapacity, int, MaxSize, "DataCapacity")
 DefineBKTParameter(m_iMetaRecordSize, int, 10, "MetaRecordSize")
@@ -65,6 +65,7 @@ inline T max(T a, T b) {
 #define mkdir(a) mkdir(a, ACCESSPERMS)
 #define InterlockedCompareExchange(a,b,c) __sync_val_compare_and_swap(a, c, b)
 #define InterlockedExchange8(a,b) __sync_lock_test_and_set(a, b)
+#define InterlockedOr64(a,b) __sync_fetch_and_or(a, b)
 #define Sleep(a) usleep(a * 1000)
 #define strtok_s(a, b, c) strtok_r(a, b, c)
 
@@ -279,6 +280,26 @@ enum class OrderStrategy : std::uint8_t
 };
 static_assert(static_cast<std::uint8_t>(OrderStrategy::Undefined) != 0, "Empty OrderStrategy!");
 
+enum class VisitedSetType : std::uint8_t
+{
+#define DefineVisitedSetType(Name) Name,
+#include "DefinitionList.h"
+#undef DefineVisitedSetType
+
+    Undefined
+};
+static_assert(static_cast<std::uint8_t>(VisitedSetType::Undefined) != 0, "Empty VisitedSetType!");
+
+enum class HugePagePolicy : std::uint8_t
+{
+#define DefineHugePagePolicy(Name) Name,
+#include "DefinitionList.h"
+#undef DefineHugePagePolicy
+
+    Undefined
+};
+static_assert(static_cast<std::uint8_t>(HugePagePolicy::Undefined) != 0, "Empty HugePagePolicy!");
+
 } // namespace SPTAG
 
 #endif // _SPTAG_CORE_COMMONDEFS_H_
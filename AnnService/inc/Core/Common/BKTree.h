@@ -4,18 +4,21 @@
 #ifndef _SPTAG_COMMON_BKTREE_H_
 #define _SPTAG_COMMON_BKTREE_H_
 
+#include <atomic>
 #include <stack>
 #include <string>
 #include <vector>
 #include <mutex>
-#include <shared_mutex>
+#include <unordered_map>
 #include "inc/Core/VectorIndex.h"
+#include "inc/Helper/TaskScheduler.h"
 
 #include "CommonUtils.h"
 #include "QueryResultSet.h"
 #include "WorkSpace.h"
 #include "Dataset.h"
 #include "DistanceUtils.h"
+#include "EpochManager.h"
 
 namespace SPTAG
 {
@@ -224,8 +227,8 @@ namespace SPTAG
             float currDist = 0;
             SizeType subsize = (last - first - 1) / args._T + 1;
 
-#pragma omp parallel for num_threads(args._T) shared(data, indices) reduction(+:currDist)
-            for (int tid = 0; tid < args._T; tid++)
+            std::vector<float> dists(args._T, 0);
+            Helper::TaskScheduler::Instance().ParallelFor(0, args._T, args._T, [&](SizeType tid)
             {
                 SizeType istart = first + tid * subsize;
                 SizeType iend = min(first + (tid + 1) * subsize, last);
@@ -274,8 +277,9 @@ namespace SPTAG
                     }
                 }
                 if (args.m_pQuantizer) ALIGN_FREE(reconstructVector);
-                currDist += idist;
-            }
+                dists[tid] = idist;
+            });
+            for (int i = 0; i < args._T; i++) currDist += dists[i];
 
             for (int i = 1; i < args._T; i++) {
                 for (int k = 0; k < args._DK; k++) {
@@ -500,35 +504,141 @@ break;
 
         class BKTree
         {
+            // The nodes of the trees as searches see them. A rebuild publishes a new set and frees the old one
+            // once every search that started on it has finished.
+            struct TreeSet
+            {
+                std::vector<SizeType> m_pTreeStart;
+                std::vector<BKTNode> m_pTreeRoots;
+                std::unordered_map<SizeType, SizeType> m_pSampleCenterMap;
+            };
+
         public:
-            BKTree(): m_iTreeNumber(1), m_iBKTKmeansK(32), m_iBKTLeafSize(8), m_iSamples(1000), m_fBalanceFactor(-1.0f), m_bfs(0), m_lock(new std::shared_timed_mutex), m_pQuantizer(nullptr) {}
+            // Pins the published trees for one search without taking a lock. Graph rows point back into the
+            // trees from the last slot of a cluster center, and those pointers are rewritten after a rebuild has
+            // been published, so a search only follows one that IsCenter confirms against the trees it holds.
+            class ReadView
+            {
+            public:
+                ReadView(const BKTree& p_tree) : m_tree(p_tree), m_token(p_tree.m_epoch->Enter()), m_trees(p_tree.m_published.load(std::memory_order_acquire)) {}
+                ~ReadView() { m_tree.m_epoch->Leave(m_token); }
+
+                inline const BKTNode& operator[](SizeType index) const { return m_trees->m_pTreeRoots[index]; }
+
+                inline SizeType size() const { return (SizeType)m_trees->m_pTreeRoots.size(); }
+
+                inline bool IsCenter(SizeType index, SizeType node) const
+                {
+                    return index >= 0 && index < size() && m_trees->m_pTreeRoots[index].centerid == node && m_trees->m_pTreeRoots[index].childStart < 0;
+                }
+
+                template <typename T, typename Dist>
+                void InitSearchTrees(const Dataset<T>& data, const Dist& fComputeDistance, COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space) const
+                {
+                    m_tree.InitSearchTrees(*m_trees, data, fComputeDistance, p_query, p_space);
+                }
+
+                template <typename T, typename Dist>
+                void SearchTrees(const Dataset<T>& data, const Dist& fComputeDistance, COMMON::QueryResultSet<T>& p_query,
+                    COMMON::WorkSpace& p_space, const int p_limits) const
+                {
+                    m_tree.SearchTrees(*m_trees, data, fComputeDistance, p_query, p_space, p_limits);
+                }
+
+            private:
+                friend class BKTree;
+
+                const BKTree& m_tree;
+                int m_token;
+                const TreeSet* m_trees;
+            };
+
+            BKTree(): m_trees(new TreeSet), m_published(m_trees.get()), m_epoch(new EpochManager), m_iTreeNumber(1), m_iBKTKmeansK(32), m_iBKTLeafSize(8), m_iSamples(1000), m_bfs(0), m_fBalanceFactor(-1.0f), m_pQuantizer(nullptr) {}
             
-            BKTree(const BKTree& other): m_iTreeNumber(other.m_iTreeNumber), 
+            BKTree(const BKTree& other): m_trees(new TreeSet),
+                                   m_published(m_trees.get()),
+                                   m_epoch(new EpochManager),
+                                   m_iTreeNumber(other.m_iTreeNumber), 
                                    m_iBKTKmeansK(other.m_iBKTKmeansK), 
                                    m_iBKTLeafSize(other.m_iBKTLeafSize),
                                    m_iSamples(other.m_iSamples),
                                    m_fBalanceFactor(other.m_fBalanceFactor),
-                                   m_lock(new std::shared_timed_mutex),
                                    m_pQuantizer(other.m_pQuantizer) {}
             ~BKTree() {}
 
-            inline const BKTNode& operator[](SizeType index) const { return m_pTreeRoots[index]; }
-            inline BKTNode& operator[](SizeType index) { return m_pTreeRoots[index]; }
+            // Direct access for whoever owns the trees exclusively, such as a build or a locked index; searches go through a ReadView.
+            inline const BKTNode& operator[](SizeType index) const { return m_trees->m_pTreeRoots[index]; }
+            inline BKTNode& operator[](SizeType index) { return m_trees->m_pTreeRoots[index]; }
 
-            inline SizeType size() const { return (SizeType)m_pTreeRoots.size(); }
+            inline SizeType size() const { return (SizeType)m_trees->m_pTreeRoots.size(); }
             
             inline SizeType sizePerTree() const {
-                std::shared_lock<std::shared_timed_mutex> lock(*m_lock);
-                return (SizeType)m_pTreeRoots.size() - m_pTreeStart.back(); 
+                ReadView trees(*this);
+                return trees.size() - trees.m_trees->m_pTreeStart.back();
             }
 
-            inline const std::unordered_map<SizeType, SizeType>& GetSampleMap() const { return m_pSampleCenterMap; }
+            inline const std::unordered_map<SizeType, SizeType>& GetSampleMap() const { return m_trees->m_pSampleCenterMap; }
 
+            // Publishes the trees of newTrees and hands it the old ones once no search can still be reading them.
+            // Call with the writers of m_epoch locked.
             inline void SwapTree(BKTree& newTrees)
             {
-                m_pTreeRoots.swap(newTrees.m_pTreeRoots);
-                m_pTreeStart.swap(newTrees.m_pTreeStart);
-                m_pSampleCenterMap.swap(newTrees.m_pSampleCenterMap);
+                std::unique_ptr<TreeSet> old = std::move(m_trees);
+                m_trees = std::move(newTrees.m_trees);
+                m_published.store(m_trees.get(), std::memory_order_release);
+                m_epoch->Synchronize();
+                newTrees.m_trees = std::move(old);
+                newTrees.m_published.store(newTrees.m_trees.get(), std::memory_order_release);
+            }
+
+            // Depth-first walk of the first tree: every cluster center is followed by the rest of its cluster, so
+            // vectors that are searched together get neighboring ids. Samples the tree does not cover go last.
+            void VertexOrder(SizeType numSamples, std::vector<SizeType>& indices) const
+            {
+                indices.clear();
+                indices.reserve(numSamples);
+                std::vector<bool> placed(numSamples, false);
+                auto place = [&](SizeType id) {
+                    if (id >= 0 && id < numSamples && !placed[id]) {
+                        placed[id] = true;
+                        indices.push_back(id);
+                    }
+                };
+
+                if (!m_trees->m_pTreeStart.empty()) {
+                    std::stack<SizeType> ss;
+                    ss.push(m_trees->m_pTreeStart[0]);
+                    while (!ss.empty()) {
+                        SizeType index = ss.top(); ss.pop();
+                        const BKTNode& node = m_trees->m_pTreeRoots[index];
+                        // A root that was split keeps the tree size in centerid instead of a sample id.
+                        if (index != m_trees->m_pTreeStart[0] || node.childStart < 0) place(node.centerid);
+                        SizeType first = (node.childStart < 0) ? -node.childStart : node.childStart;
+                        for (SizeType i = node.childEnd - 1; i >= first; i--) ss.push(i);
+                    }
+                }
+                for (SizeType i = 0; i < numSamples; i++) place(i);
+            }
+
+            // Renumbers the samples referenced by the trees after the vectors were reordered; reverseIndices maps old ids to new ones.
+            void RemapSamples(const std::vector<SizeType>& reverseIndices)
+            {
+                SizeType numSamples = (SizeType)reverseIndices.size();
+                std::vector<bool> isRoot(m_trees->m_pTreeRoots.size(), false);
+                for (SizeType start : m_trees->m_pTreeStart) isRoot[start] = true;
+                for (size_t i = 0; i < m_trees->m_pTreeRoots.size(); i++) {
+                    BKTNode& node = m_trees->m_pTreeRoots[i];
+                    // A root that was split keeps the tree size in centerid instead of a sample id.
+                    if (isRoot[i] && node.childStart >= 0) continue;
+                    if (node.centerid >= 0 && node.centerid < numSamples) node.centerid = reverseIndices[node.centerid];
+                }
+
+                std::unordered_map<SizeType, SizeType> sampleMap;
+                for (auto iter = m_trees->m_pSampleCenterMap.begin(); iter != m_trees->m_pSampleCenterMap.end(); iter++) {
+                    if (iter->first < 0) sampleMap[-1 - reverseIndices[-1 - iter->first]] = iter->second;
+                    else sampleMap[reverseIndices[iter->first]] = reverseIndices[iter->second];
+                }
+                m_trees->m_pSampleCenterMap.swap(sampleMap);
             }
 
             template <typename T>
@@ -537,10 +647,8 @@ break;
                 BKTree newTrees(*this);
                 newTrees.BuildTrees<T>(data, distMethod, 1, nullptr, nullptr, false, abort);
 
-                std::unique_lock<std::shared_timed_mutex> lock(*m_lock);
-                m_pTreeRoots.swap(newTrees.m_pTreeRoots);
-                m_pTreeStart.swap(newTrees.m_pTreeStart);
-                m_pSampleCenterMap.swap(newTrees.m_pSampleCenterMap);
+                std::unique_lock<std::mutex> lock = m_epoch->LockWriters();
+                SwapTree(newTrees);
             }
 
             template <typename T>
@@ -567,25 +675,25 @@ break;
 
                 if (m_fBalanceFactor < 0) m_fBalanceFactor = DynamicFactorSelect(data, localindices, 0, (SizeType)localindices.size(), args, m_iSamples);
 
-                m_pSampleCenterMap.clear();
+                m_trees->m_pSampleCenterMap.clear();
                 for (char i = 0; i < m_iTreeNumber; i++)
                 {
                     std::shuffle(localindices.begin(), localindices.end(), rg);
 
-                    m_pTreeStart.push_back((SizeType)m_pTreeRoots.size());
-                    m_pTreeRoots.emplace_back((SizeType)localindices.size());
+                    m_trees->m_pTreeStart.push_back((SizeType)m_trees->m_pTreeRoots.size());
+                    m_trees->m_pTreeRoots.emplace_back((SizeType)localindices.size());
                     SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Start to build BKTree %d\n", i + 1);
 
-                    ss.push(BKTStackItem(m_pTreeStart[i], 0, (SizeType)localindices.size(), true));
+                    ss.push(BKTStackItem(m_trees->m_pTreeStart[i], 0, (SizeType)localindices.size(), true));
                     while (!ss.empty()) {
                         if (abort && abort->ShouldAbort()) return;
 
                         BKTStackItem item = ss.top(); ss.pop();
-                        m_pTreeRoots[item.index].childStart = (SizeType)m_pTreeRoots.size();
+                        m_trees->m_pTreeRoots[item.index].childStart = (SizeType)m_trees->m_pTreeRoots.size();
                         if (item.last - item.first <= m_iBKTLeafSize) {
                             for (SizeType j = item.first; j < item.last; j++) {
                                 SizeType cid = (reverseIndices == nullptr)? localindices[j]: reverseIndices->at(localindices[j]);
-                                m_pTreeRoots.emplace_back(cid);
+                                m_trees->m_pTreeRoots.emplace_back(cid);
                             }
                         }
                         else { // clustering the data into BKTKmeansK clusters
@@ -598,14 +706,14 @@ break;
                             if (numClusters <= 1) {
                                 SizeType end = min(item.last + 1, (SizeType)localindices.size());
                                 std::sort(localindices.begin() + item.first, localindices.begin() + end);
-                                m_pTreeRoots[item.index].centerid = (reverseIndices == nullptr) ? localindices[item.first] : reverseIndices->at(localindices[item.first]);
-                                m_pTreeRoots[item.index].childStart = -m_pTreeRoots[item.index].childStart;
+                                m_trees->m_pTreeRoots[item.index].centerid = (reverseIndices == nullptr) ? localindices[item.first] : reverseIndices->at(localindices[item.first]);
+                                m_trees->m_pTreeRoots[item.index].childStart = -m_trees->m_pTreeRoots[item.index].childStart;
                                 for (SizeType j = item.first + 1; j < end; j++) {
                                     SizeType cid = (reverseIndices == nullptr) ? localindices[j] : reverseIndices->at(localindices[j]);
-                                    m_pTreeRoots.emplace_back(cid);
-                                    m_pSampleCenterMap[cid] = m_pTreeRoots[item.index].centerid;
+                                    m_trees->m_pTreeRoots.emplace_back(cid);
+                                    m_trees->m_pSampleCenterMap[cid] = m_trees->m_pTreeRoots[item.index].centerid;
                                 }
-                                m_pSampleCenterMap[-1 - m_pTreeRoots[item.index].centerid] = item.index;
+                                m_trees->m_pSampleCenterMap[-1 - m_trees->m_pTreeRoots[item.index].centerid] = item.index;
                             }
                             else {
                                 SizeType maxCount = 0;
@@ -613,33 +721,34 @@ break;
                                 for (int k = 0; k < m_iBKTKmeansK; k++) {
                                     if (args.counts[k] == 0) continue;
                                     SizeType cid = (reverseIndices == nullptr) ? localindices[item.first + args.counts[k] - 1] : reverseIndices->at(localindices[item.first + args.counts[k] - 1]);
-                                    m_pTreeRoots.emplace_back(cid);
-                                    if (args.counts[k] > 1) ss.push(BKTStackItem((SizeType)(m_pTreeRoots.size() - 1), item.first, item.first + args.counts[k] - 1, item.debug && (args.counts[k] == maxCount)));
+                                    m_trees->m_pTreeRoots.emplace_back(cid);
+                                    if (args.counts[k] > 1) ss.push(BKTStackItem((SizeType)(m_trees->m_pTreeRoots.size() - 1), item.first, item.first + args.counts[k] - 1, item.debug && (args.counts[k] == maxCount)));
                                     item.first += args.counts[k];
                                 }
                             }
                         }
-                        m_pTreeRoots[item.index].childEnd = (SizeType)m_pTreeRoots.size();
+                        m_trees->m_pTreeRoots[item.index].childEnd = (SizeType)m_trees->m_pTreeRoots.size();
                     }
-                    m_pTreeRoots.emplace_back(-1);
-                    SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "%d BKTree built, %zu %zu\n", i + 1, m_pTreeRoots.size() - m_pTreeStart[i], localindices.size());
+                    m_trees->m_pTreeRoots.emplace_back(-1);
+                    SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "%d BKTree built, %zu %zu\n", i + 1, m_trees->m_pTreeRoots.size() - m_trees->m_pTreeStart[i], localindices.size());
                 }
             }
 
             inline std::uint64_t BufferSize() const
             {
+                ReadView trees(*this);
                 return sizeof(int) + sizeof(SizeType) * m_iTreeNumber +
-                    sizeof(SizeType) + sizeof(BKTNode) * m_pTreeRoots.size();
+                    sizeof(SizeType) + sizeof(BKTNode) * trees.size();
             }
 
             ErrorCode SaveTrees(std::shared_ptr<Helper::DiskIO> p_out) const
             {
-                std::shared_lock<std::shared_timed_mutex> lock(*m_lock);
+                ReadView trees(*this);
                 IOBINARY(p_out, WriteBinary, sizeof(m_iTreeNumber), (char*)&m_iTreeNumber);
-                IOBINARY(p_out, WriteBinary, sizeof(SizeType) * m_iTreeNumber, (char*)m_pTreeStart.data());
-                SizeType treeNodeSize = (SizeType)m_pTreeRoots.size();
+                IOBINARY(p_out, WriteBinary, sizeof(SizeType) * m_iTreeNumber, (char*)trees.m_trees->m_pTreeStart.data());
+                SizeType treeNodeSize = trees.size();
                 IOBINARY(p_out, WriteBinary, sizeof(treeNodeSize), (char*)&treeNodeSize);
-                IOBINARY(p_out, WriteBinary, sizeof(BKTNode) * treeNodeSize, (char*)m_pTreeRoots.data());
+                IOBINARY(p_out, WriteBinary, sizeof(BKTNode) * treeNodeSize, (char*)trees.m_trees->m_pTreeRoots.data());
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Save BKT (%d,%d) Finish!\n", m_iTreeNumber, treeNodeSize);
                 return ErrorCode::Success;
             }
@@ -656,15 +765,15 @@ break;
             {
                 m_iTreeNumber = *((int*)pBKTMemFile);
                 pBKTMemFile += sizeof(int);
-                m_pTreeStart.resize(m_iTreeNumber);
-                memcpy(m_pTreeStart.data(), pBKTMemFile, sizeof(SizeType) * m_iTreeNumber);
+                m_trees->m_pTreeStart.resize(m_iTreeNumber);
+                memcpy(m_trees->m_pTreeStart.data(), pBKTMemFile, sizeof(SizeType) * m_iTreeNumber);
                 pBKTMemFile += sizeof(SizeType)*m_iTreeNumber;
 
                 SizeType treeNodeSize = *((SizeType*)pBKTMemFile);
                 pBKTMemFile += sizeof(SizeType);
-                m_pTreeRoots.resize(treeNodeSize);
-                memcpy(m_pTreeRoots.data(), pBKTMemFile, sizeof(BKTNode) * treeNodeSize);
-                if (m_pTreeRoots.size() > 0 && m_pTreeRoots.back().centerid != -1) m_pTreeRoots.emplace_back(-1);
+                m_trees->m_pTreeRoots.resize(treeNodeSize);
+                memcpy(m_trees->m_pTreeRoots.data(), pBKTMemFile, sizeof(BKTNode) * treeNodeSize);
+                if (m_trees->m_pTreeRoots.size() > 0 && m_trees->m_pTreeRoots.back().centerid != -1) m_trees->m_pTreeRoots.emplace_back(-1);
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Load BKT (%d,%d) Finish!\n", m_iTreeNumber, treeNodeSize);
                 return ErrorCode::Success;
             }
@@ -672,15 +781,15 @@ break;
             ErrorCode LoadTrees(std::shared_ptr<Helper::DiskIO> p_input)
             {
                 IOBINARY(p_input, ReadBinary, sizeof(m_iTreeNumber), (char*)&m_iTreeNumber);
-                m_pTreeStart.resize(m_iTreeNumber);
-                IOBINARY(p_input, ReadBinary, sizeof(SizeType) * m_iTreeNumber, (char*)m_pTreeStart.data());
+                m_trees->m_pTreeStart.resize(m_iTreeNumber);
+                IOBINARY(p_input, ReadBinary, sizeof(SizeType) * m_iTreeNumber, (char*)m_trees->m_pTreeStart.data());
 
                 SizeType treeNodeSize;
                 IOBINARY(p_input, ReadBinary, sizeof(treeNodeSize), (char*)&treeNodeSize);
-                m_pTreeRoots.resize(treeNodeSize);
-                IOBINARY(p_input, ReadBinary, sizeof(BKTNode) * treeNodeSize, (char*)m_pTreeRoots.data());
+                m_trees->m_pTreeRoots.resize(treeNodeSize);
+                IOBINARY(p_input, ReadBinary, sizeof(BKTNode) * treeNodeSize, (char*)m_trees->m_pTreeRoots.data());
 
-                if (m_pTreeRoots.size() > 0 && m_pTreeRoots.back().centerid != -1) m_pTreeRoots.emplace_back(-1);
+                if (m_trees->m_pTreeRoots.size() > 0 && m_trees->m_pTreeRoots.back().centerid != -1) m_trees->m_pTreeRoots.emplace_back(-1);
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Load BKT (%d,%d) Finish!\n", m_iTreeNumber, treeNodeSize);
                 return ErrorCode::Success;
             }
@@ -693,13 +802,14 @@ break;
                 return LoadTrees(ptr);
             }
 
-            template <typename T>
-            void InitSearchTrees(const Dataset<T>& data, std::function<float(const T*, const T*, DimensionType)> fComputeDistance, COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space) const
+        private:
+            template <typename T, typename Dist>
+            void InitSearchTrees(const TreeSet& p_trees, const Dataset<T>& data, const Dist& fComputeDistance, COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space) const
             {
-                for (char i = 0; i < m_iTreeNumber; i++) {
-                    const BKTNode& node = m_pTreeRoots[m_pTreeStart[i]];
+                for (size_t i = 0; i < p_trees.m_pTreeStart.size(); i++) {
+                    const BKTNode& node = p_trees.m_pTreeRoots[p_trees.m_pTreeStart[i]];
                     if (node.childStart < 0) {
-                        p_space.m_SPTQueue.insert(NodeDistPair(m_pTreeStart[i], fComputeDistance(p_query.GetQuantizedTarget(), data[node.centerid], data.C())));
+                        p_space.m_SPTQueue.insert(NodeDistPair(p_trees.m_pTreeStart[i], fComputeDistance(p_query.GetQuantizedTarget(), data[node.centerid], data.C())));
                     } else if (m_bfs) {
                         float FactorQ = 1.1f;
                         int MaxBFSNodes = 100;
@@ -708,11 +818,11 @@ break;
                         p_curr->Top().distance = 1e9;
                        
                         for (SizeType begin = node.childStart; begin < node.childEnd; begin++) {
-                            _mm_prefetch((const char*)(data[m_pTreeRoots[begin].centerid]), _MM_HINT_T0);
+                            _mm_prefetch((const char*)(data[p_trees.m_pTreeRoots[begin].centerid]), _MM_HINT_T0);
                         }
                         
                         for (SizeType begin = node.childStart; begin < node.childEnd; begin++) {
-                            SizeType index = m_pTreeRoots[begin].centerid;
+                            SizeType index = p_trees.m_pTreeRoots[begin].centerid;
                             float dist = fComputeDistance(p_query.GetQuantizedTarget(), data[index], data.C());
                             if (dist <= FactorQ * p_curr->Top().distance && p_curr->size() < MaxBFSNodes) {
                                 p_curr->insert(NodeDistPair(begin, dist));
@@ -726,19 +836,19 @@ break;
                             p_next->Top().distance = 1e9;
                             while (!p_curr->empty()) {
                                 NodeDistPair tmp = p_curr->pop();
-                                const BKTNode& tnode = m_pTreeRoots[tmp.node];
+                                const BKTNode& tnode = p_trees.m_pTreeRoots[tmp.node];
                                 if (tnode.childStart < 0) {
                                     p_space.m_SPTQueue.insert(tmp);
                                 }
                                 else {
                                     for (SizeType begin = tnode.childStart; begin < tnode.childEnd; begin++) {
-                                        _mm_prefetch((const char*)(data[m_pTreeRoots[begin].centerid]), _MM_HINT_T0);
+                                        _mm_prefetch((const char*)(data[p_trees.m_pTreeRoots[begin].centerid]), _MM_HINT_T0);
                                     }
                                     if (!p_space.CheckAndSet(tnode.centerid)) {
                                         p_space.m_NGQueue.insert(NodeDistPair(tnode.centerid, tmp.distance));
                                     }
                                     for (SizeType begin = tnode.childStart; begin < tnode.childEnd; begin++) {
-                                        SizeType index = m_pTreeRoots[begin].centerid;
+                                        SizeType index = p_trees.m_pTreeRoots[begin].centerid;
                                         float dist = fComputeDistance(p_query.GetQuantizedTarget(), data[index], data.C());
                                         if (dist <= FactorQ * p_next->Top().distance && p_next->size() < MaxBFSNodes) {
                                             p_next->insert(NodeDistPair(begin, dist));
@@ -758,24 +868,26 @@ break;
                     }
                     else {
                         for (SizeType begin = node.childStart; begin < node.childEnd; begin++) {
-                            _mm_prefetch((const char*)(data[m_pTreeRoots[begin].centerid]), _MM_HINT_T0);
+                            _mm_prefetch((const char*)(data[p_trees.m_pTreeRoots[begin].centerid]), _MM_HINT_T0);
                         }
                         for (SizeType begin = node.childStart; begin < node.childEnd; begin++) {
-                            SizeType index = m_pTreeRoots[begin].centerid;
+                            SizeType index = p_trees.m_pTreeRoots[begin].centerid;
                             p_space.m_SPTQueue.insert(NodeDistPair(begin, fComputeDistance(p_query.GetQuantizedTarget(), data[index], data.C())));
                         }
                     }
                 }
             }
 
-            template <typename T>
-            void SearchTrees(const Dataset<T>& data, std::function<float(const T*, const T*, DimensionType)> fComputeDistance, COMMON::QueryResultSet<T> &p_query,
+            template <typename T, typename Dist>
+            void SearchTrees(const TreeSet& p_trees, const Dataset<T>& data, const Dist& fComputeDistance, COMMON::QueryResultSet<T> &p_query,
                 COMMON::WorkSpace &p_space, const int p_limits) const
             {
                 while (!p_space.m_SPTQueue.empty())
                 {
                     NodeDistPair bcell = p_space.m_SPTQueue.pop();
-                    const BKTNode& tnode = m_pTreeRoots[bcell.node];
+                    // An iterative search resumes with the nodes it queued on the trees it held last time.
+                    if (bcell.node >= (SizeType)p_trees.m_pTreeRoots.size()) continue;
+                    const BKTNode& tnode = p_trees.m_pTreeRoots[bcell.node];
                     if (tnode.childStart < 0) {
                         if (!p_space.CheckAndSet(tnode.centerid)) {
                             p_space.m_iNumberOfCheckedLeaves++;
@@ -785,26 +897,25 @@ break;
                     }
                     else {
                         for (SizeType begin = tnode.childStart; begin < tnode.childEnd; begin++) {
-                            _mm_prefetch((const char*)(data[m_pTreeRoots[begin].centerid]), _MM_HINT_T0);
+                            _mm_prefetch((const char*)(data[p_trees.m_pTreeRoots[begin].centerid]), _MM_HINT_T0);
                         }
                         if (!p_space.CheckAndSet(tnode.centerid)) {
                             p_space.m_NGQueue.insert(NodeDistPair(tnode.centerid, bcell.distance));
                         }
                         for (SizeType begin = tnode.childStart; begin < tnode.childEnd; begin++) {
-                            SizeType index = m_pTreeRoots[begin].centerid;
+                            SizeType index = p_trees.m_pTreeRoots[begin].centerid;
                             p_space.m_SPTQueue.insert(NodeDistPair(begin, fComputeDistance(p_query.GetQuantizedTarget(), data[index], data.C())));
                         } 
                     }
                 }
             }
 
-        private:
-            std::vector<SizeType> m_pTreeStart;
-            std::vector<BKTNode> m_pTreeRoots;
-            std::unordered_map<SizeType, SizeType> m_pSampleCenterMap;
+            std::unique_ptr<TreeSet> m_trees;
+            std::atomic<const TreeSet*> m_published;
 
         public:
-            std::unique_ptr<std::shared_timed_mutex> m_lock;
+            // Locked exclusively by writers that change the index under the searches, such as a compaction.
+            std::unique_ptr<EpochManager> m_epoch;
             int m_iTreeNumber, m_iBKTKmeansK, m_iBKTLeafSize, m_iSamples, m_bfs;
             float m_fBalanceFactor;
             std::shared_ptr<SPTAG::COMMON::IQuantizer> m_pQuantizer;
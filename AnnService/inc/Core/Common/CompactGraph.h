@@ -0,0 +1,217 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_COMMON_COMPACTGRAPH_H_
+#define _SPTAG_COMMON_COMPACTGRAPH_H_
+
+#include "inc/Core/Common.h"
+#include "Dataset.h"
+
+#include <vector>
+
+namespace SPTAG
+{
+    namespace COMMON
+    {
+        // Read-only neighborhood graph with variable-length rows. Row i lives in m_data[m_offsets[i], m_offsets[i + 1])
+        // and starts with a header byte holding the id width (2, 3 or 4 bytes) and whether the row carries a BKT
+        // tree marker. The marker (the value kept in the last column of a fixed-size row) follows as a raw SizeType,
+        // then the neighbors: raw ids for width 4, otherwise signed little-endian deltas from i.
+        class CompactGraph
+        {
+        public:
+            // First SizeType of a saved compact graph; a fixed-size graph starts with its row count instead.
+            static const SizeType c_formatTag = -0x43475246;
+
+        private:
+            static const std::uint8_t c_widthMask = 0x07;
+            static const std::uint8_t c_hasMarker = 0x08;
+
+            SizeType m_rows = 0;
+            DimensionType m_cols = 0;
+            std::vector<std::uint64_t> m_offsets;
+            std::vector<std::uint8_t> m_data;
+
+            static inline int DeltaWidth(SizeType p_node, SizeType p_neighbor)
+            {
+                std::int64_t delta = (std::int64_t)p_neighbor - p_node;
+                if (delta >= -(1 << 15) && delta < (1 << 15)) return 2;
+                if (delta >= -(1 << 23) && delta < (1 << 23)) return 3;
+                return 4;
+            }
+
+        public:
+            CompactGraph() {}
+
+            // Packs a fixed-size graph; p_deltaCoding allows 16/24-bit rows when every neighbor is close enough to the node id.
+            void Build(const Dataset<SizeType>& p_graph, bool p_deltaCoding)
+            {
+                m_rows = p_graph.R();
+                m_cols = p_graph.C();
+                m_offsets.assign((size_t)m_rows + 1, 0);
+
+                std::vector<std::uint8_t> headers(m_rows);
+                for (SizeType i = 0; i < m_rows; i++)
+                {
+                    const SizeType* row = p_graph[i];
+                    bool hasMarker = row[m_cols - 1] < -1;
+                    DimensionType limit = hasMarker ? m_cols - 1 : m_cols;
+                    DimensionType count = 0;
+                    int width = p_deltaCoding ? 2 : 4;
+                    for (; count < limit && row[count] >= 0; count++) width = max(width, DeltaWidth(i, row[count]));
+
+                    headers[i] = (std::uint8_t)(width | (hasMarker ? c_hasMarker : 0));
+                    m_offsets[i + 1] = m_offsets[i] + 1 + (hasMarker ? sizeof(SizeType) : 0) + (std::uint64_t)count * width;
+                }
+
+                m_data.resize(m_offsets[m_rows]);
+                for (SizeType i = 0; i < m_rows; i++)
+                {
+                    const SizeType* row = p_graph[i];
+                    std::uint8_t* p = m_data.data() + m_offsets[i];
+                    std::uint8_t* end = m_data.data() + m_offsets[i + 1];
+                    int width = headers[i] & c_widthMask;
+                    *p++ = headers[i];
+                    if (headers[i] & c_hasMarker)
+                    {
+                        std::memcpy(p, row + m_cols - 1, sizeof(SizeType));
+                        p += sizeof(SizeType);
+                    }
+                    for (DimensionType j = 0; p < end; j++, p += width)
+                    {
+                        std::uint32_t v = (width == 4) ? (std::uint32_t)row[j] : (std::uint32_t)(row[j] - i);
+                        for (int b = 0; b < width; b++) p[b] = (std::uint8_t)(v >> (8 * b));
+                    }
+                }
+            }
+
+            // Writes the rows back into a fixed-size graph, padding with -1 and restoring tree markers.
+            void Expand(Dataset<SizeType>& p_graph, SizeType p_blockSize, SizeType p_capacity) const
+            {
+                p_graph.Initialize(m_rows, m_cols, p_blockSize, p_capacity);
+                std::vector<SizeType> buffer;
+                for (SizeType i = 0; i < m_rows; i++)
+                {
+                    const SizeType* row = Decode(i, buffer);
+                    SizeType* out = p_graph[i];
+                    for (DimensionType j = 0; j < m_cols && row[j] >= 0; j++) out[j] = row[j];
+                    out[m_cols - 1] = row[m_cols - 1];
+                }
+            }
+
+            // Decodes row p_index into p_buffer using the fixed-size row layout, so callers can walk it like a graph row.
+            inline const SizeType* Decode(SizeType p_index, std::vector<SizeType>& p_buffer) const
+            {
+                if (p_buffer.size() < (size_t)m_cols) p_buffer.resize(m_cols);
+
+                SizeType* out = p_buffer.data();
+                const std::uint8_t* p = m_data.data() + m_offsets[p_index];
+                const std::uint8_t* end = m_data.data() + m_offsets[p_index + 1];
+                std::uint8_t header = *p++;
+                SizeType marker = -1;
+                if (header & c_hasMarker)
+                {
+                    std::memcpy(&marker, p, sizeof(SizeType));
+                    p += sizeof(SizeType);
+                }
+
+                DimensionType count = 0;
+                switch (header & c_widthMask)
+                {
+                case 2:
+                    for (; p < end; p += 2) out[count++] = p_index + (std::int16_t)(p[0] | (p[1] << 8));
+                    break;
+                case 3:
+                    for (; p < end; p += 3)
+                    {
+                        std::int32_t delta = (std::int32_t)(p[0] | (p[1] << 8) | (p[2] << 16));
+                        out[count++] = p_index + ((delta ^ 0x800000) - 0x800000);
+                    }
+                    break;
+                default:
+                    count = (DimensionType)((end - p) / sizeof(SizeType));
+                    std::memcpy(out, p, end - p);
+                    break;
+                }
+
+                if (count < m_cols)
+                {
+                    out[count] = -1;
+                    out[m_cols - 1] = marker;
+                }
+                return out;
+            }
+
+            inline const void* RowAddress(SizeType p_index) const { return m_data.data() + m_offsets[p_index]; }
+
+            inline SizeType R() const { return m_rows; }
+
+            inline DimensionType C() const { return m_cols; }
+
+            inline std::uint64_t MemorySize() const { return sizeof(std::uint64_t) * m_offsets.size() + m_data.size(); }
+
+            inline std::uint64_t BufferSize() const
+            {
+                return sizeof(SizeType) * 2 + sizeof(DimensionType) + sizeof(std::uint64_t) * (m_offsets.size() + 1) + m_data.size();
+            }
+
+            ErrorCode Save(std::shared_ptr<Helper::DiskIO> p_out) const
+            {
+                SizeType tag = c_formatTag;
+                std::uint64_t bytes = m_data.size();
+                IOBINARY(p_out, WriteBinary, sizeof(SizeType), (char*)&tag);
+                IOBINARY(p_out, WriteBinary, sizeof(SizeType), (char*)&m_rows);
+                IOBINARY(p_out, WriteBinary, sizeof(DimensionType), (char*)&m_cols);
+                IOBINARY(p_out, WriteBinary, sizeof(std::uint64_t), (char*)&bytes);
+                IOBINARY(p_out, WriteBinary, sizeof(std::uint64_t) * m_offsets.size(), (char*)m_offsets.data());
+                if (bytes > 0) IOBINARY(p_out, WriteBinary, bytes, (char*)m_data.data());
+                return ErrorCode::Success;
+            }
+
+            // Reads everything after the format tag, which the caller has already consumed to detect the format.
+            ErrorCode Load(std::shared_ptr<Helper::DiskIO> p_input)
+            {
+                std::uint64_t bytes;
+                IOBINARY(p_input, ReadBinary, sizeof(SizeType), (char*)&m_rows);
+                IOBINARY(p_input, ReadBinary, sizeof(DimensionType), (char*)&m_cols);
+                IOBINARY(p_input, ReadBinary, sizeof(std::uint64_t), (char*)&bytes);
+                if (m_rows < 0 || m_cols <= 0) return ErrorCode::FailedParseValue;
+
+                m_offsets.resize((size_t)m_rows + 1);
+                m_data.resize(bytes);
+                IOBINARY(p_input, ReadBinary, sizeof(std::uint64_t) * m_offsets.size(), (char*)m_offsets.data());
+                if (bytes > 0) IOBINARY(p_input, ReadBinary, bytes, (char*)m_data.data());
+                if (m_offsets[m_rows] != bytes) return ErrorCode::FailedParseValue;
+                return ErrorCode::Success;
+            }
+
+            ErrorCode Load(char* p_memFile)
+            {
+                std::uint64_t bytes;
+                m_rows = *((SizeType*)p_memFile);
+                p_memFile += sizeof(SizeType);
+                m_cols = *((DimensionType*)p_memFile);
+                p_memFile += sizeof(DimensionType);
+                bytes = *((std::uint64_t*)p_memFile);
+                p_memFile += sizeof(std::uint64_t);
+                if (m_rows < 0 || m_cols <= 0) return ErrorCode::FailedParseValue;
+
+                std::uint64_t* offsets = (std::uint64_t*)p_memFile;
+                m_offsets.assign(offsets, offsets + (size_t)m_rows + 1);
+                p_memFile += sizeof(std::uint64_t) * m_offsets.size();
+                m_data.assign((std::uint8_t*)p_memFile, (std::uint8_t*)p_memFile + bytes);
+                if (m_offsets[m_rows] != bytes) return ErrorCode::FailedParseValue;
+                return ErrorCode::Success;
+            }
+
+            void Clear()
+            {
+                m_rows = 0;
+                std::vector<std::uint64_t>().swap(m_offsets);
+                std::vector<std::uint8_t>().swap(m_data);
+            }
+        };
+    }
+}
+
+#endif // _SPTAG_COMMON_COMPACTGRAPH_H_
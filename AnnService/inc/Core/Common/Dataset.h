@@ -5,6 +5,7 @@
 #define _SPTAG_COMMON_DATASET_H_
 
 #include "inc/Helper/Logging.h"
+#include "PageAllocator.h"
 #include <stdexcept>
 #include <sstream>
 
@@ -27,6 +28,7 @@ namespace SPTAG
             SizeType rowsInBlock;
             SizeType rowsInBlockEx;
             std::vector<T*> incBlocks;
+            HugePagePolicy pagePolicy = HugePagePolicy::None;
 
         public:
             Dataset() {}
@@ -37,8 +39,8 @@ namespace SPTAG
             }
             ~Dataset()
             {
-                if (ownData) ALIGN_FREE(data);
-                for (T* ptr : incBlocks) ALIGN_FREE(ptr);
+                if (ownData) PageAllocator::Free(data);
+                for (T* ptr : incBlocks) PageAllocator::Free(ptr);
                 incBlocks.clear();
             }
             void Initialize(SizeType rows_, DimensionType cols_, SizeType rowsInBlock_, SizeType capacity_, T* data_ = nullptr, bool shareOwnership_ = true)
@@ -49,7 +51,7 @@ namespace SPTAG
                 if (data_ == nullptr || !shareOwnership_)
                 {
                     ownData = true;
-                    data = (T*)ALIGN_ALLOC(((size_t)rows) * cols * sizeof(T));
+                    data = (T*)PageAllocator::Allocate(((size_t)rows) * cols * sizeof(T), pagePolicy);
                     if (data_ != nullptr) memcpy(data, data_, ((size_t)rows) * cols * sizeof(T));
                     else std::memset(data, -1, ((size_t)rows) * cols * sizeof(T));
                 }
@@ -58,8 +60,36 @@ namespace SPTAG
                 rowsInBlock = (1 << rowsInBlockEx) - 1;
                 incBlocks.reserve((static_cast<std::int64_t>(capacity_) + rowsInBlock) >> rowsInBlockEx);
             }
+            // Frees every row; the dataset stays empty until it is initialized or loaded again.
+            void Clear()
+            {
+                if (ownData) PageAllocator::Free(data);
+                for (T* ptr : incBlocks) PageAllocator::Free(ptr);
+                std::vector<T*>().swap(incBlocks);
+                data = nullptr;
+                ownData = false;
+                rows = 0;
+                incRows = 0;
+            }
+            // Exchanges the rows of two datasets; the names stay where they are.
+            void Swap(Dataset<T>& other)
+            {
+                std::swap(rows, other.rows);
+                std::swap(cols, other.cols);
+                std::swap(data, other.data);
+                std::swap(ownData, other.ownData);
+                std::swap(incRows, other.incRows);
+                std::swap(maxRows, other.maxRows);
+                std::swap(rowsInBlock, other.rowsInBlock);
+                std::swap(rowsInBlockEx, other.rowsInBlockEx);
+                incBlocks.swap(other.incBlocks);
+                std::swap(pagePolicy, other.pagePolicy);
+            }
             void SetName(const std::string& name_) { name = name_; }
             const std::string& Name() const { return name; }
+            // Applies to the blocks allocated from now on.
+            void SetHugePages(HugePagePolicy policy_) { pagePolicy = policy_; }
+            HugePagePolicy HugePages() const { return pagePolicy; }
 
             void SetR(SizeType R_)
             {
@@ -111,7 +141,7 @@ namespace SPTAG
                 while (written < num) {
                     SizeType curBlockIdx = ((incRows + written) >> rowsInBlockEx);
                     if (curBlockIdx >= (SizeType)incBlocks.size()) {
-                        T* newBlock = (T*)ALIGN_ALLOC(((size_t)rowsInBlock + 1) * cols * sizeof(T));
+                        T* newBlock = (T*)PageAllocator::Allocate(((size_t)rowsInBlock + 1) * cols * sizeof(T), pagePolicy);
                         if (newBlock == nullptr) return ErrorCode::MemoryOverFlow;
                         incBlocks.push_back(newBlock);
                     }
@@ -132,7 +162,7 @@ namespace SPTAG
                 while (written < num) {
                     SizeType curBlockIdx = (incRows + written) >> rowsInBlockEx;
                     if (curBlockIdx >= (SizeType)incBlocks.size()) {
-                        T* newBlock = (T*)ALIGN_ALLOC(sizeof(T) * (rowsInBlock + 1) * cols);
+                        T* newBlock = (T*)PageAllocator::Allocate(sizeof(T) * (rowsInBlock + 1) * cols, pagePolicy);
                         if (newBlock == nullptr) return ErrorCode::MemoryOverFlow;
                         std::memset(newBlock, -1, sizeof(T) * (rowsInBlock + 1) * cols);
                         incBlocks.push_back(newBlock);
@@ -206,13 +236,27 @@ namespace SPTAG
             ErrorCode Refine(const std::vector<SizeType>& indices, Dataset<T>& p_data) const
             {
                 SizeType R = (SizeType)(indices.size());
-                p_data.Initialize(R, cols, rowsInBlock + 1, static_cast<SizeType>(incBlocks.capacity() * (rowsInBlock + 1)));
+                p_data.Initialize(R, cols, rowsInBlock + 1, maxRows);
                 for (SizeType i = 0; i < R; i++) {
                     std::memcpy((void*)p_data.At(i), (void*)this->At(indices[i]), sizeof(T) * cols);
                 }
                 return ErrorCode::Success;
             }
 
+            // Rearranges the rows so that row i holds the former row indices[i].
+            ErrorCode Reorder(const std::vector<SizeType>& indices, SizeType blockSize, SizeType capacity)
+            {
+                if (indices.empty()) return ErrorCode::Success;
+
+                Dataset<T> reordered((SizeType)(indices.size()), cols, blockSize, capacity);
+                for (SizeType i = 0; i < reordered.R(); i++) {
+                    std::memcpy((void*)reordered.At(i), (void*)At(indices[i]), sizeof(T) * cols);
+                }
+                Clear();
+                Initialize((SizeType)(indices.size()), reordered.C(), blockSize, capacity, (T*)reordered.At(0), false);
+                return ErrorCode::Success;
+            }
+
             ErrorCode Refine(const std::vector<SizeType>& indices, std::shared_ptr<Helper::DiskIO> output) const
             {
                 SizeType R = (SizeType)(indices.size());
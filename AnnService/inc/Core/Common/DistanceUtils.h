@@ -6,6 +6,7 @@
 
 #include <functional>
 #include <iostream>
+#include <type_traits>
 
 #include "CommonUtils.h"
 #include "InstructionUtils.h"
@@ -17,7 +18,7 @@ namespace SPTAG
         template <typename T>
         using DistanceCalcReturn = float(*)(const T*, const T*, DimensionType);
         template<typename T>
-        inline DistanceCalcReturn<T> DistanceCalcSelector(SPTAG::DistCalcMethod p_method);
+        inline DistanceCalcReturn<T> DistanceCalcSelector(SPTAG::DistCalcMethod p_method, DimensionType p_dimension = 0);
 
         class DistanceUtils
         {
@@ -58,6 +59,15 @@ namespace SPTAG
             static float ComputeL2Distance_AVX(const float* pX, const float* pY, DimensionType length);
             static float ComputeL2Distance_AVX512(const float* pX, const float* pY, DimensionType length);
 
+            // AVX512-VNNI kernels exist for 8-bit types only; other types fall back to the AVX512 ones.
+            template <typename T>
+            static float ComputeL2Distance_AVX512VNNI(const T* pX, const T* pY, DimensionType length)
+            {
+                return ComputeL2Distance_AVX512(pX, pY, length);
+            }
+            static float ComputeL2Distance_AVX512VNNI(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512VNNI(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+
             template <typename T>
             static float ComputeCosineDistance(const T* pX, const T* pY, DimensionType length)
             {
@@ -94,11 +104,37 @@ namespace SPTAG
             static float ComputeCosineDistance_AVX(const float* pX, const float* pY, DimensionType length);
             static float ComputeCosineDistance_AVX512(const float* pX, const float* pY, DimensionType length);
 
+            template <typename T>
+            static float ComputeCosineDistance_AVX512VNNI(const T* pX, const T* pY, DimensionType length)
+            {
+                return ComputeCosineDistance_AVX512(pX, pY, length);
+            }
+            static float ComputeCosineDistance_AVX512VNNI(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
+            static float ComputeCosineDistance_AVX512VNNI(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+
+            // Float kernels for the dimensions listed by DefineFixedDimension. The block count is known at compile
+            // time, so the accumulation is fully unrolled and there is no tail loop; length is ignored.
+            template <DimensionType D>
+            static float ComputeL2Distance_AVX_Dim(const float* pX, const float* pY, DimensionType length);
+            template <DimensionType D>
+            static float ComputeL2Distance_AVX512_Dim(const float* pX, const float* pY, DimensionType length);
+            template <DimensionType D>
+            static float ComputeCosineDistance_AVX_Dim(const float* pX, const float* pY, DimensionType length);
+            template <DimensionType D>
+            static float ComputeCosineDistance_AVX512_Dim(const float* pX, const float* pY, DimensionType length);
+
+            // PQ4 fast-scan: scores a block of 32 codes with 16 centroids per subvector. pBlock holds numPairs rows
+            // of 32 bytes, byte j of row p packing subvector 2p of code j in the low nibble and subvector 2p + 1 in
+            // the high nibble. pLUT holds 16 uint8 distances per subvector, so a table is one pshufb register.
+            // Sums are exact in uint16 as long as the table entries times the subvector count stay below 65536.
+            static void ComputePQ4FastScan(const std::uint8_t* pLUT, const std::uint8_t* pBlock, DimensionType numPairs, std::uint16_t* pOut);
+            static void ComputePQ4FastScan_AVX(const std::uint8_t* pLUT, const std::uint8_t* pBlock, DimensionType numPairs, std::uint16_t* pOut);
+            static void ComputePQ4FastScan_AVX512(const std::uint8_t* pLUT, const std::uint8_t* pBlock, DimensionType numPairs, std::uint16_t* pOut);
 
             template<typename T>
             static inline float ComputeDistance(const T* p1, const T* p2, DimensionType length, SPTAG::DistCalcMethod distCalcMethod)
             {
-                auto func = DistanceCalcSelector<T>(distCalcMethod);
+                auto func = DistanceCalcSelector<T>(distCalcMethod, length);
                 return func(p1, p2, length);
             }
 
@@ -116,14 +152,53 @@ namespace SPTAG
             }
         };
         template<typename T>
-        inline DistanceCalcReturn<T> DistanceCalcSelector(SPTAG::DistCalcMethod p_method)
+        inline DistanceCalcReturn<T> FixedDimensionSelector(SPTAG::DistCalcMethod p_method, DimensionType p_dimension)
+        {
+            return nullptr;
+        }
+
+        template<>
+        inline DistanceCalcReturn<float> FixedDimensionSelector<float>(SPTAG::DistCalcMethod p_method, DimensionType p_dimension)
+        {
+            bool avx512 = InstructionSet::AVX512();
+            if (!avx512 && !InstructionSet::AVX()) return nullptr;
+
+            bool l2 = (p_method == SPTAG::DistCalcMethod::L2);
+            if (!l2 && p_method != SPTAG::DistCalcMethod::Cosine && p_method != SPTAG::DistCalcMethod::InnerProduct) return nullptr;
+
+            switch (p_dimension)
+            {
+#define DefineFixedDimension(D) \
+            case D: \
+                if (avx512) return l2 ? &(DistanceUtils::ComputeL2Distance_AVX512_Dim<D>) : &(DistanceUtils::ComputeCosineDistance_AVX512_Dim<D>); \
+                return l2 ? &(DistanceUtils::ComputeL2Distance_AVX_Dim<D>) : &(DistanceUtils::ComputeCosineDistance_AVX_Dim<D>); \
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineFixedDimension
+
+            default:
+                break;
+            }
+            return nullptr;
+        }
+
+        template<typename T>
+        inline DistanceCalcReturn<T> DistanceCalcSelector(SPTAG::DistCalcMethod p_method, DimensionType p_dimension)
         {
+            DistanceCalcReturn<T> fixed = FixedDimensionSelector<T>(p_method, p_dimension);
+            if (fixed != nullptr) return fixed;
+
+            bool isSize1 = (sizeof(T) == 1);
             bool isSize4 = (sizeof(T) == 4);
             switch (p_method)
             {
             case SPTAG::DistCalcMethod::InnerProduct:
             case SPTAG::DistCalcMethod::Cosine:
-                if (InstructionSet::AVX512())
+                if (isSize1 && InstructionSet::AVX512VNNI())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX512VNNI);
+                }
+                else if (InstructionSet::AVX512())
                 {
                     return &(DistanceUtils::ComputeCosineDistance_AVX512);
                 }
@@ -140,7 +215,11 @@ namespace SPTAG
                 }
 
             case SPTAG::DistCalcMethod::L2:
-                if (InstructionSet::AVX512())
+                if (isSize1 && InstructionSet::AVX512VNNI())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX512VNNI);
+                }
+                else if (InstructionSet::AVX512())
                 {
                     return &(DistanceUtils::ComputeL2Distance_AVX512);
                 }
@@ -161,6 +240,80 @@ namespace SPTAG
             }
             return nullptr;
         }
+
+        using PQ4FastScanReturn = void(*)(const std::uint8_t*, const std::uint8_t*, DimensionType, std::uint16_t*);
+
+        inline PQ4FastScanReturn PQ4FastScanSelector()
+        {
+            if (InstructionSet::AVX512()) return &(DistanceUtils::ComputePQ4FastScan_AVX512);
+            if (InstructionSet::AVX2()) return &(DistanceUtils::ComputePQ4FastScan_AVX);
+            return &(DistanceUtils::ComputePQ4FastScan);
+        }
+
+        // A distance kernel fixed at compile time. Search loops instantiated on it call the kernel
+        // directly instead of going through a std::function per candidate.
+        template <typename T, DistanceCalcReturn<T> Kernel>
+        struct StaticDistance
+        {
+            inline float operator()(const T* pX, const T* pY, DimensionType length) const
+            {
+                return Kernel(pX, pY, length);
+            }
+        };
+
+        template <typename T, DistanceCalcReturn<T> Kernel, typename F>
+        inline bool DispatchDistanceKernel(DistanceCalcReturn<T> p_kernel, F& p_func)
+        {
+            if (p_kernel != Kernel) return false;
+            p_func(StaticDistance<T, Kernel>());
+            return true;
+        }
+
+        template <typename T, typename F>
+        inline bool DispatchVNNIDistanceKernel(DistanceCalcReturn<T> p_kernel, F& p_func, std::true_type)
+        {
+            return DispatchDistanceKernel<T, &DistanceUtils::ComputeL2Distance_AVX512VNNI>(p_kernel, p_func) ||
+                DispatchDistanceKernel<T, &DistanceUtils::ComputeCosineDistance_AVX512VNNI>(p_kernel, p_func);
+        }
+
+        template <typename T, typename F>
+        inline bool DispatchVNNIDistanceKernel(DistanceCalcReturn<T>, F&, std::false_type)
+        {
+            return false;
+        }
+
+        // Any other plain kernel, called through the pointer.
+        template <typename T>
+        struct RuntimeDistance
+        {
+            DistanceCalcReturn<T> m_kernel;
+
+            inline float operator()(const T* pX, const T* pY, DimensionType length) const
+            {
+                return m_kernel(pX, pY, length);
+            }
+        };
+
+        // Calls p_func once with a StaticDistance when p_kernel is one of the AVX class kernels picked by
+        // DistanceCalcSelector, with a RuntimeDistance for the other kernels (SSE, scalar, fixed dimension)
+        // and with p_fallback when there is no plain kernel (quantized distances).
+        // Only the common kernels are listed to keep the number of search loop instantiations bounded.
+        template <typename T, typename Fallback, typename F>
+        inline void DistanceDispatch(DistanceCalcReturn<T> p_kernel, const Fallback& p_fallback, F&& p_func)
+        {
+            if (p_kernel == nullptr)
+            {
+                p_func(p_fallback);
+            }
+            else if (!DispatchVNNIDistanceKernel<T>(p_kernel, p_func, std::integral_constant<bool, sizeof(T) == 1>()) &&
+                !DispatchDistanceKernel<T, &DistanceUtils::ComputeL2Distance_AVX512>(p_kernel, p_func) &&
+                !DispatchDistanceKernel<T, &DistanceUtils::ComputeCosineDistance_AVX512>(p_kernel, p_func) &&
+                !DispatchDistanceKernel<T, &DistanceUtils::ComputeL2Distance_AVX>(p_kernel, p_func) &&
+                !DispatchDistanceKernel<T, &DistanceUtils::ComputeCosineDistance_AVX>(p_kernel, p_func))
+            {
+                p_func(RuntimeDistance<T>{ p_kernel });
+            }
+        }
     }
 }
 
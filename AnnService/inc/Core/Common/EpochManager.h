@@ -0,0 +1,170 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_COMMON_EPOCHMANAGER_H_
+#define _SPTAG_COMMON_EPOCHMANAGER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+namespace SPTAG
+{
+    namespace COMMON
+    {
+        // Lets readers use a published structure without taking a lock. A reader is counted under the current
+        // epoch from Enter to Leave; a writer that has published a replacement calls Synchronize, which moves to
+        // the next epoch and waits for the readers counted under the previous one, after which nobody can still
+        // hold the old structure. Writers that change the structure in place lock the manager instead, which
+        // keeps new readers waiting and drains the current ones. The thread holding the lock may still read:
+        // it already excludes everyone else, so its Enter neither counts nor waits. Reads nest: an Enter by a
+        // thread that is already counted rides on its outer read, so it cannot wait behind a writer that is
+        // itself waiting for that read.
+        class EpochManager
+        {
+        public:
+            EpochManager() : m_epoch(0), m_exclusive(false), m_owner(std::thread::id()), m_slots(new Slot[SlotCount]) {
+                for (int i = 0; i < SlotCount; i++) m_slots[i].m_count[0] = m_slots[i].m_count[1] = 0;
+            }
+            ~EpochManager() {}
+
+            // Returns the token to hand back to Leave.
+            int Enter()
+            {
+                if (m_owner.load() == std::this_thread::get_id()) return OwnerToken;
+
+                std::vector<OpenRead>& reads = OpenReads();
+                for (OpenRead& read : reads)
+                {
+                    if (read.m_manager == this)
+                    {
+                        read.m_depth++;
+                        return read.m_token;
+                    }
+                }
+
+                int slot = ThreadSlot();
+                while (true)
+                {
+                    unsigned epoch = m_epoch.load();
+                    int token = slot * 2 + (epoch & 1);
+                    m_slots[slot].m_count[epoch & 1].fetch_add(1);
+                    // Counted under an epoch that has already been left behind, this reader could outlive the wait of the next writer.
+                    if (m_epoch.load() == epoch && !m_exclusive.load())
+                    {
+                        reads.push_back({ this, token, 1 });
+                        return token;
+                    }
+
+                    m_slots[slot].m_count[epoch & 1].fetch_sub(1);
+                    if (m_exclusive.load())
+                    {
+                        std::shared_lock<std::shared_timed_mutex> wait(m_exclusiveLock);
+                    }
+                }
+            }
+
+            void Leave(int p_token)
+            {
+                if (p_token == OwnerToken) return;
+
+                std::vector<OpenRead>& reads = OpenReads();
+                for (auto it = reads.begin(); it != reads.end(); ++it)
+                {
+                    if (it->m_manager != this) continue;
+                    if (--it->m_depth > 0) return;
+                    reads.erase(it);
+                    break;
+                }
+                m_slots[p_token / 2].m_count[p_token & 1].fetch_sub(1, std::memory_order_release);
+            }
+
+            // Serializes the writers that publish through Synchronize. A locked manager holds it as well.
+            std::unique_lock<std::mutex> LockWriters()
+            {
+                return std::unique_lock<std::mutex>(m_writerLock);
+            }
+
+            // Call with the writers locked, after the new structure is visible to Enter.
+            void Synchronize()
+            {
+                unsigned epoch = m_epoch.fetch_add(1);
+                WaitForReaders(epoch & 1);
+            }
+
+            void lock()
+            {
+                m_writerLock.lock();
+                m_exclusiveLock.lock();
+                m_exclusive = true;
+                m_owner = std::this_thread::get_id();
+                WaitForReaders(0);
+                WaitForReaders(1);
+            }
+
+            void unlock()
+            {
+                m_owner = std::thread::id();
+                m_exclusive = false;
+                m_exclusiveLock.unlock();
+                m_writerLock.unlock();
+            }
+
+        private:
+            static const int SlotCount = 64;
+            static const int OwnerToken = -1;
+
+            // One cache line per slot, so readers on different threads do not bounce each other's counters.
+            struct Slot
+            {
+                std::atomic<std::int64_t> m_count[2];
+                char m_padding[64 - 2 * sizeof(std::atomic<std::int64_t>)];
+            };
+
+            // The managers this thread reads from, with the token of the outermost Enter and the nesting depth.
+            struct OpenRead
+            {
+                const EpochManager* m_manager;
+                int m_token;
+                int m_depth;
+            };
+
+            static std::vector<OpenRead>& OpenReads()
+            {
+                thread_local std::vector<OpenRead> reads;
+                return reads;
+            }
+
+            static int ThreadSlot()
+            {
+                static std::atomic<unsigned> next(0);
+                thread_local int slot = (int)(next++ % SlotCount);
+                return slot;
+            }
+
+            // The loads pair with the store of m_epoch or m_exclusive before them and the fetch_add and loads in
+            // Enter: either the writer sees the reader's count or the reader sees the writer, which takes seq_cst
+            // on both sides.
+            void WaitForReaders(int p_parity) const
+            {
+                for (int i = 0; i < SlotCount; i++)
+                {
+                    while (m_slots[i].m_count[p_parity].load(std::memory_order_seq_cst) != 0) std::this_thread::yield();
+                }
+            }
+
+            std::atomic<unsigned> m_epoch;
+            std::atomic<bool> m_exclusive;
+            std::atomic<std::thread::id> m_owner;
+            std::unique_ptr<Slot[]> m_slots;
+            std::mutex m_writerLock;
+            std::shared_timed_mutex m_exclusiveLock;
+        };
+    }
+}
+
+#endif // _SPTAG_COMMON_EPOCHMANAGER_H_
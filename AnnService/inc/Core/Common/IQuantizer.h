@@ -20,6 +20,18 @@ namespace SPTAG
 
             virtual float CosineDistance(const std::uint8_t* pX, const std::uint8_t* pY) const = 0;
 
+            // Number of codes search loops hand to L2DistanceBatch at a time.
+            static const int c_batchSize = 32;
+
+            // L2 distances from a quantized query to count codes. Quantizers with a block kernel override this.
+            virtual void L2DistanceBatch(const std::uint8_t* pX, const std::uint8_t* const* pY, SizeType count, float* pOut) const
+            {
+                for (SizeType i = 0; i < count; i++) pOut[i] = L2Distance(pX, pY[i]);
+            }
+
+            // True when L2DistanceBatch is faster than scoring the codes one by one.
+            virtual bool FastScanEnabled() const { return false; }
+
             template <typename T>
             std::function<float(const T*, const T*, SizeType)> DistanceCalcSelector(SPTAG::DistCalcMethod p_method) const;
 
@@ -62,6 +74,19 @@ namespace SPTAG
             template<typename T>
             T* GetCodebooks();
         };
+
+        // Distance passed to the search loops when the quantizer has fast scan enabled. Single distances go
+        // through L2Distance; the graph expansion recognizes the type and scores neighbor lists in blocks.
+        template <typename T>
+        struct QuantizerBatchDistance
+        {
+            const IQuantizer* m_quantizer;
+
+            inline float operator()(const T* pX, const T* pY, DimensionType) const
+            {
+                return m_quantizer->L2Distance((const std::uint8_t*)pX, (const std::uint8_t*)pY);
+            }
+        };
     }
 }
 
@@ -37,6 +37,7 @@ namespace SPTAG {
             static bool SSE2(void);
             static bool AVX2(void);
             static bool AVX512(void);
+            static bool AVX512VNNI(void);
             static void PrintInstructionSet(void);
 
         private:
@@ -51,6 +52,7 @@ namespace SPTAG {
                 bool HW_AVX;
                 bool HW_AVX2;
                 bool HW_AVX512;
+                bool HW_AVX512VNNI;
             };
         };
     }
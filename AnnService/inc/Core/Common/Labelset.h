@@ -5,12 +5,15 @@
 #define _SPTAG_COMMON_LABELSET_H_
 
 #include <atomic>
+#include <cassert>
 #include "Dataset.h"
 
 namespace SPTAG
 {
     namespace COMMON
     {
+        // Labels are kept as one bit per vector in blocks of 64-bit words. The on-disk layout is
+        // still the Dataset<std::int8_t> one (a byte of 1 per labeled vector), so existing indices load unchanged.
         class Labelset
         {
         public:
@@ -21,56 +24,152 @@ namespace SPTAG
                 AlwaysNotContains
             };
         private:
+            static const int c_wordBitsEx = 6;
+            static const SizeType c_wordBits = (1 << c_wordBitsEx) - 1;
+
             std::atomic<SizeType> m_inserted;
-            Dataset<std::int8_t> m_data;
+            SizeType m_rows = 0;
+            SizeType m_maxRows = 0;
+            SizeType m_wordsInBlock = 0;
+            SizeType m_wordsInBlockEx = 0;
+            std::vector<std::uint64_t*> m_blocks;
+            std::string m_name;
             InvalidIDBehavior m_invalidIDBehaviorSetting;
-            
+            HugePagePolicy m_pagePolicy = HugePagePolicy::None;
+
+            inline std::uint64_t* Word(SizeType key) const
+            {
+                SizeType word = (key >> c_wordBitsEx);
+                return m_blocks[word >> m_wordsInBlockEx] + (word & m_wordsInBlock);
+            }
+
+            inline bool InvalidIDContains(const SizeType& key) const
+            {
+                switch (m_invalidIDBehaviorSetting)
+                {
+                    case InvalidIDBehavior::AlwaysContains:
+                        return true;
+                    case InvalidIDBehavior::AlwaysNotContains:
+                        return false;
+                    default:
+                        break;
+                }
+                std::ostringstream oss;
+                oss << "Index out of range in Labelset. Index: " << key << " Size: " << R();
+                throw std::out_of_range(oss.str());
+            }
+
+            ErrorCode Reserve(SizeType rows)
+            {
+                SizeType words = (rows + c_wordBits) >> c_wordBitsEx;
+                while (((SizeType)m_blocks.size() << m_wordsInBlockEx) < words) {
+                    std::uint64_t* newBlock = (std::uint64_t*)PageAllocator::Allocate(sizeof(std::uint64_t) * (m_wordsInBlock + 1), m_pagePolicy);
+                    if (newBlock == nullptr) return ErrorCode::MemoryOverFlow;
+                    std::memset(newBlock, 0, sizeof(std::uint64_t) * (m_wordsInBlock + 1));
+                    m_blocks.push_back(newBlock);
+                }
+                return ErrorCode::Success;
+            }
+
+            void Clear()
+            {
+                for (std::uint64_t* ptr : m_blocks) PageAllocator::Free(ptr);
+                m_blocks.clear();
+                m_rows = 0;
+            }
+
+            void InitBlocks(SizeType blockSize, SizeType capacity)
+            {
+                Clear();
+                m_maxRows = capacity;
+                m_wordsInBlockEx = static_cast<SizeType>(ceil(log2(max(blockSize >> c_wordBitsEx, 1))));
+                m_wordsInBlock = (1 << m_wordsInBlockEx) - 1;
+                m_blocks.reserve(((static_cast<std::int64_t>(capacity) >> c_wordBitsEx) + m_wordsInBlock + 1) >> m_wordsInBlockEx);
+            }
+
         public:
             Labelset()
             {
                 m_inserted = 0;
-                m_data.SetName("DeleteID");
+                m_name = "DeleteID";
+            }
+
+            ~Labelset()
+            {
+                Clear();
             }
 
             void Initialize(SizeType size, SizeType blockSize, SizeType capacity, InvalidIDBehavior invalidIDBehaviorSetting = InvalidIDBehavior::Passthrough)
             {
                 m_invalidIDBehaviorSetting = invalidIDBehaviorSetting;
-                m_data.Initialize(size, 1, blockSize, capacity);
+                m_inserted = 0;
+                InitBlocks(blockSize, max(capacity, size));
+                if (Reserve(size) == ErrorCode::Success) m_rows = size;
             }
 
             inline size_t Count() const { return m_inserted.load(); }
 
+            inline void SetHugePages(HugePagePolicy policy) { m_pagePolicy = policy; }
+
+            // Exchanges the labels of two sets; the names stay where they are.
+            void Swap(Labelset& other)
+            {
+                m_inserted = other.m_inserted.exchange(m_inserted.load());
+                std::swap(m_rows, other.m_rows);
+                std::swap(m_maxRows, other.m_maxRows);
+                std::swap(m_wordsInBlock, other.m_wordsInBlock);
+                std::swap(m_wordsInBlockEx, other.m_wordsInBlockEx);
+                m_blocks.swap(other.m_blocks);
+                std::swap(m_invalidIDBehaviorSetting, other.m_invalidIDBehaviorSetting);
+                std::swap(m_pagePolicy, other.m_pagePolicy);
+            }
+
             inline bool Contains(const SizeType& key) const
             {
-                if (key >= R())
+                if (key >= R() || key < 0) return InvalidIDContains(key);
+
+                return ((*Word(key) >> (key & c_wordBits)) & 1) != 0;
+            }
+
+            // Tests up to c_maskKeys keys at once; bit i of the result is Contains(p_keys[i]). All the words are
+            // loaded first so the misses overlap, then the bits are picked out of them.
+            static const int c_maskKeys = 64;
+
+            inline std::uint64_t ContainsMask(const SizeType* p_keys, int p_count) const
+            {
+                assert(p_count <= c_maskKeys);
+                p_count = min(p_count, (int)c_maskKeys);
+
+                std::uint64_t words[c_maskKeys];
+                int shifts[c_maskKeys];
+                SizeType rows = R();
+                for (int i = 0; i < p_count; i++)
                 {
-                    switch (m_invalidIDBehaviorSetting)
+                    SizeType key = p_keys[i];
+                    if (key < rows && key >= 0)
                     {
-                        case InvalidIDBehavior::AlwaysContains:
-                            return true;
-                        case InvalidIDBehavior::AlwaysNotContains:
-                            return false;
+                        words[i] = *Word(key);
+                        shifts[i] = (int)(key & c_wordBits);
+                    }
+                    else
+                    {
+                        words[i] = InvalidIDContains(key) ? 1 : 0;
+                        shifts[i] = 0;
                     }
                 }
 
-                return *m_data[key] == 1;
+                std::uint64_t mask = 0;
+                for (int i = 0; i < p_count; i++) mask |= ((words[i] >> shifts[i]) & 1) << i;
+                return mask;
             }
 
             inline bool Insert(const SizeType& key)
             {
-                if (key >= R())
-                {
-                    switch (m_invalidIDBehaviorSetting)
-                    {
-                        case InvalidIDBehavior::AlwaysContains:
-                            return true;
-                        case InvalidIDBehavior::AlwaysNotContains:
-                            return false;
-                    }
-                }
+                if (key >= R() || key < 0) return InvalidIDContains(key);
 
-                char oldvalue = InterlockedExchange8((char*)m_data[key], 1);
-                if (oldvalue == 1) return false;
+                std::uint64_t bit = ((std::uint64_t)1 << (key & c_wordBits));
+                std::uint64_t oldvalue = (std::uint64_t)InterlockedOr64((long long*)Word(key), (long long)bit);
+                if (oldvalue & bit) return false;
                 m_inserted++;
                 return true;
             }
@@ -78,13 +177,26 @@ namespace SPTAG
             inline ErrorCode Save(std::shared_ptr<Helper::DiskIO> output)
             {
                 SizeType deleted = m_inserted.load();
+                SizeType rows = R();
+                DimensionType cols = 1;
                 IOBINARY(output, WriteBinary, sizeof(SizeType), (char*)&deleted);
-                return m_data.Save(output);
+                IOBINARY(output, WriteBinary, sizeof(SizeType), (char*)&rows);
+                IOBINARY(output, WriteBinary, sizeof(DimensionType), (char*)&cols);
+
+                std::vector<std::int8_t> buf(((std::size_t)m_wordsInBlock + 1) << c_wordBitsEx);
+                for (SizeType begin = 0; begin < rows; begin += (SizeType)buf.size())
+                {
+                    SizeType num = min((SizeType)buf.size(), rows - begin);
+                    for (SizeType i = 0; i < num; i++) buf[i] = Contains(begin + i) ? 1 : -1;
+                    IOBINARY(output, WriteBinary, sizeof(std::int8_t) * num, (char*)buf.data());
+                }
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Save %s (%d,%d) Finish!\n", m_name.c_str(), rows, cols);
+                return ErrorCode::Success;
             }
 
             inline ErrorCode Save(std::string filename)
             {
-                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Save %s To %s\n", m_data.Name().c_str(), filename.c_str());
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Save %s To %s\n", m_name.c_str(), filename.c_str());
                 auto ptr = f_createIO();
                 if (ptr == nullptr || !ptr->Initialize(filename.c_str(), std::ios::binary | std::ios::out)) return ErrorCode::FailedCreateFile;
                 return Save(ptr);
@@ -93,15 +205,34 @@ namespace SPTAG
             inline ErrorCode Load(std::shared_ptr<Helper::DiskIO> input, SizeType blockSize, SizeType capacity, InvalidIDBehavior invalidIDBehaviorSetting = InvalidIDBehavior::Passthrough)
             {
                 m_invalidIDBehaviorSetting = invalidIDBehaviorSetting;
-                SizeType deleted;
+                SizeType deleted, rows;
+                DimensionType cols;
                 IOBINARY(input, ReadBinary, sizeof(SizeType), (char*)&deleted);
+                IOBINARY(input, ReadBinary, sizeof(SizeType), (char*)&rows);
+                IOBINARY(input, ReadBinary, sizeof(DimensionType), (char*)&cols);
+                if (cols != 1) return ErrorCode::FailedParseValue;
+
+                InitBlocks(blockSize, max(capacity, rows));
+                ErrorCode ret = Reserve(rows);
+                if (ret != ErrorCode::Success) return ret;
+
+                std::vector<std::int8_t> buf(((std::size_t)m_wordsInBlock + 1) << c_wordBitsEx);
+                for (SizeType begin = 0; begin < rows; begin += (SizeType)buf.size())
+                {
+                    SizeType num = min((SizeType)buf.size(), rows - begin);
+                    IOBINARY(input, ReadBinary, sizeof(std::int8_t) * num, (char*)buf.data());
+                    for (SizeType i = 0; i < num; i++)
+                        if (buf[i] == 1) *Word(begin + i) |= ((std::uint64_t)1 << ((begin + i) & c_wordBits));
+                }
+                m_rows = rows;
                 m_inserted = deleted;
-                return m_data.Load(input, blockSize, capacity);
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Load %s (%d,%d) Finish!\n", m_name.c_str(), rows, cols);
+                return ErrorCode::Success;
             }
 
             inline ErrorCode Load(std::string filename, SizeType blockSize, SizeType capacity, InvalidIDBehavior invalidIDBehaviorSetting = InvalidIDBehavior::Passthrough)
             {
-                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Load %s From %s\n", m_data.Name().c_str(), filename.c_str());
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Load %s From %s\n", m_name.c_str(), filename.c_str());
                 auto ptr = f_createIO();
                 if (ptr == nullptr || !ptr->Initialize(filename.c_str(), std::ios::binary | std::ios::in)) return ErrorCode::FailedOpenFile;
                 return Load(ptr, blockSize, capacity, invalidIDBehaviorSetting);
@@ -110,28 +241,61 @@ namespace SPTAG
             inline ErrorCode Load(char* pmemoryFile, SizeType blockSize, SizeType capacity, InvalidIDBehavior invalidIDBehaviorSetting = InvalidIDBehavior::Passthrough)
             {
                 m_invalidIDBehaviorSetting = invalidIDBehaviorSetting;
-                m_inserted = *((SizeType*)pmemoryFile);
-                return m_data.Load(pmemoryFile + sizeof(SizeType), blockSize, capacity);
+                SizeType deleted = *((SizeType*)pmemoryFile);
+                pmemoryFile += sizeof(SizeType);
+                SizeType rows = *((SizeType*)pmemoryFile);
+                pmemoryFile += sizeof(SizeType);
+                DimensionType cols = *((DimensionType*)pmemoryFile);
+                pmemoryFile += sizeof(DimensionType);
+                if (cols != 1) return ErrorCode::FailedParseValue;
+
+                InitBlocks(blockSize, max(capacity, rows));
+                ErrorCode ret = Reserve(rows);
+                if (ret != ErrorCode::Success) return ret;
+
+                const std::int8_t* flags = (const std::int8_t*)pmemoryFile;
+                for (SizeType i = 0; i < rows; i++)
+                    if (flags[i] == 1) *Word(i) |= ((std::uint64_t)1 << (i & c_wordBits));
+                m_rows = rows;
+                m_inserted = deleted;
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Load %s (%d,%d) Finish!\n", m_name.c_str(), rows, cols);
+                return ErrorCode::Success;
             }
 
             inline ErrorCode AddBatch(SizeType num)
             {
-                return m_data.AddBatch(num);
+                if (R() > m_maxRows - num) return ErrorCode::MemoryOverFlow;
+
+                ErrorCode ret = Reserve(R() + num);
+                if (ret != ErrorCode::Success) return ret;
+                m_rows += num;
+                return ErrorCode::Success;
             }
 
-            inline std::uint64_t BufferSize() const 
+            inline std::uint64_t BufferSize() const
             {
-                return m_data.BufferSize() + sizeof(SizeType);
+                return sizeof(SizeType) + sizeof(SizeType) + sizeof(DimensionType) + sizeof(std::int8_t) * R();
             }
 
             inline void SetR(SizeType num)
             {
-                m_data.SetR(num);
+                if (num >= R())
+                {
+                    if (Reserve(num) == ErrorCode::Success) m_rows = num;
+                    return;
+                }
+
+                // Drop labels of truncated rows so that rows added again later start unlabeled.
+                for (SizeType i = num; i < R() && (i & c_wordBits) != 0; i++)
+                    *Word(i) &= ~((std::uint64_t)1 << (i & c_wordBits));
+                for (SizeType i = ((num + c_wordBits) & ~c_wordBits); i < R(); i += c_wordBits + 1)
+                    *Word(i) = 0;
+                m_rows = num;
             }
 
             inline SizeType R() const
             {
-                return m_data.R();
+                return m_rows;
             }
         };
     }
@@ -7,9 +7,11 @@
 #include "inc/Core/VectorIndex.h"
 
 #include "CommonUtils.h"
+#include "CompactGraph.h"
 #include "Dataset.h"
 #include "FineGrainedLock.h"
 #include "QueryResultSet.h"
+#include "inc/Helper/TaskScheduler.h"
 
 #include <chrono>
 #include <queue>
@@ -65,8 +67,7 @@ namespace SPTAG
             {
                 DimensionType* correct = new DimensionType[samples];
 
-#pragma omp parallel for schedule(dynamic)
-                for (SizeType i = 0; i < samples; i++)
+                Helper::TaskScheduler::Instance().ParallelFor(0, samples, index->GetNumThreads(), [&](SizeType i)
                 {
                     SizeType x = COMMON::Utils::rand(m_iGraphSize);
                     //int x = i;
@@ -74,7 +75,7 @@ namespace SPTAG
                     for (SizeType y = 0; y < m_iGraphSize; y++)
                     {
                         if ((idmap != nullptr && idmap->find(y) != idmap->end())) continue;
-                        float dist = index->ComputeDistance(index->GetSample(x), index->GetSample(y));
+                        float dist = index->ComputeDistance(index->GetVertexSample(x), index->GetVertexSample(y));
                         query.AddPoint(y, dist);
                     }
                     query.SortResult();
@@ -94,7 +95,7 @@ namespace SPTAG
                             }
                     }
                     delete[] exact_rng;
-                }
+                });
                 float acc = 0;
                 for (SizeType i = 0; i < samples; i++) acc += float(correct[i]);
                 acc = acc / samples / m_iNeighborhoodSize;
@@ -170,14 +171,14 @@ break;
                         if (quantizer_exists) {
                             cols = index->m_pQuantizer->ReconstructDim();
                             indices_vectors.reset(new BasicVectorSet(ByteArray::Alloc(sizeof(R) * cols * count), GetEnumValueType<R>(), cols, count));
-                            for (int i = 0; i < count; i++) index->m_pQuantizer->ReconstructVector((uint8_t*)index->GetSample(indices[first + i]), indices_vectors->GetVector(i));
+                            for (int i = 0; i < count; i++) index->m_pQuantizer->ReconstructVector((uint8_t*)index->GetVertexSample(indices[first + i]), indices_vectors->GetVector(i));
                         }
 
                         std::vector<float> Mean(cols, 0);
                         // calculate the mean of each dimension
                         for (SizeType j = first; j <= end; j++)
                         {
-                            R* v = (quantizer_exists) ? (R*)indices_vectors->GetVector(j - first) : (R*)index->GetSample(indices[j]);
+                            R* v = (quantizer_exists) ? (R*)indices_vectors->GetVector(j - first) : (R*)index->GetVertexSample(indices[j]);
                             for (DimensionType k = 0; k < cols; k++)
                             {
                                 Mean[k] += v[k];
@@ -195,7 +196,7 @@ break;
                         // calculate the variance of each dimension
                         for (SizeType j = first; j <= end; j++)
                         {
-                            R* v = (quantizer_exists) ? (R*)indices_vectors->GetVector(j - first) : (R*)index->GetSample(indices[j]);
+                            R* v = (quantizer_exists) ? (R*)indices_vectors->GetVector(j - first) : (R*)index->GetVertexSample(indices[j]);
                             for (DimensionType k = 0; k < cols; k++)
                             {
                                 float dist = v[k] - Mean[k];
@@ -233,7 +234,7 @@ break;
                             for (SizeType j = 0; j < count; j++)
                             {
                                 Val[j] = 0;
-                                R* v = (quantizer_exists) ? (R*)indices_vectors->GetVector(j) : (R*)index->GetSample(indices[first + j]);
+                                R* v = (quantizer_exists) ? (R*)indices_vectors->GetVector(j) : (R*)index->GetVertexSample(indices[first + j]);
                                 for (int k = 0; k < m_numTopDimensionTPTSplit; k++)
                                 {
                                     Val[j] += weight[k] * v[indexs[k]];
@@ -263,7 +264,7 @@ break;
                         while (i <= j)
                         {
                             float val = 0;
-                            R* v = (quantizer_exists) ? (R*)indices_vectors->GetVector(i - first) : (R*)index->GetSample(indices[i]);
+                            R* v = (quantizer_exists) ? (R*)indices_vectors->GetVector(i - first) : (R*)index->GetVertexSample(indices[i]);
                             for (int k = 0; k < m_numTopDimensionTPTSplit; k++)
                             {
                                 val += bestweight[k] * v[indexs[k]];
@@ -312,23 +313,21 @@ break;
 
                 auto t1 = std::chrono::high_resolution_clock::now();
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Parallel TpTree Partition begin\n");
-#pragma omp parallel for schedule(dynamic)
-                for (int i = 0; i < m_iTPTNumber; i++)
+                Helper::TaskScheduler::Instance().ParallelFor(0, m_iTPTNumber, index->GetNumThreads(), [&](SizeType i)
                 {
                     Sleep(i * 100); std::srand(clock());
                     for (SizeType j = 0; j < m_iGraphSize; j++) TptreeDataIndices[i][j] = j;
                     std::shuffle(TptreeDataIndices[i].begin(), TptreeDataIndices[i].end(), rg);
                     PartitionByTptree<T>(index, TptreeDataIndices[i], 0, m_iGraphSize - 1, TptreeLeafNodes[i]);
                     SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Finish Getting Leaves for Tree %d\n", i);
-                }
+                });
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Parallel TpTree Partition done\n");
                 auto t2 = std::chrono::high_resolution_clock::now();
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Build TPTree time (s): %lld\n", std::chrono::duration_cast<std::chrono::seconds>(t2 - t1).count());
 
                 for (int i = 0; i < m_iTPTNumber; i++)
                 {
-#pragma omp parallel for schedule(dynamic)
-                    for (SizeType j = 0; j < (SizeType)TptreeLeafNodes[i].size(); j++)
+                    Helper::TaskScheduler::Instance().ParallelFor(0, (SizeType)TptreeLeafNodes[i].size(), index->GetNumThreads(), [&](SizeType j)
                     {
                         SizeType start_index = TptreeLeafNodes[i][j].first;
                         SizeType end_index = TptreeLeafNodes[i][j].second;
@@ -339,7 +338,7 @@ break;
                             {
                                 SizeType p1 = TptreeDataIndices[i][x];
                                 SizeType p2 = TptreeDataIndices[i][y];
-                                float dist = index->ComputeDistance(index->GetSample(p1), index->GetSample(p2));
+                                float dist = index->ComputeDistance(index->GetVertexSample(p1), index->GetVertexSample(p2));
                                 if (idmap != nullptr) {
                                     p1 = (idmap->find(p1) == idmap->end()) ? p1 : idmap->at(p1);
                                     p2 = (idmap->find(p2) == idmap->end()) ? p2 : idmap->at(p2);
@@ -348,7 +347,7 @@ break;
                                 COMMON::Utils::AddNeighbor(p1, dist, (m_pNeighborhoodGraph)[p2], (NeighborhoodDists)[p2], m_iNeighborhoodSize);
                             }
                         }
-                    }
+                    });
                     TptreeDataIndices[i].clear();
                     TptreeLeafNodes[i].clear();
                 }
@@ -367,6 +366,8 @@ break;
 
                 m_iGraphSize = index->GetNumSamples();
                 m_iNeighborhoodSize = (DimensionType)(ceil(m_iNeighborhoodSize * m_fNeighborhoodScale) * (m_rebuild + 1));
+                m_compactGraph.Clear();
+                m_bCompact = false;
                 m_pNeighborhoodGraph.Initialize(m_iGraphSize, m_iNeighborhoodSize, index->m_iDataBlockSize, index->m_iDataCapacity);
 
                 if (m_iGraphSize < 1000) {
@@ -406,12 +407,10 @@ break;
             {
                 std::vector<int> indegree(m_iGraphSize);
 
-#pragma omp parallel for schedule(dynamic)
-                for (SizeType i = 0; i < m_iGraphSize; i++) indegree[i] = 0;
+                Helper::TaskScheduler::Instance().ParallelFor(0, m_iGraphSize, index->GetNumThreads(), [&](SizeType i) { indegree[i] = 0; });
 
                 auto t0 = std::chrono::high_resolution_clock::now();
-#pragma omp parallel for schedule(dynamic)
-                for (SizeType i = 0; i < m_iGraphSize; i++)
+                Helper::TaskScheduler::Instance().ParallelFor(0, m_iGraphSize, index->GetNumThreads(), [&](SizeType i)
                 {
                     SizeType* outnodes = m_pNeighborhoodGraph[i];
                     for (SizeType j = 0; j < m_iNeighborhoodSize; j++)
@@ -421,13 +420,12 @@ break;
                             indegree[node]++;
                         }
                     }
-                }
+                });
                 auto t1 = std::chrono::high_resolution_clock::now();
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Calculate Indegree time (s): %lld\n", std::chrono::duration_cast<std::chrono::seconds>(t1 - t0).count());
                 int rebuild_threshold = m_iNeighborhoodSize / 2;
                 int rebuildstart = m_iNeighborhoodSize / 2;
-#pragma omp parallel for schedule(dynamic)
-                for (SizeType i = 0; i < m_iGraphSize; i++)
+                Helper::TaskScheduler::Instance().ParallelFor(0, m_iGraphSize, index->GetNumThreads(), [&](SizeType i)
                 {
                     SizeType* outnodes = m_pNeighborhoodGraph[i];
                     std::vector<bool> reserve(2 * m_iNeighborhoodSize, false);
@@ -452,7 +450,7 @@ break;
                         z++;
                     }
                     if ((i * 5) % m_iGraphSize == 0) SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Rebuild %d%%\n", static_cast<int>(i * 1.0 / m_iGraphSize * 100));
-                }
+                });
                 auto t2 = std::chrono::high_resolution_clock::now();
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Rebuild RNG time (s): %lld Graph Acc: %f\n", std::chrono::duration_cast<std::chrono::seconds>(t2 - t1).count(), GraphAccuracyEstimation(index, 100, idmap));
             }
@@ -463,12 +461,11 @@ break;
                 for (int iter = 0; iter < m_iRefineIter - 1; iter++)
                 {
                     auto t1 = std::chrono::high_resolution_clock::now();
-#pragma omp parallel for schedule(dynamic)
-                    for (SizeType i = 0; i < m_iGraphSize; i++)
+                    Helper::TaskScheduler::Instance().ParallelFor(0, m_iGraphSize, index->GetNumThreads(), [&](SizeType i)
                     {
                         RefineNode<T>(index, i, false, false, (int)(m_iCEF * m_fCEFScale));
                         if ((i * 5) % m_iGraphSize == 0) SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Refine %d %d%%\n", iter, static_cast<int>(i * 1.0 / m_iGraphSize * 100));
-                    }
+                    });
                     auto t2 = std::chrono::high_resolution_clock::now();
                     SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Refine RNG time (s): %lld Graph Acc: %f\n", std::chrono::duration_cast<std::chrono::seconds>(t2 - t1).count(), GraphAccuracyEstimation(index, 100, idmap));
                 }
@@ -477,12 +474,11 @@ break;
 
                 if (m_iRefineIter > 0) {
                     auto t1 = std::chrono::high_resolution_clock::now();
-#pragma omp parallel for schedule(dynamic)
-                    for (SizeType i = 0; i < m_iGraphSize; i++)
+                    Helper::TaskScheduler::Instance().ParallelFor(0, m_iGraphSize, index->GetNumThreads(), [&](SizeType i)
                     {
                         RefineNode<T>(index, i, false, false, m_iCEF);
                         if ((i * 5) % m_iGraphSize == 0) SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Refine %d %d%%\n", m_iRefineIter - 1, static_cast<int>(i * 1.0 / m_iGraphSize * 100));
-                    }
+                    });
                     auto t2 = std::chrono::high_resolution_clock::now();
                     SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Refine RNG time (s): %lld Graph Acc: %f\n", std::chrono::duration_cast<std::chrono::seconds>(t2 - t1).count(), GraphAccuracyEstimation(index, 100, idmap));
                 }
@@ -502,30 +498,35 @@ break;
                 }
 
                 SizeType R = (SizeType)indices.size();
+                newGraph->m_pNeighborhoodGraph.SetHugePages(m_pNeighborhoodGraph.HugePages());
                 newGraph->m_pNeighborhoodGraph.Initialize(R, m_iNeighborhoodSize, index->m_iDataBlockSize, index->m_iDataCapacity);
                 newGraph->m_iGraphSize = R;
                 newGraph->m_iNeighborhoodSize = m_iNeighborhoodSize;
 
-#pragma omp parallel for schedule(dynamic)
-                for (SizeType i = 0; i < R; i++)
+                Helper::TaskScheduler::Instance().ParallelFor(0, R, index->GetNumThreads(), [&](SizeType i)
                 {
                     if ((i * 5) % R == 0) SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Refine %d%%\n", static_cast<int>(i * 1.0 / R * 100));
 
                     SizeType* outnodes = newGraph->m_pNeighborhoodGraph[i];
 
-                    COMMON::QueryResultSet<T> query((const T*)index->GetSample(indices[i]), m_iCEF + 1);
+                    COMMON::QueryResultSet<T> query((const T*)index->GetVertexSample(indices[i]), m_iCEF + 1);
                     index->RefineSearchIndex(query, false);
                     RebuildNeighbors(index, indices[i], outnodes, query.GetResults(), m_iCEF + 1);
 
+                    // Vectors added after the ids were chosen have no place in the new graph and are dropped.
                     std::unordered_map<SizeType, SizeType>::const_iterator iter;
+                    DimensionType kept = 0;
                     for (DimensionType j = 0; j < m_iNeighborhoodSize; j++)
                     {
-                        if (outnodes[j] >= 0 && outnodes[j] < reverseIndices.size()) outnodes[j] = reverseIndices[outnodes[j]];
+                        if (outnodes[j] >= (SizeType)reverseIndices.size()) continue;
+                        if (outnodes[j] >= 0) outnodes[j] = reverseIndices[outnodes[j]];
                         if (idmap != nullptr && (iter = idmap->find(outnodes[j])) != idmap->end()) outnodes[j] = iter->second;
+                        outnodes[kept++] = outnodes[j];
                     }
+                    while (kept < m_iNeighborhoodSize) outnodes[kept++] = -1;
                     if (idmap != nullptr && (iter = idmap->find(-1 - i)) != idmap->end())
                         outnodes[m_iNeighborhoodSize - 1] = -2 - iter->second;
-                }
+                });
 
                 if (output != nullptr) newGraph->SaveGraph(output);
                 return ErrorCode::Success;
@@ -534,7 +535,7 @@ break;
             template <typename T>
             void RefineNode(VectorIndex* index, const SizeType node, bool updateNeighbors, bool searchDeleted, int CEF)
             {
-                COMMON::QueryResultSet<T> query((const T*)index->GetSample(node), CEF + 1);
+                COMMON::QueryResultSet<T> query((const T*)index->GetVertexSample(node), CEF + 1);
                 void* rec_query = nullptr;
                 if (index->m_pQuantizer) {
                     rec_query = ALIGN_ALLOC(index->m_pQuantizer->ReconstructSize());
@@ -542,33 +543,61 @@ break;
                     query.SetTarget((T*)rec_query, index->m_pQuantizer);
                 }
                 index->RefineSearchIndex(query, searchDeleted);
-                RebuildNeighbors(index, node, m_pNeighborhoodGraph[node], query.GetResults(), CEF + 1);
+                if (updateNeighbors) LinkNode(index, node, query.GetResults(), CEF);
+                else RebuildNeighbors(index, node, m_pNeighborhoodGraph[node], query.GetResults(), CEF + 1);
                 if (rec_query)
                 {
                     ALIGN_FREE(rec_query);
                 }
-                if (updateNeighbors) {
-                    // update neighbors
-                    for (int j = 0; j <= CEF; j++)
-                    {
-                        BasicResult* item = query.GetResult(j);
-                        if (item->VID < 0) break;
-                        if (item->VID == node) continue;
+            }
 
-                        InsertNeighbors(index, item->VID, node, item->Dist);
-                    }
+            // Rebuilds the neighbors of a node from its CEF + 1 nearest candidates and inserts it into theirs.
+            void LinkNode(VectorIndex* index, const SizeType node, const BasicResult* candidates, int CEF)
+            {
+                {
+                    // Other nodes being added may insert this one's reverse edges at the same time.
+                    std::lock_guard<std::mutex> lock(m_dataUpdateLock[node]);
+                    RebuildNeighbors(index, node, m_pNeighborhoodGraph[node], candidates, CEF + 1);
+                }
+                for (int j = 0; j <= CEF; j++)
+                {
+                    const BasicResult& item = candidates[j];
+                    if (item.VID < 0) break;
+                    if (item.VID == node) continue;
+
+                    InsertNeighbors(index, item.VID, node, item.Dist);
                 }
             }
 
             inline std::uint64_t BufferSize() const
             {
-                return m_pNeighborhoodGraph.BufferSize();
+                return m_bCompact ? m_compactGraph.BufferSize() : m_pNeighborhoodGraph.BufferSize();
             }
 
             ErrorCode LoadGraph(std::shared_ptr<Helper::DiskIO> input, SizeType blockSize, SizeType capacity)
             {
                 ErrorCode ret = ErrorCode::Success;
-                if ((ret = m_pNeighborhoodGraph.Load(input, blockSize, capacity)) != ErrorCode::Success) return ret;
+                SizeType rows;
+                IOBINARY(input, ReadBinary, sizeof(SizeType), (char*)&rows);
+                if (rows == CompactGraph::c_formatTag)
+                {
+                    if ((ret = m_compactGraph.Load(input)) != ErrorCode::Success) return ret;
+
+                    m_pNeighborhoodGraph.Clear();
+                    m_bCompact = true;
+                    m_iGraphSize = m_compactGraph.R();
+                    m_iNeighborhoodSize = m_compactGraph.C();
+                    SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Load compact %s (%d,%d) Finish!\n", m_pNeighborhoodGraph.Name().c_str(), m_iGraphSize, m_iNeighborhoodSize);
+                    return ret;
+                }
+
+                DimensionType cols;
+                IOBINARY(input, ReadBinary, sizeof(DimensionType), (char*)&cols);
+                m_compactGraph.Clear();
+                m_bCompact = false;
+                m_pNeighborhoodGraph.Initialize(rows, cols, blockSize, capacity);
+                if (rows > 0) IOBINARY(input, ReadBinary, sizeof(SizeType) * cols * rows, (char*)m_pNeighborhoodGraph[0]);
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Load %s (%d,%d) Finish!\n", m_pNeighborhoodGraph.Name().c_str(), rows, cols);
 
                 m_iGraphSize = m_pNeighborhoodGraph.R();
                 m_iNeighborhoodSize = m_pNeighborhoodGraph.C();
@@ -577,17 +606,29 @@ break;
 
             ErrorCode LoadGraph(std::string sGraphFilename, SizeType blockSize, SizeType capacity)
             {
-                ErrorCode ret = ErrorCode::Success;
-                if ((ret = m_pNeighborhoodGraph.Load(sGraphFilename, blockSize, capacity)) != ErrorCode::Success) return ret;
-
-                m_iGraphSize = m_pNeighborhoodGraph.R();
-                m_iNeighborhoodSize = m_pNeighborhoodGraph.C();
-                return ret;
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Load %s From %s\n", m_pNeighborhoodGraph.Name().c_str(), sGraphFilename.c_str());
+                auto ptr = f_createIO();
+                if (ptr == nullptr || !ptr->Initialize(sGraphFilename.c_str(), std::ios::binary | std::ios::in)) return ErrorCode::FailedOpenFile;
+                return LoadGraph(ptr, blockSize, capacity);
             }
 
             ErrorCode LoadGraph(char* pGraphMemFile, SizeType blockSize, SizeType capacity)
             {
                 ErrorCode ret = ErrorCode::Success;
+                if (*((SizeType*)pGraphMemFile) == CompactGraph::c_formatTag)
+                {
+                    if ((ret = m_compactGraph.Load(pGraphMemFile + sizeof(SizeType))) != ErrorCode::Success) return ret;
+
+                    m_pNeighborhoodGraph.Clear();
+                    m_bCompact = true;
+                    m_iGraphSize = m_compactGraph.R();
+                    m_iNeighborhoodSize = m_compactGraph.C();
+                    SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Load compact %s (%d,%d) Finish!\n", m_pNeighborhoodGraph.Name().c_str(), m_iGraphSize, m_iNeighborhoodSize);
+                    return ret;
+                }
+
+                m_compactGraph.Clear();
+                m_bCompact = false;
                 if ((ret = m_pNeighborhoodGraph.Load(pGraphMemFile, blockSize, capacity)) != ErrorCode::Success) return ret;
 
                 m_iGraphSize = m_pNeighborhoodGraph.R();
@@ -605,6 +646,13 @@ break;
 
             ErrorCode SaveGraph(std::shared_ptr<Helper::DiskIO> output) const
             {
+                if (m_bCompact)
+                {
+                    ErrorCode ret = m_compactGraph.Save(output);
+                    if (ret == ErrorCode::Success) SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Save compact %s (%d,%d) Finish!\n", m_pNeighborhoodGraph.Name().c_str(), m_iGraphSize, m_iNeighborhoodSize);
+                    return ret;
+                }
+
                 IOBINARY(output, WriteBinary, sizeof(SizeType), (char*)&m_iGraphSize);
                 IOBINARY(output, WriteBinary, sizeof(DimensionType), (char*)&m_iNeighborhoodSize);
 
@@ -614,8 +662,80 @@ break;
                 return ErrorCode::Success;
             }
 
+            // Repacks the graph into variable-length rows and frees the fixed-size rows. A compact graph is read-only:
+            // it can be searched and saved, but has to be expanded again before nodes are added or refined.
+            ErrorCode Compact(bool deltaCoding)
+            {
+                if (m_bCompact) return ErrorCode::Success;
+
+                std::uint64_t before = m_pNeighborhoodGraph.BufferSize();
+                m_compactGraph.Build(m_pNeighborhoodGraph, deltaCoding);
+                m_pNeighborhoodGraph.Clear();
+                m_bCompact = true;
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Compact %s (%d,%d): %llu -> %llu bytes\n", m_pNeighborhoodGraph.Name().c_str(), m_iGraphSize, m_iNeighborhoodSize,
+                    (unsigned long long)before, (unsigned long long)m_compactGraph.MemorySize());
+                return ErrorCode::Success;
+            }
+
+            ErrorCode Expand(SizeType blockSize, SizeType capacity)
+            {
+                if (!m_bCompact) return ErrorCode::Success;
+
+                m_compactGraph.Expand(m_pNeighborhoodGraph, blockSize, capacity);
+                m_compactGraph.Clear();
+                m_bCompact = false;
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Expand %s (%d,%d) Finish!\n", m_pNeighborhoodGraph.Name().c_str(), m_iGraphSize, m_iNeighborhoodSize);
+                return ErrorCode::Success;
+            }
+
+            // Moves row indices[i] to row i and renames every neighbor through reverseIndices; tree markers stay as they are.
+            ErrorCode Reorder(const std::vector<SizeType>& indices, const std::vector<SizeType>& reverseIndices, SizeType blockSize, SizeType capacity)
+            {
+                if (m_bCompact) return ErrorCode::Fail;
+
+                ErrorCode ret = m_pNeighborhoodGraph.Reorder(indices, blockSize, capacity);
+                if (ret != ErrorCode::Success) return ret;
+#pragma omp parallel for
+                for (SizeType i = 0; i < m_iGraphSize; i++)
+                {
+                    SizeType* row = m_pNeighborhoodGraph[i];
+                    for (DimensionType j = 0; j < m_iNeighborhoodSize; j++)
+                    {
+                        if (row[j] >= 0) row[j] = reverseIndices[row[j]];
+                    }
+                }
+                return ErrorCode::Success;
+            }
+
+            inline bool IsCompact() const { return m_bCompact; }
+
+            // Exchanges the rows of two graphs in the fixed-size layout, leaving their settings alone.
+            void SwapRows(NeighborhoodGraph& other)
+            {
+                m_pNeighborhoodGraph.Swap(other.m_pNeighborhoodGraph);
+                std::swap(m_iGraphSize, other.m_iGraphSize);
+            }
+
+            // The compact layout keeps its own storage and is not affected.
+            inline void SetHugePages(HugePagePolicy policy) { m_pNeighborhoodGraph.SetHugePages(policy); }
+
+            // Row of a node in the fixed-size layout; rows of a compact graph are decoded into buffer.
+            inline const SizeType* Row(SizeType index, std::vector<SizeType>& buffer) const
+            {
+                if (m_bCompact) return m_compactGraph.Decode(index, buffer);
+                return m_pNeighborhoodGraph[index];
+            }
+
+            inline const void* RowAddress(SizeType index) const
+            {
+                if (m_bCompact) return m_compactGraph.RowAddress(index);
+                return m_pNeighborhoodGraph[index];
+            }
+
             inline ErrorCode AddBatch(SizeType num)
             {
+                if (m_bCompact) return ErrorCode::Fail;
+
                 ErrorCode ret = m_pNeighborhoodGraph.AddBatch(num);
                 if (ret != ErrorCode::Success) return ret;
 
@@ -647,6 +767,8 @@ break;
             // Graph structure
             SizeType m_iGraphSize;
             COMMON::Dataset<SizeType> m_pNeighborhoodGraph;
+            COMMON::CompactGraph m_compactGraph;
+            bool m_bCompact = false;
             FineGrainedLock m_dataUpdateLock;
         public:
             int m_iTPTNumber, m_iTPTLeafSize, m_iSamples, m_numTopDimensionTPTSplit;
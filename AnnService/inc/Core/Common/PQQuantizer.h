@@ -13,6 +13,9 @@
 #include <memory>
 #include <cassert>
 #include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 
 namespace SPTAG
@@ -33,6 +36,10 @@ namespace SPTAG
 
             virtual float CosineDistance(const std::uint8_t* pX, const std::uint8_t* pY) const;
 
+            virtual void L2DistanceBatch(const std::uint8_t* pX, const std::uint8_t* const* pY, SizeType count, float* pOut) const;
+
+            virtual bool FastScanEnabled() const;
+
             virtual void QuantizeVector(const void* vec, std::uint8_t* vecout, bool ADC = true) const;
             
             virtual SizeType QuantizeSize() const;
@@ -88,6 +95,11 @@ namespace SPTAG
             inline SizeType m_DistIndexCalc(SizeType i, SizeType j, SizeType k) const;
             void InitializeDistanceTables();
 
+            // With 16 centroids the ADC query also carries a uint8 copy of its tables for the PQ4 fast-scan kernel:
+            // 16 entries per subvector padded to an even count, then the dequantization scale and bias.
+            SizeType FastScanTableSize() const;
+            void BuildFastScanTable(const float* ADCtable, std::uint8_t* lut) const;
+
             std::unique_ptr<T[]> m_codebooks;
             std::unique_ptr<const float[]> m_L2DistanceTables;
         };
@@ -127,6 +139,47 @@ namespace SPTAG
             return out;
         }
 
+        template <typename T>
+        void PQQuantizer<T>::L2DistanceBatch(const std::uint8_t* pX, const std::uint8_t* const* pY, SizeType count, float* pOut) const
+        {
+            if (!FastScanEnabled())
+            {
+                IQuantizer::L2DistanceBatch(pX, pY, count, pOut);
+                return;
+            }
+
+            DimensionType numPairs = (m_NumSubvectors + 1) / 2;
+            const std::uint8_t* lut = pX + sizeof(float) * m_NumSubvectors * m_KsPerSubvector;
+            float scale, bias;
+            std::memcpy(&scale, lut + numPairs * 32, sizeof(float));
+            std::memcpy(&bias, lut + numPairs * 32 + sizeof(float), sizeof(float));
+
+            static thread_local std::vector<std::uint8_t> block;
+            block.resize(numPairs * 32);
+            std::uint16_t sums[32];
+            auto fastScan = PQ4FastScanSelector();
+            for (SizeType begin = 0; begin < count; begin += 32)
+            {
+                int num = (int)min(count - begin, (SizeType)32);
+                for (int j = 0; j < num; j++)
+                {
+                    const std::uint8_t* code = pY[begin + j];
+                    std::uint8_t* packed = block.data() + j;
+                    DimensionType i = 0;
+                    for (; i + 1 < m_NumSubvectors; i += 2, packed += 32) *packed = code[i] | (code[i + 1] << 4);
+                    if (i < m_NumSubvectors) *packed = code[i];
+                }
+                fastScan(lut, block.data(), numPairs, sums);
+                for (int j = 0; j < num; j++) pOut[begin + j] = bias + scale * sums[j];
+            }
+        }
+
+        template <typename T>
+        bool PQQuantizer<T>::FastScanEnabled() const
+        {
+            return m_EnableADC && m_KsPerSubvector == 16;
+        }
+
         template <typename T>
         float PQQuantizer<T>::CosineDistance(const std::uint8_t* pX, const std::uint8_t* pY) const
             // pX must be query distance table for ADC
@@ -154,6 +207,10 @@ namespace SPTAG
                     }
                     subvec += m_DimPerSubvector;
                 }
+                if (m_KsPerSubvector == 16)
+                {
+                    BuildFastScanTable((const float*)vecout, (std::uint8_t*)ADCtable);
+                }
             }
             else 
             {
@@ -184,7 +241,7 @@ namespace SPTAG
         {
             if (GetEnableADC())
             {
-                return sizeof(float) * m_NumSubvectors * m_KsPerSubvector;
+                return sizeof(float) * m_NumSubvectors * m_KsPerSubvector + ((m_KsPerSubvector == 16) ? FastScanTableSize() : 0);
             }
             else
             {
@@ -347,6 +404,43 @@ namespace SPTAG
             m_L2DistanceTables = std::move(temp_m_L2DistanceTables);
         }
 
+        template <typename T>
+        SizeType PQQuantizer<T>::FastScanTableSize() const
+        {
+            return (m_NumSubvectors + 1) / 2 * 32 + 2 * sizeof(float);
+        }
+
+        template <typename T>
+        void PQQuantizer<T>::BuildFastScanTable(const float* ADCtable, std::uint8_t* lut) const
+        {
+            // Every table is shifted by its minimum and all share one step, so a code's distance is the sum of
+            // the minimums plus step times the uint16 sum of its entries. Entries are capped to keep that sum exact.
+            float bias = 0, span = 0;
+            std::vector<float> mins(m_NumSubvectors);
+            for (int i = 0; i < m_NumSubvectors; i++)
+            {
+                const float* table = ADCtable + i * m_KsPerSubvector;
+                float lo = *std::min_element(table, table + m_KsPerSubvector), hi = *std::max_element(table, table + m_KsPerSubvector);
+                mins[i] = lo;
+                bias += lo;
+                span = max(span, hi - lo);
+            }
+            float levels = (float)min(255, 65535 / m_NumSubvectors);
+            float step = (span > 0) ? span / levels : 1.0f;
+            DimensionType numPairs = (m_NumSubvectors + 1) / 2;
+            std::memset(lut, 0, numPairs * 32);
+            for (int i = 0; i < m_NumSubvectors; i++)
+            {
+                const float* table = ADCtable + i * m_KsPerSubvector;
+                for (int j = 0; j < m_KsPerSubvector; j++)
+                {
+                    lut[i * 16 + j] = (std::uint8_t)std::lround((table[j] - mins[i]) / step);
+                }
+            }
+            std::memcpy(lut + numPairs * 32, &step, sizeof(float));
+            std::memcpy(lut + numPairs * 32 + sizeof(float), &bias, sizeof(float));
+        }
+
         template <typename T>
         float* PQQuantizer<T>::GetL2DistanceTables() {
             return (float*)(m_L2DistanceTables.get());
@@ -0,0 +1,250 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_COMMON_PAGEALLOCATOR_H_
+#define _SPTAG_COMMON_PAGEALLOCATOR_H_
+
+#include "inc/Core/Common.h"
+#include "inc/Helper/Logging.h"
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+
+#ifndef _MSC_VER
+#include <sys/mman.h>
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+#endif
+
+namespace SPTAG
+{
+    namespace COMMON
+    {
+        // Allocates the row blocks of Dataset and Labelset. Under a huge page policy, blocks of at least one huge page
+        // are mapped with 1GB or 2MB hugetlb pages or advised for transparent huge pages, stepping down to the next
+        // option when one is not available. Every block starts with a header recording how it was obtained.
+        class PageAllocator
+        {
+        public:
+            static const std::size_t c_headerSize = 64;
+
+            struct Stats
+            {
+                std::atomic<std::uint64_t> m_pages1GB{ 0 };
+                std::atomic<std::uint64_t> m_pages2MB{ 0 };
+                std::atomic<std::uint64_t> m_transparentBytes{ 0 };
+                std::atomic<std::uint64_t> m_regularBytes{ 0 };
+            };
+
+            // Blocks currently allocated, by the kind of pages backing them.
+            static Stats& GetStats()
+            {
+                static Stats stats;
+                return stats;
+            }
+
+            static void* Allocate(std::size_t p_size, HugePagePolicy p_policy = HugePagePolicy::None)
+            {
+                std::size_t total = p_size + c_headerSize;
+                char* base = nullptr;
+                BlockKind kind = BlockKind::Heap;
+                std::size_t length = total;
+#ifndef _MSC_VER
+                if (p_policy == HugePagePolicy::Huge1GB && total >= c_1GB)
+                {
+                    length = RoundUp(total, c_1GB);
+                    if ((base = Map(length, MAP_HUGETLB | MAP_HUGE_1GB)) != nullptr) kind = BlockKind::HugeTLB1GB;
+                    else WarnOnce(FallbackWarned()[0], "Cannot map 1GB huge pages, falling back to 2MB pages.\n");
+                }
+                if (base == nullptr && (p_policy == HugePagePolicy::Huge1GB || p_policy == HugePagePolicy::Huge2MB) && total >= c_2MB)
+                {
+                    length = RoundUp(total, c_2MB);
+                    if ((base = Map(length, MAP_HUGETLB | MAP_HUGE_2MB)) != nullptr) kind = BlockKind::HugeTLB2MB;
+                    else WarnOnce(FallbackWarned()[1], "Cannot map 2MB huge pages, falling back to transparent huge pages.\n");
+                }
+                if (base == nullptr && p_policy != HugePagePolicy::None && total >= c_2MB)
+                {
+                    // Map one extra huge page so that the block can start on a 2MB boundary, then trim both ends.
+                    length = RoundUp(total, c_2MB);
+                    char* raw = Map(length + c_2MB, 0);
+                    if (raw != nullptr)
+                    {
+                        base = (char*)RoundUp((std::uintptr_t)raw, c_2MB);
+                        if (base > raw) munmap(raw, base - raw);
+                        munmap(base + length, raw + c_2MB - base);
+                        if (madvise(base, length, MADV_HUGEPAGE) == 0) kind = BlockKind::Transparent;
+                        else
+                        {
+                            kind = BlockKind::Mapped;
+                            WarnOnce(FallbackWarned()[2], "Transparent huge pages are not available, using regular pages.\n");
+                        }
+                    }
+                }
+#else
+                if (p_policy != HugePagePolicy::None) WarnOnce(FallbackWarned()[0], "Huge pages are not supported on this platform, using regular pages.\n");
+#endif
+                if (base == nullptr)
+                {
+                    length = total;
+                    kind = BlockKind::Heap;
+                    base = (char*)ALIGN_ALLOC(total);
+                    if (base == nullptr) return nullptr;
+                }
+
+                BlockHeader* header = (BlockHeader*)base;
+                header->m_length = length;
+                header->m_kind = kind;
+                Account(header, true);
+                return base + c_headerSize;
+            }
+
+            static void Free(void* p_ptr)
+            {
+                if (p_ptr == nullptr) return;
+
+                char* base = (char*)p_ptr - c_headerSize;
+                BlockHeader* header = (BlockHeader*)base;
+                Account(header, false);
+                if (header->m_kind == BlockKind::Heap)
+                {
+                    ALIGN_FREE(base);
+                    return;
+                }
+#ifndef _MSC_VER
+                munmap(base, header->m_length);
+#endif
+            }
+
+            // Bytes of the transparent huge page blocks the kernel actually backs with huge pages.
+            static std::uint64_t TransparentHugeBytes()
+            {
+                std::uint64_t bytes = 0;
+#ifndef _MSC_VER
+                std::lock_guard<std::mutex> lock(TransparentBlocksLock());
+                auto& blocks = TransparentBlocks();
+                if (blocks.empty()) return 0;
+
+                std::ifstream smaps("/proc/self/smaps");
+                std::string line;
+                bool overlaps = false;
+                while (std::getline(smaps, line))
+                {
+                    std::uint64_t start, end;
+                    if (sscanf(line.c_str(), "%" SCNx64 "-%" SCNx64, &start, &end) == 2)
+                    {
+                        auto iter = blocks.lower_bound((std::uintptr_t)end);
+                        overlaps = (iter != blocks.begin() && (--iter)->first + iter->second > start);
+                    }
+                    else if (overlaps && line.compare(0, 14, "AnonHugePages:") == 0)
+                    {
+                        bytes += std::strtoull(line.c_str() + 14, nullptr, 10) * 1024;
+                    }
+                }
+#endif
+                return bytes;
+            }
+
+            static void LogStats()
+            {
+                Stats& stats = GetStats();
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Huge pages: %llu of 1GB, %llu of 2MB, %llu bytes advised for transparent huge pages (%llu backed by them), %llu bytes on regular pages.\n",
+                    (unsigned long long)stats.m_pages1GB.load(), (unsigned long long)stats.m_pages2MB.load(),
+                    (unsigned long long)stats.m_transparentBytes.load(), (unsigned long long)TransparentHugeBytes(),
+                    (unsigned long long)stats.m_regularBytes.load());
+            }
+
+        private:
+            static const std::size_t c_2MB = (std::size_t)1 << 21;
+            static const std::size_t c_1GB = (std::size_t)1 << 30;
+
+            enum class BlockKind : std::uint32_t
+            {
+                Heap,
+                Mapped,
+                HugeTLB2MB,
+                HugeTLB1GB,
+                Transparent
+            };
+
+            struct BlockHeader
+            {
+                std::uint64_t m_length;
+                BlockKind m_kind;
+            };
+
+            static inline std::size_t RoundUp(std::size_t p_size, std::size_t p_page) { return (p_size + p_page - 1) & ~(p_page - 1); }
+
+            static std::atomic<bool>* FallbackWarned()
+            {
+                static std::atomic<bool> warned[3] = { {false}, {false}, {false} };
+                return warned;
+            }
+
+            static void WarnOnce(std::atomic<bool>& p_warned, const char* p_message)
+            {
+                if (!p_warned.exchange(true)) SPTAGLIB_LOG(Helper::LogLevel::LL_Warning, p_message);
+            }
+
+            static std::map<std::uintptr_t, std::size_t>& TransparentBlocks()
+            {
+                static std::map<std::uintptr_t, std::size_t> blocks;
+                return blocks;
+            }
+
+            static std::mutex& TransparentBlocksLock()
+            {
+                static std::mutex lock;
+                return lock;
+            }
+
+            static void Account(const BlockHeader* p_header, bool p_allocate)
+            {
+                Stats& stats = GetStats();
+                std::uint64_t length = p_header->m_length;
+                switch (p_header->m_kind)
+                {
+                case BlockKind::HugeTLB1GB:
+                    if (p_allocate) stats.m_pages1GB += length / c_1GB; else stats.m_pages1GB -= length / c_1GB;
+                    break;
+                case BlockKind::HugeTLB2MB:
+                    if (p_allocate) stats.m_pages2MB += length / c_2MB; else stats.m_pages2MB -= length / c_2MB;
+                    break;
+                case BlockKind::Transparent:
+                {
+                    if (p_allocate) stats.m_transparentBytes += length; else stats.m_transparentBytes -= length;
+                    std::lock_guard<std::mutex> lock(TransparentBlocksLock());
+                    if (p_allocate) TransparentBlocks()[(std::uintptr_t)p_header] = length;
+                    else TransparentBlocks().erase((std::uintptr_t)p_header);
+                    break;
+                }
+                default:
+                    if (p_allocate) stats.m_regularBytes += length; else stats.m_regularBytes -= length;
+                    break;
+                }
+            }
+
+#ifndef _MSC_VER
+            static char* Map(std::size_t p_length, int p_flags)
+            {
+                void* ptr = mmap(nullptr, p_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | p_flags, -1, 0);
+                return (ptr == MAP_FAILED) ? nullptr : (char*)ptr;
+            }
+#endif
+        };
+    }
+}
+
+#endif // _SPTAG_COMMON_PAGEALLOCATOR_H_
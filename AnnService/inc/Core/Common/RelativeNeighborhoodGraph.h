@@ -24,7 +24,7 @@ namespace SPTAG
 
                     bool good = true;
                     for (DimensionType k = 0; k < count; k++) {
-                        if (m_fRNGFactor * index->ComputeDistance(index->GetSample(nodes[k]), index->GetSample(item.VID)) < item.Dist) {
+                        if (m_fRNGFactor * index->ComputeDistance(index->GetVertexSample(nodes[k]), index->GetVertexSample(item.VID)) < item.Dist) {
                             good = false;
                             break;
                         }
@@ -37,8 +37,8 @@ namespace SPTAG
             void InsertNeighbors(VectorIndex* index, const SizeType node, SizeType insertNode, float insertDist)
             {                
                 SizeType* nodes = m_pNeighborhoodGraph[node];
-                const void* nodeVec = index->GetSample(node);
-                const void* insertVec = index->GetSample(insertNode);
+                const void* nodeVec = index->GetVertexSample(node);
+                const void* insertVec = index->GetVertexSample(insertNode);
                 
                 std::lock_guard<std::mutex> lock(m_dataUpdateLock[node]);
 
@@ -48,7 +48,7 @@ namespace SPTAG
                 for (DimensionType i = 0; i < m_iNeighborhoodSize; i++) {
                     auto futureNode = nodes[i];
                     if (futureNode < 0) break;
-                    _mm_prefetch((const char*)(index->GetSample(futureNode)), _MM_HINT_T0);
+                    _mm_prefetch((const char*)(index->GetVertexSample(futureNode)), _MM_HINT_T0);
                 }
 
                 SizeType tmpNode;
@@ -63,7 +63,7 @@ namespace SPTAG
                         break;
                     }
 
-                    tmpVec = index->GetSample(tmpNode);
+                    tmpVec = index->GetVertexSample(tmpNode);
                     tmpDist = index->ComputeDistance(tmpVec, nodeVec);
                     if (tmpDist > insertDist || (insertDist == tmpDist && insertNode < tmpNode))
                     {
@@ -71,7 +71,7 @@ namespace SPTAG
                         while (++k < checkNeighborhoodSize && index->ComputeDistance(tmpVec, nodeVec) <= index->ComputeDistance(tmpVec, insertVec)) {
                             std::swap(tmpNode, nodes[k]);
                             if (tmpNode < 0) return;
-                            tmpVec = index->GetSample(tmpNode);
+                            tmpVec = index->GetVertexSample(tmpNode);
                         }
                         break;
                     }
@@ -0,0 +1,360 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_COMMON_SCALARQUANTIZER_H_
+#define _SPTAG_COMMON_SCALARQUANTIZER_H_
+
+#include "CommonUtils.h"
+#include "DistanceUtils.h"
+#include "IQuantizer.h"
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace SPTAG
+{
+    namespace COMMON
+    {
+        // Maps every dimension linearly from its [min, max] range onto 8-bit codes, or 4-bit codes packed two per
+        // byte with the even dimension in the low nibble. With ADC the query stays in full precision.
+        template <typename T>
+        class ScalarQuantizer : public IQuantizer
+        {
+        public:
+            ScalarQuantizer();
+
+            ScalarQuantizer(DimensionType Dimension, int Bits, bool EnableADC, std::unique_ptr<float[]>&& Mins, std::unique_ptr<float[]>&& Scales);
+
+            ~ScalarQuantizer();
+
+            // Collects the per-dimension ranges in one pass over p_num contiguous vectors.
+            static std::shared_ptr<ScalarQuantizer<T>> Train(const T* p_data, SizeType p_num, DimensionType p_dimension, int p_bits);
+
+            virtual float L2Distance(const std::uint8_t* pX, const std::uint8_t* pY) const;
+
+            virtual float CosineDistance(const std::uint8_t* pX, const std::uint8_t* pY) const;
+
+            virtual void QuantizeVector(const void* vec, std::uint8_t* vecout, bool ADC = true) const;
+
+            virtual SizeType QuantizeSize() const;
+
+            virtual void ReconstructVector(const std::uint8_t* qvec, void* vecout) const;
+
+            virtual SizeType ReconstructSize() const;
+
+            virtual DimensionType ReconstructDim() const;
+
+            virtual std::uint64_t BufferSize() const;
+
+            virtual ErrorCode SaveQuantizer(std::shared_ptr<Helper::DiskIO> p_out) const;
+
+            virtual ErrorCode LoadQuantizer(std::shared_ptr<Helper::DiskIO> p_in);
+
+            virtual ErrorCode LoadQuantizer(std::uint8_t* raw_bytes);
+
+            virtual DimensionType GetNumSubvectors() const;
+
+            virtual int GetBase() const;
+
+            int GetBits() const;
+
+            virtual bool GetEnableADC() const;
+
+            virtual void SetEnableADC(bool enableADC);
+
+            VectorValueType GetReconstructType() const
+            {
+                return GetEnumValueType<T>();
+            }
+
+            QuantizerType GetQuantizerType() const {
+                return QuantizerType::ScalarQuantizer;
+            }
+
+            float* GetL2DistanceTables();
+
+        protected:
+            DimensionType m_Dimension;
+            int m_Bits;
+            bool m_EnableADC;
+
+            std::unique_ptr<float[]> m_mins;
+            std::unique_ptr<float[]> m_scales;
+
+            template <int Bits>
+            static inline int Code(const std::uint8_t* p_code, DimensionType d)
+            {
+                return (Bits == 8) ? p_code[d] : ((p_code[d >> 1] >> ((d & 1) << 2)) & 0xF);
+            }
+
+            template <int Bits>
+            float L2(const std::uint8_t* pX, const std::uint8_t* pY) const;
+
+            template <int Bits>
+            float Dot(const std::uint8_t* pX, const std::uint8_t* pY) const;
+        };
+
+        template <typename T>
+        ScalarQuantizer<T>::ScalarQuantizer() : m_Dimension(0), m_Bits(8), m_EnableADC(false)
+        {
+        }
+
+        template <typename T>
+        ScalarQuantizer<T>::ScalarQuantizer(DimensionType Dimension, int Bits, bool EnableADC, std::unique_ptr<float[]>&& Mins, std::unique_ptr<float[]>&& Scales) : m_Dimension(Dimension), m_Bits(Bits), m_EnableADC(EnableADC), m_mins(std::move(Mins)), m_scales(std::move(Scales))
+        {
+        }
+
+        template <typename T>
+        ScalarQuantizer<T>::~ScalarQuantizer()
+        {}
+
+        template <typename T>
+        std::shared_ptr<ScalarQuantizer<T>> ScalarQuantizer<T>::Train(const T* p_data, SizeType p_num, DimensionType p_dimension, int p_bits)
+        {
+            if ((p_bits != 4 && p_bits != 8) || p_num <= 0 || p_dimension <= 0)
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Cannot train a %d-bit scalar quantizer on %d vectors of dimension %d.\n", p_bits, p_num, p_dimension);
+                return nullptr;
+            }
+
+            auto mins = std::make_unique<float[]>(p_dimension);
+            auto scales = std::make_unique<float[]>(p_dimension);
+            std::vector<float> maxs(p_dimension, std::numeric_limits<float>::lowest());
+            for (DimensionType d = 0; d < p_dimension; d++) mins[d] = (std::numeric_limits<float>::max)();
+            for (SizeType i = 0; i < p_num; i++)
+            {
+                const T* vec = p_data + ((size_t)i) * p_dimension;
+                for (DimensionType d = 0; d < p_dimension; d++)
+                {
+                    float v = (float)vec[d];
+                    if (v < mins[d]) mins[d] = v;
+                    if (v > maxs[d]) maxs[d] = v;
+                }
+            }
+
+            float levels = (float)((1 << p_bits) - 1);
+            for (DimensionType d = 0; d < p_dimension; d++) scales[d] = (maxs[d] - mins[d]) / levels;
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Trained %d-bit scalar quantizer on %d vectors of dimension %d.\n", p_bits, p_num, p_dimension);
+            return std::make_shared<ScalarQuantizer<T>>(p_dimension, p_bits, false, std::move(mins), std::move(scales));
+        }
+
+        template <typename T>
+        template <int Bits>
+        float ScalarQuantizer<T>::L2(const std::uint8_t* pX, const std::uint8_t* pY) const
+        {
+            float out = 0;
+            if (GetEnableADC())
+            {
+                const float* query = (const float*)pX;
+                for (DimensionType d = 0; d < m_Dimension; d++)
+                {
+                    float diff = query[d] - (m_mins[d] + m_scales[d] * Code<Bits>(pY, d));
+                    out += diff * diff;
+                }
+            }
+            else
+            {
+                for (DimensionType d = 0; d < m_Dimension; d++)
+                {
+                    float diff = m_scales[d] * (Code<Bits>(pX, d) - Code<Bits>(pY, d));
+                    out += diff * diff;
+                }
+            }
+            return out;
+        }
+
+        template <typename T>
+        template <int Bits>
+        float ScalarQuantizer<T>::Dot(const std::uint8_t* pX, const std::uint8_t* pY) const
+        {
+            float out = 0;
+            if (GetEnableADC())
+            {
+                const float* query = (const float*)pX;
+                for (DimensionType d = 0; d < m_Dimension; d++)
+                {
+                    out += query[d] * (m_mins[d] + m_scales[d] * Code<Bits>(pY, d));
+                }
+            }
+            else
+            {
+                for (DimensionType d = 0; d < m_Dimension; d++)
+                {
+                    out += (m_mins[d] + m_scales[d] * Code<Bits>(pX, d)) * (m_mins[d] + m_scales[d] * Code<Bits>(pY, d));
+                }
+            }
+            return out;
+        }
+
+        template <typename T>
+        float ScalarQuantizer<T>::L2Distance(const std::uint8_t* pX, const std::uint8_t* pY) const
+            // pX must be the full-precision query for ADC
+        {
+            return (m_Bits == 8) ? L2<8>(pX, pY) : L2<4>(pX, pY);
+        }
+
+        template <typename T>
+        float ScalarQuantizer<T>::CosineDistance(const std::uint8_t* pX, const std::uint8_t* pY) const
+            // pX must be the full-precision query for ADC
+        {
+            float base = (float)GetBase();
+            return base * base - ((m_Bits == 8) ? Dot<8>(pX, pY) : Dot<4>(pX, pY));
+        }
+
+        template <typename T>
+        void ScalarQuantizer<T>::QuantizeVector(const void* vec, std::uint8_t* vecout, bool ADC) const
+        {
+            const T* subvec = (const T*)vec;
+            if (ADC && GetEnableADC())
+            {
+                float* query = (float*)vecout;
+                for (DimensionType d = 0; d < m_Dimension; d++) query[d] = (float)subvec[d];
+                return;
+            }
+
+            int levels = (1 << m_Bits) - 1;
+            std::memset(vecout, 0, GetNumSubvectors());
+            for (DimensionType d = 0; d < m_Dimension; d++)
+            {
+                int code = 0;
+                if (m_scales[d] > 0)
+                {
+                    code = (int)std::lround(((float)subvec[d] - m_mins[d]) / m_scales[d]);
+                    code = (code < 0) ? 0 : ((code > levels) ? levels : code);
+                }
+                if (m_Bits == 8) vecout[d] = (std::uint8_t)code;
+                else vecout[d >> 1] |= (std::uint8_t)(code << ((d & 1) << 2));
+            }
+        }
+
+        template <typename T>
+        SizeType ScalarQuantizer<T>::QuantizeSize() const
+        {
+            if (GetEnableADC())
+            {
+                return sizeof(float) * m_Dimension;
+            }
+            else
+            {
+                return GetNumSubvectors();
+            }
+        }
+
+        template <typename T>
+        void ScalarQuantizer<T>::ReconstructVector(const std::uint8_t* qvec, void* vecout) const
+        {
+            T* out = (T*)vecout;
+            for (DimensionType d = 0; d < m_Dimension; d++)
+            {
+                float v = m_mins[d] + m_scales[d] * ((m_Bits == 8) ? Code<8>(qvec, d) : Code<4>(qvec, d));
+                out[d] = (T)(std::is_integral<T>::value ? std::round(v) : v);
+            }
+        }
+
+        template <typename T>
+        SizeType ScalarQuantizer<T>::ReconstructSize() const
+        {
+            return sizeof(T) * ReconstructDim();
+        }
+
+        template <typename T>
+        DimensionType ScalarQuantizer<T>::ReconstructDim() const
+        {
+            return m_Dimension;
+        }
+
+        template <typename T>
+        std::uint64_t ScalarQuantizer<T>::BufferSize() const
+        {
+            return sizeof(float) * 2 * m_Dimension +
+                sizeof(DimensionType) + sizeof(int) + sizeof(VectorValueType) + sizeof(QuantizerType);
+        }
+
+        template <typename T>
+        ErrorCode ScalarQuantizer<T>::SaveQuantizer(std::shared_ptr<Helper::DiskIO> p_out) const
+        {
+            QuantizerType qtype = QuantizerType::ScalarQuantizer;
+            VectorValueType rtype = GetEnumValueType<T>();
+            IOBINARY(p_out, WriteBinary, sizeof(QuantizerType), (char*)&qtype);
+            IOBINARY(p_out, WriteBinary, sizeof(VectorValueType), (char*)&rtype);
+            IOBINARY(p_out, WriteBinary, sizeof(DimensionType), (char*)&m_Dimension);
+            IOBINARY(p_out, WriteBinary, sizeof(int), (char*)&m_Bits);
+            IOBINARY(p_out, WriteBinary, sizeof(float) * m_Dimension, (char*)m_mins.get());
+            IOBINARY(p_out, WriteBinary, sizeof(float) * m_Dimension, (char*)m_scales.get());
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Saving quantizer: Dimension:%d Bits:%d\n", m_Dimension, m_Bits);
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode ScalarQuantizer<T>::LoadQuantizer(std::shared_ptr<Helper::DiskIO> p_in)
+        {
+            IOBINARY(p_in, ReadBinary, sizeof(DimensionType), (char*)&m_Dimension);
+            IOBINARY(p_in, ReadBinary, sizeof(int), (char*)&m_Bits);
+            if (m_Dimension <= 0 || (m_Bits != 4 && m_Bits != 8)) return ErrorCode::FailedParseValue;
+            m_mins = std::make_unique<float[]>(m_Dimension);
+            m_scales = std::make_unique<float[]>(m_Dimension);
+            IOBINARY(p_in, ReadBinary, sizeof(float) * m_Dimension, (char*)m_mins.get());
+            IOBINARY(p_in, ReadBinary, sizeof(float) * m_Dimension, (char*)m_scales.get());
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Loaded quantizer: Dimension:%d Bits:%d\n", m_Dimension, m_Bits);
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode ScalarQuantizer<T>::LoadQuantizer(std::uint8_t* raw_bytes)
+        {
+            m_Dimension = *(DimensionType*)raw_bytes;
+            raw_bytes += sizeof(DimensionType);
+            m_Bits = *(int*)raw_bytes;
+            raw_bytes += sizeof(int);
+            if (m_Dimension <= 0 || (m_Bits != 4 && m_Bits != 8)) return ErrorCode::FailedParseValue;
+            m_mins = std::make_unique<float[]>(m_Dimension);
+            m_scales = std::make_unique<float[]>(m_Dimension);
+            std::memcpy(m_mins.get(), raw_bytes, sizeof(float) * m_Dimension);
+            raw_bytes += sizeof(float) * m_Dimension;
+            std::memcpy(m_scales.get(), raw_bytes, sizeof(float) * m_Dimension);
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Loaded quantizer: Dimension:%d Bits:%d\n", m_Dimension, m_Bits);
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        DimensionType ScalarQuantizer<T>::GetNumSubvectors() const
+        {
+            return (m_Bits == 8) ? m_Dimension : (m_Dimension + 1) / 2;
+        }
+
+        template <typename T>
+        int ScalarQuantizer<T>::GetBase() const
+        {
+            return COMMON::Utils::GetBase<T>();
+        }
+
+        template <typename T>
+        int ScalarQuantizer<T>::GetBits() const
+        {
+            return m_Bits;
+        }
+
+        template <typename T>
+        bool ScalarQuantizer<T>::GetEnableADC() const
+        {
+            return m_EnableADC;
+        }
+
+        template <typename T>
+        void ScalarQuantizer<T>::SetEnableADC(bool enableADC)
+        {
+            m_EnableADC = enableADC;
+        }
+
+        template <typename T>
+        float* ScalarQuantizer<T>::GetL2DistanceTables()
+        {
+            return nullptr;
+        }
+    }
+}
+
+#endif // _SPTAG_COMMON_SCALARQUANTIZER_H_
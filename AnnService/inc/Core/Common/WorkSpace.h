@@ -77,16 +77,22 @@ namespace SPTAG
             ~OptHashPosVector() {}
 
 
-            void Init(SizeType size, int exp)
+            // Slots in one hash block for a search visiting up to size vectors.
+            static int PoolSize(SizeType size, int exp)
             {
                 int ex = 0;
                 while (size != 0) {
                     ex++;
                     size >>= 1;
                 }
+                return 1 << (ex + exp);
+            }
+
+            void Init(SizeType size, int exp)
+            {
                 m_secondHash = true;
                 m_exp = exp;
-                m_poolSize = (1 << (ex + exp)) - 1;
+                m_poolSize = PoolSize(size, exp) - 1;
                 m_hashTable.reset(new SizeType[(m_poolSize + 1) * 2]);
                 clear();
             }
@@ -164,6 +170,113 @@ namespace SPTAG
             }
         };
 
+        // One 16-bit stamp per vector id. A vector is visited when its stamp equals the current epoch, so clear()
+        // only bumps the epoch and the array is wiped once every 65535 searches. Ids past the end (vectors added
+        // after the workspace was created) grow the array.
+        class EpochPosVector
+        {
+        public:
+            EpochPosVector() : m_size(0), m_epoch(1) {}
+
+            void Init(SizeType size)
+            {
+                m_size = size;
+                m_stamps.reset(new std::uint16_t[m_size]());
+                m_epoch = 1;
+            }
+
+            void clear()
+            {
+                if (++m_epoch == 0)
+                {
+                    memset(m_stamps.get(), 0, sizeof(std::uint16_t) * m_size);
+                    m_epoch = 1;
+                }
+            }
+
+            inline SizeType Size() const { return m_size; }
+
+            inline bool CheckAndSet(SizeType idx)
+            {
+                if (idx >= m_size) Grow(idx);
+                if (m_stamps[idx] == m_epoch) return true;
+                m_stamps[idx] = m_epoch;
+                return false;
+            }
+
+        private:
+            void Grow(SizeType idx)
+            {
+                SizeType size = max(idx + 1, m_size * 2);
+                std::unique_ptr<std::uint16_t[]> stamps(new std::uint16_t[size]());
+                if (m_size > 0) memcpy(stamps.get(), m_stamps.get(), sizeof(std::uint16_t) * m_size);
+                m_stamps = std::move(stamps);
+                m_size = size;
+            }
+
+            SizeType m_size;
+
+            std::uint16_t m_epoch;
+
+            std::unique_ptr<std::uint16_t[]> m_stamps;
+        };
+
+        // Visited set of one search, either the MaxCheck sized hash table or an epoch array over all vector ids.
+        // Auto takes the epoch array while it costs at most 4x the memory of the two hash blocks: it needs no
+        // memset per search and cannot fill up, but it grows with the index rather than with MaxCheck.
+        class VisitedPosVector
+        {
+        public:
+            static const SizeType c_epochRowsPerHashSlot = 16;
+
+            VisitedPosVector() : m_useEpoch(false), m_maxCheck(0), m_exp(2), m_type(VisitedSetType::Hash) {}
+
+            void Init(int maxCheck, int exp, SizeType rows = 0, VisitedSetType type = VisitedSetType::Auto)
+            {
+                m_maxCheck = maxCheck;
+                m_exp = exp;
+                m_type = type;
+                m_useEpoch = (type == VisitedSetType::Epoch) ||
+                    (type == VisitedSetType::Auto && rows > 0 && rows <= c_epochRowsPerHashSlot * OptHashPosVector::PoolSize(maxCheck, exp));
+                if (m_useEpoch) m_epoch.Init(rows);
+                else m_hash.Init(maxCheck, exp);
+            }
+
+            inline void clear()
+            {
+                if (m_useEpoch) m_epoch.clear();
+                else m_hash.clear();
+            }
+
+            inline bool CheckAndSet(SizeType idx)
+            {
+                return m_useEpoch ? m_epoch.CheckAndSet(idx) : m_hash.CheckAndSet(idx);
+            }
+
+            inline bool UseEpoch() const { return m_useEpoch; }
+
+            inline int HashTableExponent() const { return m_useEpoch ? m_exp : m_hash.HashTableExponent(); }
+
+            inline int MaxCheck() const { return m_useEpoch ? m_maxCheck : m_hash.MaxCheck(); }
+
+            inline SizeType Rows() const { return m_useEpoch ? m_epoch.Size() : 0; }
+
+            inline VisitedSetType Type() const { return m_type; }
+
+        private:
+            bool m_useEpoch;
+
+            int m_maxCheck;
+
+            int m_exp;
+
+            VisitedSetType m_type;
+
+            OptHashPosVector m_hash;
+
+            EpochPosVector m_epoch;
+        };
+
         class DistPriorityQueue {
             int m_size;
             std::unique_ptr<float[]> m_data;
@@ -233,16 +346,16 @@ namespace SPTAG
 
             WorkSpace(WorkSpace& other) 
             {
-                Initialize(other.m_iMaxCheck, other.nodeCheckStatus.HashTableExponent());
+                Initialize(other.m_iMaxCheck, other.nodeCheckStatus.HashTableExponent(), other.nodeCheckStatus.Rows(), other.nodeCheckStatus.Type());
             }
 
             ~WorkSpace() {
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Delete workspace happens!\n");
             }
 
-            void Initialize(int maxCheck, int hashExp)
+            void Initialize(int maxCheck, int hashExp, SizeType rows = 0, VisitedSetType visitedSet = VisitedSetType::Auto)
             {
-                nodeCheckStatus.Init(maxCheck, hashExp);
+                nodeCheckStatus.Init(maxCheck, hashExp, rows, visitedSet);
                 m_SPTQueue.Resize(maxCheck * 10);
                 m_NGQueue.Resize(maxCheck * 30);
                 m_Results.Resize(maxCheck / 16);
@@ -259,7 +372,9 @@ namespace SPTAG
             {
                 int maxCheck = va_arg(arg, int);
                 int hashExp = va_arg(arg, int);
-                Initialize(maxCheck, hashExp);
+                SizeType rows = va_arg(arg, SizeType);
+                int visitedSet = va_arg(arg, int);
+                Initialize(maxCheck, hashExp, rows, (VisitedSetType)visitedSet);
             }
 
             void Reset(int maxCheck, int resultNum)
@@ -297,7 +412,7 @@ namespace SPTAG
 
             static void Reset() {}
 
-            OptHashPosVector nodeCheckStatus;
+            VisitedPosVector nodeCheckStatus;
 
             // counter for dynamic pivoting
             int m_iNumOfContinuousNoBetterPropagation;
@@ -317,6 +432,9 @@ namespace SPTAG
             Heap<NodeDistPair> m_nextBSPTQueue;
 
             DistPriorityQueue m_Results;
+
+            // Scratch row for graphs kept in compact form
+            std::vector<SizeType> m_graphRow;
         };
     }
 }
@@ -44,6 +44,7 @@ DefineDistCalcMethod(InnerProduct)
 DefineQuantizerType(None, std::shared_ptr<void>)
 DefineQuantizerType(PQQuantizer, std::shared_ptr<SPTAG::COMMON::PQQuantizer>)
 DefineQuantizerType(OPQQuantizer, std::shared_ptr<SPTAG::COMMON::OPQQuantizer>)
+DefineQuantizerType(ScalarQuantizer, std::shared_ptr<SPTAG::COMMON::ScalarQuantizer>)
 
 #endif // DefineQuantizerType
 
@@ -139,4 +140,35 @@ DefineNumaStrategy(SCATTER)
 DefineOrderStrategy(ASC)
 DefineOrderStrategy(DESC)
 
-#endif // DefineOrderStrategy
\ No newline at end of file
+#endif // DefineOrderStrategy
+
+#ifdef DefineVisitedSetType
+
+DefineVisitedSetType(Auto)
+DefineVisitedSetType(Hash)
+DefineVisitedSetType(Epoch)
+
+#endif // DefineVisitedSetType
+
+#ifdef DefineHugePagePolicy
+
+DefineHugePagePolicy(None)
+DefineHugePagePolicy(Transparent)
+DefineHugePagePolicy(Huge2MB)
+DefineHugePagePolicy(Huge1GB)
+
+#endif // DefineHugePagePolicy
+
+#ifdef DefineFixedDimension
+
+DefineFixedDimension(64)
+DefineFixedDimension(96)
+DefineFixedDimension(100)
+DefineFixedDimension(128)
+DefineFixedDimension(256)
+DefineFixedDimension(384)
+DefineFixedDimension(512)
+DefineFixedDimension(768)
+DefineFixedDimension(1024)
+
+#endif // DefineFixedDimension
@@ -82,6 +82,12 @@ namespace SPTAG
             int m_iNumberOfInitialDynamicPivots;
             int m_iNumberOfOtherDynamicPivots;
             int m_iHashTableExp;
+            VisitedSetType m_visitedSetType;
+            HugePagePolicy m_hugePagePolicy;
+            bool m_bMapIndexFiles;
+            bool m_bPrefaultIndexFiles;
+            int m_iLoadThreads;
+            int m_iLoadChunkMB;
             std::unique_ptr<SPTAG::COMMON::IWorkSpaceFactory<SPTAG::COMMON::WorkSpace>> m_workSpaceFactory;
 
         public:
@@ -196,10 +202,16 @@ namespace SPTAG
             }
 
         private:
-            template <typename Q>
-            void SearchIndex(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted) const;
-            template <typename Q, bool(*notDeleted)(const COMMON::Labelset&, SizeType)>
-            void Search(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space) const;
+            // Backs the vectors, graph and deletes allocated from now on with the pages HugePages asks for.
+            void ApplyHugePages();
+
+            // The kernel behind m_fComputeDistance, or nullptr when distances go through the quantizer.
+            inline COMMON::DistanceCalcReturn<T> DistanceKernel() const { return m_pQuantizer ? nullptr : COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod, GetFeatureDim()); }
+
+            template <typename Q, typename Dist>
+            void SearchIndex(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted, const Dist& fComputeDistance) const;
+            template <typename Q, bool(*notDeleted)(const COMMON::Labelset&, SizeType), typename Dist>
+            void Search(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, const Dist& fComputeDistance) const;
         };
     } // namespace KDT
 } // namespace SPTAG
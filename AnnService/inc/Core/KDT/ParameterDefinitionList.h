@@ -45,6 +45,12 @@ DefineKDTParameter(m_iThresholdOfNumberOfContinuousNoBetterPropagation, int, 3L,
 DefineKDTParameter(m_iNumberOfInitialDynamicPivots, int, 50L, "NumberOfInitialDynamicPivots")
 DefineKDTParameter(m_iNumberOfOtherDynamicPivots, int, 4L, "NumberOfOtherDynamicPivots")
 DefineKDTParameter(m_iHashTableExp, int, 2L, "HashTableExponent")
+DefineKDTParameter(m_visitedSetType, VisitedSetType, VisitedSetType::Auto, "VisitedSet") // Hash, Epoch, or Auto to pick the epoch array for small indexes
+DefineKDTParameter(m_hugePagePolicy, HugePagePolicy, HugePagePolicy::None, "HugePages") // Back vectors, graph and deletes with Transparent, Huge2MB or Huge1GB pages
+DefineKDTParameter(m_bMapIndexFiles, bool, false, "MapIndexFiles") // Load from a folder by mapping the vector, tree, graph and delete files copy-on-write instead of reading them
+DefineKDTParameter(m_bPrefaultIndexFiles, bool, false, "PrefaultIndexFiles") // Read the mapped files in at load time rather than on first access
+DefineKDTParameter(m_iLoadThreads, int, 0L, "LoadThreads") // When not mapping, read the index data files whole with this many threads using unbuffered chunk reads
+DefineKDTParameter(m_iLoadChunkMB, int, 64L, "LoadChunkMB") // Chunk size of those reads
 DefineKDTParameter(m_iDataBlockSize, int, 1024 * 1024, "DataBlockSize")
 DefineKDTParameter(m_iDataCapacity, int, MaxSize, "DataCapacity")
 DefineKDTParameter(m_iMetaRecordSize, int, 10, "MetaRecordSize")
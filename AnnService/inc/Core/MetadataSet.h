@@ -6,6 +6,8 @@
 
 #include "CommonDataStructure.h"
 
+#include <atomic>
+
 namespace SPTAG
 {
 
@@ -69,15 +71,27 @@ public:
     ErrorCode SaveMetadata(const std::string& p_metaFile, const std::string& p_metaindexFile);
 
 private:
+    void MapMetadata(const std::string& p_metaFile, std::uint64_t p_bytes);
+
+    ByteArray ReadFromFile(std::uint64_t p_offset, std::uint64_t p_bytes, bool p_copy) const;
+
     std::shared_ptr<void> m_lock;
 
-    std::vector<std::uint64_t> m_offsets;
+    std::shared_ptr<void> m_pOffsets;
 
     SizeType m_count;
 
     std::shared_ptr<Helper::DiskIO> m_fp = nullptr;
     
     std::vector<std::uint8_t> m_newdata;
+
+    // Bytes of metadata persisted in the meta file; rows below this offset are served from the file.
+    std::atomic<std::uint64_t> m_fileBytes;
+
+    // Read-only mapping of the meta file, or nullptr when reads fall back to m_fp. Swapped with
+    // atomic_load/atomic_store; the views GetMetadata returns share it, so a replaced mapping is
+    // unmapped once the last of them is released.
+    std::shared_ptr<void> m_mapping;
 };
 
 
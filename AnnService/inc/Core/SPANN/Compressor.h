@@ -20,6 +20,7 @@ namespace SPTAG
         private:
             void CreateCDict()
             {
+                ZSTD_freeCDict(cdict);
                 cdict = ZSTD_createCDict((void *)dictBuffer.data(), dictBuffer.size(), compress_level);
                 if (cdict == NULL)
                 {
@@ -30,6 +31,7 @@ namespace SPTAG
 
             void CreateDDict()
             {
+                ZSTD_freeDDict(ddict);
                 ddict = ZSTD_createDDict((void *)dictBuffer.data(), dictBuffer.size());
                 if (ddict == NULL)
                 {
@@ -38,25 +40,68 @@ namespace SPTAG
                 }
             }
 
+            // Compression contexts are reused per thread. A context carries no dictionary state
+            // between calls, so it is shared by every Compressor used on that thread.
+            struct ThreadContexts
+            {
+                ZSTD_CCtx* cctx = nullptr;
+                ZSTD_DCtx* dctx = nullptr;
+
+                ~ThreadContexts()
+                {
+                    ZSTD_freeCCtx(cctx);
+                    ZSTD_freeDCtx(dctx);
+                }
+            };
+
+            static ThreadContexts& GetThreadContexts()
+            {
+                static thread_local ThreadContexts contexts;
+                return contexts;
+            }
+
+            static ZSTD_CCtx* GetCCtx()
+            {
+                ThreadContexts& contexts = GetThreadContexts();
+                if (contexts.cctx == nullptr)
+                {
+                    contexts.cctx = ZSTD_createCCtx();
+                    if (contexts.cctx == NULL)
+                    {
+                        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "ZSTD_createCCtx() failed! \n");
+                        throw std::runtime_error("ZSTD_createCCtx() failed!");
+                    }
+                }
+                return contexts.cctx;
+            }
+
+            static ZSTD_DCtx* GetDCtx()
+            {
+                ThreadContexts& contexts = GetThreadContexts();
+                if (contexts.dctx == nullptr)
+                {
+                    contexts.dctx = ZSTD_createDCtx();
+                    if (contexts.dctx == NULL)
+                    {
+                        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "ZSTD_createDCtx() failed! \n");
+                        throw std::runtime_error("ZSTD_createDCtx() failed!");
+                    }
+                }
+                return contexts.dctx;
+            }
+
             std::string CompressWithDict(const std::string &src)
             {
                 size_t est_compress_size = ZSTD_compressBound(src.size());
                 std::string comp_buffer{};
                 comp_buffer.resize(est_compress_size);
 
-                ZSTD_CCtx *const cctx = ZSTD_createCCtx();
-                if (cctx == NULL)
-                {
-                    SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "ZSTD_createCCtx() failed! \n");
-                    throw std::runtime_error("ZSTD_createCCtx() failed!");
-                }
-                size_t compressed_size = ZSTD_compress_usingCDict(cctx, (void *)comp_buffer.data(), est_compress_size, src.data(), src.size(), cdict);
+                size_t compressed_size = ZSTD_compress_usingCDict(GetCCtx(), (void *)comp_buffer.data(), est_compress_size, src.data(), src.size(), cdict);
                 if (ZSTD_isError(compressed_size))
                 {
                     SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "ZSTD compress error %s, \n", ZSTD_getErrorName(compressed_size));
                     throw std::runtime_error("ZSTD compress error");
                 }
-                ZSTD_freeCCtx(cctx);
                 comp_buffer.resize(compressed_size);
                 comp_buffer.shrink_to_fit();
 
@@ -65,20 +110,13 @@ namespace SPTAG
 
             std::size_t DecompressWithDict(const char* src, size_t srcSize, char* dst, size_t dstCapacity)
             {
-                ZSTD_DCtx* const dctx = ZSTD_createDCtx();
-                if (dctx == NULL)
-                {
-                    SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "ZSTD_createDCtx() failed! \n");
-                    throw std::runtime_error("ZSTD_createDCtx() failed!");
-                }
-                std::size_t const decomp_size = ZSTD_decompress_usingDDict(dctx,
+                std::size_t const decomp_size = ZSTD_decompress_usingDDict(GetDCtx(),
                     (void*)dst, dstCapacity, src, srcSize, ddict);
                 if (ZSTD_isError(decomp_size))
                 {
                     SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "ZSTD decompress error %s, \n", ZSTD_getErrorName(decomp_size));
                     throw std::runtime_error("ZSTD decompress failed.");
                 }
-                ZSTD_freeDCtx(dctx);
                 return decomp_size;
             }
 
@@ -87,7 +125,7 @@ namespace SPTAG
                 size_t est_comp_size = ZSTD_compressBound(src.size());
                 std::string buffer{};
                 buffer.resize(est_comp_size);
-                size_t compressed_size = ZSTD_compress((void *)buffer.data(), est_comp_size,
+                size_t compressed_size = ZSTD_compressCCtx(GetCCtx(), (void *)buffer.data(), est_comp_size,
                                                        src.data(), src.size(), compress_level);
                 if (ZSTD_isError(compressed_size))
                 {
@@ -102,7 +140,7 @@ namespace SPTAG
 
             std::size_t DecompressWithoutDict(const char *src, size_t srcSize, char* dst, size_t dstCapacity)
             {
-                std::size_t const decomp_size = ZSTD_decompress(
+                std::size_t const decomp_size = ZSTD_decompressDCtx(GetDCtx(),
                     (void *)dst, dstCapacity, src, srcSize);
                 if (ZSTD_isError(decomp_size))
                 {
@@ -122,7 +160,11 @@ namespace SPTAG
                 ddict = nullptr;
             }
 
-            virtual ~Compressor() {}
+            virtual ~Compressor()
+            {
+                ZSTD_freeCDict(cdict);
+                ZSTD_freeDDict(ddict);
+            }
 
             std::size_t TrainDict(const std::string &samplesBuffer, const size_t *samplesSizes, unsigned nbSamples)
             {
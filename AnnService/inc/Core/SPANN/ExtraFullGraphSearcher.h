@@ -6,6 +6,7 @@
 
 #include "inc/Helper/VectorSetReader.h"
 #include "inc/Helper/AsyncFileReader.h"
+#include "inc/Helper/TaskScheduler.h"
 #include "IExtraSearcher.h"
 #include "inc/Core/Common/TruthSet.h"
 #include "Compressor.h"
@@ -118,23 +119,32 @@ namespace SPTAG
 }\
 
 #define ProcessPosting() \
+        if (p_index->m_pQuantizer && p_index->m_pQuantizer->FastScanEnabled() && p_index->GetDistCalcMethod() == DistCalcMethod::L2) { \
+            ProcessPostingBatch(p_exWorkSpace, queryResults, p_index, listInfo, p_postingListFullData); \
+        } \
+        else { \
+        std::uint64_t deletedMask = 0; \
         for (int i = 0; i < listInfo->listEleCount; i++) { \
+            if ((i & (COMMON::Labelset::c_maskKeys - 1)) == 0) deletedMask = PostingDeletedMask(p_exWorkSpace, listInfo, p_postingListFullData, i); \
             uint64_t offsetVectorID, offsetVector;\
             (this->*m_parsePosting)(offsetVectorID, offsetVector, i, listInfo->listEleCount);\
             int vectorID = *(reinterpret_cast<int*>(p_postingListFullData + offsetVectorID));\
-            if (p_exWorkSpace->m_deduper.CheckAndSet(vectorID)) continue; \
+            if (((deletedMask >> (i & (COMMON::Labelset::c_maskKeys - 1))) & 1) || p_exWorkSpace->m_deduper.CheckAndSet(vectorID)) continue; \
             (this->*m_parseEncoding)(p_index, listInfo, (ValueType*)(p_postingListFullData + offsetVector));\
             auto distance2leaf = p_index->ComputeDistance(queryResults.GetQuantizedTarget(), p_postingListFullData + offsetVector); \
             queryResults.AddPoint(vectorID, distance2leaf); \
         } \
+        } \
 
 #define ProcessPostingOffset() \
         while (p_exWorkSpace->m_offset < listInfo->listEleCount) { \
+            int maskBit = (p_exWorkSpace->m_offset & (COMMON::Labelset::c_maskKeys - 1)); \
+            if (maskBit == 0) p_exWorkSpace->m_deletedMask = PostingDeletedMask(p_exWorkSpace, listInfo, p_postingListFullData, p_exWorkSpace->m_offset); \
             uint64_t offsetVectorID, offsetVector;\
             (this->*m_parsePosting)(offsetVectorID, offsetVector, p_exWorkSpace->m_offset, listInfo->listEleCount);\
             p_exWorkSpace->m_offset++;\
             int vectorID = *(reinterpret_cast<int*>(p_postingListFullData + offsetVectorID));\
-            if (p_exWorkSpace->m_deduper.CheckAndSet(vectorID)) continue; \
+            if (((p_exWorkSpace->m_deletedMask >> maskBit) & 1) || p_exWorkSpace->m_deduper.CheckAndSet(vectorID)) continue; \
             (this->*m_parseEncoding)(p_index, listInfo, (ValueType*)(p_postingListFullData + offsetVector));\
             auto distance2leaf = p_index->ComputeDistance(queryResults.GetQuantizedTarget(), p_postingListFullData + offsetVector); \
             queryResults.AddPoint(vectorID, distance2leaf); \
@@ -167,8 +177,21 @@ namespace SPTAG
                 std::string curFile = m_extraFullGraphFile;
                 p_opt.m_searchPostingPageLimit = max(p_opt.m_searchPostingPageLimit, static_cast<int>((p_opt.m_postingVectorLimit * (p_opt.m_dim * sizeof(ValueType) + sizeof(int)) + PageSize - 1) / PageSize));
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Load index with posting page limit:%d\n", p_opt.m_searchPostingPageLimit);
+                m_useIOUring = false;
+#ifndef _MSC_VER
+                if (p_opt.m_useIOUring) {
+                    auto uringFile = std::make_shared<Helper::IOUringFileIO>(p_opt.m_ioUringSQPoll);
+                    m_useIOUring = uringFile->Initialize(curFile.c_str(), std::ios::binary | std::ios::in, p_opt.m_searchInternalResultNum, 2, 2, p_opt.m_iSSDNumberOfThreads);
+                    if (!m_useIOUring) SPTAGLIB_LOG(Helper::LogLevel::LL_Warning, "io_uring is not available, fall back to aio.\n");
+                }
+#endif
                 do {
-                    auto curIndexFile = f_createAsyncIO();
+                    std::shared_ptr<Helper::DiskIO> curIndexFile;
+#ifndef _MSC_VER
+                    if (m_useIOUring) curIndexFile = std::make_shared<Helper::IOUringFileIO>(p_opt.m_ioUringSQPoll);
+                    else
+#endif
+                    curIndexFile = f_createAsyncIO();
                     if (curIndexFile == nullptr || !curIndexFile->Initialize(curFile.c_str(), std::ios::binary | std::ios::in, 
 #ifndef _MSC_VER
 #ifdef BATCH_READ
@@ -314,6 +337,7 @@ namespace SPTAG
 
 #ifdef ASYNC_READ
 #ifdef BATCH_READ
+                RegisterPageBuffers(p_exWorkSpace);
                 BatchReadFileAsync(m_indexFiles, (p_exWorkSpace->m_diskRequests).data(), postingListCount);
 #else
                 while (unprocessed > 0)
@@ -464,6 +488,7 @@ namespace SPTAG
 
 #ifdef ASYNC_READ
 #ifdef BATCH_READ
+                RegisterPageBuffers(p_exWorkSpace);
                 BatchReadFileAsync(m_indexFiles, (p_exWorkSpace->m_diskRequests).data(), postingListCount);
 #else
                 while (unprocessed > 0)
@@ -510,6 +535,73 @@ namespace SPTAG
                 return !(p_exWorkSpace->m_pi == p_exWorkSpace->m_postingIDs.size());
             }
 
+            virtual bool SupportsPipelinedSearch() const
+            {
+#if !defined(_MSC_VER) && defined(BATCH_READ)
+                return true;
+#else
+                return false;
+#endif
+            }
+
+            virtual int SubmitPostings(ExtraWorkSpace* p_exWorkSpace,
+                QueryResult& p_queryResults,
+                std::shared_ptr<VectorIndex> p_index,
+                int p_begin)
+            {
+#if !defined(_MSC_VER) && defined(BATCH_READ)
+                const int postingListCount = static_cast<int>(p_exWorkSpace->m_postingIDs.size());
+                COMMON::QueryResultSet<ValueType>& queryResults = *((COMMON::QueryResultSet<ValueType>*)&p_queryResults);
+
+                for (int pi = p_begin; pi < postingListCount; ++pi)
+                {
+                    auto curPostingID = p_exWorkSpace->m_postingIDs[pi];
+                    ListInfo* listInfo = &(m_listInfos[curPostingID]);
+                    int fileid = m_oneContext ? 0 : curPostingID / m_listPerFile;
+
+                    auto& request = p_exWorkSpace->m_diskRequests[pi];
+                    request.m_offset = listInfo->listOffset;
+                    request.m_readSize = (static_cast<size_t>(listInfo->listPageCount) << PageSizeEx);
+                    request.m_buffer = (char*)((p_exWorkSpace->m_pageBuffers[pi]).GetBuffer());
+                    request.m_status = (fileid << 16) | p_exWorkSpace->m_spaceID;
+                    request.m_payload = (void*)listInfo;
+                    request.m_success = false;
+
+                    // Runs from a later PollPostings. The request lives in the workspace and the result set belongs to
+                    // the caller, which keeps both until every submitted read has completed.
+                    COMMON::QueryResultSet<ValueType>* p_results = &queryResults;
+                    request.m_callback = [p_exWorkSpace, p_results, p_index, &request, this](bool success) mutable
+                    {
+                        COMMON::QueryResultSet<ValueType>& queryResults = *p_results;
+                        char* buffer = request.m_buffer;
+                        ListInfo* listInfo = (ListInfo*)(request.m_payload);
+
+                        char* p_postingListFullData = buffer + listInfo->pageOffset;
+                        if (m_enableDataCompression)
+                        {
+                            DecompressPosting();
+                        }
+
+                        ProcessPosting();
+                    };
+                }
+
+                RegisterPageBuffers(p_exWorkSpace);
+                return Helper::BatchReadFileSubmit(m_indexFiles, (p_exWorkSpace->m_diskRequests).data(), p_begin, postingListCount);
+#else
+                return 0;
+#endif
+            }
+
+            virtual int PollPostings(ExtraWorkSpace* p_exWorkSpace, bool p_wait)
+            {
+#if !defined(_MSC_VER) && defined(BATCH_READ)
+                return Helper::BatchReadFilePoll(m_indexFiles, (p_exWorkSpace->m_diskRequests).data(), static_cast<int>(p_exWorkSpace->m_postingIDs.size()), p_wait);
+#else
+                return 0;
+#endif
+            }
+
             virtual bool SearchIterativeNext(ExtraWorkSpace* p_exWorkSpace,
                  QueryResult& p_query,
 		 std::shared_ptr<VectorIndex> p_index)
@@ -670,11 +762,10 @@ namespace SPTAG
                         }
 
                         float acc = 0;
-#pragma omp parallel for schedule(dynamic)
-                        for (int j = 0; j < sampleNum; j++)
+                        Helper::TaskScheduler::Instance().ParallelFor(0, sampleNum, numThreads, [&](SizeType j)
                         {
                             COMMON::Utils::atomic_float_add(&acc, COMMON::TruthSet::CalculateRecall(p_headIndex.get(), fullVectors->GetVector(samples[j]), candidateNum));
-                        }
+                        });
                         acc = acc / sampleNum;
                         SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Batch %d vector(%d,%d) loaded with %d vectors (%zu) HeadIndex acc @%d:%f.\n", i, start, end, fullVectors->Count(), selections.m_selections.size(), candidateNum, acc);
 
@@ -744,10 +835,9 @@ namespace SPTAG
                     }
                 }
 
-#pragma omp parallel for schedule(dynamic)
-                for (int i = 0; i < postingListSize.size(); ++i)
+                Helper::TaskScheduler::Instance().ParallelFor(0, (SizeType)postingListSize.size(), numThreads, [&](SizeType i)
                 {
-                    if (postingListSize[i] <= postingSizeLimit) continue;
+                    if (postingListSize[i] <= postingSizeLimit) return;
 
                     std::size_t selectIdx = std::lower_bound(selections.m_selections.begin(), selections.m_selections.end(), i, Selection::g_edgeComparer) - selections.m_selections.begin();
 
@@ -757,7 +847,7 @@ namespace SPTAG
                         --replicaCount[tonode];
                     }
                     postingListSize[i] = postingSizeLimit;
-                }
+                });
 
                 if (p_opt.m_outputEmptyReplicaID)
                 {
@@ -863,14 +953,13 @@ namespace SPTAG
 
                     if (p_opt.m_enableDataCompression) {
                         SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Getting compressed size of each posting list...\n");
-#pragma omp parallel for schedule(dynamic)
-                        for (int j = 0; j < curPostingListSizes.size(); j++) 
+                        Helper::TaskScheduler::Instance().ParallelFor(0, (SizeType)curPostingListSizes.size(), numThreads, [&](SizeType j)
                         {
                             SizeType postingListId = j + (SizeType)curPostingListOffSet;
                             // do not compress if no data
                             if (postingListSize[postingListId] == 0) {
                                 curPostingListBytes[j] = 0;
-                                continue;
+                                return;
                             }
                             ValueType* headVector = nullptr;
                             if (p_opt.m_enableDeltaEncoding)
@@ -887,7 +976,7 @@ namespace SPTAG
                             if (postingListId % 10000 == 0 || curPostingListBytes[j] > static_cast<uint64_t>(p_opt.m_postingPageLimit) * PageSize) {
                                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Posting list %d/%d, compressed size: %d, compression ratio: %.4f\n", postingListId, postingListSize.size(), curPostingListBytes[j], curPostingListBytes[j] / float(sizeToCompress));
                             }
-                        }
+                        });
                         SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Getted compressed size for all the %d posting lists in SSD Index file %d.\n", curPostingListBytes.size(), i);
                         SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Mean compressed size: %.4f \n", std::accumulate(curPostingListBytes.begin(), curPostingListBytes.end(), 0.0) / curPostingListBytes.size());
                         SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Mean compression ratio: %.4f \n", std::accumulate(curPostingListBytes.begin(), curPostingListBytes.end(), 0.0) / (std::accumulate(curPostingListSizes.begin(), curPostingListSizes.end(), 0.0) * vectorInfoSize));
@@ -930,7 +1019,7 @@ namespace SPTAG
 
             virtual bool CheckValidPosting(SizeType postingID)
             {
-                return m_listInfos[postingID].listEleCount != 0;
+                return postingID < (SizeType)m_listInfos.size() && m_listInfos[postingID].listEleCount != 0;
             }
 
 
@@ -1203,6 +1292,52 @@ namespace SPTAG
 
             inline void ParseEncoding(std::shared_ptr<VectorIndex>& p_index, ListInfo* p_info, ValueType* vector) { }
 
+            // Gathers the ids of the next c_maskKeys entries of a posting from p_begin on and tests them against the
+            // deleted set in one call; bit i of the result is set when entry p_begin + i is deleted.
+            inline std::uint64_t PostingDeletedMask(ExtraWorkSpace* p_exWorkSpace, ListInfo* listInfo, char* p_postingListFullData, int p_begin)
+            {
+                if (p_exWorkSpace->m_deletedID == nullptr) return 0;
+
+                SizeType ids[COMMON::Labelset::c_maskKeys];
+                int count = min(listInfo->listEleCount - p_begin, (int)COMMON::Labelset::c_maskKeys);
+                for (int i = 0; i < count; i++)
+                {
+                    uint64_t offsetVectorID, offsetVector;
+                    (this->*m_parsePosting)(offsetVectorID, offsetVector, p_begin + i, listInfo->listEleCount);
+                    ids[i] = *(reinterpret_cast<int*>(p_postingListFullData + offsetVectorID));
+                }
+                return p_exWorkSpace->m_deletedID->ContainsMask(ids, count);
+            }
+
+            // ProcessPosting for quantizers with fast scan: the surviving codes of a posting are scored a block at a time.
+            void ProcessPostingBatch(ExtraWorkSpace* p_exWorkSpace, COMMON::QueryResultSet<ValueType>& queryResults, std::shared_ptr<VectorIndex>& p_index, ListInfo* listInfo, char* p_postingListFullData)
+            {
+                int ids[COMMON::IQuantizer::c_batchSize];
+                const std::uint8_t* codes[COMMON::IQuantizer::c_batchSize];
+                float dists[COMMON::IQuantizer::c_batchSize];
+                int count = 0;
+                std::uint64_t deletedMask = 0;
+                for (int i = 0; i <= listInfo->listEleCount; i++)
+                {
+                    if (count == COMMON::IQuantizer::c_batchSize || (i == listInfo->listEleCount && count > 0))
+                    {
+                        p_index->m_pQuantizer->L2DistanceBatch((const std::uint8_t*)queryResults.GetQuantizedTarget(), codes, count, dists);
+                        for (int j = 0; j < count; j++) queryResults.AddPoint(ids[j], dists[j]);
+                        count = 0;
+                    }
+                    if (i == listInfo->listEleCount) break;
+
+                    if ((i & (COMMON::Labelset::c_maskKeys - 1)) == 0) deletedMask = PostingDeletedMask(p_exWorkSpace, listInfo, p_postingListFullData, i);
+                    uint64_t offsetVectorID, offsetVector;
+                    (this->*m_parsePosting)(offsetVectorID, offsetVector, i, listInfo->listEleCount);
+                    int vectorID = *(reinterpret_cast<int*>(p_postingListFullData + offsetVectorID));
+                    if (((deletedMask >> (i & (COMMON::Labelset::c_maskKeys - 1))) & 1) || p_exWorkSpace->m_deduper.CheckAndSet(vectorID)) continue;
+                    (this->*m_parseEncoding)(p_index, listInfo, (ValueType*)(p_postingListFullData + offsetVector));
+                    ids[count] = vectorID;
+                    codes[count++] = (const std::uint8_t*)(p_postingListFullData + offsetVector);
+                }
+            }
+
             void SelectPostingOffset(
                 const std::vector<size_t>& p_postingListBytes,
                 std::unique_ptr<int[]>& p_postPageNum,
@@ -1568,11 +1703,27 @@ namespace SPTAG
             }
 
         private:
-            
+            void RegisterPageBuffers(ExtraWorkSpace* p_exWorkSpace)
+            {
+#ifndef _MSC_VER
+                if (!m_useIOUring || p_exWorkSpace->m_pageBuffersRegistered) return;
+
+                std::vector<struct iovec> buffers(p_exWorkSpace->m_pageBuffers.size());
+                for (std::size_t pi = 0; pi < buffers.size(); pi++) {
+                    buffers[pi].iov_base = p_exWorkSpace->m_pageBuffers[pi].GetBuffer();
+                    buffers[pi].iov_len = p_exWorkSpace->m_pageBuffers[pi].GetPageSize();
+                }
+                for (auto& indexFile : m_indexFiles)
+                    ((Helper::IOUringFileIO*)(indexFile.get()))->RegisterBuffers(p_exWorkSpace->m_spaceID, buffers);
+#endif
+                p_exWorkSpace->m_pageBuffersRegistered = true;
+            }
+
             std::string m_extraFullGraphFile;
 
             std::vector<ListInfo> m_listInfos;
             bool m_oneContext;
+            bool m_useIOUring = false;
 
             std::vector<std::shared_ptr<Helper::DiskIO>> m_indexFiles;
             std::unique_ptr<Compressor> m_pCompressor;
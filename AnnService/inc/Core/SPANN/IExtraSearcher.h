@@ -7,6 +7,7 @@
 #include "Options.h"
 
 #include "inc/Core/VectorIndex.h"
+#include "inc/Core/Common/Labelset.h"
 #include "inc/Helper/AsyncFileReader.h"
 
 #include <memory>
@@ -108,12 +109,13 @@ namespace SPTAG {
             ~ExtraWorkSpace() { g_spaceCount--; }
 
             ExtraWorkSpace(ExtraWorkSpace& other) {
-                Initialize(other.m_deduper.MaxCheck(), other.m_deduper.HashTableExponent(), (int)other.m_pageBuffers.size(), (int)(other.m_pageBuffers[0].GetPageSize()), other.m_enableDataCompression);
+                Initialize(other.m_deduper.MaxCheck(), other.m_deduper.HashTableExponent(), (int)other.m_pageBuffers.size(), (int)(other.m_pageBuffers[0].GetPageSize()), other.m_enableDataCompression, other.m_deduper.Rows(), other.m_deduper.Type());
             }
 
-            void Initialize(int p_maxCheck, int p_hashExp, int p_internalResultNum, int p_maxPages, bool enableDataCompression) {
+            void Initialize(int p_maxCheck, int p_hashExp, int p_internalResultNum, int p_maxPages, bool enableDataCompression, SizeType p_rows = 0, VisitedSetType p_visitedSet = VisitedSetType::Auto) {
                 m_postingIDs.reserve(p_internalResultNum);
-                m_deduper.Init(p_maxCheck, p_hashExp);
+                m_deltaPostingIDs.reserve(p_internalResultNum);
+                m_deduper.Init(p_maxCheck, p_hashExp, p_rows, p_visitedSet);
                 m_processIocp.reset(p_internalResultNum);
                 m_pageBuffers.resize(p_internalResultNum);
                 for (int pi = 0; pi < p_internalResultNum; pi++) {
@@ -129,6 +131,7 @@ namespace SPTAG {
                 }
                 m_spaceID = g_spaceCount++;
                 m_relaxedMono = false;
+                m_pageBuffersRegistered = false;
             }
 
             void Initialize(va_list& arg) {
@@ -152,8 +155,10 @@ namespace SPTAG {
                     for (int pi = 0; pi < p_internalResultNum; pi++) {
                         m_diskRequests[pi].m_extension = m_processIocp.handle();
                     }
+                    m_pageBuffersRegistered = false;
                 } else if (p_maxPages > m_pageBuffers[0].GetPageSize()) {
                     for (int pi = 0; pi < m_pageBuffers.size(); pi++) m_pageBuffers[pi].ReservePageBuffer(p_maxPages);
+                    m_pageBuffersRegistered = false;
                 }
 
                 m_enableDataCompression = enableDataCompression;
@@ -166,7 +171,10 @@ namespace SPTAG {
 
             std::vector<int> m_postingIDs;
 
-            COMMON::OptHashPosVector m_deduper;
+            // Postings without a disk part, e.g. of heads created by online splits.
+            std::vector<int> m_deltaPostingIDs;
+
+            COMMON::VisitedPosVector m_deduper;
 
             Helper::RequestQueue m_processIocp;
 
@@ -179,16 +187,25 @@ namespace SPTAG {
 
             int m_spaceID;
 
+            // Whether m_pageBuffers are registered with the io_uring rings of this workspace's channel.
+            bool m_pageBuffersRegistered = false;
+
             uint32_t m_pi;
 
             int m_offset;
 
+            // Deleted bits of the block of the current posting that m_offset is in.
+            std::uint64_t m_deletedMask = 0;
+
             bool m_loadPosting;
 
             bool m_relaxedMono;
 
             int m_loadedPostingNum;
 
+            // Vectors labeled here are skipped while scanning postings; nullptr disables the check.
+            const COMMON::Labelset* m_deletedID = nullptr;
+
             static std::atomic_int g_spaceCount;
         };
 
@@ -212,6 +229,18 @@ namespace SPTAG {
                 std::set<int>* truth = nullptr,
                 std::map<int, std::set<int>>* found = nullptr) = 0;
 
+            // Pipelined search: reads of p_exWorkSpace->m_postingIDs[p_begin, end) are issued without waiting,
+            // and PollPostings merges the postings read so far into p_queryResults given at submission. PollPostings
+            // returns how many reads finished, or -1 when polling failed and the reads may still be in flight.
+            virtual bool SupportsPipelinedSearch() const { return false; }
+
+            virtual int SubmitPostings(ExtraWorkSpace* p_exWorkSpace,
+                QueryResult& p_queryResults,
+                std::shared_ptr<VectorIndex> p_index,
+                int p_begin) { return 0; }
+
+            virtual int PollPostings(ExtraWorkSpace* p_exWorkSpace, bool p_wait) { return 0; }
+
             virtual bool SearchIterativeNext(ExtraWorkSpace* p_exWorkSpace,
                 QueryResult& p_queryResults,
                 std::shared_ptr<VectorIndex> p_index) = 0;
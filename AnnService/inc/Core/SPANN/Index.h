@@ -19,6 +19,7 @@
 #include "inc/Helper/StringConvert.h"
 #include "inc/Helper/ThreadPool.h"
 #include "inc/Helper/ConcurrentSet.h"
+#include "inc/Helper/LockFree.h"
 #include "inc/Helper/VectorSetReader.h"
 #include "inc/Core/Common/IQuantizer.h"
 
@@ -27,6 +28,7 @@
 
 #include <functional>
 #include <shared_mutex>
+#include <unordered_set>
 
 namespace SPTAG
 {
@@ -45,6 +47,15 @@ namespace SPTAG
         template<typename T>
         class Index : public VectorIndex
         {
+            class SplitJob : public Helper::ThreadPool::Job {
+            public:
+                SplitJob(Index<T>* p_index, SizeType p_headID) : m_index(p_index), m_headID(p_headID) {}
+                void exec(IAbortOperation* p_abort) { m_index->SplitPosting(m_headID, p_abort); }
+            private:
+                Index<T>* m_index;
+                SizeType m_headID;
+            };
+
         private:
             std::shared_ptr<VectorIndex> m_index;
             std::shared_ptr<std::uint64_t> m_vectorTranslateMap;
@@ -58,6 +69,21 @@ namespace SPTAG
             int m_iBaseSquare;
             std::unique_ptr<SPTAG::COMMON::IWorkSpaceFactory<ExtraWorkSpace>> m_workSpaceFactory;
 
+            // Vectors added after the build. Global IDs continue from m_options.m_vectorSize and each vector
+            // is appended to the in-memory posting of its nearest heads, scanned after the disk posting.
+            COMMON::Dataset<T> m_deltaVectors;
+            std::unordered_map<SizeType, std::vector<SizeType>> m_deltaPostings;
+            std::unordered_set<SizeType> m_splitting;
+            mutable std::shared_timed_mutex m_deltaLock; // protect m_deltaPostings and m_splitting
+            std::mutex m_dataAddLock; // protect m_deltaVectors and metadata
+            COMMON::Labelset m_deletedID;
+
+            // Global IDs of heads created by posting splits, for head IDs from m_splitHeadBase on.
+            Helper::LockFree::LockFreeVector<std::uint64_t> m_splitHeads;
+            SizeType m_splitHeadBase = 0;
+
+            Helper::ThreadPool m_threadPool;
+
         public:
             Index()
             {
@@ -72,7 +98,7 @@ namespace SPTAG
             inline std::shared_ptr<IExtraSearcher> GetDiskIndex() { return m_extraSearcher; }
             inline Options* GetOptions() { return &m_options; }
 
-            inline SizeType GetNumSamples() const { return m_options.m_vectorSize; }
+            inline SizeType GetNumSamples() const { return m_options.m_vectorSize + m_deltaVectors.R(); }
             inline DimensionType GetFeatureDim() const { return m_pQuantizer ? m_pQuantizer->ReconstructDim() : m_index->GetFeatureDim(); }
         
             inline int GetCurrMaxCheck() const { return m_options.m_maxCheck; }
@@ -96,7 +122,7 @@ namespace SPTAG
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "GetDistance NOT SUPPORT FOR SPANN");
                 return -1;
             }
-            inline bool ContainSample(const SizeType idx) const { return idx < m_options.m_vectorSize; }
+            inline bool ContainSample(const SizeType idx) const { return idx >= 0 && idx < GetNumSamples() && !m_deletedID.Contains(idx); }
 
             std::shared_ptr<std::vector<std::uint64_t>> BufferSize() const
             {
@@ -149,14 +175,14 @@ namespace SPTAG
             std::string GetParameter(const char* p_param, const char* p_section = nullptr) const;
 
             inline const void* GetSample(const SizeType idx) const { return nullptr; }
-            inline SizeType GetNumDeleted() const { return 0; }
+            inline SizeType GetNumDeleted() const { return (SizeType)m_deletedID.Count(); }
             inline bool NeedRefine() const { return false; }
 
             ErrorCode RefineSearchIndex(QueryResult &p_query, bool p_searchDeleted = false) const { return ErrorCode::Undefined; }
             ErrorCode SearchTree(QueryResult& p_query) const { return ErrorCode::Undefined; }
-            ErrorCode AddIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex = false, bool p_normalized = false) { return ErrorCode::Undefined; }
-            ErrorCode DeleteIndex(const void* p_vectors, SizeType p_vectorNum) { return ErrorCode::Undefined; }
-            ErrorCode DeleteIndex(const SizeType& p_id) { return ErrorCode::Undefined; }
+            ErrorCode AddIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex = false, bool p_normalized = false);
+            ErrorCode DeleteIndex(const void* p_vectors, SizeType p_vectorNum);
+            ErrorCode DeleteIndex(const SizeType& p_id);
             ErrorCode RefineIndex(const std::vector<std::shared_ptr<Helper::DiskIO>>& p_indexStreams, IAbortOperation* p_abort) { return ErrorCode::Undefined; }
             ErrorCode RefineIndex(std::shared_ptr<VectorIndex>& p_newIndex) { return ErrorCode::Undefined; }
             ErrorCode SetWorkSpaceFactory(std::unique_ptr<SPTAG::COMMON::IWorkSpaceFactory<SPTAG::COMMON::IWorkSpace>> up_workSpaceFactory)
@@ -187,9 +213,11 @@ namespace SPTAG
                 }
             }
 
-            SizeType GetGlobalVID(SizeType vid)
+            SizeType GetGlobalVID(SizeType vid) const
             {
-                return static_cast<SizeType>((m_vectorTranslateMap.get())[vid]);
+                if (vid < m_splitHeadBase) return static_cast<SizeType>((m_vectorTranslateMap.get())[vid]);
+                if ((std::uint64_t)(vid - m_splitHeadBase) >= m_splitHeads.size()) return MaxSize;
+                return static_cast<SizeType>(m_splitHeads[vid - m_splitHeadBase]);
             }
 
             ErrorCode GetPostingDebug(SizeType vid, std::vector<SizeType>& VIDs, std::shared_ptr<VectorSet>& vecs);
@@ -204,6 +232,14 @@ namespace SPTAG
             bool SelectHeadInternal(std::shared_ptr<Helper::VectorSetReader>& p_reader);
 
             ErrorCode BuildIndexInternal(std::shared_ptr<Helper::VectorSetReader>& p_reader);
+
+            void InitUpdateStore(bool p_loadDelta);
+            ErrorCode SaveDelta();
+            ErrorCode LoadDelta();
+            void AppendToPostings(SizeType p_vid);
+            void SplitPosting(SizeType p_headID, IAbortOperation* p_abort);
+            void SearchDeltaPostings(ExtraWorkSpace* p_exWorkSpace, COMMON::QueryResultSet<T>& p_queryResults) const;
+            ErrorCode SearchIndexPipelined(QueryResult& p_query, bool p_searchDeleted) const;
         };
     } // namespace SPANN
 } // namespace SPTAG
@@ -40,6 +40,7 @@ namespace SPTAG {
             std::string m_headIndexFolder;
             std::string m_deleteIDFile;
             std::string m_ssdIndex;
+            std::string m_deltaIndex;
             bool m_deleteHeadVectors;
             int m_ssdIndexFileNum;
             std::string m_quantizerFilePath;
@@ -113,6 +114,7 @@ namespace SPTAG {
             int m_queryCountLimit;
             int m_maxCheck;
             int m_hashExp;
+            VisitedSetType m_visitedSetType;
             float m_maxDistRatio;
             int m_ioThreads;
             int m_searchPostingPageLimit;
@@ -122,6 +124,11 @@ namespace SPTAG {
             int m_debugBuildInternalResultNum;
             bool m_enableADC;
             int m_iotimeout;
+            bool m_useIOUring;
+            bool m_ioUringSQPoll;
+            bool m_enablePipelinedSearch;
+            int m_pipelineStageCheck;
+            int m_pipelineStageHeads;
 
             // Iterative
             int m_headBatch;
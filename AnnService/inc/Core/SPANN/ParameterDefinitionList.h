@@ -29,6 +29,7 @@ DefineBasicParameter(m_deleteIDFile, std::string, std::string("DeletedIDs.bin"),
 DefineBasicParameter(m_headVectorFile, std::string, std::string("SPTAGHeadVectors.bin"), "HeadVectors")
 DefineBasicParameter(m_headIndexFolder, std::string, std::string("HeadIndex"), "HeadIndexFolder")
 DefineBasicParameter(m_ssdIndex, std::string, std::string("SPTAGFullList.bin"), "SSDIndex")
+DefineBasicParameter(m_deltaIndex, std::string, std::string("SPTAGDeltaList.bin"), "DeltaIndex")
 DefineBasicParameter(m_deleteHeadVectors, bool, false, "DeleteHeadVectors")
 DefineBasicParameter(m_ssdIndexFileNum, int, 1, "SSDIndexFileNum")
 DefineBasicParameter(m_quantizerFilePath, std::string, std::string(), "QuantizerFilePath")
@@ -110,6 +111,7 @@ DefineSSDParameter(m_resultNum, int, 5, "ResultNum")
 DefineSSDParameter(m_truthResultNum, int, -1, "TruthResultNum")
 DefineSSDParameter(m_maxCheck, int, 4096, "MaxCheck")
 DefineSSDParameter(m_hashExp, int, 4, "HashTableExponent")
+DefineSSDParameter(m_visitedSetType, VisitedSetType, VisitedSetType::Auto, "VisitedSet")
 DefineSSDParameter(m_queryCountLimit, int, (std::numeric_limits<int>::max)(), "QueryCountLimit")
 DefineSSDParameter(m_maxDistRatio, float, 10000, "MaxDistRatio")
 DefineSSDParameter(m_ioThreads, int, 4, "IOThreadsPerHandler")
@@ -120,6 +122,11 @@ DefineSSDParameter(m_enableADC, bool, false, "EnableADC")
 DefineSSDParameter(m_recall_analysis, bool, false, "RecallAnalysis")
 DefineSSDParameter(m_debugBuildInternalResultNum, int, 64, "DebugBuildInternalResultNum")
 DefineSSDParameter(m_iotimeout, int, 30, "IOTimeout")
+DefineSSDParameter(m_useIOUring, bool, false, "UseIOUring")
+DefineSSDParameter(m_ioUringSQPoll, bool, false, "IOUringSQPoll")
+DefineSSDParameter(m_enablePipelinedSearch, bool, false, "EnablePipelinedSearch")
+DefineSSDParameter(m_pipelineStageCheck, int, 256, "PipelineStageCheck")
+DefineSSDParameter(m_pipelineStageHeads, int, 8, "PipelineStageHeads")
 
 // Iterative
 DefineSSDParameter(m_headBatch, int, 32, "IterativeSearchHeadBatch")
@@ -62,12 +62,15 @@ public:
     virtual float ComputeDistance(const void* pX, const void* pY) const = 0;
     virtual float GetDistance(const void* target, const SizeType idx) const = 0;
     virtual const void* GetSample(const SizeType idx) const = 0;
+    // The row the graph stores for a vertex. Only an index that keeps its vectors out of id order tells it apart from GetSample.
+    virtual const void* GetVertexSample(const SizeType vertex) const { return GetSample(vertex); }
     virtual bool ContainSample(const SizeType idx) const = 0;
     virtual bool NeedRefine() const = 0;
    
     virtual DimensionType GetFeatureDim() const = 0;
     virtual SizeType GetNumSamples() const = 0;
     virtual SizeType GetNumDeleted() const = 0;
+    virtual int GetNumThreads() const = 0;
 
     virtual DistCalcMethod GetDistCalcMethod() const = 0;
     virtual IndexAlgoType GetIndexAlgoType() const = 0;
@@ -97,11 +100,22 @@ public:
     virtual ErrorCode DeleteIndex(ByteArray p_meta);
 
     virtual ErrorCode MergeIndex(VectorIndex* p_addindex, int p_threadnum, IAbortOperation* p_abort);
+
+    // Drops the deleted vectors in place while adds, deletes and searches go on; only the final swap waits for
+    // the searches in flight and briefly holds up new ones. Ids change: p_idMap[old] is the
+    // new id of each vector, or -1 for the dropped ones.
+    virtual ErrorCode CompactIndex(std::vector<SizeType>& p_idMap, IAbortOperation* p_abort = nullptr) { return ErrorCode::Undefined; }
     
     virtual const void* GetSample(ByteArray p_meta, bool& deleteFlag);
 
     virtual ErrorCode SearchIndex(const void* p_vector, int p_vectorCount, int p_neighborCount, bool p_withMeta, BasicResult* p_results) const;
 
+    virtual ErrorCode SearchIndexBatch(QueryResult* p_queries, int p_queryCount, bool p_searchDeleted = false) const;
+
+    // Same as SearchIndex, but hands p_onStage a sorted snapshot of the current candidates every p_stageCheck checked nodes.
+    // Indices that cannot stop mid-traversal fall back to a plain SearchIndex without staging.
+    virtual ErrorCode SearchIndexStaged(QueryResult& p_query, int p_stageCheck, std::function<void(QueryResult&)> p_onStage, bool p_searchDeleted = false) const;
+
     virtual void ApproximateRNG(std::shared_ptr<VectorSet>& fullVectors, std::unordered_set<SizeType>& exceptIDS, int candidateNum, Edge* selections, int replicaCount, int numThreads, int numTrees, int leafSize, float RNGFactor, int numGPUs);
 
     static void SortSelections(std::vector<Edge>* selections);
@@ -184,6 +198,13 @@ public:
 
     virtual ErrorCode SetWorkSpaceFactory(std::unique_ptr<SPTAG::COMMON::IWorkSpaceFactory<SPTAG::COMMON::IWorkSpace>> up_workSpaceFactory) = 0;
 
+    // Builds a BYTE index from full-precision vectors by training its own quantizer on them; indices that do not
+    // quantize on build reject them.
+    virtual ErrorCode BuildQuantizedIndex(std::shared_ptr<VectorSet> p_vectorSet, bool p_normalized) { return ErrorCode::Fail; }
+
+    // Adds full-precision vectors to a quantized index, which encodes them with its quantizer.
+    virtual ErrorCode AddQuantizedIndex(std::shared_ptr<VectorSet> p_vectorSet, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex, bool p_normalized) { return ErrorCode::Fail; }
+
     inline bool HasMetaMapping() const { return nullptr != m_pMetaToVec; }
 
     inline SizeType GetMetaMapping(std::string& meta) const;
@@ -205,6 +226,8 @@ protected:
     std::string m_sQuantizerFile = "quantizer.bin";
     std::shared_ptr<MetadataSet> m_pMetadata;
     std::shared_ptr<void> m_pMetaToVec;
+    // Index files LoadIndex mapped or read whole in parallel; the loaded vectors and graph point into them.
+    std::vector<ByteArray> m_indexFileBuffers;
 
 public:
     int m_iDataBlockSize = 1024 * 1024;
@@ -7,6 +7,7 @@
 #include "inc/Helper/DiskIO.h"
 #include "inc/Helper/ConcurrentSet.h"
 #include "inc/Core/Common.h"
+#include "inc/Core/CommonDataStructure.h"
 
 #include <cstdint>
 #include <functional>
@@ -24,7 +25,9 @@
 #else
 #include <fcntl.h>
 #include <sys/syscall.h>
+#include <sys/uio.h>
 #include <linux/aio_abi.h>
+#include <mutex>
 #ifdef NUMA
 #include <numa.h>
 #endif
@@ -35,6 +38,23 @@ namespace SPTAG
     namespace Helper
     {
         void SetThreadAffinity(int threadID, std::thread& thread, NumaStrategy socketStrategy = NumaStrategy::LOCAL, OrderStrategy idStrategy = OrderStrategy::ASC);
+
+        // Number of NUMA nodes, 1 when the build or the machine has no NUMA support.
+        int GetNumaNodeCount();
+
+        // NUMA node of the cpu running the calling thread.
+        int GetCurrentNumaNode();
+
+        // Runs the calling thread on the cpus of a node and prefers that node for its later allocations.
+        bool BindThreadToNumaNode(int node);
+
+        // Maps a whole file copy-on-write: pages stay shared with the page cache until they are written.
+        // Prefault reads the file in up front instead of on first touch.
+        bool MapFile(const std::string& filePath, bool prefault, ByteArray& mapped);
+
+        // Reads whole files into page-aligned buffers. The files are split into chunks that threads read
+        // concurrently, unbuffered (O_DIRECT, FILE_FLAG_NO_BUFFERING) where the file system allows it.
+        bool ReadFilesParallel(const std::vector<std::string>& filePaths, int threads, std::size_t chunkSize, std::vector<ByteArray>& contents);
 #ifdef _MSC_VER
         namespace DiskUtils
         {
@@ -644,6 +664,88 @@ namespace SPTAG
 
             std::vector<aio_context_t> m_iocps;
         };
+
+        // DiskIO on top of io_uring. Each channel owns a ring with the file registered as fixed file 0;
+        // page buffers registered through RegisterBuffers are read with IORING_OP_READ_FIXED.
+        // Completions are reaped by blocking in io_uring_enter instead of polling with AIOTimeout.
+        class IOUringFileIO : public DiskIO
+        {
+        public:
+            IOUringFileIO(bool sqPoll = false, DiskIOScenario scenario = DiskIOScenario::DIS_UserRead);
+
+            virtual ~IOUringFileIO();
+
+            virtual bool Initialize(const char* filePath, int openMode,
+                std::uint64_t maxIOSize = (1 << 20),
+                std::uint32_t maxReadRetries = 2,
+                std::uint32_t maxWriteRetries = 2,
+                std::uint16_t threadPoolSize = 4);
+
+            virtual std::uint64_t ReadBinary(std::uint64_t readSize, char* buffer, std::uint64_t offset = UINT64_MAX)
+            {
+                return pread(m_fileHandle, (void*)buffer, readSize, offset);
+            }
+
+            virtual std::uint64_t WriteBinary(std::uint64_t writeSize, const char* buffer, std::uint64_t offset = UINT64_MAX)
+            {
+                return 0;
+            }
+
+            virtual std::uint64_t ReadString(std::uint64_t& readSize, std::unique_ptr<char[]>& buffer, char delim = '\n', std::uint64_t offset = UINT64_MAX)
+            {
+                return 0;
+            }
+
+            virtual std::uint64_t WriteString(const char* buffer, std::uint64_t offset = UINT64_MAX)
+            {
+                return 0;
+            }
+
+            virtual bool ReadFileAsync(AsyncReadRequest& readRequest);
+
+            virtual bool BatchReadFile(AsyncReadRequest* readRequests, std::uint32_t requestCount);
+
+            virtual std::uint64_t TellP() { return 0; }
+
+            virtual void ShutDown();
+
+            // Buffer i of p_buffers serves requests at position i of a batch. A later call for the same
+            // channel replaces the previous set; reads into unregistered buffers use plain IORING_OP_READ.
+            bool RegisterBuffers(int channel, const std::vector<struct iovec>& p_buffers);
+
+            int GetFileHandler() { return m_fileHandle; }
+
+            static void BatchRead(std::vector<std::shared_ptr<Helper::DiskIO>>& handlers, AsyncReadRequest* readRequests, int num);
+
+            static int BatchSubmit(std::vector<std::shared_ptr<Helper::DiskIO>>& handlers, AsyncReadRequest* readRequests, int begin, int end);
+
+            static int BatchPoll(std::vector<std::shared_ptr<Helper::DiskIO>>& handlers, AsyncReadRequest* readRequests, int num, bool wait);
+
+        private:
+            struct Ring;
+
+            Ring* GetRing(int channel) { return m_rings[channel % m_rings.size()].get(); }
+
+#ifndef BATCH_READ
+            void ListenRing(int i);
+
+            bool m_shutdown;
+
+            std::vector<std::thread> m_ringThreads;
+#endif
+            bool m_sqPoll;
+
+            int m_fileHandle;
+
+            std::vector<std::unique_ptr<Ring>> m_rings;
+        };
+
+        // Issues readRequests[begin, end) without waiting for them and returns how many were submitted.
+        int BatchReadFileSubmit(std::vector<std::shared_ptr<Helper::DiskIO>>& handlers, AsyncReadRequest* readRequests, int begin, int end);
+
+        // Runs the callbacks of finished reads among readRequests[0, num) and returns how many finished, or -1
+        // when waiting failed with none finished. With wait set, blocks until at least one read finishes.
+        int BatchReadFilePoll(std::vector<std::shared_ptr<Helper::DiskIO>>& handlers, AsyncReadRequest* readRequests, int num, bool wait);
 #endif
         void BatchReadFileAsync(std::vector<std::shared_ptr<Helper::DiskIO>>& handlers, AsyncReadRequest* readRequests, int num);
     }
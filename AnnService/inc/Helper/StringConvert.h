@@ -353,6 +353,48 @@ inline bool ConvertStringTo<QuantizerType>(const char* p_str, QuantizerType& p_v
     return false;
 }
 
+template <>
+inline bool ConvertStringTo<VisitedSetType>(const char* p_str, VisitedSetType& p_value)
+{
+    if (nullptr == p_str)
+    {
+        return false;
+    }
+
+#define DefineVisitedSetType(Name) \
+    else if (StrUtils::StrEqualIgnoreCase(p_str, #Name)) \
+    { \
+        p_value = VisitedSetType::Name; \
+        return true; \
+    } \
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineVisitedSetType
+
+    return false;
+}
+
+template <>
+inline bool ConvertStringTo<HugePagePolicy>(const char* p_str, HugePagePolicy& p_value)
+{
+    if (nullptr == p_str)
+    {
+        return false;
+    }
+
+#define DefineHugePagePolicy(Name) \
+    else if (StrUtils::StrEqualIgnoreCase(p_str, #Name)) \
+    { \
+        p_value = HugePagePolicy::Name; \
+        return true; \
+    } \
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineHugePagePolicy
+
+    return false;
+}
+
 // Specialization of ConvertToString<>().
 
 template<>
@@ -407,6 +449,44 @@ inline std::string ConvertToString<QuantizerType>(const QuantizerType& p_value)
     return "Undefined";
 }
 
+template <>
+inline std::string ConvertToString<VisitedSetType>(const VisitedSetType& p_value)
+{
+    switch (p_value)
+    {
+#define DefineVisitedSetType(Name) \
+    case VisitedSetType::Name: \
+        return #Name; \
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineVisitedSetType
+
+    default:
+        break;
+    }
+
+    return "Undefined";
+}
+
+template <>
+inline std::string ConvertToString<HugePagePolicy>(const HugePagePolicy& p_value)
+{
+    switch (p_value)
+    {
+#define DefineHugePagePolicy(Name) \
+    case HugePagePolicy::Name: \
+        return #Name; \
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineHugePagePolicy
+
+    default:
+        break;
+    }
+
+    return "Undefined";
+}
+
 template <>
 inline std::string ConvertToString<DistCalcMethod>(const DistCalcMethod& p_value)
 {
@@ -0,0 +1,82 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_HELPER_TASKSCHEDULER_H_
+#define _SPTAG_HELPER_TASKSCHEDULER_H_
+
+#include "inc/Core/Common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SPTAG
+{
+    class IAbortOperation;
+
+    namespace Helper
+    {
+        // One set of worker threads shared by every index in the process. Each worker keeps its own deque of
+        // tasks, runs the newest one it queued itself and steals the oldest from the others when it runs dry.
+        // Parallel loops take the thread budget of the index that runs them, so indexes no longer change a
+        // process-wide OpenMP thread count under each other, and a loop started from inside another one runs
+        // on whatever workers are idle instead of blocking them.
+        class TaskScheduler
+        {
+        public:
+            // Background tasks, such as tree rebuilds and splits, only run on workers that find no foreground
+            // work, and on at most half of the workers at a time.
+            enum class Priority : std::uint8_t
+            {
+                Foreground,
+                Background
+            };
+
+            static TaskScheduler& Instance();
+
+            // Tasks queued from inside a task inherit its priority unless they ask for background.
+            void Submit(std::function<void()> p_task, Priority p_priority = Priority::Foreground);
+
+            // Runs p_body over [p_begin, p_end) on the calling thread and on up to p_threads - 1 workers, handing out
+            // p_grain indices at a time. Stops handing them out once p_abort asks to, and rethrows the first
+            // exception a call to p_body threw.
+            void ParallelFor(SizeType p_begin, SizeType p_end, int p_threads, const std::function<void(SizeType)>& p_body,
+                IAbortOperation* p_abort = nullptr, SizeType p_grain = 1);
+
+            int NumberOfWorkers() const { return (int)m_workers.size(); }
+
+        private:
+            struct Worker
+            {
+                std::mutex m_lock;
+                std::deque<std::function<void()>> m_tasks;
+            };
+
+            struct Loop;
+
+            TaskScheduler(int p_workers);
+
+            bool PopForeground(int p_self, std::function<void()>& p_task);
+
+            void Run(int p_self);
+
+            std::vector<std::unique_ptr<Worker>> m_workers;
+            std::deque<std::function<void()>> m_background;
+            std::atomic<int> m_queued;
+            std::atomic<unsigned> m_nextWorker;
+            int m_backgroundRunning;
+            int m_backgroundLimit;
+            std::mutex m_lock;
+            std::condition_variable m_cond;
+            std::vector<std::thread> m_threads;
+        };
+    }
+}
+
+#endif // _SPTAG_HELPER_TASKSCHEDULER_H_
@@ -4,9 +4,9 @@
 #ifndef _SPTAG_HELPER_THREADPOOL_H_
 #define _SPTAG_HELPER_THREADPOOL_H_
 
+#include "inc/Helper/TaskScheduler.h"
+
 #include <queue>
-#include <vector>
-#include <thread>
 #include <mutex>
 #include <condition_variable>
 
@@ -36,57 +36,48 @@ namespace SPTAG
                 virtual void exec(IAbortOperation* p_abort) = 0;
             };
 
-            ThreadPool() {}
+            ThreadPool() : m_concurrency(1), m_running(0) {}
 
             ~ThreadPool() 
             {
+                std::unique_lock<std::mutex> lock(m_lock);
                 m_abort.SetAbort(true);
-                m_cond.notify_all();
-                for (auto&& t : m_threads) t.join();
-                m_threads.clear();
+                while (!m_jobs.empty())
+                {
+                    delete m_jobs.front();
+                    m_jobs.pop();
+                }
+                m_cond.wait(lock, [this] { return m_running == 0; });
             }
 
+            // The jobs run as background tasks of the shared TaskScheduler, at most numberOfThreads of them at a time.
             void init(int numberOfThreads = 1)
             {
+                std::lock_guard<std::mutex> lock(m_lock);
                 m_abort.SetAbort(false);
-                for (int i = 0; i < numberOfThreads; i++)
-                {
-                    m_threads.emplace_back([this] {
-                        Job *j;
-                        while (get(j))
-                        {
-                            try 
-                            {
-                                j->exec(&m_abort);
-                            }
-                            catch (std::exception& e) {
-                                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "ThreadPool: exception in %s %s\n", typeid(*j).name(), e.what());
-                            }
-                            
-                            delete j;
-                        }
-                    });
-                }
+                m_concurrency = (numberOfThreads > 1) ? numberOfThreads : 1;
+                while (m_running < m_concurrency && m_running < (int)m_jobs.size()) Dispatch();
             }
 
             void add(Job* j)
             {
-                {
-                    std::lock_guard<std::mutex> lock(m_lock);
-                    m_jobs.push(j);
-                }
-                m_cond.notify_one();
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_jobs.push(j);
+                if (!m_abort.ShouldAbort() && m_running < m_concurrency) Dispatch();
             }
 
             bool get(Job*& j)
             {
-                std::unique_lock<std::mutex> lock(m_lock);
-                while (m_jobs.empty() && !m_abort.ShouldAbort()) m_cond.wait(lock);
-                if (!m_abort.ShouldAbort()) {
-                    j = m_jobs.front();
-                    m_jobs.pop();
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (m_jobs.empty() || m_abort.ShouldAbort())
+                {
+                    m_running--;
+                    m_cond.notify_all();
+                    return false;
                 }
-                return !m_abort.ShouldAbort();
+                j = m_jobs.front();
+                m_jobs.pop();
+                return true;
             }
 
             size_t jobsize()
@@ -95,12 +86,35 @@ namespace SPTAG
                 return m_jobs.size();
             }
 
+        private:
+            // Called with m_lock held. The task keeps taking jobs until the queue is empty.
+            void Dispatch()
+            {
+                m_running++;
+                TaskScheduler::Instance().Submit([this] {
+                    Job *j;
+                    while (get(j))
+                    {
+                        try 
+                        {
+                            j->exec(&m_abort);
+                        }
+                        catch (std::exception& e) {
+                            SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "ThreadPool: exception in %s %s\n", typeid(*j).name(), e.what());
+                        }
+                        
+                        delete j;
+                    }
+                }, TaskScheduler::Priority::Background);
+            }
+
         protected:
             std::queue<Job*> m_jobs;
             Abort m_abort;
             std::mutex m_lock;
             std::condition_variable m_cond;
-            std::vector<std::thread> m_threads;
+            int m_concurrency;
+            int m_running;
         };
     }
 }
@@ -22,6 +22,7 @@ public:
         AddOptionalOption(m_outputQuantizerFile, "-oq", "--outputquantizer", "Output quantizer.");
         AddOptionalOption(m_quantizerType, "-qt", "--quantizer", "Quantizer type.");
         AddOptionalOption(m_quantizedDim, "-qd", "--quantizeddim", "Quantized Dimension.");
+        AddOptionalOption(m_numCentroids, "-qk", "--centroids", "PQ centroids per subvector, 16 enables fast scan with ADC.");
 
         // We also use this to determine batch size (max number of vectors to load at once)
         AddOptionalOption(m_trainingSamples, "-ts", "--train_samples", "Number of samples for training.");
@@ -49,6 +50,8 @@ public:
 
     DimensionType m_quantizedDim;
 
+    SizeType m_numCentroids = 256;
+
     SizeType m_trainingSamples;
 
     SPTAG::QuantizerType m_quantizerType;
@@ -61,7 +64,11 @@ public:
 template <typename T>
 std::unique_ptr<T[]> TrainPQQuantizer(std::shared_ptr<QuantizerOptions> options, std::shared_ptr<VectorSet> raw_vectors, std::shared_ptr<VectorSet> quantized_vectors)
 {
-    SizeType numCentroids = 256;
+    SizeType numCentroids = options->m_numCentroids;
+    if (numCentroids < 1 || numCentroids > 256) {
+        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Centroids per subvector must be between 1 and 256.\n");
+        exit(1);
+    }
     if (raw_vectors->Dimension() % options->m_quantizedDim != 0) {
         SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Only n_codebooks that divide dimension are supported.\n");
         exit(1);
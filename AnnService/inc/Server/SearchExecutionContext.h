@@ -35,6 +35,8 @@ public:
 
     ErrorCode ExtractVector(VectorValueType p_targetType);
 
+    ErrorCode SetBinaryQuery(Socket::RemoteBinaryQuery& p_query);
+
     void AddResults(std::string p_indexName, QueryResult& p_results);
 
     std::vector<SearchResult>& GetResults();
@@ -47,6 +49,8 @@ public:
 
     const SizeType GetVectorDimension() const;
 
+    const SizeType GetVectorCount() const;
+
     const std::vector<QueryParser::OptionPair>& GetOptions() const;
 
     const SizeType GetResultNum() const;
@@ -64,12 +68,16 @@ private:
 
     SizeType m_vectorDimension;
 
+    SizeType m_vectorCount;
+
     std::vector<SearchResult> m_results;
 
     VectorValueType m_inputValueType;
 
     bool m_extractMetadata;
 
+    bool m_binaryQuery;
+
     SizeType m_resultNum;
 };
 
@@ -27,6 +27,11 @@ public:
                    std::shared_ptr<ServiceContext> p_serviceContext,
                    const CallBack& p_callback);
 
+    SearchExecutor(Socket::RemoteBinaryQuery p_query,
+                   bool p_batch,
+                   std::shared_ptr<ServiceContext> p_serviceContext,
+                   const CallBack& p_callback);
+
     ~SearchExecutor();
 
     void Execute();
@@ -45,6 +50,12 @@ private:
 
     std::string m_queryString;
 
+    Socket::RemoteBinaryQuery m_binaryQuery;
+
+    bool m_isBinaryQuery;
+
+    bool m_isBatchQuery;
+
     std::vector<std::shared_ptr<VectorIndex>> m_selectedIndex;
 };
 
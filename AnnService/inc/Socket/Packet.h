@@ -27,13 +27,21 @@ enum class PacketType : std::uint8_t
 
     SearchRequest = 0x03,
 
+    BinarySearchRequest = 0x04,
+
+    BatchSearchRequest = 0x05,
+
     ResponseMask = 0x80,
 
     HeartbeatResponse = ResponseMask | HeartbeatRequest,
 
     RegisterResponse = ResponseMask | RegisterRequest,
 
-    SearchResponse = ResponseMask | SearchRequest
+    SearchResponse = ResponseMask | SearchRequest,
+
+    BinarySearchResponse = ResponseMask | BinarySearchRequest,
+
+    BatchSearchResponse = ResponseMask | BatchSearchRequest
 };
 
 
@@ -45,6 +45,57 @@ struct RemoteQuery
 };
 
 
+// Search request with typed fields and the query vector as raw bytes, answered by a RemoteSearchResult.
+// A BatchSearchRequest packs several vectors back to back in m_vector; its RemoteSearchResult holds
+// one entry per selected index and vector, index-major.
+struct RemoteBinaryQuery
+{
+    static constexpr std::uint16_t MajorVersion() { return 1; }
+    static constexpr std::uint16_t MirrorVersion() { return 0; }
+
+    enum class QueryFlag : std::uint8_t
+    {
+        None = 0x00,
+
+        ExtractMetadata = 0x01
+    };
+
+    RemoteBinaryQuery();
+
+    std::size_t EstimateBufferSize() const;
+
+    std::uint8_t* Write(std::uint8_t* p_buffer) const;
+
+    // Largest number of results per vector a query may ask for.
+    static constexpr std::uint32_t MaxResultNum() { return 1 << 16; }
+
+    // m_vector is left pointing into p_buffer, so the buffer must outlive the query. Returns nullptr
+    // on a version mismatch, an unknown value type or when a field would run past the p_bufferLength
+    // bytes of p_buffer.
+    const std::uint8_t* Read(const std::uint8_t* p_buffer, std::size_t p_bufferLength);
+
+    bool HasFlag(QueryFlag p_flag) const;
+
+    void SetFlag(QueryFlag p_flag, bool p_value);
+
+    // Number of vectors in m_vector, or 0 if its length is not a whole number of vectors.
+    SizeType VectorCount() const;
+
+
+    std::uint8_t m_flags;
+
+    VectorValueType m_valueType;
+
+    DimensionType m_dimension;
+
+    std::uint32_t m_resultNum;
+
+    std::vector<std::string> m_indexNames;
+
+    ByteArray m_vector;
+};
+
+
 struct IndexSearchResult
 {
     std::string m_indexName;
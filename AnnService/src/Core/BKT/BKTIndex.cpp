@@ -2,7 +2,10 @@
 // Licensed under the MIT License.
 
 #include "inc/Core/BKT/Index.h"
+#include "inc/Core/Common/ScalarQuantizer.h"
+#include "inc/Helper/AsyncFileReader.h"
 #include <chrono>
+#include <thread>
 #include "inc/Core/ResultIterator.h"
 
 #pragma warning(disable:4242)  // '=' : conversion from 'int' to 'short', possible loss of data
@@ -65,11 +68,20 @@ namespace SPTAG
         {
             if (p_indexBlobs.size() < 3) return ErrorCode::LackOfInputs;
 
+            ApplyHugePages();
             if (m_pSamples.Load((char*)p_indexBlobs[0].Data(), m_iDataBlockSize, m_iDataCapacity) != ErrorCode::Success) return ErrorCode::FailedParseValue;
             if (m_pTrees.LoadTrees((char*)p_indexBlobs[1].Data()) != ErrorCode::Success) return ErrorCode::FailedParseValue;
             if (m_pGraph.LoadGraph((char*)p_indexBlobs[2].Data(), m_iDataBlockSize, m_iDataCapacity) != ErrorCode::Success) return ErrorCode::FailedParseValue;
             if (p_indexBlobs.size() <= 3) m_deletedID.Initialize(m_pSamples.R(), m_iDataBlockSize, m_iDataCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysContains);
             else if (m_deletedID.Load((char*)p_indexBlobs[3].Data(), m_iDataBlockSize, m_iDataCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysContains) != ErrorCode::Success) return ErrorCode::FailedParseValue;
+            if (m_bReorderGraph && p_indexBlobs.size() > 4)
+            {
+                COMMON::Dataset<SizeType> vertexMap;
+                if (vertexMap.Load((char*)p_indexBlobs[4].Data(), m_iDataBlockSize, m_iDataCapacity) != ErrorCode::Success ||
+                    LoadVertexMap(vertexMap) != ErrorCode::Success) return ErrorCode::FailedParseValue;
+            }
+            if (m_iRerankCandidates > 0 && p_indexBlobs.size() > FullVectorStream() &&
+                m_pFullSamples.Load((char*)p_indexBlobs[FullVectorStream()].Data(), m_iDataBlockSize, m_iDataCapacity) != ErrorCode::Success) return ErrorCode::FailedParseValue;
 
             if (m_pSamples.R() != m_pGraph.R() || m_pSamples.R() != m_deletedID.R())
             {
@@ -77,9 +89,12 @@ namespace SPTAG
                 return ErrorCode::FailedParseValue;
             }
 
-            omp_set_num_threads(m_iNumberOfThreads);
+            if (ApplyGraphFormat() != ErrorCode::Success) return ErrorCode::FailedParseValue;
+
             m_threadPool.init();
-            return ErrorCode::Success;
+            m_batchWorkSpaces.Init(0, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_pSamples.R(), (int)m_visitedSetType);
+            if (m_hugePagePolicy != HugePagePolicy::None) COMMON::PageAllocator::LogStats();
+            return UpdateNumaReplicas();
         }
 
         template <typename T>
@@ -88,21 +103,250 @@ namespace SPTAG
             if (p_indexStreams.size() < 4) return ErrorCode::LackOfInputs;
 
             ErrorCode ret = ErrorCode::Success;
+            ApplyHugePages();
             if (p_indexStreams[0] == nullptr || (ret = m_pSamples.Load(p_indexStreams[0], m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
             if (p_indexStreams[1] == nullptr || (ret = m_pTrees.LoadTrees(p_indexStreams[1])) != ErrorCode::Success) return ret;
             if (p_indexStreams[2] == nullptr || (ret = m_pGraph.LoadGraph(p_indexStreams[2], m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
             if (p_indexStreams[3] == nullptr) m_deletedID.Initialize(m_pSamples.R(), m_iDataBlockSize, m_iDataCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysContains);
             else if ((ret = m_deletedID.Load(p_indexStreams[3], m_iDataBlockSize, m_iDataCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysContains)) != ErrorCode::Success) return ret;
+            if (m_bReorderGraph && p_indexStreams.size() > 4 && p_indexStreams[4] != nullptr)
+            {
+                COMMON::Dataset<SizeType> vertexMap;
+                if ((ret = vertexMap.Load(p_indexStreams[4], m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
+                if ((ret = LoadVertexMap(vertexMap)) != ErrorCode::Success) return ret;
+            }
+            if (m_iRerankCandidates > 0 && p_indexStreams.size() > FullVectorStream() && p_indexStreams[FullVectorStream()] != nullptr &&
+                (ret = m_pFullSamples.Load(p_indexStreams[FullVectorStream()], m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
 
             if (m_pSamples.R() != m_pGraph.R() || m_pSamples.R() != m_deletedID.R())
             {
                 SPTAGLIB_LOG(SPTAG::Helper::LogLevel::LL_Error, "Index data is corrupted, please rebuild the index. Samples: %i, Graph: %i, DeletedID: %i.", m_pSamples.R(), m_pGraph.R(), m_deletedID.R());
                 return ErrorCode::FailedParseValue;
             }
+            if ((ret = ApplyGraphFormat()) != ErrorCode::Success) return ret;
 
-            omp_set_num_threads(m_iNumberOfThreads);
             m_threadPool.init();
-            return ret;
+            m_batchWorkSpaces.Init(0, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_pSamples.R(), (int)m_visitedSetType);
+            if (m_hugePagePolicy != HugePagePolicy::None) COMMON::PageAllocator::LogStats();
+            return UpdateNumaReplicas();
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::UpdateNumaReplicas()
+        {
+            std::atomic_store(&m_numaReplicas, std::shared_ptr<const NumaReplicaSet>());
+            if (!m_bNumaReplicas || GetNumSamples() == 0) return ErrorCode::Success;
+
+            // Serialize once, then let a thread on each node copy the streams into memory of its own node.
+            auto sizes = BufferSize();
+            std::vector<ByteArray> blobs;
+            std::vector<std::shared_ptr<Helper::DiskIO>> streams;
+            std::uint64_t totalSize = 0;
+            for (std::uint64_t size : *sizes)
+            {
+                blobs.push_back(ByteArray::Alloc(size));
+                std::shared_ptr<Helper::DiskIO> ptr(new Helper::SimpleBufferIO());
+                if (ptr == nullptr || !ptr->Initialize((char*)blobs.back().Data(), std::ios::binary | std::ios::out, size)) return ErrorCode::EmptyDiskIO;
+                streams.push_back(std::move(ptr));
+                totalSize += size;
+            }
+            // The caller keeps the index still, which may be from inside AddIndex with the data lock held.
+            ErrorCode ret = WriteIndexData(streams);
+            if (ret != ErrorCode::Success) return ret;
+
+            int numNodes = Helper::GetNumaNodeCount();
+            std::shared_ptr<NumaReplicaSet> replicas(new NumaReplicaSet(numNodes));
+            std::vector<ErrorCode> rets(numNodes, ErrorCode::Success);
+            std::vector<std::thread> threads;
+            for (int node = 0; node < numNodes; node++)
+            {
+                threads.emplace_back([&, node]() {
+                    Helper::BindThreadToNumaNode(node);
+                    rets[node] = LoadNumaReplica(blobs, (*replicas)[node]);
+                });
+            }
+            for (auto& thread : threads) thread.join();
+            for (int node = 0; node < numNodes; node++)
+            {
+                if (rets[node] != ErrorCode::Success)
+                {
+                    SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Failed to copy the index to NUMA node %d.\n", node);
+                    return rets[node];
+                }
+            }
+
+            std::atomic_store(&m_numaReplicas, std::shared_ptr<const NumaReplicaSet>(replicas));
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Copied the index to %d NUMA nodes, %llu bytes each, %llu bytes in total.\n",
+                numNodes, (unsigned long long)totalSize, (unsigned long long)(totalSize * numNodes));
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::LoadNumaReplica(const std::vector<ByteArray>& p_indexBlobs, std::shared_ptr<Index<T>>& p_replica) const
+        {
+            p_replica.reset(new Index<T>());
+            Index<T>* ptr = p_replica.get();
+
+#define DefineBKTParameter(VarName, VarType, DefaultValue, RepresentStr) \
+            ptr->VarName =  VarName; \
+
+#include "inc/Core/BKT/ParameterDefinitionList.h"
+#undef DefineBKTParameter
+            ptr->m_bNumaReplicas = false;
+            ptr->m_iNumberOfThreads = 1;
+            if (m_pQuantizer) ptr->SetQuantizer(m_pQuantizer);
+            ptr->m_fComputeDistance = m_fComputeDistance;
+            ptr->m_iBaseSquare = m_iBaseSquare;
+
+            std::vector<std::shared_ptr<Helper::DiskIO>> streams;
+            for (const ByteArray& blob : p_indexBlobs)
+            {
+                std::shared_ptr<Helper::DiskIO> stream(new Helper::SimpleBufferIO());
+                if (stream == nullptr || !stream->Initialize((char*)blob.Data(), std::ios::binary | std::ios::in, blob.Length())) return ErrorCode::EmptyDiskIO;
+                streams.push_back(std::move(stream));
+            }
+            ErrorCode ret = ptr->LoadIndexData(streams);
+            if (ret != ErrorCode::Success) return ret;
+            ptr->SetReady(true);
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        void Index<T>::InvalidateNumaReplicas()
+        {
+            // Searches already inside the copies hold them until they finish.
+            if (std::atomic_exchange(&m_numaReplicas, std::shared_ptr<const NumaReplicaSet>()) != nullptr)
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Warning, "Index changed, searches go back to the original index until NumaReplicas is set again.\n");
+            }
+        }
+
+        template <typename T>
+        void Index<T>::ApplyHugePages()
+        {
+            m_pSamples.SetHugePages(m_hugePagePolicy);
+            m_pFullSamples.SetHugePages(m_hugePagePolicy);
+            m_pGraph.SetHugePages(m_hugePagePolicy);
+            m_deletedID.SetHugePages(m_hugePagePolicy);
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::ApplyGraphFormat()
+        {
+            if (m_bReorderGraph == m_externalIDs.empty())
+            {
+                ErrorCode ret = ErrorCode::Success;
+                if ((ret = m_pGraph.Expand(m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
+
+                std::vector<SizeType> indices;
+                if (m_bReorderGraph) m_pTrees.VertexOrder(GetNumSamples(), indices);
+                else {
+                    indices.resize(GetNumSamples());
+                    for (SizeType i = 0; i < GetNumSamples(); i++) indices[i] = ToInternalID(i);
+                }
+                if ((ret = ReorderVertices(indices)) != ErrorCode::Success) return ret;
+            }
+
+            if (m_bCompactGraph) return m_pGraph.Compact(m_bCompactGraphDeltaCoding);
+            return m_pGraph.Expand(m_iDataBlockSize, m_iDataCapacity);
+        }
+
+        template <typename T>
+        void Index<T>::WaitForGraphWriters()
+        {
+            // Only adds queue rebuilds, so once they are done and the add lock is held no new one can start.
+            while (m_addsInFlight > 0) std::this_thread::yield();
+            while (m_rebuildsRunning > 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::ReorderVertices(const std::vector<SizeType>& indices)
+        {
+            SizeType numSamples = GetNumSamples();
+            if ((SizeType)indices.size() != numSamples) return ErrorCode::Fail;
+
+            std::vector<SizeType> reverseIndices(numSamples);
+            for (SizeType i = 0; i < numSamples; i++) reverseIndices[indices[i]] = i;
+
+            ErrorCode ret = ErrorCode::Success;
+            if ((ret = m_pSamples.Reorder(indices, m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
+            if (m_pFullSamples.R() == numSamples && (ret = m_pFullSamples.Reorder(indices, m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
+            if ((ret = m_pGraph.Reorder(indices, reverseIndices, m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
+            m_pTrees.RemapSamples(reverseIndices);
+
+            std::vector<SizeType> deleted;
+            for (SizeType i = 0; i < numSamples; i++) {
+                if (m_deletedID.Contains(i)) deleted.push_back(reverseIndices[i]);
+            }
+            m_deletedID.Initialize(numSamples, m_iDataBlockSize, m_iDataCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysContains);
+            for (SizeType id : deleted) m_deletedID.Insert(id);
+
+            std::vector<SizeType> externalIDs(numSamples);
+            bool identity = true;
+            for (SizeType i = 0; i < numSamples; i++) {
+                externalIDs[i] = ToExternalID(indices[i]);
+                if (externalIDs[i] != i) identity = false;
+            }
+            // The map is dropped only when the input order is restored, so a reordered index always saves one.
+            if (identity && !m_bReorderGraph) {
+                std::vector<SizeType>().swap(m_externalIDs);
+                std::vector<SizeType>().swap(m_internalIDs);
+            }
+            else {
+                m_internalIDs.resize(numSamples);
+                for (SizeType i = 0; i < numSamples; i++) m_internalIDs[externalIDs[i]] = i;
+                m_externalIDs.swap(externalIDs);
+            }
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Reorder %d vertices into %s order\n", numSamples, identity ? "input" : "traversal");
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::LoadVertexMap(const COMMON::Dataset<SizeType>& p_vertexMap)
+        {
+            SizeType numSamples = GetNumSamples();
+            if (p_vertexMap.R() != numSamples || p_vertexMap.C() != 1)
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Vertex map does not match the index. Samples: %d, Map: %d.\n", numSamples, p_vertexMap.R());
+                return ErrorCode::FailedParseValue;
+            }
+
+            m_externalIDs.resize(numSamples);
+            m_internalIDs.assign(numSamples, -1);
+            for (SizeType i = 0; i < numSamples; i++) {
+                SizeType id = *p_vertexMap[i];
+                if (id < 0 || id >= numSamples || m_internalIDs[id] >= 0) return ErrorCode::FailedParseValue;
+                m_externalIDs[i] = id;
+                m_internalIDs[id] = i;
+            }
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        void Index<T>::FinishResults(QueryResult& p_query, int p_resultNum) const
+        {
+            if (!m_externalIDs.empty())
+            {
+                for (int i = 0; i < p_resultNum; ++i)
+                {
+                    BasicResult* res = p_query.GetResult(i);
+                    res->VID = ToExternalID(res->VID);
+                }
+            }
+            AttachMetadata(p_query, p_resultNum);
+        }
+
+        template <typename T>
+        void Index<T>::AttachMetadata(QueryResult& p_query, int p_resultNum) const
+        {
+            if (p_query.WithMeta() && nullptr != m_pMetadata)
+            {
+                for (int i = 0; i < p_resultNum; ++i)
+                {
+                    SizeType result = p_query.GetResult(i)->VID;
+                    p_query.SetMetadata(i, (result < 0) ? ByteArray::c_empty : m_pMetadata->GetMetadataCopy(result));
+                }
+            }
         }
 
         template <typename T>
@@ -132,12 +376,29 @@ namespace SPTAG
             
             std::lock_guard<std::mutex> lock(m_dataAddLock);
             std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
+            return WriteIndexData(p_indexStreams);
+        }
 
+        template <typename T>
+        ErrorCode Index<T>::WriteIndexData(const std::vector<std::shared_ptr<Helper::DiskIO>>& p_indexStreams)
+        {
             ErrorCode ret = ErrorCode::Success;
             if ((ret = m_pSamples.Save(p_indexStreams[0])) != ErrorCode::Success) return ret;
             if ((ret = m_pTrees.SaveTrees(p_indexStreams[1])) != ErrorCode::Success) return ret;
             if ((ret = m_pGraph.SaveGraph(p_indexStreams[2])) != ErrorCode::Success) return ret;
             if ((ret = m_deletedID.Save(p_indexStreams[3])) != ErrorCode::Success) return ret;
+            if (m_bReorderGraph && p_indexStreams.size() > 4)
+            {
+                std::vector<SizeType> externalIDs(GetNumSamples());
+                for (SizeType i = 0; i < GetNumSamples(); i++) externalIDs[i] = ToExternalID(i);
+                COMMON::Dataset<SizeType> vertexMap(GetNumSamples(), 1, m_iDataBlockSize, m_iDataCapacity, externalIDs.data());
+                vertexMap.SetName("VertexMap");
+                if ((ret = vertexMap.Save(p_indexStreams[4])) != ErrorCode::Success) return ret;
+            }
+            if (m_iRerankCandidates > 0 && p_indexStreams.size() > FullVectorStream())
+            {
+                if ((ret = m_pFullSamples.Save(p_indexStreams[FullVectorStream()])) != ErrorCode::Success) return ret;
+            }
             return ret;
         }
         
@@ -265,88 +526,167 @@ namespace SPTAG
         p_query.SortResult(); \
 */
 
+        // Collects the unvisited neighbors a block at a time, prefetches their vectors and scores the whole block
+        // against the query before touching the queues, so the distance loop runs over vectors already in flight.
         template<typename T>
-        template <bool(*notDeleted)(const COMMON::Labelset&, SizeType), 
-            bool(*isDup)(COMMON::QueryResultSet<T>&, SizeType, float), 
-            bool(*checkFilter)(const std::shared_ptr<MetadataSet>&, SizeType, std::function<bool(const ByteArray&)>)>
-        void Index<T>::Search(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, std::function<bool(const ByteArray&)> filterFunc) const
+        template <typename Dist>
+        inline void Index<T>::ScoreNeighbors(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, const SizeType* node, const Dist& fComputeDistance) const
         {
-            std::shared_lock<std::shared_timed_mutex> lock(*(m_pTrees.m_lock));
-            m_pTrees.InitSearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space);
-            m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfInitialDynamicPivots);
-            const DimensionType checkPos = m_pGraph.m_iNeighborhoodSize - 1;
+            const int blockSize = 16;
+            SizeType ids[blockSize];
+            const T* vecs[blockSize];
+            float dists[blockSize];
+            const T* target = p_query.GetQuantizedTarget();
+            DimensionType dim = GetFeatureDim();
+            DimensionType i = 0;
+            while (i < m_pGraph.m_iNeighborhoodSize)
+            {
+                int count = 0;
+                for (; i < m_pGraph.m_iNeighborhoodSize && count < blockSize; i++)
+                {
+                    SizeType nn_index = node[i];
+                    if (nn_index < 0)
+                    {
+                        i = m_pGraph.m_iNeighborhoodSize;
+                        break;
+                    }
+                    if (p_space.CheckAndSet(nn_index)) continue;
+                    ids[count] = nn_index;
+                    vecs[count] = (m_pSamples)[nn_index];
+                    _mm_prefetch((const char*)vecs[count++], _MM_HINT_T0);
+                }
+                if (count == 0) break;
 
-            while (!p_space.m_NGQueue.empty()) {
-                NodeDistPair gnode = p_space.m_NGQueue.pop();
-                SizeType tmpNode = gnode.node;
-                const SizeType* node = m_pGraph[tmpNode];
-                _mm_prefetch((const char*)node, _MM_HINT_T0);
-                for (DimensionType i = 0; i <= checkPos; i++) {
-                    auto futureNode = node[i];
-                    if (futureNode < 0) break;
-                    _mm_prefetch((const char*)(m_pSamples)[futureNode], _MM_HINT_T0);
+                for (int j = 0; j < count; j++) dists[j] = fComputeDistance(target, vecs[j], dim);
+                for (int j = 0; j < count; j++)
+                {
+                    p_space.m_iNumberOfCheckedLeaves++;
+                    if (p_space.m_Results.insert(dists[j]))
+                    {
+                        p_space.m_NGQueue.insert(NodeDistPair(ids[j], dists[j]));
+                    }
                 }
+            }
+        }
 
-                if (gnode.distance <= p_query.worstDist()) 
+        // Collects the unvisited neighbors and scores them a block at a time with the quantizer's fast scan.
+        template<typename T>
+        inline void Index<T>::ScoreNeighbors(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, const SizeType* node, const COMMON::QuantizerBatchDistance<T>& fComputeDistance) const
+        {
+            SizeType ids[COMMON::IQuantizer::c_batchSize];
+            const std::uint8_t* codes[COMMON::IQuantizer::c_batchSize];
+            float dists[COMMON::IQuantizer::c_batchSize];
+            DimensionType i = 0;
+            while (i < m_pGraph.m_iNeighborhoodSize)
+            {
+                int count = 0;
+                for (; i < m_pGraph.m_iNeighborhoodSize && count < COMMON::IQuantizer::c_batchSize; i++)
                 {
-                    SizeType checkNode = node[checkPos];
-                    if (checkNode < -1) 
+                    SizeType nn_index = node[i];
+                    if (nn_index < 0)
                     {
-                        const COMMON::BKTNode& tnode = m_pTrees[-2 - checkNode];
-                        SizeType i = -tnode.childStart;
-                        do
-                        {
-                            if (notDeleted(m_deletedID, tmpNode))
-                            {
-                                if (checkFilter(m_pMetadata, tmpNode, filterFunc))
-                                {
-                                    if (isDup(p_query, tmpNode, gnode.distance))
-                                        break;
-                                }
-                            }
-                            if (i <= 0) break;
-                            tmpNode = m_pTrees[i].centerid;
-                        } while (i++ < tnode.childEnd);
+                        i = m_pGraph.m_iNeighborhoodSize;
+                        break;
                     }
-                    else {
+                    if (p_space.CheckAndSet(nn_index)) continue;
+                    ids[count] = nn_index;
+                    codes[count++] = (const std::uint8_t*)(m_pSamples)[nn_index];
+                }
+                if (count == 0) break;
 
+                fComputeDistance.m_quantizer->L2DistanceBatch((const std::uint8_t*)p_query.GetQuantizedTarget(), codes, count, dists);
+                for (int j = 0; j < count; j++)
+                {
+                    p_space.m_iNumberOfCheckedLeaves++;
+                    if (p_space.m_Results.insert(dists[j]))
+                    {
+                        p_space.m_NGQueue.insert(NodeDistPair(ids[j], dists[j]));
+                    }
+                }
+            }
+        }
+
+        template<typename T>
+        template <bool(*notDeleted)(const COMMON::Labelset&, SizeType), 
+            bool(*isDup)(COMMON::QueryResultSet<T>&, SizeType, float), 
+            bool(*checkFilter)(const std::shared_ptr<MetadataSet>&, SizeType, std::function<bool(const ByteArray&)>), typename Dist>
+        inline bool Index<T>::ExpandNode(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, const NodeDistPair& gnode, const SizeType* node, const std::function<bool(const ByteArray&)>& filterFunc, const Dist& fComputeDistance, const COMMON::BKTree::ReadView& p_trees) const
+        {
+            const DimensionType checkPos = m_pGraph.m_iNeighborhoodSize - 1;
+            SizeType tmpNode = gnode.node;
+
+            if (gnode.distance <= p_query.worstDist()) 
+            {
+                SizeType checkNode = node[checkPos];
+                if (checkNode < -1 && p_trees.IsCenter(-2 - checkNode, tmpNode)) 
+                {
+                    const COMMON::BKTNode& tnode = p_trees[-2 - checkNode];
+                    SizeType i = -tnode.childStart;
+                    do
+                    {
                         if (notDeleted(m_deletedID, tmpNode))
                         {
-                            if (checkFilter(m_pMetadata, tmpNode, filterFunc))
+                            if (checkFilter(m_pMetadata, ToExternalID(tmpNode), filterFunc))
                             {
-                                p_query.AddPoint(tmpNode, gnode.distance);
+                                if (isDup(p_query, tmpNode, gnode.distance))
+                                    break;
                             }
                         }
-                    }
+                        if (i <= 0) break;
+                        tmpNode = p_trees[i].centerid;
+                    } while (i++ < tnode.childEnd);
                 }
-                else 
-                {
+                else {
+
                     if (notDeleted(m_deletedID, tmpNode))
                     {
-                        if (gnode.distance > p_space.m_Results.worst() || p_space.m_iNumberOfCheckedLeaves > p_space.m_iMaxCheck) 
+                        if (checkFilter(m_pMetadata, ToExternalID(tmpNode), filterFunc))
                         {
-                                p_query.SortResult();
-                                return;
+                            p_query.AddPoint(tmpNode, gnode.distance);
                         }
                     }
                 }
-                for (DimensionType i = 0; i <= checkPos; i++) 
+            }
+            else 
+            {
+                if (notDeleted(m_deletedID, tmpNode))
                 {
-                    SizeType nn_index = node[i];
-                    if (nn_index < 0) break;
-
-                    if (p_space.CheckAndSet(nn_index)) continue;
-                    float distance2leaf = m_fComputeDistance(p_query.GetQuantizedTarget(), (m_pSamples)[nn_index], GetFeatureDim());
-                    p_space.m_iNumberOfCheckedLeaves++;
-                    if (p_space.m_Results.insert(distance2leaf))
+                    if (gnode.distance > p_space.m_Results.worst() || p_space.m_iNumberOfCheckedLeaves > p_space.m_iMaxCheck) 
                     {
-                        p_space.m_NGQueue.insert(NodeDistPair(nn_index, distance2leaf));
+                        return false;
                     }
                 }
-                if (p_space.m_NGQueue.Top().distance > p_space.m_SPTQueue.Top().distance)
-                {
-                    m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfOtherDynamicPivots + p_space.m_iNumberOfCheckedLeaves);
+            }
+            ScoreNeighbors(p_query, p_space, node, fComputeDistance);
+            if (p_space.m_NGQueue.Top().distance > p_space.m_SPTQueue.Top().distance)
+            {
+                p_trees.SearchTrees(m_pSamples, fComputeDistance, p_query, p_space, m_iNumberOfOtherDynamicPivots + p_space.m_iNumberOfCheckedLeaves);
+            }
+            return true;
+        }
+
+        template<typename T>
+        template <bool(*notDeleted)(const COMMON::Labelset&, SizeType), 
+            bool(*isDup)(COMMON::QueryResultSet<T>&, SizeType, float), 
+            bool(*checkFilter)(const std::shared_ptr<MetadataSet>&, SizeType, std::function<bool(const ByteArray&)>), typename Dist>
+        void Index<T>::Search(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, const std::function<bool(const ByteArray&)>& filterFunc, const Dist& fComputeDistance) const
+        {
+            COMMON::BKTree::ReadView trees(m_pTrees);
+            trees.InitSearchTrees(m_pSamples, fComputeDistance, p_query, p_space);
+            trees.SearchTrees(m_pSamples, fComputeDistance, p_query, p_space, m_iNumberOfInitialDynamicPivots);
+            const DimensionType checkPos = m_pGraph.m_iNeighborhoodSize - 1;
+
+            while (!p_space.m_NGQueue.empty()) {
+                NodeDistPair gnode = p_space.m_NGQueue.pop();
+                const SizeType* node = m_pGraph.Row(gnode.node, p_space.m_graphRow);
+                _mm_prefetch((const char*)node, _MM_HINT_T0);
+                for (DimensionType i = 0; i <= checkPos; i++) {
+                    auto futureNode = node[i];
+                    if (futureNode < 0) break;
+                    _mm_prefetch((const char*)(m_pSamples)[futureNode], _MM_HINT_T0);
                 }
+
+                if (!ExpandNode<notDeleted, isDup, checkFilter>(p_query, p_space, gnode, node, filterFunc, fComputeDistance, trees)) break;
             }
             p_query.SortResult();
         }
@@ -357,10 +697,10 @@ namespace SPTAG
             int Index<T>::SearchIterative(COMMON::QueryResultSet<T>& p_query, 
                 COMMON::WorkSpace& p_space, bool p_isFirst, int batch) const
         {
-            std::shared_lock<std::shared_timed_mutex> lock(*(m_pTrees.m_lock));
+            COMMON::BKTree::ReadView trees(m_pTrees);
             if (p_isFirst) {
-                m_pTrees.InitSearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space);
-                m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, 
+                trees.InitSearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space);
+                trees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, 
                     p_space, m_iNumberOfInitialDynamicPivots);
             } 
             int count = 0;
@@ -368,7 +708,7 @@ namespace SPTAG
             while (!p_space.m_NGQueue.empty()) {
                 NodeDistPair gnode = p_space.m_NGQueue.pop();
                 SizeType tmpNode = gnode.node;
-                const SizeType* node = m_pGraph[tmpNode];
+                const SizeType* node = m_pGraph.Row(tmpNode, p_space.m_graphRow);
                 _mm_prefetch((const char*)node, _MM_HINT_T0);
                 for (DimensionType i = 0; i <= checkPos; i++) {
                     auto futureNode = node[i];
@@ -385,11 +725,11 @@ namespace SPTAG
                     }
                 }
                 SizeType checkNode = node[checkPos];
-                if (checkNode < -1) {
-                    const COMMON::BKTNode& tnode = m_pTrees[-2 - checkNode];
+                if (checkNode < -1 && trees.IsCenter(-2 - checkNode, gnode.node)) {
+                    const COMMON::BKTNode& tnode = trees[-2 - checkNode];
                     SizeType i = -tnode.childStart;
                     while (i < tnode.childEnd) {
-                        tmpNode = m_pTrees[i].centerid;
+                        tmpNode = trees[i].centerid;
                         if (notDeleted(m_deletedID, tmpNode))
                         {
                             float distance2leaf = m_fComputeDistance(
@@ -414,7 +754,7 @@ namespace SPTAG
                     p_space.m_Results.insert(distance2leaf);
                 }
                 if (p_space.m_NGQueue.Top().distance > p_space.m_SPTQueue.Top().distance) {
-                    m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance,
+                    trees.SearchTrees(m_pSamples, m_fComputeDistance,
                         p_query, p_space,
                         m_iNumberOfOtherDynamicPivots + p_space.m_iNumberOfCheckedLeaves);
                 }
@@ -460,6 +800,109 @@ namespace SPTAG
 
         };
 
+        template<typename T>
+        template <bool(*notDeleted)(const COMMON::Labelset&, SizeType), bool(*isDup)(COMMON::QueryResultSet<T>&, SizeType, float), typename Dist>
+        void Index<T>::SearchBatch(COMMON::QueryResultSet<T>** p_queries, COMMON::WorkSpace** p_spaces, int p_count, const Dist& fComputeDistance) const
+        {
+            COMMON::BKTree::ReadView trees(m_pTrees);
+            const DimensionType checkPos = m_pGraph.m_iNeighborhoodSize - 1;
+
+            // Every active query sits on a popped node in one of two stages: its graph row has been
+            // prefetched (rowReady == false), or the row is cached and the neighbor vectors have been
+            // prefetched as well (rowReady == true) so the node can be expanded on the next visit.
+            std::vector<NodeDistPair> pending(p_count);
+            std::vector<const SizeType*> rows(p_count);
+            std::vector<bool> rowReady(p_count, false);
+            std::vector<int> active;
+            active.reserve(p_count);
+            for (int q = 0; q < p_count; q++)
+            {
+                trees.InitSearchTrees(m_pSamples, fComputeDistance, *p_queries[q], *p_spaces[q]);
+                trees.SearchTrees(m_pSamples, fComputeDistance, *p_queries[q], *p_spaces[q], m_iNumberOfInitialDynamicPivots);
+                if (p_spaces[q]->m_NGQueue.empty())
+                {
+                    p_queries[q]->SortResult();
+                    continue;
+                }
+                pending[q] = p_spaces[q]->m_NGQueue.pop();
+                _mm_prefetch((const char*)m_pGraph.RowAddress(pending[q].node), _MM_HINT_T0);
+                active.push_back(q);
+            }
+
+            while (!active.empty())
+            {
+                for (size_t a = 0; a < active.size();)
+                {
+                    int q = active[a];
+                    if (!rowReady[q])
+                    {
+                        const SizeType* node = m_pGraph.Row(pending[q].node, p_spaces[q]->m_graphRow);
+                        for (DimensionType i = 0; i <= checkPos; i++) {
+                            auto futureNode = node[i];
+                            if (futureNode < 0) break;
+                            _mm_prefetch((const char*)(m_pSamples)[futureNode], _MM_HINT_T0);
+                        }
+                        rows[q] = node;
+                        rowReady[q] = true;
+                        a++;
+                        continue;
+                    }
+
+                    COMMON::WorkSpace& space = *p_spaces[q];
+                    if (ExpandNode<notDeleted, isDup, StaticDispatch::AlwaysTrue>(*p_queries[q], space, pending[q], rows[q], nullptr, fComputeDistance, trees) && !space.m_NGQueue.empty())
+                    {
+                        pending[q] = space.m_NGQueue.pop();
+                        _mm_prefetch((const char*)m_pGraph.RowAddress(pending[q].node), _MM_HINT_T0);
+                        rowReady[q] = false;
+                        a++;
+                    }
+                    else
+                    {
+                        p_queries[q]->SortResult();
+                        active[a] = active.back();
+                        active.pop_back();
+                    }
+                }
+            }
+        }
+
+        template<typename T>
+        template <bool(*notDeleted)(const COMMON::Labelset&, SizeType)>
+        void Index<T>::SearchStaged(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, int p_stageCheck, std::function<void(QueryResult&)>& p_onStage) const
+        {
+            COMMON::QueryResultSet<T> stage(p_query.GetTarget(), p_query.GetResultNum());
+            {
+                COMMON::BKTree::ReadView trees(m_pTrees);
+                trees.InitSearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space);
+                trees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfInitialDynamicPivots);
+                const DimensionType checkPos = m_pGraph.m_iNeighborhoodSize - 1;
+
+                int nextStage = p_stageCheck;
+                while (!p_space.m_NGQueue.empty()) {
+                    NodeDistPair gnode = p_space.m_NGQueue.pop();
+                    const SizeType* node = m_pGraph.Row(gnode.node, p_space.m_graphRow);
+                    _mm_prefetch((const char*)node, _MM_HINT_T0);
+                    for (DimensionType i = 0; i <= checkPos; i++) {
+                        auto futureNode = node[i];
+                        if (futureNode < 0) break;
+                        _mm_prefetch((const char*)(m_pSamples)[futureNode], _MM_HINT_T0);
+                    }
+
+                    if (!ExpandNode<notDeleted, StaticDispatch::CheckDup, StaticDispatch::AlwaysTrue>(p_query, p_space, gnode, node, nullptr, m_fComputeDistance, trees)) break;
+
+                    // The result heap must stay intact for the rest of the walk, so the snapshot is sorted on a copy.
+                    if (p_space.m_iNumberOfCheckedLeaves >= nextStage) {
+                        std::copy(p_query.GetResults(), p_query.GetResults() + p_query.GetResultNum(), stage.GetResults());
+                        stage.SortResult();
+                        FinishResults(stage, stage.GetResultNum());
+                        p_onStage(stage);
+                        nextStage = p_space.m_iNumberOfCheckedLeaves + p_stageCheck;
+                    }
+                }
+            }
+            p_query.SortResult();
+        }
+
         template <typename T>
         void Index<T>::SearchIndex(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted, bool p_searchDuplicated, std::function<bool(const ByteArray&)> filterFunc) const
         {
@@ -474,36 +917,48 @@ namespace SPTAG
             flags += p_searchDuplicated << 1;
             flags += (filterFunc == nullptr);
 
-            switch (flags)
+            // The distance kernel is resolved once per query so the hot loops call it directly; filtered
+            // searches are dominated by the metadata callback and keep the generic distance.
+            auto search = [&](const auto& fComputeDistance) {
+                switch (flags)
+                {
+                case 0b000:
+                    this->Search<StaticDispatch::CheckIfNotDeleted, StaticDispatch::NeverDup, StaticDispatch::CheckFilter>(p_query, p_space, filterFunc, m_fComputeDistance);
+                    break;
+                case 0b001:
+                    this->Search<StaticDispatch::CheckIfNotDeleted, StaticDispatch::NeverDup, StaticDispatch::AlwaysTrue>(p_query, p_space, filterFunc, fComputeDistance);
+                    break;
+                case 0b010:
+                    this->Search<StaticDispatch::CheckIfNotDeleted, StaticDispatch::CheckDup, StaticDispatch::CheckFilter>(p_query, p_space, filterFunc, m_fComputeDistance);
+                    break;
+                case 0b011:
+                    this->Search<StaticDispatch::CheckIfNotDeleted, StaticDispatch::CheckDup, StaticDispatch::AlwaysTrue>(p_query, p_space, filterFunc, fComputeDistance);
+                    break;
+                case 0b100:
+                    this->Search<StaticDispatch::AlwaysTrue, StaticDispatch::NeverDup, StaticDispatch::CheckFilter>(p_query, p_space, filterFunc, m_fComputeDistance);
+                    break;
+                case 0b101:
+                    this->Search<StaticDispatch::AlwaysTrue, StaticDispatch::NeverDup, StaticDispatch::AlwaysTrue>(p_query, p_space, filterFunc, fComputeDistance);
+                    break;
+                case 0b110:
+                    this->Search<StaticDispatch::AlwaysTrue, StaticDispatch::CheckDup, StaticDispatch::CheckFilter>(p_query, p_space, filterFunc, m_fComputeDistance);
+                    break;
+                case 0b111:
+                    this->Search<StaticDispatch::AlwaysTrue, StaticDispatch::CheckDup, StaticDispatch::AlwaysTrue>(p_query, p_space, filterFunc, fComputeDistance);
+                    break;
+                default:
+                    std::ostringstream oss;
+                    oss << "Invalid flags in BKT SearchIndex dispatch: " << flags;
+                    throw std::logic_error(oss.str());
+                }
+            };
+            if (m_pQuantizer && m_pQuantizer->FastScanEnabled() && m_iDistCalcMethod == DistCalcMethod::L2)
             {
-            case 0b000:
-                Search<StaticDispatch::CheckIfNotDeleted, StaticDispatch::NeverDup, StaticDispatch::CheckFilter>(p_query, p_space, filterFunc);
-                break;
-            case 0b001:
-                Search<StaticDispatch::CheckIfNotDeleted, StaticDispatch::NeverDup, StaticDispatch::AlwaysTrue>(p_query, p_space, filterFunc);
-                break;
-            case 0b010:
-                Search<StaticDispatch::CheckIfNotDeleted, StaticDispatch::CheckDup, StaticDispatch::CheckFilter>(p_query, p_space, filterFunc);
-                break;
-            case 0b011:
-                Search<StaticDispatch::CheckIfNotDeleted, StaticDispatch::CheckDup, StaticDispatch::AlwaysTrue>(p_query, p_space, filterFunc);
-                break;
-            case 0b100:
-                Search<StaticDispatch::AlwaysTrue, StaticDispatch::NeverDup, StaticDispatch::CheckFilter>(p_query, p_space, filterFunc);
-                break;
-            case 0b101:
-                Search<StaticDispatch::AlwaysTrue, StaticDispatch::NeverDup, StaticDispatch::AlwaysTrue>(p_query, p_space, filterFunc);
-                break;
-            case 0b110:
-                Search<StaticDispatch::AlwaysTrue, StaticDispatch::CheckDup, StaticDispatch::CheckFilter>(p_query, p_space, filterFunc);
-                break;
-            case 0b111:
-                Search<StaticDispatch::AlwaysTrue, StaticDispatch::CheckDup, StaticDispatch::AlwaysTrue>(p_query, p_space, filterFunc);
-                break;
-            default:
-                std::ostringstream oss;
-                oss << "Invalid flags in BKT SearchIndex dispatch: " << flags;
-                throw std::logic_error(oss.str());
+                COMMON::DistanceDispatch<T>(nullptr, COMMON::QuantizerBatchDistance<T>{ m_pQuantizer.get() }, search);
+            }
+            else
+            {
+                COMMON::DistanceDispatch<T>(DistanceKernel(), m_fComputeDistance, search);
             }
         }
 
@@ -542,6 +997,7 @@ namespace SPTAG
         template <typename T>
         bool Index<T>::SearchIndexIterativeFromNeareast(QueryResult& p_query, COMMON::WorkSpace* p_space, bool p_isFirst, bool p_searchDeleted) const
         {
+            COMMON::BKTree::ReadView view(m_pTrees);
             if (p_isFirst) 
             {
 		        p_space->ResetResult(m_iMaxCheck, p_query.GetResultNum());
@@ -555,7 +1011,7 @@ namespace SPTAG
                         continue;
                     p_space->nodeCheckStatus.CheckAndSet(result);
                     const DimensionType checkPos = m_pGraph.m_iNeighborhoodSize - 1;
-                    const SizeType* node = m_pGraph[result];
+                    const SizeType* node = m_pGraph.Row(result, p_space->m_graphRow);
                     _mm_prefetch((const char*)node, _MM_HINT_T0);
                     for (DimensionType i = 0; i <= checkPos; i++) {
                         auto futureNode = node[i];
@@ -577,45 +1033,166 @@ namespace SPTAG
                 p_space->ResetResult(m_iMaxCheck, p_query.GetResultNum());
                 SearchIndexIterative(*((COMMON::QueryResultSet<T>*) & p_query), *p_space, p_isFirst, p_query.GetResultNum(), p_searchDeleted, true);
             }
-            if (p_query.GetResult(0) == nullptr || p_query.GetResult(0)->VID < 0)
+            if (p_query.GetResult(0) == nullptr || p_query.GetResult(0)->VID < 0)
+            {
+                return false;
+            }
+            FinishResults(p_query, p_query.GetResultNum());
+            return true;
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchIndex(QueryResult &p_query, bool p_searchDeleted) const
+        {
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+            // Held until the ids and metadata are attached, so a compaction cannot swap them in between.
+            COMMON::BKTree::ReadView view(m_pTrees);
+
+            std::shared_ptr<const NumaReplicaSet> replicas = NumaReplicas();
+            if (replicas != nullptr)
+            {
+                // The copy maps ids back to caller ids itself, only the metadata is kept here.
+                ErrorCode ret = (*replicas)[Helper::GetCurrentNumaNode() % replicas->size()]->SearchIndex(p_query, p_searchDeleted);
+                if (ret == ErrorCode::Success) AttachMetadata(p_query, p_query.GetResultNum());
+                return ret;
+            }
+
+            auto workSpace = m_workSpaceFactory->GetWorkSpace();
+            if (!workSpace) {
+                workSpace.reset(new COMMON::WorkSpace());
+                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_pSamples.R(), m_visitedSetType);
+            }
+            if (Reranks())
+            {
+                // Walk the graph on the codes for extra candidates, then order them by full-precision distance.
+                COMMON::QueryResultSet<T> candidates((const T*)p_query.GetTarget(), max(m_iRerankCandidates, p_query.GetResultNum()));
+                workSpace->Reset(m_iMaxCheck, candidates.GetResultNum());
+                SearchIndex(candidates, *workSpace, p_searchDeleted, true);
+
+                switch (m_pQuantizer->GetReconstructType())
+                {
+#define DefineVectorValueType(Name, Type) \
+                case VectorValueType::Name: \
+                    Rerank<Type>(p_query, candidates); \
+                    break; \
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineVectorValueType
+
+                default: break;
+                }
+            }
+            else
             {
-                return false;
+                workSpace->Reset(m_iMaxCheck, p_query.GetResultNum());
+                SearchIndex(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, p_searchDeleted, true);
             }
-            if (p_query.WithMeta() && nullptr != m_pMetadata)
+
+            m_workSpaceFactory->ReturnWorkSpace(std::move(workSpace));
+
+            FinishResults(p_query, p_query.GetResultNum());
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        template <typename R>
+        void Index<T>::Rerank(QueryResult& p_query, const COMMON::QueryResultSet<T>& p_candidates) const
+        {
+            DimensionType dim = m_pQuantizer->ReconstructDim();
+            auto fComputeDistance = COMMON::DistanceCalcSelector<R>(m_iDistCalcMethod, dim);
+            const R* target = (const R*)p_query.GetTarget();
+
+            COMMON::QueryResultSet<R>& query = *((COMMON::QueryResultSet<R>*)&p_query);
+            query.Reset();
+            for (int i = 0; i < p_candidates.GetResultNum(); i++)
             {
-                for (int i = 0; i < p_query.GetResultNum(); ++i)
-                {
-                    SizeType result = p_query.GetResult(i)->VID;
-                    p_query.SetMetadata(i, (result < 0) ? ByteArray::c_empty : m_pMetadata->GetMetadataCopy(result));
-                }
+                SizeType vid = p_candidates.GetResult(i)->VID;
+                if (vid < 0) continue;
+                query.AddPoint(vid, fComputeDistance(target, (const R*)m_pFullSamples[vid], dim));
             }
-            return true;
+            query.SortResult();
         }
 
         template<typename T>
-        ErrorCode Index<T>::SearchIndex(QueryResult &p_query, bool p_searchDeleted) const
+        ErrorCode Index<T>::SearchIndexStaged(QueryResult& p_query, int p_stageCheck, std::function<void(QueryResult&)> p_onStage, bool p_searchDeleted) const
         {
             if (!m_bReady) return ErrorCode::EmptyIndex;
+            if (p_stageCheck <= 0 || !p_onStage) return SearchIndex(p_query, p_searchDeleted);
+            COMMON::BKTree::ReadView view(m_pTrees);
 
             auto workSpace = m_workSpaceFactory->GetWorkSpace();
             if (!workSpace) {
                 workSpace.reset(new COMMON::WorkSpace());
-                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_pSamples.R(), m_visitedSetType);
             }
             workSpace->Reset(m_iMaxCheck, p_query.GetResultNum());
 
-            SearchIndex(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, p_searchDeleted, true);
+            COMMON::QueryResultSet<T>& query = *((COMMON::QueryResultSet<T>*)&p_query);
+            if (m_pQuantizer && !query.HasQuantizedTarget())
+            {
+                query.SetTarget(query.GetTarget(), m_pQuantizer);
+            }
+            if (m_deletedID.Count() == 0 || p_searchDeleted)
+                SearchStaged<StaticDispatch::AlwaysTrue>(query, *workSpace, p_stageCheck, p_onStage);
+            else
+                SearchStaged<StaticDispatch::CheckIfNotDeleted>(query, *workSpace, p_stageCheck, p_onStage);
 
             m_workSpaceFactory->ReturnWorkSpace(std::move(workSpace));
 
-            if (p_query.WithMeta() && nullptr != m_pMetadata)
+            FinishResults(p_query, p_query.GetResultNum());
+            return ErrorCode::Success;
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchIndexBatch(QueryResult* p_queries, int p_queryCount, bool p_searchDeleted) const
+        {
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+            std::shared_ptr<const NumaReplicaSet> replicas = NumaReplicas();
+            if (replicas == nullptr && Reranks()) return VectorIndex::SearchIndexBatch(p_queries, p_queryCount, p_searchDeleted);
+
+            int batchSize = max(1, m_iBatchSearchSize);
+            int batchCount = (p_queryCount + batchSize - 1) / batchSize;
+            bool checkDeleted = !(m_deletedID.Count() == 0 || p_searchDeleted);
+            Helper::TaskScheduler::Instance().ParallelFor(0, batchCount, m_iNumberOfThreads, [&](SizeType b)
             {
-                for (int i = 0; i < p_query.GetResultNum(); ++i)
+                int begin = b * batchSize;
+                int count = min(batchSize, p_queryCount - begin);
+                COMMON::BKTree::ReadView view(m_pTrees);
+                if (replicas != nullptr)
                 {
-                    SizeType result = p_query.GetResult(i)->VID;
-                    p_query.SetMetadata(i, (result < 0) ? ByteArray::c_empty : m_pMetadata->GetMetadataCopy(result));
+                    // Each batch goes to the copy on the node of the thread that picked it up.
+                    (*replicas)[Helper::GetCurrentNumaNode() % replicas->size()]->SearchIndexBatch(p_queries + begin, count, p_searchDeleted);
+                    for (int i = 0; i < count; i++) AttachMetadata(p_queries[begin + i], p_queries[begin + i].GetResultNum());
+                    return;
                 }
-            }
+
+                std::vector<std::shared_ptr<COMMON::WorkSpace>> rented(count);
+                std::vector<COMMON::WorkSpace*> spaces(count);
+                std::vector<COMMON::QueryResultSet<T>*> queries(count);
+                for (int i = 0; i < count; i++)
+                {
+                    rented[i] = m_batchWorkSpaces.Rent();
+                    rented[i]->Reset(m_iMaxCheck, p_queries[begin + i].GetResultNum());
+                    spaces[i] = rented[i].get();
+                    queries[i] = (COMMON::QueryResultSet<T>*)&p_queries[begin + i];
+                    if (m_pQuantizer && !queries[i]->HasQuantizedTarget())
+                    {
+                        queries[i]->SetTarget(queries[i]->GetTarget(), m_pQuantizer);
+                    }
+                }
+
+                COMMON::DistanceDispatch<T>(DistanceKernel(), m_fComputeDistance, [&](const auto& fComputeDistance) {
+                    if (checkDeleted) this->SearchBatch<StaticDispatch::CheckIfNotDeleted, StaticDispatch::CheckDup>(queries.data(), spaces.data(), count, fComputeDistance);
+                    else this->SearchBatch<StaticDispatch::AlwaysTrue, StaticDispatch::CheckDup>(queries.data(), spaces.data(), count, fComputeDistance);
+                });
+
+                for (int i = 0; i < count; i++)
+                {
+                    m_batchWorkSpaces.Return(rented[i]);
+
+                    FinishResults(p_queries[begin + i], p_queries[begin + i].GetResultNum());
+                }
+            });
             return ErrorCode::Success;
         }
 
@@ -623,11 +1200,12 @@ namespace SPTAG
         ErrorCode Index<T>::SearchIndexWithFilter(QueryResult& p_query, std::function<bool(const ByteArray&)> filterFunc, int maxCheck, bool p_searchDeleted) const
         {
             if (!m_bReady) return ErrorCode::EmptyIndex;
+            COMMON::BKTree::ReadView view(m_pTrees);
 
             auto workSpace = m_workSpaceFactory->GetWorkSpace();
             if (!workSpace) {
                 workSpace.reset(new COMMON::WorkSpace());
-                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_pSamples.R(), m_visitedSetType);
             }
 			workSpace->Reset(maxCheck == 0 ? m_iMaxCheck : maxCheck, p_query.GetResultNum());
 
@@ -635,14 +1213,7 @@ namespace SPTAG
 
             m_workSpaceFactory->ReturnWorkSpace(std::move(workSpace));
 
-            if (p_query.WithMeta() && nullptr != m_pMetadata)
-            {
-                for (int i = 0; i < p_query.GetResultNum(); ++i)
-                {
-                    SizeType result = p_query.GetResult(i)->VID;
-                    p_query.SetMetadata(i, (result < 0) ? ByteArray::c_empty : m_pMetadata->GetMetadataCopy(result));
-                }
-            }
+            FinishResults(p_query, p_query.GetResultNum());
             return ErrorCode::Success;
         }
 
@@ -660,17 +1231,11 @@ namespace SPTAG
         ErrorCode Index<T>::SearchIndexIterativeNext(QueryResult& p_query, COMMON::WorkSpace* workSpace, int p_batch, int& resultCount,  bool p_isFirst, bool p_searchDeleted) const
         {
             if (!m_bReady) return ErrorCode::EmptyIndex;
+            COMMON::BKTree::ReadView view(m_pTrees);
             workSpace->ResetResult(m_iMaxCheck, p_batch);
             resultCount = SearchIndexIterative(*((COMMON::QueryResultSet<T>*) & p_query), *workSpace, p_isFirst, p_batch, p_searchDeleted, true);
 
-            if (p_query.WithMeta() && nullptr != m_pMetadata)
-            {
-                for (int i = 0; i < resultCount; ++i)
-                {
-                    SizeType result = p_query.GetResult(i)->VID;
-                    p_query.SetMetadata(i, (result < 0) ? ByteArray::c_empty : m_pMetadata->GetMetadataCopy(result));
-                }
-            }
+            FinishResults(p_query, resultCount);
             return ErrorCode::Success;
         }
 
@@ -689,7 +1254,7 @@ namespace SPTAG
             auto workSpace = m_workSpaceFactory->GetWorkSpace();
             if (!workSpace) {
                 workSpace.reset(new COMMON::WorkSpace());
-                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_pSamples.R(), m_visitedSetType);
             }
             workSpace->Reset(m_iMaxCheck, batch);
             return std::move(workSpace);
@@ -701,7 +1266,7 @@ namespace SPTAG
             auto workSpace = m_workSpaceFactory->GetWorkSpace();
             if (!workSpace) {
                 workSpace.reset(new COMMON::WorkSpace());
-                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_pSamples.R(), m_visitedSetType);
             }
             workSpace->Reset(m_pGraph.m_iMaxCheckForRefineGraph, p_query.GetResultNum());
             SearchIndex(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, p_searchDeleted, false);
@@ -716,18 +1281,19 @@ namespace SPTAG
             auto workSpace = m_workSpaceFactory->GetWorkSpace();
             if (!workSpace) {
                 workSpace.reset(new COMMON::WorkSpace());
-                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_pSamples.R(), m_visitedSetType);
             }
             workSpace->Reset(m_pGraph.m_iMaxCheckForRefineGraph, p_query.GetResultNum());
 
             COMMON::QueryResultSet<T>* p_results = (COMMON::QueryResultSet<T>*)&p_query;
-            m_pTrees.InitSearchTrees(m_pSamples, m_fComputeDistance, *p_results, *workSpace);
-            m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, *p_results, *workSpace, m_iNumberOfInitialDynamicPivots);
+            COMMON::BKTree::ReadView trees(m_pTrees);
+            trees.InitSearchTrees(m_pSamples, m_fComputeDistance, *p_results, *workSpace);
+            trees.SearchTrees(m_pSamples, m_fComputeDistance, *p_results, *workSpace, m_iNumberOfInitialDynamicPivots);
             BasicResult * res = p_query.GetResults();
             for (int i = 0; i < p_query.GetResultNum(); i++)
             {
                 auto& cell = workSpace->m_NGQueue.pop();
-                res[i].VID = cell.node;
+                res[i].VID = ToExternalID(cell.node);
                 res[i].Dist = cell.distance;
             }
             m_workSpaceFactory->ReturnWorkSpace(std::move(workSpace));
@@ -741,21 +1307,23 @@ namespace SPTAG
         {
             if (p_data == nullptr || p_vectorNum == 0 || p_dimension == 0) return ErrorCode::EmptyData;
 
-            omp_set_num_threads(m_iNumberOfThreads);
-
+            ApplyHugePages();
             m_pSamples.Initialize(p_vectorNum, p_dimension, m_iDataBlockSize, m_iDataCapacity, (T*)p_data, p_shareOwnership);
             m_deletedID.Initialize(p_vectorNum, m_iDataBlockSize, m_iDataCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysContains);
+            m_pFullSamples.Clear();
+            std::vector<SizeType>().swap(m_externalIDs);
+            std::vector<SizeType>().swap(m_internalIDs);
 
             if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized)
             {
                 int base = COMMON::Utils::GetBase<T>();
-#pragma omp parallel for
-                for (SizeType i = 0; i < GetNumSamples(); i++) {
+                Helper::TaskScheduler::Instance().ParallelFor(0, GetNumSamples(), m_iNumberOfThreads, [&](SizeType i) {
                     COMMON::Utils::Normalize(m_pSamples[i], GetFeatureDim(), base);
-                }
+                });
             }
 
             m_threadPool.init();
+            m_batchWorkSpaces.Init(0, max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_pSamples.R(), (int)m_visitedSetType);
 
             auto t1 = std::chrono::high_resolution_clock::now();
             m_pTrees.BuildTrees<T>(m_pSamples, m_iDistCalcMethod, m_iNumberOfThreads);
@@ -767,13 +1335,116 @@ namespace SPTAG
             auto t3 = std::chrono::high_resolution_clock::now();
             SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Build Graph time (s): %lld\n", std::chrono::duration_cast<std::chrono::seconds>(t3 - t2).count());
 
+            ErrorCode ret = ApplyGraphFormat();
+            if (ret != ErrorCode::Success) return ret;
+
+            if (m_hugePagePolicy != HugePagePolicy::None) COMMON::PageAllocator::LogStats();
             m_bReady = true;
+            return UpdateNumaReplicas();
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::BuildQuantizedIndex(std::shared_ptr<VectorSet> p_vectorSet, bool p_normalized)
+        {
+            if (GetEnumValueType<T>() != VectorValueType::UInt8 || (m_iScalarQuantizerBits != 4 && m_iScalarQuantizerBits != 8))
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Building from %s vectors needs a UInt8 index with ScalarQuantizerBits=4 or 8.\n",
+                    Helper::Convert::ConvertToString(p_vectorSet->GetValueType()).c_str());
+                return ErrorCode::Fail;
+            }
+
+            SizeType num = p_vectorSet->Count();
+            DimensionType dim = p_vectorSet->Dimension();
+            if (num == 0 || dim == 0) return ErrorCode::EmptyData;
+
+            ByteArray full = ByteArray::Alloc(((size_t)p_vectorSet->PerVectorDataSize()) * num);
+            std::memcpy(full.Data(), p_vectorSet->GetData(), full.Length());
+            std::shared_ptr<COMMON::IQuantizer> quantizer;
+            switch (p_vectorSet->GetValueType())
+            {
+#define DefineVectorValueType(Name, Type) \
+            case VectorValueType::Name: \
+                if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized) \
+                    COMMON::Utils::BatchNormalize((Type*)full.Data(), num, dim, COMMON::Utils::GetBase<Type>(), m_iNumberOfThreads); \
+                quantizer = COMMON::ScalarQuantizer<Type>::Train((const Type*)full.Data(), num, dim, m_iScalarQuantizerBits); \
+                break; \
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineVectorValueType
+
+            default: break;
+            }
+            if (!quantizer) return ErrorCode::Fail;
+
+            DimensionType codeSize = quantizer->GetNumSubvectors();
+            std::uint8_t* codes = (std::uint8_t*)ALIGN_ALLOC(((size_t)codeSize) * num);
+            Helper::TaskScheduler::Instance().ParallelFor(0, num, m_iNumberOfThreads, [&](SizeType i)
+            {
+                quantizer->QuantizeVector(full.Data() + ((size_t)i) * p_vectorSet->PerVectorDataSize(), codes + ((size_t)i) * codeSize, false);
+            });
+
+            SetQuantizer(quantizer);
+            ErrorCode ret = BuildIndex(codes, num, codeSize, true, false);
+            ALIGN_FREE(codes);
+            if (ret != ErrorCode::Success) return ret;
+
+            if (m_iRerankCandidates > 0)
+            {
+                m_pFullSamples.Initialize(num, (DimensionType)p_vectorSet->PerVectorDataSize(), m_iDataBlockSize, m_iDataCapacity, full.Data(), false);
+                if (m_bReorderGraph) m_pFullSamples.Reorder(m_externalIDs, m_iDataBlockSize, m_iDataCapacity);
+                return UpdateNumaReplicas();
+            }
             return ErrorCode::Success;
         }
 
+        template <typename T>
+        ErrorCode Index<T>::AddQuantizedIndex(std::shared_ptr<VectorSet> p_vectorSet, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex, bool p_normalized)
+        {
+            if (!m_pQuantizer || p_vectorSet->GetValueType() != m_pQuantizer->GetReconstructType()) return ErrorCode::Fail;
+
+            SizeType num = p_vectorSet->Count();
+            if (num == 0 || p_vectorSet->Dimension() == 0) return ErrorCode::EmptyData;
+            if ((SizeType)p_vectorSet->PerVectorDataSize() != m_pQuantizer->ReconstructSize()) return ErrorCode::DimensionSizeMismatch;
+
+            ByteArray full = ByteArray::Alloc(((size_t)p_vectorSet->PerVectorDataSize()) * num);
+            std::memcpy(full.Data(), p_vectorSet->GetData(), full.Length());
+            if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized)
+            {
+                switch (p_vectorSet->GetValueType())
+                {
+#define DefineVectorValueType(Name, Type) \
+                case VectorValueType::Name: \
+                    COMMON::Utils::BatchNormalize((Type*)full.Data(), num, p_vectorSet->Dimension(), COMMON::Utils::GetBase<Type>(), m_iNumberOfThreads); \
+                    break; \
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineVectorValueType
+
+                default: break;
+                }
+            }
+
+            DimensionType codeSize = m_pQuantizer->GetNumSubvectors();
+            std::uint8_t* codes = (std::uint8_t*)ALIGN_ALLOC(((size_t)codeSize) * num);
+            Helper::TaskScheduler::Instance().ParallelFor(0, num, m_iNumberOfThreads, [&](SizeType i)
+            {
+                m_pQuantizer->QuantizeVector(full.Data() + ((size_t)i) * p_vectorSet->PerVectorDataSize(), codes + ((size_t)i) * codeSize, false);
+            });
+
+            ErrorCode ret = AddIndexRows(codes, num, codeSize, p_metadataSet, p_withMetaIndex, true, full.Data());
+            ALIGN_FREE(codes);
+            return ret;
+        }
+
         template <typename T>
         ErrorCode Index<T>::RefineIndex(std::shared_ptr<VectorIndex>& p_newIndex)
         {
+            if (m_pGraph.IsCompact())
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Cannot refine an index with a compact graph, set CompactGraph=false first.\n");
+                return ErrorCode::Fail;
+            }
+
             p_newIndex.reset(new Index<T>());
             Index<T>* ptr = (Index<T>*)p_newIndex.get();
 
@@ -782,6 +1453,8 @@ namespace SPTAG
 
 #include "inc/Core/BKT/ParameterDefinitionList.h"
 #undef DefineBKTParameter
+            if (m_pQuantizer) ptr->SetQuantizer(m_pQuantizer);
+            ptr->ApplyHugePages();
 
             std::lock_guard<std::mutex> lock(m_dataAddLock);
             std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
@@ -808,15 +1481,20 @@ namespace SPTAG
             if (newR == 0) return ErrorCode::EmptyIndex;
 
             ptr->m_threadPool.init();
+            ptr->m_batchWorkSpaces.Init(0, max(ptr->m_iMaxCheck, ptr->m_pGraph.m_iMaxCheckForRefineGraph), ptr->m_iHashTableExp, ptr->m_pSamples.R(), (int)ptr->m_visitedSetType);
 
             ErrorCode ret = ErrorCode::Success;
             if ((ret = m_pSamples.Refine(indices, ptr->m_pSamples)) != ErrorCode::Success) return ret;
-            if (nullptr != m_pMetadata && (ret = m_pMetadata->RefineMetadata(indices, ptr->m_pMetadata, m_iDataBlockSize, m_iDataCapacity, m_iMetaRecordSize)) != ErrorCode::Success) return ret;
+            if (m_pFullSamples.R() > 0 && (ret = m_pFullSamples.Refine(indices, ptr->m_pFullSamples)) != ErrorCode::Success) return ret;
+            std::vector<SizeType> metaIndices = ToExternalIDs(indices);
+            if (nullptr != m_pMetadata && (ret = m_pMetadata->RefineMetadata(metaIndices, ptr->m_pMetadata, m_iDataBlockSize, m_iDataCapacity, m_iMetaRecordSize)) != ErrorCode::Success) return ret;
 
             ptr->m_deletedID.Initialize(newR, m_iDataBlockSize, m_iDataCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysContains);
             COMMON::BKTree* newtree = &(ptr->m_pTrees);
-            (*newtree).BuildTrees<T>(ptr->m_pSamples, ptr->m_iDistCalcMethod, omp_get_num_threads());
+            (*newtree).BuildTrees<T>(ptr->m_pSamples, ptr->m_iDistCalcMethod, m_iNumberOfThreads);
             m_pGraph.RefineGraph<T>(this, indices, reverseIndices, nullptr, &(ptr->m_pGraph), &(ptr->m_pTrees.GetSampleMap()));
+            // The refined ids are new, so a reordered index starts over from the traversal order of its own trees.
+            if (ptr->m_bReorderGraph && (ret = ptr->ApplyGraphFormat()) != ErrorCode::Success) return ret;
             if (HasMetaMapping()) ptr->BuildMetaMapping(false);
             ptr->m_bReady = true;
             return ret;
@@ -825,6 +1503,27 @@ namespace SPTAG
         template <typename T>
         ErrorCode Index<T>::RefineIndex(const std::vector<std::shared_ptr<Helper::DiskIO>>& p_indexStreams, IAbortOperation* p_abort)
         {
+            if (m_pGraph.IsCompact())
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Cannot refine an index with a compact graph, set CompactGraph=false first.\n");
+                return ErrorCode::Fail;
+            }
+            if (m_bOnlineRefine)
+            {
+                // The refined copy is built from a snapshot without blocking adds and deletes, and only the copy is
+                // saved: the ids of this index stay as they are, like with the refine below.
+                std::vector<SizeType> idMap;
+                std::unique_ptr<Index<T>> compacted;
+                ErrorCode ret = RunCompaction(idMap, &compacted, p_abort);
+                if (ret == ErrorCode::Success) ret = compacted->SaveIndexData(p_indexStreams);
+                size_t metaStart = compacted->GetIndexFiles()->size();
+                if (ret == ErrorCode::Success && nullptr != compacted->m_pMetadata) {
+                    if (p_indexStreams.size() < metaStart + 2) return ErrorCode::LackOfInputs;
+                    ret = compacted->m_pMetadata->SaveMetadata(p_indexStreams[metaStart], p_indexStreams[metaStart + 1]);
+                }
+                return ret;
+            }
+
             std::lock_guard<std::mutex> lock(m_dataAddLock);
             std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
 
@@ -855,7 +1554,7 @@ namespace SPTAG
             if (p_abort != nullptr && p_abort->ShouldAbort()) return ErrorCode::ExternalAbort;
 
             COMMON::BKTree newTrees(m_pTrees);
-            newTrees.BuildTrees<T>(m_pSamples, m_iDistCalcMethod, omp_get_num_threads(), &indices, &reverseIndices);
+            newTrees.BuildTrees<T>(m_pSamples, m_iDistCalcMethod, m_iNumberOfThreads, &indices, &reverseIndices);
             if ((ret = newTrees.SaveTrees(p_indexStreams[1])) != ErrorCode::Success) return ret;
 
             if (p_abort != nullptr && p_abort->ShouldAbort()) return ErrorCode::ExternalAbort;
@@ -865,18 +1564,220 @@ namespace SPTAG
             COMMON::Labelset newDeletedID;
             newDeletedID.Initialize(newR, m_iDataBlockSize, m_iDataCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysContains);
             if ((ret = newDeletedID.Save(p_indexStreams[3])) != ErrorCode::Success) return ret;
+            if (m_bReorderGraph && p_indexStreams.size() > 4)
+            {
+                // The refined vertices keep their order and take new ids, so the saved map is the identity.
+                std::vector<SizeType> identity(newR);
+                for (SizeType i = 0; i < newR; i++) identity[i] = i;
+                COMMON::Dataset<SizeType> vertexMap(newR, 1, m_iDataBlockSize, m_iDataCapacity, identity.data());
+                vertexMap.SetName("VertexMap");
+                if ((ret = vertexMap.Save(p_indexStreams[4])) != ErrorCode::Success) return ret;
+            }
+            if (m_iRerankCandidates > 0 && p_indexStreams.size() > FullVectorStream())
+            {
+                if (m_pFullSamples.R() > 0) ret = m_pFullSamples.Refine(indices, p_indexStreams[FullVectorStream()]);
+                else ret = m_pFullSamples.Save(p_indexStreams[FullVectorStream()]);
+                if (ret != ErrorCode::Success) return ret;
+            }
+            size_t metaStart = GetIndexFiles()->size();
             if (nullptr != m_pMetadata) {
-                if (p_indexStreams.size() < 6) return ErrorCode::LackOfInputs;
-                if ((ret = m_pMetadata->RefineMetadata(indices, p_indexStreams[4], p_indexStreams[5])) != ErrorCode::Success) return ret;
+                if (p_indexStreams.size() < metaStart + 2) return ErrorCode::LackOfInputs;
+                std::vector<SizeType> metaIndices = ToExternalIDs(indices);
+                if ((ret = m_pMetadata->RefineMetadata(metaIndices, p_indexStreams[metaStart], p_indexStreams[metaStart + 1])) != ErrorCode::Success) return ret;
+            }
+            return ret;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::CompactIndex(std::vector<SizeType>& p_idMap, IAbortOperation* p_abort)
+        {
+            return RunCompaction(p_idMap, nullptr, p_abort);
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::RunCompaction(std::vector<SizeType>& p_idMap, std::unique_ptr<Index<T>>* p_copy, IAbortOperation* p_abort)
+        {
+            if (m_pGraph.IsCompact())
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Cannot compact an index with a compact graph, set CompactGraph=false first.\n");
+                return ErrorCode::Fail;
+            }
+            std::unique_lock<std::mutex> compactionLock(m_compactionLock, std::try_to_lock);
+            if (!compactionLock.owns_lock())
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Another compaction of this index is running.\n");
+                return ErrorCode::Fail;
+            }
+
+            // The snapshot waits for the adds that are still linking their vectors, so that it only holds
+            // finished rows. From here on deletes are logged and tree rebuilds are put off.
+            SizeType snapshot;
+            {
+                std::lock_guard<std::mutex> lock(m_dataAddLock);
+                while (m_addsInFlight > 0) std::this_thread::yield();
+                std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
+                snapshot = GetNumSamples();
+                m_compactionDeletes.clear();
+                m_compacting = true;
+            }
+
+            std::unique_ptr<Index<T>> compacted;
+            ErrorCode ret = BuildCompactedCopy(snapshot, p_idMap, compacted, p_abort);
+            if (ret == ErrorCode::Success)
+            {
+                if (p_copy != nullptr) p_copy->swap(compacted);
+                else ret = SwapInCompaction(snapshot, p_idMap, compacted.get());
             }
+            m_compacting = false;
             return ret;
         }
 
+        template <typename T>
+        ErrorCode Index<T>::BuildCompactedCopy(SizeType p_snapshot, std::vector<SizeType>& p_idMap, std::unique_ptr<Index<T>>& p_copy, IAbortOperation* p_abort)
+        {
+            // Same order as RefineIndex: holes are filled with the last vectors, so most ids stay put. Deletes
+            // that race with the scan are in the log either way.
+            SizeType newR = p_snapshot;
+            std::vector<SizeType> indices;
+            std::vector<SizeType> reverseIndices(p_snapshot, -1);
+            for (SizeType i = 0; i < newR; i++) {
+                if (!m_deletedID.Contains(i)) {
+                    indices.push_back(i);
+                    reverseIndices[i] = i;
+                }
+                else {
+                    while (m_deletedID.Contains(newR - 1) && newR > i) newR--;
+                    if (newR == i) break;
+                    indices.push_back(newR - 1);
+                    reverseIndices[newR - 1] = i;
+                    newR--;
+                }
+            }
+
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Compact in the background... from %d -> %d\n", p_snapshot, newR);
+            if (newR == 0) return ErrorCode::EmptyIndex;
+
+            p_copy.reset(new Index<T>());
+            Index<T>* ptr = p_copy.get();
+
+#define DefineBKTParameter(VarName, VarType, DefaultValue, RepresentStr) \
+            ptr->VarName =  VarName; \
+
+#include "inc/Core/BKT/ParameterDefinitionList.h"
+#undef DefineBKTParameter
+            if (m_pQuantizer) ptr->SetQuantizer(m_pQuantizer);
+            ptr->m_fComputeDistance = m_fComputeDistance;
+            ptr->m_iBaseSquare = m_iBaseSquare;
+            ptr->ApplyHugePages();
+            // The copy only lives until the swap, so the replayed adds must not queue tree rebuilds on it.
+            ptr->m_addCountForRebuild = MaxSize;
+
+            ErrorCode ret = ErrorCode::Success;
+            if ((ret = m_pSamples.Refine(indices, ptr->m_pSamples)) != ErrorCode::Success) return ret;
+            if (m_pFullSamples.R() > 0 && (ret = m_pFullSamples.Refine(indices, ptr->m_pFullSamples)) != ErrorCode::Success) return ret;
+            std::vector<SizeType> metaIndices = ToExternalIDs(indices);
+            if (nullptr != m_pMetadata && (ret = m_pMetadata->RefineMetadata(metaIndices, ptr->m_pMetadata, m_iDataBlockSize, m_iDataCapacity, m_iMetaRecordSize)) != ErrorCode::Success) return ret;
+            ptr->m_deletedID.Initialize(newR, m_iDataBlockSize, m_iDataCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysContains);
+            if (p_abort != nullptr && p_abort->ShouldAbort()) return ErrorCode::ExternalAbort;
+
+            ptr->m_pTrees.BuildTrees<T>(ptr->m_pSamples, ptr->m_iDistCalcMethod, m_iNumberOfThreads, nullptr, nullptr, false, p_abort);
+            if (p_abort != nullptr && p_abort->ShouldAbort()) return ErrorCode::ExternalAbort;
+            if ((ret = m_pGraph.RefineGraph<T>(this, indices, reverseIndices, nullptr, &(ptr->m_pGraph), &(ptr->m_pTrees.GetSampleMap()))) != ErrorCode::Success) return ret;
+            if (HasMetaMapping()) ptr->BuildMetaMapping(false);
+            ptr->m_bReady = true;
+            if (p_abort != nullptr && p_abort->ShouldAbort()) return ErrorCode::ExternalAbort;
+            p_idMap.swap(reverseIndices);
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::SwapInCompaction(SizeType p_snapshot, std::vector<SizeType>& p_idMap, Index<T>* p_copy)
+        {
+            // Catch up with the adds made so far without holding any lock, until only a short tail is left.
+            ErrorCode ret = ErrorCode::Success;
+            SizeType replayed = p_snapshot;
+            while (true)
+            {
+                SizeType added;
+                {
+                    std::lock_guard<std::mutex> lock(m_dataAddLock);
+                    added = GetNumSamples();
+                }
+                if (added - replayed <= c_compactionTail) break;
+                if ((ret = ReplayAdds(p_copy, replayed, added, p_idMap)) != ErrorCode::Success) return ret;
+                replayed = added;
+            }
+
+            while (m_rebuildsRunning > 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            std::lock_guard<std::mutex> lock(m_dataAddLock);
+            while (m_addsInFlight > 0) std::this_thread::yield();
+            std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
+            std::lock_guard<COMMON::EpochManager> treeLock(*(m_pTrees.m_epoch));
+            if ((ret = ReplayAdds(p_copy, replayed, GetNumSamples(), p_idMap)) != ErrorCode::Success) return ret;
+            for (SizeType id : m_compactionDeletes) {
+                if (p_idMap[id] >= 0) p_copy->m_deletedID.Insert(p_idMap[id]);
+            }
+            m_compactionDeletes.clear();
+            // The map so far goes from vertex to vertex. Callers hold their own ids, and the copy has no id maps
+            // of its own, so its vertices are the new caller ids.
+            if (!m_externalIDs.empty())
+            {
+                std::vector<SizeType> idMap(p_idMap.size());
+                for (SizeType i = 0; i < (SizeType)p_idMap.size(); i++) idMap[i] = p_idMap[ToInternalID(i)];
+                p_idMap.swap(idMap);
+            }
+
+            m_pSamples.Swap(p_copy->m_pSamples);
+            m_pFullSamples.Swap(p_copy->m_pFullSamples);
+            m_pTrees.SwapTree(p_copy->m_pTrees);
+            m_pGraph.SwapRows(p_copy->m_pGraph);
+            m_deletedID.Swap(p_copy->m_deletedID);
+            m_externalIDs.swap(p_copy->m_externalIDs);
+            m_internalIDs.swap(p_copy->m_internalIDs);
+            std::atomic_store(&m_pMetadata, p_copy->m_pMetadata);
+            m_pMetaToVec.swap(p_copy->m_pMetaToVec);
+            // The old rows may still point into the loaded files, so these are freed together with them.
+            m_indexFileBuffers.swap(p_copy->m_indexFileBuffers);
+            m_compacting = false;
+            InvalidateNumaReplicas();
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Compacted %d vectors into %d.\n", (SizeType)p_idMap.size(), GetNumSamples());
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::ReplayAdds(Index<T>* p_target, SizeType p_begin, SizeType p_end, std::vector<SizeType>& p_idMap)
+        {
+            DimensionType dim = GetFeatureDim();
+            std::vector<T> rows;
+            std::vector<std::uint8_t> fullRows;
+            for (SizeType begin = p_begin; begin < p_end; begin += c_compactionTail)
+            {
+                SizeType end = min(begin + c_compactionTail, p_end);
+                rows.resize((size_t)(end - begin) * dim);
+                if (m_pFullSamples.R() > 0) {
+                    fullRows.resize((size_t)(end - begin) * m_pFullSamples.C());
+                    for (SizeType i = begin; i < end; i++) std::memcpy(fullRows.data() + (size_t)(i - begin) * m_pFullSamples.C(), m_pFullSamples[i], m_pFullSamples.C());
+                }
+                std::shared_ptr<MetadataSet> metadata;
+                if (nullptr != m_pMetadata) metadata.reset(new MemMetadataSet(m_iDataBlockSize, m_iDataCapacity, m_iMetaRecordSize));
+                for (SizeType i = begin; i < end; i++) {
+                    std::memcpy(rows.data() + (size_t)(i - begin) * dim, m_pSamples[i], sizeof(T) * dim);
+                    if (nullptr != metadata) metadata->Add(m_pMetadata->GetMetadata(i));
+                }
+
+                SizeType first = p_target->GetNumSamples();
+                ErrorCode ret = p_target->AddIndexRows(rows.data(), end - begin, dim, metadata, HasMetaMapping(), true, fullRows.empty() ? nullptr : fullRows.data());
+                if (ret != ErrorCode::Success) return ret;
+                for (SizeType i = begin; i < end; i++) p_idMap.push_back(first + i - begin);
+            }
+            return ErrorCode::Success;
+        }
+
         template <typename T>
         ErrorCode Index<T>::DeleteIndex(const void* p_vectors, SizeType p_vectorNum) {
             const T* ptr_v = (const T*)p_vectors;
-#pragma omp parallel for schedule(dynamic)
-            for (SizeType i = 0; i < p_vectorNum; i++) {
+            Helper::TaskScheduler::Instance().ParallelFor(0, p_vectorNum, m_iNumberOfThreads, [&](SizeType i) {
                 COMMON::QueryResultSet<T> query(ptr_v + i * GetFeatureDim(), m_pGraph.m_iCEF);
                 SearchIndex(query);
 
@@ -885,7 +1786,7 @@ namespace SPTAG
                         DeleteIndex(query.GetResult(j)->VID);
                     }
                 }
-            }
+            });
             return ErrorCode::Success;
         }
 
@@ -894,17 +1795,46 @@ namespace SPTAG
             if (!m_bReady) return ErrorCode::EmptyIndex;
 
             std::shared_lock<std::shared_timed_mutex> sharedlock(m_dataDeleteLock);
-            if (m_deletedID.Insert(p_id)) return ErrorCode::Success;
+            if (m_deletedID.Insert(ToInternalID(p_id)))
+            {
+                InvalidateNumaReplicas();
+                if (m_compacting)
+                {
+                    std::lock_guard<std::mutex> lock(m_compactionLogLock);
+                    m_compactionDeletes.push_back(ToInternalID(p_id));
+                }
+                return ErrorCode::Success;
+            }
             return ErrorCode::VectorNotFound;
         }
 
         template <typename T>
         ErrorCode Index<T>::AddIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex, bool p_normalized)
+        {
+            return AddIndexRows(p_data, p_vectorNum, p_dimension, p_metadataSet, p_withMetaIndex, p_normalized, nullptr);
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::AddFullRows(const void* p_codes, SizeType p_vectorNum, const std::uint8_t* p_fullRows)
+        {
+            if (p_fullRows != nullptr) return m_pFullSamples.AddBatch(p_fullRows, p_vectorNum);
+            if (!m_pQuantizer || m_pQuantizer->ReconstructSize() != m_pFullSamples.C()) return ErrorCode::Fail;
+
+            std::vector<std::uint8_t> rows((size_t)p_vectorNum * m_pFullSamples.C());
+            for (SizeType i = 0; i < p_vectorNum; i++) {
+                m_pQuantizer->ReconstructVector((const std::uint8_t*)p_codes + (size_t)i * GetFeatureDim() * sizeof(T), rows.data() + (size_t)i * m_pFullSamples.C());
+            }
+            return m_pFullSamples.AddBatch(rows.data(), p_vectorNum);
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::AddIndexRows(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex, bool p_normalized, const std::uint8_t* p_fullRows)
         {
             if (p_data == nullptr || p_vectorNum == 0 || p_dimension == 0) return ErrorCode::EmptyData;
 
             SizeType begin, end;
             ErrorCode ret;
+            InFlightCount inFlight(m_addsInFlight);
             {
                 std::lock_guard<std::mutex> lock(m_dataAddLock);
 
@@ -918,15 +1848,33 @@ namespace SPTAG
                         if (p_withMetaIndex) BuildMetaMapping(false);
                     }
                     if ((ret = BuildIndex(p_data, p_vectorNum, p_dimension, p_normalized)) != ErrorCode::Success) return ret;
+                    if (p_fullRows != nullptr && m_iRerankCandidates > 0) {
+                        m_pFullSamples.Initialize(p_vectorNum, (DimensionType)m_pQuantizer->ReconstructSize(), m_iDataBlockSize, m_iDataCapacity, (std::uint8_t*)p_fullRows, false);
+                    }
                     return ErrorCode::Success;
                 }
 
                 if (p_dimension != GetFeatureDim()) return ErrorCode::DimensionSizeMismatch;
 
+                if (m_pGraph.IsCompact())
+                {
+                    SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Cannot add vectors to an index with a compact graph, set CompactGraph=false first.\n");
+                    return ErrorCode::Fail;
+                }
+                bool fullRows = m_pFullSamples.R() > 0;
+                if (fullRows && AddFullRows(p_data, p_vectorNum, p_fullRows) != ErrorCode::Success)
+                {
+                    SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Cannot add the full-precision rows of the vectors!\n");
+                    m_pFullSamples.SetR(begin);
+                    return ErrorCode::Fail;
+                }
+                InvalidateNumaReplicas();
+
                 if (m_pSamples.AddBatch((const T*)p_data, p_vectorNum) != ErrorCode::Success || 
                     m_pGraph.AddBatch(p_vectorNum) != ErrorCode::Success || 
                     m_deletedID.AddBatch(p_vectorNum) != ErrorCode::Success) {
                     SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Memory Error: Cannot alloc space for vectors!\n");
+                    if (fullRows) m_pFullSamples.SetR(begin);
                     m_pSamples.SetR(begin);
                     m_pGraph.SetR(begin);
                     m_deletedID.SetR(begin);
@@ -948,32 +1896,93 @@ namespace SPTAG
                         for (SizeType i = begin; i < end; i++) m_pMetadata->Add(ByteArray::c_empty);
                     }
                 }
+                inFlight.Raise();
             }
 
+            // The ids are reserved above; linking them runs outside the add lock, and the reverse edges that
+            // several new vectors share are serialized by the per-node locks of the graph.
+            int addThreads = (int)min((SizeType)max(m_iAddThreads, 1), end - begin);
             if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized)
             {
                 int base = COMMON::Utils::GetBase<T>();
-                for (SizeType i = begin; i < end; i++) {
+                Helper::TaskScheduler::Instance().ParallelFor(begin, end, addThreads, [&](SizeType i) {
                     COMMON::Utils::Normalize((T*)m_pSamples[i], GetFeatureDim(), base);
-                }
+                });
             }
 
-            if (end - m_pTrees.sizePerTree() >= m_addCountForRebuild && m_threadPool.jobsize() == 0) {
-                m_threadPool.add(new RebuildJob(&m_pSamples, &m_pTrees, &m_pGraph, m_iDistCalcMethod));
+            if (!m_compacting && end - m_pTrees.sizePerTree() >= m_addCountForRebuild && m_threadPool.jobsize() == 0) {
+                m_threadPool.add(new RebuildJob(&m_pSamples, &m_pTrees, &m_pGraph, m_iDistCalcMethod, &m_rebuildsRunning));
             }
 
-            for (SizeType node = begin; node < end; node++)
+            if (m_pQuantizer)
+            {
+                // Quantized samples are searched with their reconstruction, which RefineNode takes care of.
+                Helper::TaskScheduler::Instance().ParallelFor(begin, end, addThreads, [&](SizeType node)
+                {
+                    m_pGraph.RefineNode<T>(this, node, true, true, m_pGraph.m_iAddCEF);
+                }, nullptr, 16);
+            }
+            else
             {
-                m_pGraph.RefineNode<T>(this, node, true, true, m_pGraph.m_iAddCEF);
+                // The candidates of a group of new vectors are found with one batched walk over the graph, as
+                // SearchIndexBatch does for queries, and each vector is then linked in on its own.
+                int batchSize = max(1, m_iBatchSearchSize);
+                SizeType batchCount = (end - begin + batchSize - 1) / batchSize;
+                int CEF = m_pGraph.m_iAddCEF;
+                Helper::TaskScheduler::Instance().ParallelFor(0, batchCount, addThreads, [&](SizeType b)
+                {
+                    SizeType first = begin + b * batchSize;
+                    int count = (int)min((SizeType)batchSize, end - first);
+                    std::vector<std::unique_ptr<COMMON::QueryResultSet<T>>> results(count);
+                    std::vector<std::shared_ptr<COMMON::WorkSpace>> rented(count);
+                    std::vector<COMMON::WorkSpace*> spaces(count);
+                    std::vector<COMMON::QueryResultSet<T>*> queries(count);
+                    for (int i = 0; i < count; i++)
+                    {
+                        results[i].reset(new COMMON::QueryResultSet<T>((const T*)m_pSamples[first + i], CEF + 1));
+                        rented[i] = m_batchWorkSpaces.Rent();
+                        rented[i]->Reset(m_pGraph.m_iMaxCheckForRefineGraph, CEF + 1);
+                        spaces[i] = rented[i].get();
+                        queries[i] = results[i].get();
+                    }
+
+                    COMMON::DistanceDispatch<T>(DistanceKernel(), m_fComputeDistance, [&](const auto& fComputeDistance) {
+                        this->SearchBatch<StaticDispatch::AlwaysTrue, StaticDispatch::NeverDup>(queries.data(), spaces.data(), count, fComputeDistance);
+                    });
+
+                    for (int i = 0; i < count; i++)
+                    {
+                        m_batchWorkSpaces.Return(rented[i]);
+                        m_pGraph.LinkNode(this, first + i, results[i]->GetResults(), CEF);
+                    }
+                });
             }
+            ReportIngest(end - begin);
             return ErrorCode::Success;
         }
 
+        template <typename T>
+        void Index<T>::ReportIngest(SizeType p_added)
+        {
+            m_ingestVectors += p_added;
+            std::int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            std::int64_t last = m_ingestReportTime.load();
+            if (last == 0)
+            {
+                m_ingestReportTime.compare_exchange_strong(last, now);
+                return;
+            }
+            if (now - last < c_ingestReportSeconds * 1000 || !m_ingestReportTime.compare_exchange_strong(last, now)) return;
+
+            std::uint64_t added = m_ingestVectors.exchange(0);
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Ingested %llu vectors in %.1f s: %.0f vectors/s.\n",
+                (unsigned long long)added, (now - last) / 1000.0, added * 1000.0 / (now - last));
+        }
+
         template <typename T>
         ErrorCode
             Index<T>::UpdateIndex()
         {
-            omp_set_num_threads(m_iNumberOfThreads);
             return ErrorCode::Success;
         }
 
@@ -1002,6 +2011,28 @@ namespace SPTAG
                 auto base = m_pQuantizer ? m_pQuantizer->GetBase() : COMMON::Utils::GetBase<T>();
                 m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? base * base : 1;
             }
+            else if (m_bReady && (SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "CompactGraph") ||
+                SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "ReorderGraph"))) {
+                ErrorCode ret;
+                {
+                    std::lock_guard<std::mutex> lock(m_dataAddLock);
+                    WaitForGraphWriters();
+                    std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
+                    std::lock_guard<COMMON::EpochManager> treeLock(*(m_pTrees.m_epoch));
+                    ret = ApplyGraphFormat();
+                }
+                return (ret == ErrorCode::Success) ? UpdateNumaReplicas() : ret;
+            }
+            else if (m_bReady && SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "NumaReplicas")) {
+                return UpdateNumaReplicas();
+            }
+
+            // Search settings such as MaxCheck have to reach the copies that serve the searches.
+            std::shared_ptr<const NumaReplicaSet> replicas = NumaReplicas();
+            if (replicas != nullptr)
+            {
+                for (auto& replica : *replicas) replica->SetParameter(p_param, p_value, p_section);
+            }
             return ErrorCode::Success;
         }
 
@@ -1044,3 +1044,319 @@ float DistanceUtils::ComputeCosineDistance_AVX512(const float* pX, const float*
     while (pX < pEnd1) diff += (*pX++) * (*pY++);
     return 1 - diff;
 }
+
+// Fixed dimension kernels. UnrollBlocks expands the block loop at compile time; the blocks rotate over
+// four accumulators so consecutive adds do not wait on each other, and a remainder of 4, 8 or 12 floats
+// (e.g. D = 100) is covered by one extra narrower or masked step.
+template <int N>
+struct UnrollBlocks
+{
+    template <typename F>
+    static inline void Run(F& f)
+    {
+        UnrollBlocks<N - 1>::Run(f);
+        f(N - 1);
+    }
+};
+
+template <>
+struct UnrollBlocks<0>
+{
+    template <typename F>
+    static inline void Run(F&) {}
+};
+
+template <DimensionType D, bool L2>
+inline float ComputeFixedDistance_AVX(const float* pX, const float* pY)
+{
+    static_assert(D % 4 == 0, "fixed dimension kernels need a multiple of 4 floats");
+    __m256 acc[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+    auto block = [&](int i) {
+        __m256 x = _mm256_loadu_ps(pX + 8 * i), y = _mm256_loadu_ps(pY + 8 * i);
+        acc[i & 3] = _mm256_add_ps(acc[i & 3], L2 ? _mm256_sqdf_ps(x, y) : _mm256_mul_ps(x, y));
+    };
+    UnrollBlocks<D / 8>::Run(block);
+
+    __m256 diff256 = _mm256_add_ps(_mm256_add_ps(acc[0], acc[1]), _mm256_add_ps(acc[2], acc[3]));
+    __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+    if (D % 8 != 0)
+    {
+        __m128 x = _mm_loadu_ps(pX + D - 4), y = _mm_loadu_ps(pY + D - 4);
+        diff128 = _mm_add_ps(diff128, L2 ? _mm_sqdf_ps(x, y) : _mm_mul_ps(x, y));
+    }
+    return DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+}
+
+#if (!defined _MSC_VER) || (_MSC_VER >= 1920)
+template <DimensionType D, bool L2>
+inline float ComputeFixedDistance_AVX512(const float* pX, const float* pY)
+{
+    static_assert(D % 4 == 0, "fixed dimension kernels need a multiple of 4 floats");
+    __m512 acc[4] = { _mm512_setzero_ps(), _mm512_setzero_ps(), _mm512_setzero_ps(), _mm512_setzero_ps() };
+    auto block = [&](int i) {
+        __m512 x = _mm512_loadu_ps(pX + 16 * i), y = _mm512_loadu_ps(pY + 16 * i);
+        acc[i & 3] = _mm512_add_ps(acc[i & 3], L2 ? _mm512_sqdf_ps(x, y) : _mm512_mul_ps(x, y));
+    };
+    UnrollBlocks<D / 16>::Run(block);
+    if (D % 16 != 0)
+    {
+        __mmask16 mask = (__mmask16)((1 << (D % 16)) - 1);
+        __m512 x = _mm512_maskz_loadu_ps(mask, pX + D / 16 * 16), y = _mm512_maskz_loadu_ps(mask, pY + D / 16 * 16);
+        acc[3] = _mm512_add_ps(acc[3], L2 ? _mm512_sqdf_ps(x, y) : _mm512_mul_ps(x, y));
+    }
+
+    __m512 diff512 = _mm512_add_ps(_mm512_add_ps(acc[0], acc[1]), _mm512_add_ps(acc[2], acc[3]));
+    __m256 diff256 = _mm256_add_ps(_mm512_castps512_ps256(diff512), _mm512_extractf32x8_ps(diff512, 1));
+    __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+    return DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+}
+#endif
+
+template <DimensionType D>
+float DistanceUtils::ComputeL2Distance_AVX_Dim(const float* pX, const float* pY, DimensionType length)
+{
+    return ComputeFixedDistance_AVX<D, true>(pX, pY);
+}
+
+template <DimensionType D>
+float DistanceUtils::ComputeL2Distance_AVX512_Dim(const float* pX, const float* pY, DimensionType length)
+{
+#if (!defined _MSC_VER) || (_MSC_VER >= 1920)
+    return ComputeFixedDistance_AVX512<D, true>(pX, pY);
+#else
+    return ComputeFixedDistance_AVX<D, true>(pX, pY);
+#endif
+}
+
+template <DimensionType D>
+float DistanceUtils::ComputeCosineDistance_AVX_Dim(const float* pX, const float* pY, DimensionType length)
+{
+    return 1 - ComputeFixedDistance_AVX<D, false>(pX, pY);
+}
+
+template <DimensionType D>
+float DistanceUtils::ComputeCosineDistance_AVX512_Dim(const float* pX, const float* pY, DimensionType length)
+{
+#if (!defined _MSC_VER) || (_MSC_VER >= 1920)
+    return 1 - ComputeFixedDistance_AVX512<D, false>(pX, pY);
+#else
+    return 1 - ComputeFixedDistance_AVX<D, false>(pX, pY);
+#endif
+}
+
+#define DefineFixedDimension(D) \
+template float DistanceUtils::ComputeL2Distance_AVX_Dim<D>(const float* pX, const float* pY, DimensionType length); \
+template float DistanceUtils::ComputeL2Distance_AVX512_Dim<D>(const float* pX, const float* pY, DimensionType length); \
+template float DistanceUtils::ComputeCosineDistance_AVX_Dim<D>(const float* pX, const float* pY, DimensionType length); \
+template float DistanceUtils::ComputeCosineDistance_AVX512_Dim<D>(const float* pX, const float* pY, DimensionType length); \
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineFixedDimension
+
+// vpdpbusd/vpdpwssd accumulate exactly in int32 lanes. Each lane gains at most 4 * 255 * 255 per 64 bytes,
+// so the lanes are flushed into the float result every c_vnniBlock elements to keep long vectors from overflowing.
+#if defined(__AVX512VNNI__) || (defined _MSC_VER && _MSC_VER >= 1920)
+#define VNNI_ENABLED
+static const DimensionType c_vnniBlock = 64 * 4096;
+
+inline __mmask64 _vnni_tail_mask(DimensionType remain)
+{
+    return (remain >= 64) ? ~(__mmask64)0 : (((__mmask64)1 << remain) - 1);
+}
+
+inline __m512i _mm512_sqdf_epi8_vnni(__m512i acc, __m512i X, __m512i Y)
+{
+    __m512i dlo = _mm512_sub_epi16(_mm512_cvtepi8_epi16(_mm512_castsi512_si256(X)), _mm512_cvtepi8_epi16(_mm512_castsi512_si256(Y)));
+    __m512i dhi = _mm512_sub_epi16(_mm512_cvtepi8_epi16(_mm512_extracti64x4_epi64(X, 1)), _mm512_cvtepi8_epi16(_mm512_extracti64x4_epi64(Y, 1)));
+    return _mm512_dpwssd_epi32(_mm512_dpwssd_epi32(acc, dlo, dlo), dhi, dhi);
+}
+
+inline __m512i _mm512_sqdf_epu8_vnni(__m512i acc, __m512i X, __m512i Y)
+{
+    __m512i dlo = _mm512_sub_epi16(_mm512_cvtepu8_epi16(_mm512_castsi512_si256(X)), _mm512_cvtepu8_epi16(_mm512_castsi512_si256(Y)));
+    __m512i dhi = _mm512_sub_epi16(_mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(X, 1)), _mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(Y, 1)));
+    return _mm512_dpwssd_epi32(_mm512_dpwssd_epi32(acc, dlo, dlo), dhi, dhi);
+}
+#endif
+
+float DistanceUtils::ComputeL2Distance_AVX512VNNI(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
+{
+#ifdef VNNI_ENABLED
+    float diff = 0;
+    for (DimensionType begin = 0; begin < length; begin += c_vnniBlock)
+    {
+        DimensionType end = min(length, begin + c_vnniBlock), i = begin;
+        __m512i acc = _mm512_setzero_si512();
+        for (; i + 64 <= end; i += 64)
+            acc = _mm512_sqdf_epi8_vnni(acc, _mm512_loadu_si512(pX + i), _mm512_loadu_si512(pY + i));
+        if (i < end)
+        {
+            __mmask64 mask = _vnni_tail_mask(end - i);
+            acc = _mm512_sqdf_epi8_vnni(acc, _mm512_maskz_loadu_epi8(mask, pX + i), _mm512_maskz_loadu_epi8(mask, pY + i));
+        }
+        diff += (float)_mm512_reduce_add_epi32(acc);
+    }
+    return diff;
+#else
+    return ComputeL2Distance_AVX512(pX, pY, length);
+#endif
+}
+
+float DistanceUtils::ComputeL2Distance_AVX512VNNI(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+#ifdef VNNI_ENABLED
+    float diff = 0;
+    for (DimensionType begin = 0; begin < length; begin += c_vnniBlock)
+    {
+        DimensionType end = min(length, begin + c_vnniBlock), i = begin;
+        __m512i acc = _mm512_setzero_si512();
+        for (; i + 64 <= end; i += 64)
+            acc = _mm512_sqdf_epu8_vnni(acc, _mm512_loadu_si512(pX + i), _mm512_loadu_si512(pY + i));
+        if (i < end)
+        {
+            __mmask64 mask = _vnni_tail_mask(end - i);
+            acc = _mm512_sqdf_epu8_vnni(acc, _mm512_maskz_loadu_epi8(mask, pX + i), _mm512_maskz_loadu_epi8(mask, pY + i));
+        }
+        diff += (float)_mm512_reduce_add_epi32(acc);
+    }
+    return diff;
+#else
+    return ComputeL2Distance_AVX512(pX, pY, length);
+#endif
+}
+
+// vpdpbusd multiplies unsigned by signed bytes. For int8 x.y = (x + 128).y - 128 * sum(y), where x + 128 is x ^ 0x80.
+float DistanceUtils::ComputeCosineDistance_AVX512VNNI(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
+{
+#ifdef VNNI_ENABLED
+    const __m512i bias = _mm512_set1_epi8((char)0x80);
+    const __m512i ones = _mm512_set1_epi8(1);
+    float diff = 0;
+    for (DimensionType begin = 0; begin < length; begin += c_vnniBlock)
+    {
+        DimensionType end = min(length, begin + c_vnniBlock), i = begin;
+        __m512i dot = _mm512_setzero_si512(), sum = _mm512_setzero_si512();
+        for (; i + 64 <= end; i += 64)
+        {
+            __m512i x = _mm512_loadu_si512(pX + i), y = _mm512_loadu_si512(pY + i);
+            dot = _mm512_dpbusd_epi32(dot, _mm512_xor_si512(x, bias), y);
+            sum = _mm512_dpbusd_epi32(sum, ones, y);
+        }
+        if (i < end)
+        {
+            __mmask64 mask = _vnni_tail_mask(end - i);
+            __m512i x = _mm512_maskz_loadu_epi8(mask, pX + i), y = _mm512_maskz_loadu_epi8(mask, pY + i);
+            dot = _mm512_dpbusd_epi32(dot, _mm512_xor_si512(x, bias), y);
+            sum = _mm512_dpbusd_epi32(sum, ones, y);
+        }
+        diff += (float)_mm512_reduce_add_epi32(_mm512_sub_epi32(dot, _mm512_slli_epi32(sum, 7)));
+    }
+    return 16129 - diff;
+#else
+    return ComputeCosineDistance_AVX512(pX, pY, length);
+#endif
+}
+
+// For uint8 the signed operand is y - 128: x.y = x.(y ^ 0x80) + 128 * sum(x).
+float DistanceUtils::ComputeCosineDistance_AVX512VNNI(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+#ifdef VNNI_ENABLED
+    const __m512i bias = _mm512_set1_epi8((char)0x80);
+    const __m512i ones = _mm512_set1_epi8(1);
+    float diff = 0;
+    for (DimensionType begin = 0; begin < length; begin += c_vnniBlock)
+    {
+        DimensionType end = min(length, begin + c_vnniBlock), i = begin;
+        __m512i dot = _mm512_setzero_si512(), sum = _mm512_setzero_si512();
+        for (; i + 64 <= end; i += 64)
+        {
+            __m512i x = _mm512_loadu_si512(pX + i), y = _mm512_loadu_si512(pY + i);
+            dot = _mm512_dpbusd_epi32(dot, x, _mm512_xor_si512(y, bias));
+            sum = _mm512_dpbusd_epi32(sum, x, ones);
+        }
+        if (i < end)
+        {
+            __mmask64 mask = _vnni_tail_mask(end - i);
+            __m512i x = _mm512_maskz_loadu_epi8(mask, pX + i), y = _mm512_maskz_loadu_epi8(mask, pY + i);
+            dot = _mm512_dpbusd_epi32(dot, x, _mm512_xor_si512(y, bias));
+            sum = _mm512_dpbusd_epi32(sum, x, ones);
+        }
+        diff += (float)_mm512_reduce_add_epi32(_mm512_add_epi32(dot, _mm512_slli_epi32(sum, 7)));
+    }
+    return 65025 - diff;
+#else
+    return ComputeCosineDistance_AVX512(pX, pY, length);
+#endif
+}
+
+void DistanceUtils::ComputePQ4FastScan(const std::uint8_t* pLUT, const std::uint8_t* pBlock, DimensionType numPairs, std::uint16_t* pOut)
+{
+    for (int j = 0; j < 32; j++)
+    {
+        std::uint16_t sum = 0;
+        const std::uint8_t* lut = pLUT;
+        const std::uint8_t* code = pBlock + j;
+        for (DimensionType p = 0; p < numPairs; p++, lut += 32, code += 32)
+            sum += lut[*code & 0x0f] + lut[16 + (*code >> 4)];
+        pOut[j] = sum;
+    }
+}
+
+// The lookups give one byte per code. They are widened by splitting every 16-bit lane into the even code
+// (low byte) and the odd code (high byte), and the two accumulators are interleaved back on the way out.
+inline void _mm256_pq4_accumulate(__m256i lutLo, __m256i lutHi, __m256i codes, __m256i& even, __m256i& odd)
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i lowByte = _mm256_set1_epi16(0x00ff);
+    __m256i dlo = _mm256_shuffle_epi8(lutLo, _mm256_and_si256(codes, nibble));
+    __m256i dhi = _mm256_shuffle_epi8(lutHi, _mm256_and_si256(_mm256_srli_epi16(codes, 4), nibble));
+    even = _mm256_add_epi16(even, _mm256_add_epi16(_mm256_and_si256(dlo, lowByte), _mm256_and_si256(dhi, lowByte)));
+    odd = _mm256_add_epi16(odd, _mm256_add_epi16(_mm256_srli_epi16(dlo, 8), _mm256_srli_epi16(dhi, 8)));
+}
+
+inline void _mm256_pq4_store(__m256i even, __m256i odd, std::uint16_t* pOut)
+{
+    __m256i lo = _mm256_unpacklo_epi16(even, odd); // codes 0-7 | 16-23
+    __m256i hi = _mm256_unpackhi_epi16(even, odd); // codes 8-15 | 24-31
+    _mm256_storeu_si256((__m256i*)pOut, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i*)(pOut + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+void DistanceUtils::ComputePQ4FastScan_AVX(const std::uint8_t* pLUT, const std::uint8_t* pBlock, DimensionType numPairs, std::uint16_t* pOut)
+{
+    __m256i even = _mm256_setzero_si256(), odd = _mm256_setzero_si256();
+    for (DimensionType p = 0; p < numPairs; p++, pLUT += 32, pBlock += 32)
+    {
+        __m256i lutLo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)pLUT));
+        __m256i lutHi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(pLUT + 16)));
+        _mm256_pq4_accumulate(lutLo, lutHi, _mm256_loadu_si256((const __m256i*)pBlock), even, odd);
+    }
+    _mm256_pq4_store(even, odd, pOut);
+}
+
+// Two subvector pairs per iteration: the 128-bit lanes hold codes 0-15 and 16-31 of pair p, then of pair p + 1.
+void DistanceUtils::ComputePQ4FastScan_AVX512(const std::uint8_t* pLUT, const std::uint8_t* pBlock, DimensionType numPairs, std::uint16_t* pOut)
+{
+    const __m512i nibble = _mm512_set1_epi8(0x0f);
+    const __m512i lowByte = _mm512_set1_epi16(0x00ff);
+    __m512i even512 = _mm512_setzero_si512(), odd512 = _mm512_setzero_si512();
+    DimensionType p = 0;
+    for (; p + 2 <= numPairs; p += 2, pLUT += 64, pBlock += 64)
+    {
+        __m512i lut = _mm512_loadu_si512(pLUT);
+        __m512i codes = _mm512_loadu_si512(pBlock);
+        __m512i dlo = _mm512_shuffle_epi8(_mm512_shuffle_i64x2(lut, lut, _MM_SHUFFLE(2, 2, 0, 0)), _mm512_and_si512(codes, nibble));
+        __m512i dhi = _mm512_shuffle_epi8(_mm512_shuffle_i64x2(lut, lut, _MM_SHUFFLE(3, 3, 1, 1)), _mm512_and_si512(_mm512_srli_epi16(codes, 4), nibble));
+        even512 = _mm512_add_epi16(even512, _mm512_add_epi16(_mm512_and_si512(dlo, lowByte), _mm512_and_si512(dhi, lowByte)));
+        odd512 = _mm512_add_epi16(odd512, _mm512_add_epi16(_mm512_srli_epi16(dlo, 8), _mm512_srli_epi16(dhi, 8)));
+    }
+    __m256i even = _mm256_add_epi16(_mm512_castsi512_si256(even512), _mm512_extracti64x4_epi64(even512, 1));
+    __m256i odd = _mm256_add_epi16(_mm512_castsi512_si256(odd512), _mm512_extracti64x4_epi64(odd512, 1));
+    if (p < numPairs)
+    {
+        __m256i lutLo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)pLUT));
+        __m256i lutHi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(pLUT + 16)));
+        _mm256_pq4_accumulate(lutLo, lutHi, _mm256_loadu_si256((const __m256i*)pBlock), even, odd);
+    }
+    _mm256_pq4_store(even, odd, pOut);
+}
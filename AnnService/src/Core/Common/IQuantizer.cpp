@@ -1,6 +1,7 @@
 #include <inc/Core/Common/IQuantizer.h>
 #include <inc/Core/Common/PQQuantizer.h>
 #include <inc/Core/Common/OPQQuantizer.h>
+#include <inc/Core/Common/ScalarQuantizer.h>
 #include <inc/Helper/StringConvert.h>
 
 namespace SPTAG
@@ -42,6 +43,19 @@ namespace SPTAG
                         ret.reset(new OPQQuantizer<Type>()); \
                         break;
 
+#include "inc/Core/DefinitionList.h"
+#undef DefineVectorValueType
+                default: break;
+                }
+                if (ret->LoadQuantizer(p_in) != ErrorCode::Success) ret.reset();
+                return ret;
+            case QuantizerType::ScalarQuantizer:
+                switch (reconstructType) {
+#define DefineVectorValueType(Name, Type) \
+                    case VectorValueType::Name: \
+                        ret.reset(new ScalarQuantizer<Type>()); \
+                        break;
+
 #include "inc/Core/DefinitionList.h"
 #undef DefineVectorValueType
                 default: break;
@@ -89,6 +103,20 @@ namespace SPTAG
                         ret.reset(new OPQQuantizer<Type>()); \
                         break;
 
+#include "inc/Core/DefinitionList.h"
+#undef DefineVectorValueType
+                default: break;
+                }
+
+                if (ret->LoadQuantizer(raw_bytes) != ErrorCode::Success) ret.reset();
+                return ret;
+            case QuantizerType::ScalarQuantizer:
+                switch (reconstructType) {
+#define DefineVectorValueType(Name, Type) \
+                    case VectorValueType::Name: \
+                        ret.reset(new ScalarQuantizer<Type>()); \
+                        break;
+
 #include "inc/Core/DefinitionList.h"
 #undef DefineVectorValueType
                 default: break;
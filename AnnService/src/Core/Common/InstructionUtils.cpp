@@ -16,10 +16,13 @@ namespace SPTAG {
         bool InstructionSet::AVX(void) { return CPU_Rep.HW_AVX; }
         bool InstructionSet::AVX2(void) { return CPU_Rep.HW_AVX2; }
         bool InstructionSet::AVX512(void) { return CPU_Rep.HW_AVX512; }
+        bool InstructionSet::AVX512VNNI(void) { return CPU_Rep.HW_AVX512VNNI; }
         
         void InstructionSet::PrintInstructionSet(void) 
         {
-            if (CPU_Rep.HW_AVX512)
+            if (CPU_Rep.HW_AVX512VNNI)
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Using AVX512 VNNI InstructionSet!\n");
+            else if (CPU_Rep.HW_AVX512)
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Using AVX512 InstructionSet!\n");
             else if (CPU_Rep.HW_AVX2)
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Using AVX2 InstructionSet!\n");
@@ -39,6 +42,7 @@ namespace SPTAG {
             HW_SSE2{ false },
             HW_AVX{ false },
             HW_AVX512{ false },
+            HW_AVX512VNNI{ false },
             HW_AVX2{ false }
         {
             int info[4];
@@ -56,15 +60,19 @@ namespace SPTAG {
                 cpuid(info, 0x00000007);
                 HW_AVX2 = (info[1] & ((int)1 << 5)) != 0;
                 HW_AVX512 = (info[1] & (((int)1 << 16) | ((int) 1 << 30)));
+                HW_AVX512VNNI = HW_AVX512 && (info[2] & ((int)1 << 11)) != 0;
 
 // If we are not compiling support for AVX-512 due to old compiler version, we should not call it
 #ifdef _MSC_VER
 #if _MSC_VER < 1920
                 HW_AVX512 = false;
+                HW_AVX512VNNI = false;
 #endif
 #endif
             }
-            if (HW_AVX512)
+            if (HW_AVX512VNNI)
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Using AVX512 VNNI InstructionSet!\n");
+            else if (HW_AVX512)
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Using AVX512 InstructionSet!\n");
             else if (HW_AVX2)
                 SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Using AVX2 InstructionSet!\n");
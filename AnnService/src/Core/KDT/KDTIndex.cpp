@@ -58,11 +58,20 @@ namespace SPTAG
             }
         }
 
+        template <typename T>
+        void Index<T>::ApplyHugePages()
+        {
+            m_pSamples.SetHugePages(m_hugePagePolicy);
+            m_pGraph.SetHugePages(m_hugePagePolicy);
+            m_deletedID.SetHugePages(m_hugePagePolicy);
+        }
+
         template <typename T>
         ErrorCode Index<T>::LoadIndexDataFromMemory(const std::vector<ByteArray>& p_indexBlobs)
         {
             if (p_indexBlobs.size() < 3) return ErrorCode::LackOfInputs;
 
+            ApplyHugePages();
             if (m_pSamples.Load((char*)p_indexBlobs[0].Data(), m_iDataBlockSize, m_iDataCapacity) != ErrorCode::Success) return ErrorCode::FailedParseValue;
             if (m_pTrees.LoadTrees((char*)p_indexBlobs[1].Data()) != ErrorCode::Success) return ErrorCode::FailedParseValue;
             if (m_pGraph.LoadGraph((char*)p_indexBlobs[2].Data(), m_iDataBlockSize, m_iDataCapacity) != ErrorCode::Success) return ErrorCode::FailedParseValue;
@@ -75,8 +84,8 @@ namespace SPTAG
                 return ErrorCode::FailedParseValue;
             }
 
-            omp_set_num_threads(m_iNumberOfThreads);
             m_threadPool.init();
+            if (m_hugePagePolicy != HugePagePolicy::None) COMMON::PageAllocator::LogStats();
             return ErrorCode::Success;
         }
 
@@ -85,6 +94,7 @@ namespace SPTAG
         {
             if (p_indexStreams.size() < 4) return ErrorCode::LackOfInputs;
 
+            ApplyHugePages();
             ErrorCode ret = ErrorCode::Success;
             if (p_indexStreams[0] == nullptr || (ret = m_pSamples.Load(p_indexStreams[0], m_iDataBlockSize, m_iDataCapacity)) != ErrorCode::Success) return ret;
             if (p_indexStreams[1] == nullptr || (ret = m_pTrees.LoadTrees(p_indexStreams[1])) != ErrorCode::Success) return ret;
@@ -98,8 +108,8 @@ namespace SPTAG
                 return ErrorCode::FailedParseValue;
             }
 
-            omp_set_num_threads(m_iNumberOfThreads);
             m_threadPool.init();
+            if (m_hugePagePolicy != HugePagePolicy::None) COMMON::PageAllocator::LogStats();
             return ret;
         }
 
@@ -180,12 +190,12 @@ namespace SPTAG
         p_query.SortResult(); \
 */
         template<typename T>
-        template<typename Q, bool(*notDeleted)(const COMMON::Labelset&, SizeType)>
-        void Index<T>::Search(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space) const
+        template<typename Q, bool(*notDeleted)(const COMMON::Labelset&, SizeType), typename Dist>
+        void Index<T>::Search(COMMON::QueryResultSet<T>& p_query, COMMON::WorkSpace& p_space, const Dist& fComputeDistance) const
         {
             std::shared_lock<std::shared_timed_mutex> lock(*(m_pTrees.m_lock));
-            m_pTrees.InitSearchTrees<T, Q>(m_pSamples, m_fComputeDistance, p_query, p_space);
-            m_pTrees.SearchTrees<T, Q>(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfInitialDynamicPivots);
+            m_pTrees.InitSearchTrees<T, Q>(m_pSamples, fComputeDistance, p_query, p_space);
+            m_pTrees.SearchTrees<T, Q>(m_pSamples, fComputeDistance, p_query, p_space, m_iNumberOfInitialDynamicPivots);
             while (!p_space.m_NGQueue.empty()) 
             {
                 NodeDistPair gnode = p_space.m_NGQueue.pop();
@@ -215,7 +225,7 @@ namespace SPTAG
                     if (nn_index < 0) break;
 
                     if (p_space.CheckAndSet(nn_index)) continue;
-                    float distance2leaf = m_fComputeDistance(p_query.GetQuantizedTarget(), (m_pSamples)[nn_index], GetFeatureDim());
+                    float distance2leaf = fComputeDistance(p_query.GetQuantizedTarget(), (m_pSamples)[nn_index], GetFeatureDim());
                     if (distance2leaf <= upperBound) 
                         bLocalOpt = false;
                     p_space.m_iNumberOfCheckedLeaves++;
@@ -229,7 +239,7 @@ namespace SPTAG
                 {
                     if (p_space.m_iNumberOfTreeCheckedLeaves <= p_space.m_iNumberOfCheckedLeaves / 10) 
                     {
-                        m_pTrees.SearchTrees<T, Q>(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfOtherDynamicPivots + p_space.m_iNumberOfCheckedLeaves);
+                        m_pTrees.SearchTrees<T, Q>(m_pSamples, fComputeDistance, p_query, p_space, m_iNumberOfOtherDynamicPivots + p_space.m_iNumberOfCheckedLeaves);
                     }
                     else if (gnode.distance > p_query.worstDist()) 
                     {
@@ -254,14 +264,14 @@ namespace SPTAG
         };
 
         template <typename T>
-        template <typename Q>
-        void Index<T>::SearchIndex(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted) const
+        template <typename Q, typename Dist>
+        void Index<T>::SearchIndex(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted, const Dist& fComputeDistance) const
         {
             if (m_deletedID.Count() == 0 || p_searchDeleted) {
-                Search<Q, StaticDispatch::AlwaysTrue>(p_query, p_space);
+                Search<Q, StaticDispatch::AlwaysTrue>(p_query, p_space, fComputeDistance);
             }
             else {
-                Search<Q, StaticDispatch::CheckIfNotDeleted>(p_query, p_space);
+                Search<Q, StaticDispatch::CheckIfNotDeleted>(p_query, p_space, fComputeDistance);
             }
         }
 
@@ -274,7 +284,7 @@ namespace SPTAG
             auto workSpace = m_workSpaceFactory->GetWorkSpace();
             if (!workSpace) {
                 workSpace.reset(new COMMON::WorkSpace());
-                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_pSamples.R(), m_visitedSetType);
             }
             workSpace->Reset(m_iMaxCheck, p_query.GetResultNum());
 
@@ -289,7 +299,7 @@ namespace SPTAG
                 {
 #define DefineVectorValueType(Name, Type) \
 case VectorValueType::Name: \
-                SearchIndex<Type>(*p_results, *workSpace, p_searchDeleted); \
+                SearchIndex<Type>(*p_results, *workSpace, p_searchDeleted, m_fComputeDistance); \
                 break; \
 
 #include "inc/Core/DefinitionList.h"
@@ -299,8 +309,10 @@ case VectorValueType::Name: \
                 }
             }
             else
-            {            
-                SearchIndex<T>(*p_results, *workSpace, p_searchDeleted);
+            {
+                COMMON::DistanceDispatch<T>(DistanceKernel(), m_fComputeDistance, [&](const auto& fComputeDistance) {
+                    this->SearchIndex<T>(*p_results, *workSpace, p_searchDeleted, fComputeDistance);
+                });
             }
 
             m_workSpaceFactory->ReturnWorkSpace(std::move(workSpace));
@@ -351,7 +363,7 @@ case VectorValueType::Name: \
             auto workSpace = m_workSpaceFactory->GetWorkSpace();
             if (!workSpace) {
                 workSpace.reset(new COMMON::WorkSpace());
-                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_pSamples.R(), m_visitedSetType);
             }
             workSpace->ResetResult(m_iMaxCheck, batch);
             return std::move(workSpace);
@@ -370,7 +382,7 @@ case VectorValueType::Name: \
             auto workSpace = m_workSpaceFactory->GetWorkSpace();
             if (!workSpace) {
                 workSpace.reset(new COMMON::WorkSpace());
-                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_pSamples.R(), m_visitedSetType);
             }
             workSpace->Reset(m_pGraph.m_iMaxCheckForRefineGraph, p_query.GetResultNum());
 
@@ -385,7 +397,7 @@ case VectorValueType::Name: \
                 {
 #define DefineVectorValueType(Name, Type) \
 case VectorValueType::Name: \
-                SearchIndex<Type>(*p_results, *workSpace, p_searchDeleted); \
+                SearchIndex<Type>(*p_results, *workSpace, p_searchDeleted, m_fComputeDistance); \
                 break; \
 
 #include "inc/Core/DefinitionList.h"
@@ -396,7 +408,9 @@ case VectorValueType::Name: \
             }
             else
             {
-                SearchIndex<T>(*p_results, *workSpace, p_searchDeleted);
+                COMMON::DistanceDispatch<T>(DistanceKernel(), m_fComputeDistance, [&](const auto& fComputeDistance) {
+                    this->SearchIndex<T>(*p_results, *workSpace, p_searchDeleted, fComputeDistance);
+                });
             }
             m_workSpaceFactory->ReturnWorkSpace(std::move(workSpace));
 
@@ -409,7 +423,7 @@ case VectorValueType::Name: \
             auto workSpace = m_workSpaceFactory->GetWorkSpace();
             if (!workSpace) {
                 workSpace.reset(new COMMON::WorkSpace());
-                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp);
+                workSpace->Initialize(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), m_iHashTableExp, m_pSamples.R(), m_visitedSetType);
             }
             workSpace->Reset(m_pGraph.m_iMaxCheckForRefineGraph, p_query.GetResultNum());
 
@@ -458,18 +472,16 @@ case VectorValueType::Name: \
         {
             if (p_data == nullptr || p_vectorNum == 0 || p_dimension == 0) return ErrorCode::EmptyData;
 
-            omp_set_num_threads(m_iNumberOfThreads);
-
+            ApplyHugePages();
             m_pSamples.Initialize(p_vectorNum, p_dimension, m_iDataBlockSize, m_iDataCapacity, (T*)p_data, p_shareOwnership);
             m_deletedID.Initialize(p_vectorNum, m_iDataBlockSize, m_iDataCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysContains);
 
             if (DistCalcMethod::Cosine == m_iDistCalcMethod && !p_normalized)
             {
                 int base = m_pQuantizer ? m_pQuantizer->GetBase() : COMMON::Utils::GetBase<T>();
-#pragma omp parallel for
-                for (SizeType i = 0; i < GetNumSamples(); i++) {
+                Helper::TaskScheduler::Instance().ParallelFor(0, GetNumSamples(), m_iNumberOfThreads, [&](SizeType i) {
                     COMMON::Utils::Normalize(m_pSamples[i], GetFeatureDim(), base);
-                }
+                });
             }
 
             m_threadPool.init();
@@ -484,6 +496,7 @@ case VectorValueType::Name: \
             auto t3 = std::chrono::high_resolution_clock::now();
             SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Build Graph time (s): %lld\n", std::chrono::duration_cast<std::chrono::seconds>(t3 - t2).count());
 
+            if (m_hugePagePolicy != HugePagePolicy::None) COMMON::PageAllocator::LogStats();
             m_bReady = true;
             return ErrorCode::Success;
         }
@@ -499,6 +512,7 @@ case VectorValueType::Name: \
 
 #include "inc/Core/KDT/ParameterDefinitionList.h"
 #undef DefineKDTParameter
+            ptr->ApplyHugePages();
 
             std::lock_guard<std::mutex> lock(m_dataAddLock);
             std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
@@ -533,7 +547,7 @@ case VectorValueType::Name: \
             ptr->m_deletedID.Initialize(newR, m_iDataBlockSize, m_iDataCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysContains);
             COMMON::KDTree* newtree = &(ptr->m_pTrees);
 
-            (*newtree).BuildTrees<T>(ptr->m_pSamples, omp_get_num_threads());
+            (*newtree).BuildTrees<T>(ptr->m_pSamples, m_iNumberOfThreads);
             m_pGraph.RefineGraph<T>(this, indices, reverseIndices, nullptr, &(ptr->m_pGraph));
             if (HasMetaMapping()) ptr->BuildMetaMapping(false);
             ptr->m_bReady = true;
@@ -573,14 +587,13 @@ case VectorValueType::Name: \
             if (p_abort != nullptr && p_abort->ShouldAbort()) return ErrorCode::ExternalAbort;
 
             COMMON::KDTree newTrees(m_pTrees);
-            newTrees.BuildTrees<T>(m_pSamples, omp_get_num_threads(), &indices);
-#pragma omp parallel for
-            for (SizeType i = 0; i < newTrees.size(); i++) {
+            newTrees.BuildTrees<T>(m_pSamples, m_iNumberOfThreads, &indices);
+            Helper::TaskScheduler::Instance().ParallelFor(0, newTrees.size(), m_iNumberOfThreads, [&](SizeType i) {
                 if (newTrees[i].left < 0)
                     newTrees[i].left = -reverseIndices[-newTrees[i].left - 1] - 1;
                 if (newTrees[i].right < 0)
                     newTrees[i].right = -reverseIndices[-newTrees[i].right - 1] - 1;
-            }
+            });
             if ((ret = newTrees.SaveTrees(p_indexStreams[1])) != ErrorCode::Success) return ret;
 
             if (p_abort != nullptr && p_abort->ShouldAbort()) return ErrorCode::ExternalAbort;
@@ -601,8 +614,7 @@ case VectorValueType::Name: \
         template <typename T>
         ErrorCode Index<T>::DeleteIndex(const void* p_vectors, SizeType p_vectorNum) {
             const T* ptr_v = (const T*)p_vectors;
-#pragma omp parallel for schedule(dynamic)
-            for (SizeType i = 0; i < p_vectorNum; i++) {
+            Helper::TaskScheduler::Instance().ParallelFor(0, p_vectorNum, m_iNumberOfThreads, [&](SizeType i) {
                 COMMON::QueryResultSet<T> query(ptr_v + i * GetFeatureDim(), m_pGraph.m_iCEF);
                 SearchIndex(query);
 
@@ -611,7 +623,7 @@ case VectorValueType::Name: \
                         DeleteIndex(query.GetResult(j)->VID);
                     }
                 }
-            }
+            });
             return ErrorCode::Success;
         }
 
@@ -699,7 +711,6 @@ case VectorValueType::Name: \
         ErrorCode
             Index<T>::UpdateIndex()
         {
-            omp_set_num_threads(m_iNumberOfThreads);
             return ErrorCode::Success;
         }
 
@@ -6,6 +6,13 @@
 #include <string.h>
 #include <shared_mutex>
 
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace SPTAG;
 
 #include "inc/Helper/LockFree.h"
@@ -102,7 +109,40 @@ bool MetadataSet::GetMetadataOffsets(const std::uint8_t* p_meta, const std::uint
 }
 
 
+namespace
+{
+    // Maps the first p_bytes of p_file read-only. Returns nullptr when the file cannot be mapped,
+    // in which case callers fall back to reading through DiskIO.
+    std::shared_ptr<void> MapFile(const std::string& p_file, std::uint64_t p_bytes)
+    {
+#ifndef _MSC_VER
+        if (p_bytes == 0) return nullptr;
+
+        int fd = open(p_file.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (std::uint64_t)st.st_size < p_bytes) {
+            close(fd);
+            return nullptr;
+        }
+
+        void* addr = mmap(nullptr, p_bytes, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) return nullptr;
+
+        madvise(addr, p_bytes, MADV_RANDOM);
+        return std::shared_ptr<void>(addr, [p_bytes](void* p) { munmap(p, p_bytes); });
+#else
+        // The meta file is replaced by rename in SaveMetadata, which Windows refuses while a view is open.
+        return nullptr;
+#endif
+    }
+}
+
+
 FileMetadataSet::FileMetadataSet(const std::string& p_metafile, const std::string& p_metaindexfile, std::uint64_t p_blockSize, std::uint64_t p_capacity, std::uint64_t p_metaSize)
+    : m_fileBytes(0)
 {
     m_fp = f_createIO();
     auto fpidx = f_createIO();
@@ -116,15 +156,23 @@ FileMetadataSet::FileMetadataSet(const std::string& p_metafile, const std::strin
         throw std::runtime_error("Cannot read meta files");
     }
 
-    m_offsets.reserve(p_blockSize);
-    m_offsets.resize(m_count + 1);
-    if (fpidx->ReadBinary(sizeof(std::uint64_t) * (m_count + 1), (char*)m_offsets.data()) != sizeof(std::uint64_t) * (m_count + 1)) {
-        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "ERROR: Cannot read FileMetadataSet!\n");
-        throw std::runtime_error("Cannot read meta files");
+    m_pOffsets.reset(new MetadataOffsets, std::default_delete<MetadataOffsets>());
+    auto& m_offsets = *static_cast<MetadataOffsets*>(m_pOffsets.get());
+    m_offsets.reserve(p_blockSize, p_capacity);
+    {
+        std::vector<std::uint64_t> tmp(m_count + 1, 0);
+        if (fpidx->ReadBinary(sizeof(std::uint64_t) * (m_count + 1), (char*)tmp.data()) != sizeof(std::uint64_t) * (m_count + 1) ||
+            !m_offsets.assign(tmp.data(), tmp.data() + tmp.size())) {
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "ERROR: Cannot read FileMetadataSet!\n");
+            throw std::runtime_error("Cannot read meta files");
+        }
     }
     m_newdata.reserve(p_blockSize * p_metaSize);
     m_lock.reset(new std::shared_timed_mutex, std::default_delete<std::shared_timed_mutex>());
-    SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Load MetaIndex(%d) Meta(%llu)\n", m_count, m_offsets[m_count]);
+
+    MapMetadata(p_metafile, m_offsets[m_count]);
+    m_fileBytes.store(m_offsets[m_count], std::memory_order_release);
+    SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Load MetaIndex(%d) Meta(%llu)%s\n", m_count, m_offsets[m_count], (std::atomic_load(&m_mapping) != nullptr) ? " mapped" : "");
 }
 
 
@@ -133,46 +181,75 @@ FileMetadataSet::~FileMetadataSet()
 }
 
 
+void
+FileMetadataSet::MapMetadata(const std::string& p_metaFile, std::uint64_t p_bytes)
+{
+    std::atomic_store(&m_mapping, MapFile(p_metaFile, p_bytes));
+}
+
+
 ByteArray
-FileMetadataSet::GetMetadata(SizeType p_vectorID) const
+FileMetadataSet::ReadFromFile(std::uint64_t p_offset, std::uint64_t p_bytes, bool p_copy) const
 {
+    std::shared_ptr<void> mapping = std::atomic_load(&m_mapping);
+    if (mapping != nullptr) {
+        std::uint8_t* mapped = static_cast<std::uint8_t*>(mapping.get());
+        if (!p_copy) return ByteArray(mapped + p_offset, p_bytes, std::shared_ptr<std::uint8_t>(mapping, mapped));
+
+        ByteArray b = ByteArray::Alloc(p_bytes);
+        memcpy(b.Data(), mapped + p_offset, p_bytes);
+        return b;
+    }
+
+    ByteArray b = ByteArray::Alloc(p_bytes);
     std::unique_lock<std::shared_timed_mutex> lock(*static_cast<std::shared_timed_mutex*>(m_lock.get()));
+    m_fp->ReadBinary(p_bytes, (char*)b.Data(), p_offset);
+    return b;
+}
+
+
+ByteArray
+FileMetadataSet::GetMetadata(SizeType p_vectorID) const
+{
+    auto& m_offsets = *static_cast<MetadataOffsets*>(m_pOffsets.get());
     std::uint64_t startoff = m_offsets[p_vectorID];
     std::uint64_t bytes = m_offsets[p_vectorID + 1] - startoff;
-    if (p_vectorID < m_count) {
-        ByteArray b = ByteArray::Alloc(bytes);
-        m_fp->ReadBinary(bytes, (char*)b.Data(), startoff);
-        return b;
-    }
-    else {
-        return ByteArray((std::uint8_t*)m_newdata.data() + startoff - m_offsets[m_count], bytes, false);
+    if (startoff < m_fileBytes.load(std::memory_order_acquire)) return ReadFromFile(startoff, bytes, false);
+
+    std::shared_lock<std::shared_timed_mutex> lock(*static_cast<std::shared_timed_mutex*>(m_lock.get()));
+    std::uint64_t fileBytes = m_fileBytes.load(std::memory_order_acquire);
+    if (startoff < fileBytes) {
+        lock.unlock();
+        return ReadFromFile(startoff, bytes, false);
     }
+    return ByteArray((std::uint8_t*)m_newdata.data() + startoff - fileBytes, bytes, false);
 }
 
 
 ByteArray
 FileMetadataSet::GetMetadataCopy(SizeType p_vectorID) const
 {
-    std::unique_lock<std::shared_timed_mutex> lock(*static_cast<std::shared_timed_mutex*>(m_lock.get()));
+    auto& m_offsets = *static_cast<MetadataOffsets*>(m_pOffsets.get());
     std::uint64_t startoff = m_offsets[p_vectorID];
     std::uint64_t bytes = m_offsets[p_vectorID + 1] - startoff;
-    if (p_vectorID < m_count) {
-        ByteArray b = ByteArray::Alloc(bytes);
-        m_fp->ReadBinary(bytes, (char*)b.Data(), startoff);
-        return b;
-    }
-    else {
-        ByteArray b = ByteArray::Alloc(bytes);
-        memcpy(b.Data(), m_newdata.data() + (startoff - m_offsets[m_count]), bytes);
-        return b;
+    if (startoff < m_fileBytes.load(std::memory_order_acquire)) return ReadFromFile(startoff, bytes, true);
+
+    std::shared_lock<std::shared_timed_mutex> lock(*static_cast<std::shared_timed_mutex*>(m_lock.get()));
+    std::uint64_t fileBytes = m_fileBytes.load(std::memory_order_acquire);
+    if (startoff < fileBytes) {
+        lock.unlock();
+        return ReadFromFile(startoff, bytes, true);
     }
+    ByteArray b = ByteArray::Alloc(bytes);
+    memcpy(b.Data(), m_newdata.data() + (startoff - fileBytes), bytes);
+    return b;
 }
 
 
 SizeType
 FileMetadataSet::Count() const
 {
-    std::shared_lock<std::shared_timed_mutex> lock(*static_cast<std::shared_timed_mutex*>(m_lock.get()));
+    auto& m_offsets = *static_cast<MetadataOffsets*>(m_pOffsets.get());
     return static_cast<SizeType>(m_offsets.size() - 1);
 }
 
@@ -180,7 +257,7 @@ FileMetadataSet::Count() const
 bool
 FileMetadataSet::Available() const
 {
-    std::shared_lock<std::shared_timed_mutex> lock(*static_cast<std::shared_timed_mutex*>(m_lock.get()));
+    auto& m_offsets = *static_cast<MetadataOffsets*>(m_pOffsets.get());
     return m_fp != nullptr && m_offsets.size() > 1;
 }
 
@@ -188,40 +265,55 @@ FileMetadataSet::Available() const
 std::pair<std::uint64_t, std::uint64_t> 
 FileMetadataSet::BufferSize() const
 {
-    std::shared_lock<std::shared_timed_mutex> lock(*static_cast<std::shared_timed_mutex*>(m_lock.get()));
-    return std::make_pair(m_offsets.back(), 
-        sizeof(SizeType) + sizeof(std::uint64_t) * m_offsets.size());
+    auto& m_offsets = *static_cast<MetadataOffsets*>(m_pOffsets.get());
+    auto n = m_offsets.size();
+    return std::make_pair(m_offsets[n - 1],
+        sizeof(SizeType) + sizeof(std::uint64_t) * n);
 }
 
 
 void
 FileMetadataSet::Add(const ByteArray& data)
 {
+    auto& m_offsets = *static_cast<MetadataOffsets*>(m_pOffsets.get());
     std::unique_lock<std::shared_timed_mutex> lock(*static_cast<std::shared_timed_mutex*>(m_lock.get()));
     m_newdata.insert(m_newdata.end(), data.Data(), data.Data() + data.Length());
-    m_offsets.push_back(m_offsets.back() + data.Length());
+    if (!m_offsets.push_back(m_offsets.back() + data.Length())) {
+        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Insert MetaIndex error! DataCapacity overflow!\n");
+        m_newdata.resize(m_newdata.size() - data.Length());
+    }
 }
 
 
 ErrorCode
 FileMetadataSet::SaveMetadata(std::shared_ptr<Helper::DiskIO> p_metaOut, std::shared_ptr<Helper::DiskIO> p_metaIndexOut)
 {
+    auto& m_offsets = *static_cast<MetadataOffsets*>(m_pOffsets.get());
     std::shared_lock<std::shared_timed_mutex> lock(*static_cast<std::shared_timed_mutex*>(m_lock.get()));
     SizeType count = Count();
     IOBINARY(p_metaIndexOut, WriteBinary, sizeof(SizeType), (const char*)&count);
-    IOBINARY(p_metaIndexOut, WriteBinary, sizeof(std::uint64_t) * m_offsets.size(), (const char*)m_offsets.data());
-
-    std::uint64_t bufsize = 1000000;
-    char* buf = new char[bufsize];
-    auto readsize = m_fp->ReadBinary(bufsize, buf, 0);
-    while (readsize > 0) {
-        IOBINARY(p_metaOut, WriteBinary, readsize, buf);
-        readsize = m_fp->ReadBinary(bufsize, buf);
+    for (SizeType i = 0; i <= count; i++) {
+        IOBINARY(p_metaIndexOut, WriteBinary, sizeof(std::uint64_t), (const char*)(&m_offsets[i]));
+    }
+
+    std::uint64_t fileBytes = m_fileBytes.load(std::memory_order_acquire);
+    std::shared_ptr<void> mapping = std::atomic_load(&m_mapping);
+    if (mapping != nullptr) {
+        IOBINARY(p_metaOut, WriteBinary, fileBytes, (const char*)mapping.get());
+    }
+    else {
+        std::uint64_t bufsize = 1000000;
+        char* buf = new char[bufsize];
+        auto readsize = m_fp->ReadBinary(bufsize, buf, 0);
+        while (readsize > 0) {
+            IOBINARY(p_metaOut, WriteBinary, readsize, buf);
+            readsize = m_fp->ReadBinary(bufsize, buf);
+        }
+        delete[] buf;
     }
-    delete[] buf;
     
     if (m_newdata.size() > 0) {
-        IOBINARY(p_metaOut, WriteBinary, m_newdata.size(), (const char*)m_newdata.data());
+        IOBINARY(p_metaOut, WriteBinary, m_offsets[count] - fileBytes, (const char*)m_newdata.data());
     }
     SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Save MetaIndex(%llu) Meta(%llu)\n", m_offsets.size() - 1, m_offsets.back());
     return ErrorCode::Success;
@@ -240,6 +332,7 @@ FileMetadataSet::SaveMetadata(const std::string& p_metaFile, const std::string&
         if (ret != ErrorCode::Success) return ret;
     }
     {
+        auto& m_offsets = *static_cast<MetadataOffsets*>(m_pOffsets.get());
         std::unique_lock<std::shared_timed_mutex> lock(*static_cast<std::shared_timed_mutex*>(m_lock.get()));
         m_fp->ShutDown();
         if (fileexists(p_metaFile.c_str())) std::remove(p_metaFile.c_str());
@@ -247,7 +340,12 @@ FileMetadataSet::SaveMetadata(const std::string& p_metaFile, const std::string&
         std::rename((p_metaFile + "_tmp").c_str(), p_metaFile.c_str());
         std::rename((p_metaindexFile + "_tmp").c_str(), p_metaindexFile.c_str());
         if (!m_fp->Initialize(p_metaFile.c_str(), std::ios::binary | std::ios::in)) return ErrorCode::FailedOpenFile;
-        m_count = static_cast<SizeType>(m_offsets.size() - 1);
+        m_count = Count();
+
+        // The new file starts with the bytes of the old one, so readers still holding the previous
+        // mapping or file size keep seeing valid data; the old mapping goes away with its last view.
+        MapMetadata(p_metaFile, m_offsets[m_count]);
+        m_fileBytes.store(m_offsets[m_count], std::memory_order_release);
         m_newdata.clear();
     }
     return ErrorCode::Success;
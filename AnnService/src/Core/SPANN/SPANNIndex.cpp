@@ -102,8 +102,7 @@ namespace SPTAG
             if (!m_extraSearcher->LoadIndex(m_options)) return ErrorCode::Fail;
 
             m_vectorTranslateMap.reset((std::uint64_t*)(p_indexBlobs.back().Data()), [=](std::uint64_t* ptr) {});
-           
-            omp_set_num_threads(m_options.m_iSSDNumberOfThreads);
+            InitUpdateStore(true);
             return ErrorCode::Success;
         }
 
@@ -132,8 +131,7 @@ namespace SPTAG
 
             m_vectorTranslateMap.reset(new std::uint64_t[m_index->GetNumSamples()], std::default_delete<std::uint64_t[]>());
             IOBINARY(p_indexStreams[m_index->GetIndexFiles()->size()], ReadBinary, sizeof(std::uint64_t) * m_index->GetNumSamples(), reinterpret_cast<char*>(m_vectorTranslateMap.get()));
-
-            omp_set_num_threads(m_options.m_iSSDNumberOfThreads);
+            InitUpdateStore(true);
             return ErrorCode::Success;
         }
 
@@ -183,8 +181,12 @@ namespace SPTAG
             ErrorCode ret;
             if ((ret = m_index->SaveIndexData(p_indexStreams)) != ErrorCode::Success) return ret;
 
-            IOBINARY(p_indexStreams[m_index->GetIndexFiles()->size()], WriteBinary, sizeof(std::uint64_t) * m_index->GetNumSamples(), (char*)(m_vectorTranslateMap.get()));
-            return ErrorCode::Success;
+            IOBINARY(p_indexStreams[m_index->GetIndexFiles()->size()], WriteBinary, sizeof(std::uint64_t) * m_splitHeadBase, (char*)(m_vectorTranslateMap.get()));
+            for (SizeType i = m_splitHeadBase; i < m_index->GetNumSamples(); i++) {
+                std::uint64_t vid = static_cast<std::uint64_t>(GetGlobalVID(i));
+                IOBINARY(p_indexStreams[m_index->GetIndexFiles()->size()], WriteBinary, sizeof(std::uint64_t), (char*)(&vid));
+            }
+            return SaveDelta();
         }
 
 #pragma region K-NN search
@@ -193,6 +195,8 @@ namespace SPTAG
         ErrorCode Index<T>::SearchIndex(QueryResult &p_query, bool p_searchDeleted) const
         {
             if (!m_bReady) return ErrorCode::EmptyIndex;
+            if (m_options.m_enablePipelinedSearch && m_extraSearcher != nullptr && m_extraSearcher->SupportsPipelinedSearch())
+                return SearchIndexPipelined(p_query, p_searchDeleted);
 
             COMMON::QueryResultSet<T>* p_queryResults;
             if (p_query.GetResultNum() >= m_options.m_searchInternalResultNum) 
@@ -206,13 +210,15 @@ namespace SPTAG
                 auto workSpace = m_workSpaceFactory->GetWorkSpace();
                 if (!workSpace) {
                     workSpace.reset(new ExtraWorkSpace());
-                    workSpace->Initialize(m_options.m_maxCheck, m_options.m_hashExp, m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression);
+                    workSpace->Initialize(m_options.m_maxCheck, m_options.m_hashExp, m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression, GetNumSamples(), m_options.m_visitedSetType);
                 }
                 else {
                     workSpace->Clear(m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression);
                 }
                 workSpace->m_deduper.clear();
                 workSpace->m_postingIDs.clear();
+                workSpace->m_deltaPostingIDs.clear();
+                workSpace->m_deletedID = (p_searchDeleted || m_deletedID.Count() == 0) ? nullptr : &m_deletedID;
 
                 float limitDist = p_queryResults->GetResult(0)->Dist * m_options.m_maxDistRatio;
                 for (int i = 0; i < p_queryResults->GetResultNum(); ++i)
@@ -221,22 +227,28 @@ namespace SPTAG
                     if (res->VID == -1) break;
 
                     auto postingID = res->VID;
-                    res->VID = static_cast<SizeType>((m_vectorTranslateMap.get())[res->VID]);
-                    if (res->VID == MaxSize) {
+                    res->VID = GetGlobalVID(res->VID);
+                    if (res->VID == MaxSize || (workSpace->m_deletedID != nullptr && workSpace->m_deletedID->Contains(res->VID))) {
                         res->VID = -1;
                         res->Dist = MaxDist;
                     }
+                    else {
+                        // Heads promoted by splits may still sit in other in-memory postings
+                        workSpace->m_deduper.CheckAndSet(res->VID);
+                    }
 
                     // Don't do disk reads for irrelevant pages
                     if (workSpace->m_postingIDs.size() >= m_options.m_searchInternalResultNum ||
-                        (limitDist > 0.1 && res->Dist > limitDist) || 
-                        !m_extraSearcher->CheckValidPosting(postingID)) 
+                        (limitDist > 0.1 && res->Dist > limitDist)) 
                         continue;
-                    workSpace->m_postingIDs.emplace_back(postingID);
+                    if (m_extraSearcher->CheckValidPosting(postingID)) workSpace->m_postingIDs.emplace_back(postingID);
+                    else workSpace->m_deltaPostingIDs.emplace_back(postingID);
                 }
 
                 p_queryResults->Reverse();
                 m_extraSearcher->SearchIndex(workSpace.get(), *p_queryResults, m_index, nullptr);
+                SearchDeltaPostings(workSpace.get(), *p_queryResults);
+                workSpace->m_deletedID = nullptr;
                 m_workSpaceFactory->ReturnWorkSpace(std::move(workSpace));
                 p_queryResults->SortResult();
             }
@@ -257,6 +269,132 @@ namespace SPTAG
             return ErrorCode::Success;
         }
 
+        // Posting reads start while the head search is still running: every PipelineStageCheck checked heads,
+        // heads that stayed within the top PipelineStageHeads since the previous stage are read speculatively,
+        // and postings that have arrived are merged. The heads of the final head result that were not read
+        // yet are issued last, so the result set covers the same postings as SearchIndex.
+        template<typename T>
+        ErrorCode Index<T>::SearchIndexPipelined(QueryResult& p_query, bool p_searchDeleted) const
+        {
+            int internalResultNum = m_options.m_searchInternalResultNum;
+            auto workSpace = m_workSpaceFactory->GetWorkSpace();
+            if (!workSpace) {
+                workSpace.reset(new ExtraWorkSpace());
+                workSpace->Initialize(m_options.m_maxCheck, m_options.m_hashExp, internalResultNum * 2, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression, GetNumSamples(), m_options.m_visitedSetType);
+            }
+            else {
+                workSpace->Clear(internalResultNum * 2, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression);
+            }
+            workSpace->m_deduper.clear();
+            workSpace->m_postingIDs.clear();
+            workSpace->m_deltaPostingIDs.clear();
+            workSpace->m_deletedID = (p_searchDeleted || m_deletedID.Count() == 0) ? nullptr : &m_deletedID;
+
+            COMMON::QueryResultSet<T>* p_queryResults;
+            if (p_query.GetResultNum() >= internalResultNum)
+                p_queryResults = (COMMON::QueryResultSet<T>*) & p_query;
+            else
+                p_queryResults = new COMMON::QueryResultSet<T>((const T*)p_query.GetTarget(), internalResultNum);
+            p_queryResults->SetTarget((const T*)p_query.GetTarget(), m_pQuantizer);
+
+            std::vector<int>& postingIDs = workSpace->m_postingIDs;
+            std::vector<SizeType> stable, top;
+            int submitted = 0, completed = 0, speculative = 0, failedPolls = 0;
+            auto onStage = [&](QueryResult& p_stage) {
+                float limitDist = p_stage.GetResult(0)->Dist * m_options.m_maxDistRatio;
+                top.clear();
+                for (int i = 0; i < p_stage.GetResultNum() && (int)top.size() < m_options.m_pipelineStageHeads; ++i)
+                {
+                    auto res = p_stage.GetResult(i);
+                    if (res->VID == -1 || (limitDist > 0.1 && res->Dist > limitDist)) break;
+                    top.push_back(res->VID);
+                }
+
+                int begin = (int)postingIDs.size();
+                for (SizeType head : top)
+                {
+                    if (speculative >= internalResultNum) break;
+                    if (std::find(stable.begin(), stable.end(), head) == stable.end() ||
+                        std::find(postingIDs.begin(), postingIDs.end(), head) != postingIDs.end() ||
+                        !m_extraSearcher->CheckValidPosting(head)) continue;
+                    postingIDs.push_back(head);
+                    speculative++;
+                }
+                stable.swap(top);
+
+                if (begin < (int)postingIDs.size()) submitted += m_extraSearcher->SubmitPostings(workSpace.get(), *p_queryResults, m_index, begin);
+                if (completed < submitted) {
+                    int done = m_extraSearcher->PollPostings(workSpace.get(), false);
+                    if (done < 0) failedPolls++;
+                    else completed += done;
+                }
+            };
+
+            COMMON::QueryResultSet<T> headResults((const T*)p_query.GetTarget(), internalResultNum);
+            m_index->SearchIndexStaged(headResults, m_options.m_pipelineStageCheck, onStage);
+
+            float limitDist = headResults.GetResult(0)->Dist * m_options.m_maxDistRatio;
+            int begin = (int)postingIDs.size(), diskPostings = 0;
+            for (int i = 0; i < headResults.GetResultNum(); ++i)
+            {
+                auto res = headResults.GetResult(i);
+                if (res->VID == -1 || diskPostings >= internalResultNum || (limitDist > 0.1 && res->Dist > limitDist)) break;
+
+                if (!m_extraSearcher->CheckValidPosting(res->VID)) workSpace->m_deltaPostingIDs.emplace_back(res->VID);
+                else {
+                    diskPostings++;
+                    if (std::find(postingIDs.begin(), postingIDs.begin() + begin, res->VID) == postingIDs.begin() + begin) postingIDs.push_back(res->VID);
+                }
+            }
+            if (begin < (int)postingIDs.size()) submitted += m_extraSearcher->SubmitPostings(workSpace.get(), *p_queryResults, m_index, begin);
+
+            // Heads are merged while the last reads are in flight; their own posting entries then dedup against them.
+            for (int i = 0; i < headResults.GetResultNum(); ++i)
+            {
+                auto res = headResults.GetResult(i);
+                if (res->VID == -1) break;
+
+                SizeType vid = GetGlobalVID(res->VID);
+                if (vid == MaxSize || (workSpace->m_deletedID != nullptr && workSpace->m_deletedID->Contains(vid))) continue;
+                if (!workSpace->m_deduper.CheckAndSet(vid)) p_queryResults->AddPoint(vid, res->Dist);
+            }
+            SearchDeltaPostings(workSpace.get(), *p_queryResults);
+
+            // Every read must land before the page buffers and the result set are released, so a failed poll
+            // is retried; reads that never report back leave both behind rather than let them be reused.
+            const int maxFailedPolls = 10;
+            while (completed < submitted && failedPolls < maxFailedPolls)
+            {
+                int done = m_extraSearcher->PollPostings(workSpace.get(), true);
+                if (done < 0) failedPolls++;
+                else completed += done;
+            }
+            if (completed < submitted)
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Pipelined search gave up on %d posting reads!\n", submitted - completed);
+                workSpace.release();
+                return ErrorCode::DiskIOFail;
+            }
+            workSpace->m_deletedID = nullptr;
+            m_workSpaceFactory->ReturnWorkSpace(std::move(workSpace));
+            p_queryResults->SortResult();
+
+            if (p_query.GetResultNum() < internalResultNum) {
+                std::copy(p_queryResults->GetResults(), p_queryResults->GetResults() + p_query.GetResultNum(), p_query.GetResults());
+                delete p_queryResults;
+            }
+
+            if (p_query.WithMeta() && nullptr != m_pMetadata)
+            {
+                for (int i = 0; i < p_query.GetResultNum(); ++i)
+                {
+                    SizeType result = p_query.GetResult(i)->VID;
+                    p_query.SetMetadata(i, (result < 0) ? ByteArray::c_empty : m_pMetadata->GetMetadataCopy(result));
+                }
+            }
+            return ErrorCode::Success;
+        }
+
         template<typename T>
         ErrorCode Index<T>::SearchIndexIterative(QueryResult& p_headQuery, QueryResult& p_query,
             COMMON::WorkSpace* p_indexWorkspace,
@@ -308,7 +446,7 @@ namespace SPTAG
             auto extraWorkspace = m_workSpaceFactory->GetWorkSpace();
             if (!extraWorkspace) {
                 extraWorkspace.reset(new ExtraWorkSpace());
-                extraWorkspace->Initialize(m_options.m_maxCheck, m_options.m_hashExp, m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression);
+                extraWorkspace->Initialize(m_options.m_maxCheck, m_options.m_hashExp, m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression, GetNumSamples(), m_options.m_visitedSetType);
             }
             extraWorkspace->m_relaxedMono = false;
             extraWorkspace->m_loadedPostingNum = 0;
@@ -368,13 +506,15 @@ namespace SPTAG
             auto workSpace = m_workSpaceFactory->GetWorkSpace();
             if (!workSpace) {
                 workSpace.reset(new ExtraWorkSpace());
-                workSpace->Initialize(m_options.m_maxCheck, m_options.m_hashExp, m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression);
+                workSpace->Initialize(m_options.m_maxCheck, m_options.m_hashExp, m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression, GetNumSamples(), m_options.m_visitedSetType);
             }
             else {
                 workSpace->Clear(m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression);
             }
             workSpace->m_deduper.clear();
             workSpace->m_postingIDs.clear();
+            workSpace->m_deltaPostingIDs.clear();
+            workSpace->m_deletedID = (m_deletedID.Count() == 0) ? nullptr : &m_deletedID;
 
             float limitDist = p_queryResults->GetResult(0)->Dist * m_options.m_maxDistRatio;
             int i = 0;
@@ -386,7 +526,11 @@ namespace SPTAG
                 {
                     workSpace->m_postingIDs.emplace_back(res->VID);
                 }
-                res->VID = static_cast<SizeType>((m_vectorTranslateMap.get())[res->VID]);
+                else
+                {
+                    workSpace->m_deltaPostingIDs.emplace_back(res->VID);
+                }
+                res->VID = GetGlobalVID(res->VID);
                 if (res->VID == MaxSize) 
                 {
                     res->VID = -1;
@@ -398,7 +542,7 @@ namespace SPTAG
             {
                 auto res = p_queryResults->GetResult(i);
                 if (res->VID == -1) break;
-                res->VID = static_cast<SizeType>((m_vectorTranslateMap.get())[res->VID]);
+                res->VID = GetGlobalVID(res->VID);
                 if (res->VID == MaxSize) 
                 {
                     res->VID = -1;
@@ -408,6 +552,8 @@ namespace SPTAG
 
             p_queryResults->Reverse();
             m_extraSearcher->SearchIndex(workSpace.get(), *p_queryResults, m_index, p_stats);
+            SearchDeltaPostings(workSpace.get(), *p_queryResults);
+            workSpace->m_deletedID = nullptr;
             m_workSpaceFactory->ReturnWorkSpace(std::move(workSpace));
             p_queryResults->SortResult();
             return ErrorCode::Success;
@@ -434,7 +580,7 @@ namespace SPTAG
                     {
                         extraWorkspace->m_postingIDs.emplace_back(res->VID);
                     }
-                    res->VID = static_cast<SizeType>((m_vectorTranslateMap.get())[res->VID]);
+                    res->VID = GetGlobalVID(res->VID);
                     if (res->VID == MaxSize)
                     {
                         res->VID = -1;
@@ -467,7 +613,7 @@ namespace SPTAG
                 auto res = newResults.GetResult(i);
                 if (res->VID == -1) break;
 
-                auto global_VID = static_cast<SizeType>((m_vectorTranslateMap.get())[res->VID]);
+                auto global_VID = GetGlobalVID(res->VID);
                 if (truth && truth->count(global_VID)) (*found)[res->VID].insert(global_VID);
                 res->VID = global_VID;
                 if (res->VID == MaxSize) {
@@ -480,7 +626,7 @@ namespace SPTAG
             auto workSpace = m_workSpaceFactory->GetWorkSpace();
             if (!workSpace) {
                 workSpace.reset(new ExtraWorkSpace());
-                workSpace->Initialize(m_options.m_maxCheck, m_options.m_hashExp, m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression);
+                workSpace->Initialize(m_options.m_maxCheck, m_options.m_hashExp, m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression, GetNumSamples(), m_options.m_visitedSetType);
             }
             else {
                 workSpace->Clear(m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression);
@@ -509,6 +655,311 @@ namespace SPTAG
             std::copy(newResults.GetResults(), newResults.GetResults() + newResults.GetResultNum(), p_query.GetResults());
             return ErrorCode::Success;
         }
+
+        template <typename T>
+        void Index<T>::SearchDeltaPostings(ExtraWorkSpace* p_exWorkSpace, COMMON::QueryResultSet<T>& p_queryResults) const
+        {
+            if (m_deltaVectors.R() == 0) return;
+
+            std::shared_lock<std::shared_timed_mutex> lock(m_deltaLock);
+            for (auto postingIDs : { &(p_exWorkSpace->m_postingIDs), &(p_exWorkSpace->m_deltaPostingIDs) }) {
+                for (int postingID : *postingIDs) {
+                    auto iter = m_deltaPostings.find(postingID);
+                    if (iter == m_deltaPostings.end()) continue;
+
+                    const std::vector<SizeType>& vids = iter->second;
+                    for (size_t begin = 0; begin < vids.size(); begin += COMMON::Labelset::c_maskKeys) {
+                        int count = (int)min(vids.size() - begin, (size_t)COMMON::Labelset::c_maskKeys);
+                        std::uint64_t deleted = (p_exWorkSpace->m_deletedID != nullptr) ? p_exWorkSpace->m_deletedID->ContainsMask(vids.data() + begin, count) : 0;
+                        for (int i = 0; i < count; i++) {
+                            SizeType vid = vids[begin + i];
+                            if (((deleted >> i) & 1) || p_exWorkSpace->m_deduper.CheckAndSet(vid)) continue;
+                            p_queryResults.AddPoint(vid, ComputeDistance(p_queryResults.GetTarget(), m_deltaVectors[vid - m_options.m_vectorSize]));
+                        }
+                    }
+                }
+            }
+        }
+#pragma endregion
+
+#pragma region Online update
+
+        template <typename T>
+        void Index<T>::InitUpdateStore(bool p_loadDelta)
+        {
+            m_deltaVectors.Initialize(0, m_options.m_dim, m_options.m_datasetRowsInBlock, m_options.m_datasetCapacity);
+            m_deltaVectors.SetName("DeltaVectors");
+            m_deletedID.Initialize(max(m_options.m_vectorSize, 0), m_options.m_datasetRowsInBlock, m_options.m_datasetCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysNotContains);
+            {
+                std::unique_lock<std::shared_timed_mutex> lock(m_deltaLock);
+                m_deltaPostings.clear();
+                m_splitting.clear();
+            }
+            m_splitHeadBase = m_index->GetNumSamples();
+            m_splitHeads.reserve(m_options.m_datasetRowsInBlock, m_options.m_datasetCapacity);
+
+            if (p_loadDelta && m_extraSearcher != nullptr && LoadDelta() != ErrorCode::Success) {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Warning, "Failed to load online updates from %s, ignore them.\n", (m_options.m_indexDirectory + FolderSep + m_options.m_deltaIndex).c_str());
+                m_deltaVectors.Initialize(0, m_options.m_dim, m_options.m_datasetRowsInBlock, m_options.m_datasetCapacity);
+                m_deletedID.Initialize(max(m_options.m_vectorSize, 0), m_options.m_datasetRowsInBlock, m_options.m_datasetCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysNotContains);
+                std::unique_lock<std::shared_timed_mutex> lock(m_deltaLock);
+                m_deltaPostings.clear();
+            }
+            m_threadPool.init();
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::SaveDelta()
+        {
+            std::string deltaFile = m_options.m_indexDirectory + FolderSep + m_options.m_deltaIndex;
+            std::string deletedFile = m_options.m_indexDirectory + FolderSep + m_options.m_deleteIDFile;
+            if (m_deltaVectors.R() == 0 && m_deletedID.Count() == 0) {
+                if (fileexists(deltaFile.c_str())) remove(deltaFile.c_str());
+                if (fileexists(deletedFile.c_str())) remove(deletedFile.c_str());
+                return ErrorCode::Success;
+            }
+
+            ErrorCode ret;
+            if ((ret = m_deletedID.Save(deletedFile)) != ErrorCode::Success) return ret;
+
+            auto ptr = f_createIO();
+            if (ptr == nullptr || !ptr->Initialize(deltaFile.c_str(), std::ios::binary | std::ios::out)) return ErrorCode::FailedCreateFile;
+            if ((ret = m_deltaVectors.Save(ptr)) != ErrorCode::Success) return ret;
+
+            std::shared_lock<std::shared_timed_mutex> lock(m_deltaLock);
+            SizeType postingNum = static_cast<SizeType>(m_deltaPostings.size());
+            IOBINARY(ptr, WriteBinary, sizeof(SizeType), (char*)&postingNum);
+            for (auto& posting : m_deltaPostings) {
+                SizeType headID = posting.first, listSize = static_cast<SizeType>(posting.second.size());
+                IOBINARY(ptr, WriteBinary, sizeof(SizeType), (char*)&headID);
+                IOBINARY(ptr, WriteBinary, sizeof(SizeType), (char*)&listSize);
+                IOBINARY(ptr, WriteBinary, sizeof(SizeType) * listSize, (char*)posting.second.data());
+            }
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Save %d online added vectors in %d postings and %zu deleted IDs.\n", m_deltaVectors.R(), postingNum, m_deletedID.Count());
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::LoadDelta()
+        {
+            std::string deltaFile = m_options.m_indexDirectory + FolderSep + m_options.m_deltaIndex;
+            std::string deletedFile = m_options.m_indexDirectory + FolderSep + m_options.m_deleteIDFile;
+
+            ErrorCode ret;
+            if (fileexists(deltaFile.c_str())) {
+                auto ptr = f_createIO();
+                if (ptr == nullptr || !ptr->Initialize(deltaFile.c_str(), std::ios::binary | std::ios::in)) return ErrorCode::FailedOpenFile;
+                if ((ret = m_deltaVectors.Load(ptr, m_options.m_datasetRowsInBlock, m_options.m_datasetCapacity)) != ErrorCode::Success) return ret;
+
+                SizeType postingNum;
+                IOBINARY(ptr, ReadBinary, sizeof(SizeType), (char*)&postingNum);
+                for (SizeType i = 0; i < postingNum; i++) {
+                    SizeType headID, listSize;
+                    IOBINARY(ptr, ReadBinary, sizeof(SizeType), (char*)&headID);
+                    IOBINARY(ptr, ReadBinary, sizeof(SizeType), (char*)&listSize);
+                    std::vector<SizeType>& posting = m_deltaPostings[headID];
+                    posting.resize(listSize);
+                    IOBINARY(ptr, ReadBinary, sizeof(SizeType) * listSize, (char*)posting.data());
+                }
+            }
+
+            if (fileexists(deletedFile.c_str())) {
+                if ((ret = m_deletedID.Load(deletedFile, m_options.m_datasetRowsInBlock, m_options.m_datasetCapacity, COMMON::Labelset::InvalidIDBehavior::AlwaysNotContains)) != ErrorCode::Success) return ret;
+            }
+            else if ((ret = m_deletedID.AddBatch(m_deltaVectors.R())) != ErrorCode::Success) return ret;
+
+            if (m_deletedID.R() != GetNumSamples()) {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Deleted IDs (%d) do not match vector count (%d)!\n", m_deletedID.R(), GetNumSamples());
+                return ErrorCode::FailedParseValue;
+            }
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::AddIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex, bool p_normalized)
+        {
+            if (p_data == nullptr || p_vectorNum == 0 || p_dimension == 0) return ErrorCode::EmptyData;
+            if (!m_bReady || m_extraSearcher == nullptr || m_options.m_vectorSize < 0) return ErrorCode::EmptyIndex;
+            if (m_pQuantizer) {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "AddIndex is not supported for quantized SPANN index!\n");
+                return ErrorCode::Fail;
+            }
+            if (p_dimension != m_options.m_dim) return ErrorCode::DimensionSizeMismatch;
+
+            SizeType begin, end;
+            {
+                std::lock_guard<std::mutex> lock(m_dataAddLock);
+
+                begin = GetNumSamples();
+                end = begin + p_vectorNum;
+                if (m_deltaVectors.AddBatch((const T*)p_data, p_vectorNum) != ErrorCode::Success ||
+                    m_deletedID.AddBatch(p_vectorNum) != ErrorCode::Success) {
+                    SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Memory Error: Cannot alloc space for vectors!\n");
+                    m_deltaVectors.SetR(begin - m_options.m_vectorSize);
+                    m_deletedID.SetR(begin);
+                    return ErrorCode::MemoryOverFlow;
+                }
+
+                if (m_pMetadata != nullptr) {
+                    if (p_metadataSet != nullptr) {
+                        m_pMetadata->AddBatch(*p_metadataSet);
+                        if (HasMetaMapping()) {
+                            for (SizeType i = begin; i < end; i++) {
+                                ByteArray meta = m_pMetadata->GetMetadata(i);
+                                std::string metastr((char*)meta.Data(), meta.Length());
+                                UpdateMetaMapping(metastr, i);
+                            }
+                        }
+                    }
+                    else {
+                        for (SizeType i = begin; i < end; i++) m_pMetadata->Add(ByteArray::c_empty);
+                    }
+                }
+            }
+
+            if (DistCalcMethod::Cosine == m_options.m_distCalcMethod && !p_normalized)
+            {
+                int base = COMMON::Utils::GetBase<T>();
+                for (SizeType i = begin; i < end; i++) {
+                    COMMON::Utils::Normalize(m_deltaVectors[i - m_options.m_vectorSize], m_options.m_dim, base);
+                }
+            }
+
+            Helper::TaskScheduler::Instance().ParallelFor(begin, end, m_options.m_iSSDNumberOfThreads, [&](SizeType i) { AppendToPostings(i); });
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        void Index<T>::AppendToPostings(SizeType p_vid)
+        {
+            const T* vector = m_deltaVectors[p_vid - m_options.m_vectorSize];
+            COMMON::QueryResultSet<T> query(vector, m_options.m_internalResultNum);
+            m_index->SearchIndex(query);
+
+            // Same replica selection as BuildSSDIndex: skip heads closer to an already selected head than to the vector.
+            std::vector<SizeType> selected;
+            for (int i = 0; i < query.GetResultNum() && (int)selected.size() < m_options.m_replicaCount; i++) {
+                auto res = query.GetResult(i);
+                if (res->VID == -1) break;
+
+                bool rngAccepted = true;
+                for (SizeType head : selected) {
+                    if (m_options.m_rngFactor * m_index->ComputeDistance(m_index->GetSample(res->VID), m_index->GetSample(head)) < res->Dist) {
+                        rngAccepted = false;
+                        break;
+                    }
+                }
+                if (rngAccepted) selected.push_back(res->VID);
+            }
+
+            std::vector<SizeType> oversized;
+            {
+                std::unique_lock<std::shared_timed_mutex> lock(m_deltaLock);
+                for (SizeType head : selected) {
+                    std::vector<SizeType>& posting = m_deltaPostings[head];
+                    posting.push_back(p_vid);
+                    if ((int)posting.size() > m_options.m_postingVectorLimit && m_splitting.insert(head).second) oversized.push_back(head);
+                }
+            }
+            for (SizeType head : oversized) m_threadPool.add(new SplitJob(this, head));
+        }
+
+        template <typename T>
+        void Index<T>::SplitPosting(SizeType p_headID, IAbortOperation* p_abort)
+        {
+            std::vector<SizeType> members;
+            {
+                std::unique_lock<std::shared_timed_mutex> lock(m_deltaLock);
+                m_splitting.erase(p_headID);
+                auto iter = m_deltaPostings.find(p_headID);
+                if (iter == m_deltaPostings.end()) return;
+
+                // Deleted vectors only cost scan time, drop them first.
+                iter->second.erase(std::remove_if(iter->second.begin(), iter->second.end(), [this](SizeType vid) { return m_deletedID.Contains(vid); }), iter->second.end());
+                if ((int)iter->second.size() <= m_options.m_postingVectorLimit) return;
+                members = iter->second;
+            }
+
+            // Seed the new head with the member farthest from the old one, then move the members
+            // closer to the seed to the seed's medoid.
+            const void* headVector = m_index->GetSample(p_headID);
+            std::vector<float> headDist(members.size());
+            size_t seed = 0;
+            for (size_t i = 0; i < members.size(); i++) {
+                headDist[i] = ComputeDistance(m_deltaVectors[members[i] - m_options.m_vectorSize], headVector);
+                if (headDist[i] > headDist[seed]) seed = i;
+            }
+
+            std::vector<size_t> cluster;
+            for (size_t i = 0; i < members.size(); i++) {
+                if (ComputeDistance(m_deltaVectors[members[i] - m_options.m_vectorSize], m_deltaVectors[members[seed] - m_options.m_vectorSize]) < headDist[i]) cluster.push_back(i);
+            }
+            if (cluster.size() < 2 || p_abort->ShouldAbort()) return;
+
+            size_t medoid = cluster[0];
+            float minSum = MaxDist;
+            for (size_t i : cluster) {
+                float sum = 0;
+                for (size_t j : cluster) sum += ComputeDistance(m_deltaVectors[members[i] - m_options.m_vectorSize], m_deltaVectors[members[j] - m_options.m_vectorSize]);
+                if (sum < minSum) {
+                    minSum = sum;
+                    medoid = i;
+                }
+            }
+
+            SizeType newHeadVID = members[medoid];
+            const T* newHeadVector = m_deltaVectors[newHeadVID - m_options.m_vectorSize];
+            std::vector<SizeType> moved;
+            for (size_t i = 0; i < members.size(); i++) {
+                if (i != medoid && ComputeDistance(m_deltaVectors[members[i] - m_options.m_vectorSize], newHeadVector) < headDist[i]) moved.push_back(members[i]);
+            }
+            if (p_abort->ShouldAbort()) return;
+
+            // Split jobs run on a single thread, so new heads take consecutive IDs.
+            if (m_index->AddIndex(newHeadVector, 1, m_options.m_dim, nullptr, false, true) != ErrorCode::Success) {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Failed to add head for splitting posting %d!\n", p_headID);
+                return;
+            }
+            SizeType newHeadID = m_index->GetNumSamples() - 1;
+            if ((std::uint64_t)(newHeadID - m_splitHeadBase) != m_splitHeads.size() || !m_splitHeads.push_back(newHeadVID)) {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Head %d does not match split head list (%llu)!\n", newHeadID, m_splitHeads.size());
+                return;
+            }
+
+            std::unique_lock<std::shared_timed_mutex> lock(m_deltaLock);
+            m_deltaPostings[newHeadID] = moved;
+            std::unordered_set<SizeType> movedSet(moved.begin(), moved.end());
+            movedSet.insert(newHeadVID);
+            std::vector<SizeType>& posting = m_deltaPostings[p_headID];
+            posting.erase(std::remove_if(posting.begin(), posting.end(), [&movedSet](SizeType vid) { return movedSet.count(vid) > 0; }), posting.end());
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Debug, "Split posting %d: %d vectors moved to new head %d (vector %d).\n", p_headID, (int)moved.size(), newHeadID, newHeadVID);
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::DeleteIndex(const void* p_vectors, SizeType p_vectorNum)
+        {
+            const T* ptr_v = (const T*)p_vectors;
+            Helper::TaskScheduler::Instance().ParallelFor(0, p_vectorNum, m_options.m_iSSDNumberOfThreads, [&](SizeType i) {
+                COMMON::QueryResultSet<T> query(ptr_v + i * m_options.m_dim, m_options.m_searchInternalResultNum);
+                SearchIndex(query);
+
+                for (int j = 0; j < m_options.m_searchInternalResultNum; j++) {
+                    if (query.GetResult(j)->VID >= 0 && query.GetResult(j)->Dist < 1e-6) {
+                        DeleteIndex(query.GetResult(j)->VID);
+                    }
+                }
+            });
+            return ErrorCode::Success;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::DeleteIndex(const SizeType& p_id)
+        {
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+
+            if (m_deletedID.Insert(p_id)) return ErrorCode::Success;
+            return ErrorCode::VectorNotFound;
+        }
 #pragma endregion
 
         template <typename T>
@@ -521,7 +972,7 @@ namespace SPTAG
             auto workSpace = m_workSpaceFactory->GetWorkSpace();
             if (!workSpace) {
                 workSpace.reset(new ExtraWorkSpace());
-                workSpace->Initialize(m_options.m_maxCheck, m_options.m_hashExp, m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression);
+                workSpace->Initialize(m_options.m_maxCheck, m_options.m_hashExp, m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression, GetNumSamples(), m_options.m_visitedSetType);
             }
             else {
                 workSpace->Clear(m_options.m_searchInternalResultNum, max(m_options.m_postingPageLimit, m_options.m_searchPostingPageLimit + 1) << PageSizeEx, m_options.m_enableDataCompression);
@@ -960,6 +1411,7 @@ namespace SPTAG
                 }
             }
 
+            InitUpdateStore(false);
             m_bReady = true;
             return ErrorCode::Success;
         }
@@ -1020,7 +1472,6 @@ namespace SPTAG
         ErrorCode
             Index<T>::UpdateIndex()
         {
-            omp_set_num_threads(m_options.m_iSSDNumberOfThreads);
             m_index->SetParameter("NumberOfThreads", std::to_string(m_options.m_iSSDNumberOfThreads));
             //m_index->SetParameter("MaxCheck", std::to_string(m_options.m_maxCheck));
             //m_index->SetParameter("HashTableExponent", std::to_string(m_options.m_hashExp));
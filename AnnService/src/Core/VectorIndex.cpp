@@ -6,6 +6,8 @@
 #include "inc/Helper/StringConvert.h"
 #include "inc/Helper/SimpleIniReader.h"
 #include "inc/Helper/ConcurrentSet.h"
+#include "inc/Helper/AsyncFileReader.h"
+#include "inc/Helper/TaskScheduler.h"
 
 #include "inc/Core/BKT/Index.h"
 #include "inc/Core/KDT/Index.h"
@@ -148,9 +150,16 @@ VectorIndex::GetMetadata() const {
 
 ByteArray 
 VectorIndex::GetMetadata(SizeType p_vectorID) const {
-    if (nullptr != m_pMetadata)
+    std::shared_ptr<MetadataSet> metadata = std::atomic_load(&m_pMetadata);
+    if (nullptr != metadata)
     {
-        return m_pMetadata->GetMetadata(p_vectorID);
+        ByteArray meta = metadata->GetMetadata(p_vectorID);
+        // A compaction can replace the set once this returns, so a view into it keeps the set alive.
+        if (meta.Data() != nullptr && meta.DataHolder() == nullptr)
+        {
+            return ByteArray(meta.Data(), meta.Length(), std::shared_ptr<std::uint8_t>(metadata, meta.Data()));
+        }
+        return meta;
     }
     return ByteArray::c_empty;
 }
@@ -353,6 +362,8 @@ VectorIndex::SaveIndex(const std::string& p_folderPath)
     for (std::string& f : *indexfiles) {
         std::string newfile = folderPath + f;
         if (!direxists(newfile.substr(0, newfile.find_last_of(FolderSep)).c_str())) mkdir(newfile.substr(0, newfile.find_last_of(FolderSep)).c_str());
+        // Replace rather than overwrite a file this index may have mapped, so the pages it still reads stay valid.
+        if (!m_indexFileBuffers.empty()) std::remove(newfile.c_str());
         
         auto ptr = SPTAG::f_createIO();
         if (ptr == nullptr || !ptr->Initialize(newfile.c_str(), std::ios::binary | std::ios::out)) return ErrorCode::FailedCreateFile;
@@ -434,9 +445,15 @@ VectorIndex::BuildIndex(std::shared_ptr<VectorSet> p_vectorSet,
 {
     SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Begin build index...\n");
 
+    if (nullptr == p_vectorSet) return ErrorCode::Fail;
+
     bool valueMatches = p_vectorSet->GetValueType() == GetVectorValueType();
     bool quantizerMatches = ((bool)m_pQuantizer) && (p_vectorSet->GetValueType() == SPTAG::VectorValueType::UInt8);
-    if (nullptr == p_vectorSet || !(valueMatches || quantizerMatches))
+    // Otherwise only a BYTE index told to train its own quantizer can take the vectors.
+    std::string quantizerBits = GetParameter("ScalarQuantizerBits");
+    bool quantizeOnBuild = !(valueMatches || quantizerMatches) && !m_pQuantizer && GetVectorValueType() == SPTAG::VectorValueType::UInt8 &&
+        !quantizerBits.empty() && quantizerBits != "0";
+    if (!(valueMatches || quantizerMatches || quantizeOnBuild))
     {
         return ErrorCode::Fail;
     }
@@ -446,6 +463,7 @@ VectorIndex::BuildIndex(std::shared_ptr<VectorSet> p_vectorSet,
         SPTAGLIB_LOG(Helper::LogLevel::LL_Info, "Build meta mapping...\n");
         BuildMetaMapping(false);
     }
+    if (quantizeOnBuild) return BuildQuantizedIndex(p_vectorSet, p_normalized);
     BuildIndex(p_vectorSet->GetData(), p_vectorSet->Count(), p_vectorSet->Dimension(), p_normalized, p_shareOwnership);
     return ErrorCode::Success;
 }
@@ -454,19 +472,36 @@ VectorIndex::BuildIndex(std::shared_ptr<VectorSet> p_vectorSet,
 ErrorCode
 VectorIndex::SearchIndex(const void* p_vector, int p_vectorCount, int p_neighborCount, bool p_withMeta, BasicResult* p_results) const {
     size_t vectorSize = GetValueTypeSize(GetVectorValueType()) * GetFeatureDim();
-#pragma omp parallel for schedule(dynamic,10)
+    std::vector<QueryResult> queries;
+    queries.reserve(p_vectorCount);
     for (int i = 0; i < p_vectorCount; i++) {
-        QueryResult res((char*)p_vector + i * vectorSize, p_neighborCount, p_withMeta, p_results + i * p_neighborCount);
-        SearchIndex(res);
+        queries.emplace_back((char*)p_vector + i * vectorSize, p_neighborCount, p_withMeta, p_results + i * p_neighborCount);
     }
+    return SearchIndexBatch(queries.data(), p_vectorCount);
+}
+
+
+ErrorCode
+VectorIndex::SearchIndexBatch(QueryResult* p_queries, int p_queryCount, bool p_searchDeleted) const {
+    Helper::TaskScheduler::Instance().ParallelFor(0, p_queryCount, GetNumThreads(), [&](SizeType i) {
+        SearchIndex(p_queries[i], p_searchDeleted);
+    }, nullptr, 10);
     return ErrorCode::Success;
 }
 
 
+ErrorCode
+VectorIndex::SearchIndexStaged(QueryResult& p_query, int p_stageCheck, std::function<void(QueryResult&)> p_onStage, bool p_searchDeleted) const {
+    return SearchIndex(p_query, p_searchDeleted);
+}
+
+
 ErrorCode 
 VectorIndex::AddIndex(std::shared_ptr<VectorSet> p_vectorSet, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex, bool p_normalized) {
-    if (nullptr == p_vectorSet || p_vectorSet->GetValueType() != GetVectorValueType())
+    if (nullptr == p_vectorSet) return ErrorCode::Fail;
+    if (p_vectorSet->GetValueType() != GetVectorValueType())
     {
+        if (m_pQuantizer && p_vectorSet->GetValueType() == m_pQuantizer->GetReconstructType()) return AddQuantizedIndex(p_vectorSet, p_metadataSet, p_withMetaIndex, p_normalized);
         return ErrorCode::Fail;
     }
 
@@ -488,13 +523,9 @@ VectorIndex::DeleteIndex(ByteArray p_meta) {
 ErrorCode
 VectorIndex::MergeIndex(VectorIndex* p_addindex, int p_threadnum, IAbortOperation* p_abort)
 {
-    ErrorCode ret = ErrorCode::Success;
     if (p_addindex->m_pMetadata != nullptr) {
-#pragma omp parallel for num_threads(p_threadnum) schedule(dynamic,128)
-        for (SizeType i = 0; i < p_addindex->GetNumSamples(); i++)
+        Helper::TaskScheduler::Instance().ParallelFor(0, p_addindex->GetNumSamples(), p_threadnum, [&](SizeType i)
         {
-            if (ret == ErrorCode::ExternalAbort) continue;
-
             if (p_addindex->ContainSample(i))
             {
                 ByteArray meta = p_addindex->GetMetadata(i);
@@ -502,31 +533,18 @@ VectorIndex::MergeIndex(VectorIndex* p_addindex, int p_threadnum, IAbortOperatio
                 std::shared_ptr<MetadataSet> p_metaSet(new MemMetadataSet(meta, ByteArray((std::uint8_t*)offsets, sizeof(offsets), false), 1));
                 AddIndex(p_addindex->GetSample(i), 1, p_addindex->GetFeatureDim(), p_metaSet);
             }
-
-            if (p_abort != nullptr && p_abort->ShouldAbort()) 
-            {
-                ret = ErrorCode::ExternalAbort;
-            }
-        }
+        }, p_abort, 128);
     }
     else {
-#pragma omp parallel for num_threads(p_threadnum) schedule(dynamic,128)
-        for (SizeType i = 0; i < p_addindex->GetNumSamples(); i++) 
+        Helper::TaskScheduler::Instance().ParallelFor(0, p_addindex->GetNumSamples(), p_threadnum, [&](SizeType i)
         {
-            if (ret == ErrorCode::ExternalAbort) continue;
-
             if (p_addindex->ContainSample(i))
             {
                 AddIndex(p_addindex->GetSample(i), 1, p_addindex->GetFeatureDim(), nullptr);
             }
-
-            if (p_abort != nullptr && p_abort->ShouldAbort())
-            {
-                ret = ErrorCode::ExternalAbort;
-            }
-        }
+        }, p_abort, 128);
     }
-    return ret;
+    return (p_abort != nullptr && p_abort->ShouldAbort()) ? ErrorCode::ExternalAbort : ErrorCode::Success;
 }
 
 
@@ -642,8 +660,39 @@ VectorIndex::LoadIndex(const std::string& p_loaderFilePath, std::shared_ptr<Vect
     if (iniReader.DoesSectionExist("Quantizer")) {
         indexfiles->push_back(p_vectorIndex->m_sQuantizerFile);
     }
+    // Mapping or parallel reading falls back to the streams as soon as one of the index data files fails.
+    size_t dataFiles = p_vectorIndex->GetIndexFiles()->size();
+    std::vector<ByteArray> blobs;
+    int loadThreads = 0, loadChunkMB = 0;
+    if (p_vectorIndex->GetParameter("MapIndexFiles") == "true") {
+        bool prefault = (p_vectorIndex->GetParameter("PrefaultIndexFiles") == "true");
+        for (size_t i = 0; i < dataFiles; i++) {
+            ByteArray mapped;
+            if (!Helper::MapFile(folderPath + (*indexfiles)[i], prefault, mapped)) {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Warning, "Cannot map %s, reading the index files instead.\n", (folderPath + (*indexfiles)[i]).c_str());
+                blobs.clear();
+                break;
+            }
+            blobs.push_back(std::move(mapped));
+        }
+    }
+    else if (Helper::Convert::ConvertStringTo<int>(p_vectorIndex->GetParameter("LoadThreads").c_str(), loadThreads) && loadThreads > 0 &&
+        Helper::Convert::ConvertStringTo<int>(p_vectorIndex->GetParameter("LoadChunkMB").c_str(), loadChunkMB)) {
+        std::vector<std::string> paths;
+        for (size_t i = 0; i < dataFiles; i++) paths.push_back(folderPath + (*indexfiles)[i]);
+        if (!Helper::ReadFilesParallel(paths, loadThreads, ((std::size_t)max(loadChunkMB, 1)) << 20, blobs)) {
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Warning, "Parallel read of %s failed, reading the index files as streams instead.\n", folderPath.c_str());
+            blobs.clear();
+        }
+    }
+
     std::vector<std::shared_ptr<Helper::DiskIO>> handles;
-    for (std::string& f : *indexfiles) {
+    for (size_t i = 0; i < indexfiles->size(); i++) {
+        if (i < blobs.size()) {
+            handles.push_back(nullptr);
+            continue;
+        }
+        std::string& f = (*indexfiles)[i];
         auto ptr = SPTAG::f_createIO();
         if (ptr == nullptr || !ptr->Initialize((folderPath + f).c_str(), std::ios::binary | std::ios::in)) {
             SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Cannot open file %s!\n", (folderPath + f).c_str());
@@ -652,7 +701,11 @@ VectorIndex::LoadIndex(const std::string& p_loaderFilePath, std::shared_ptr<Vect
         handles.push_back(std::move(ptr));
     }
 
-    if ((ret = p_vectorIndex->LoadIndexData(handles)) != ErrorCode::Success) return ret;
+    if (!blobs.empty()) {
+        if ((ret = p_vectorIndex->LoadIndexDataFromMemory(blobs)) != ErrorCode::Success) return ret;
+        p_vectorIndex->m_indexFileBuffers = std::move(blobs);
+    }
+    else if ((ret = p_vectorIndex->LoadIndexData(handles)) != ErrorCode::Success) return ret;
 
     size_t metaStart = p_vectorIndex->GetIndexFiles()->size();
     if (iniReader.DoesSectionExist("MetaData"))
@@ -0,0 +1,77 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Core/VectorIndex.h"
+#include "inc/Core/Common.h"
+#include "inc/Helper/ArgumentsParser.h"
+
+#include <memory>
+
+using namespace SPTAG;
+
+class ConverterOptions : public Helper::ArgumentsParser
+{
+public:
+    ConverterOptions()
+    {
+        AddRequiredOption(m_indexFolder, "-i", "--index", "BKT index folder to convert.");
+        AddOptionalOption(m_outputFolder, "-o", "--outputfolder", "Output folder, the index is rewritten in place if not set.");
+        AddOptionalOption(m_deltaCoding, "-d", "--deltacoding", "Allow 16/24-bit delta coded neighbor ids.");
+        AddOptionalSwitch(m_expand, "-e", "--expand", "Convert a compact graph back to fixed-size rows.", true);
+        AddOptionalOption(m_reorder, "-r", "--reorder", "true to store vectors and graph rows in BKT traversal order, false to restore the input order.");
+    }
+
+    ~ConverterOptions() {}
+
+    std::string m_indexFolder;
+
+    std::string m_outputFolder;
+
+    bool m_deltaCoding = true;
+
+    bool m_expand = false;
+
+    std::string m_reorder;
+};
+
+int main(int argc, char* argv[])
+{
+    std::shared_ptr<ConverterOptions> options(new ConverterOptions);
+    if (!options->Parse(argc - 1, argv + 1))
+    {
+        exit(1);
+    }
+
+    std::shared_ptr<VectorIndex> index;
+    if (VectorIndex::LoadIndex(options->m_indexFolder, index) != ErrorCode::Success || index == nullptr)
+    {
+        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Failed to load index %s.\n", options->m_indexFolder.c_str());
+        exit(1);
+    }
+    if (index->GetIndexAlgoType() != IndexAlgoType::BKT)
+    {
+        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Only BKT graphs can be converted.\n");
+        exit(1);
+    }
+
+    if (!options->m_reorder.empty() && index->SetParameter("ReorderGraph", options->m_reorder.c_str()) != ErrorCode::Success)
+    {
+        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Failed to reorder the index.\n");
+        exit(1);
+    }
+
+    index->SetParameter("CompactGraphDeltaCoding", options->m_deltaCoding ? "true" : "false");
+    if (index->SetParameter("CompactGraph", options->m_expand ? "false" : "true") != ErrorCode::Success)
+    {
+        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Failed to convert the graph.\n");
+        exit(1);
+    }
+
+    std::string output = options->m_outputFolder.empty() ? options->m_indexFolder : options->m_outputFolder;
+    if (index->SaveIndex(output) != ErrorCode::Success)
+    {
+        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Failed to save index to %s.\n", output.c_str());
+        exit(1);
+    }
+    return 0;
+}
@@ -3,6 +3,17 @@
 
 #include "inc/Helper/AsyncFileReader.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#ifndef _MSC_VER
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#endif
+
 namespace SPTAG {
     namespace Helper {
 #ifndef _MSC_VER
@@ -49,9 +60,133 @@ namespace SPTAG {
 #endif
         }
 
+        int GetNumaNodeCount()
+        {
+#ifdef NUMA
+            if (numa_available() < 0) return 1;
+            return numa_max_node() + 1;
+#else
+            return 1;
+#endif
+        }
+
+        int GetCurrentNumaNode()
+        {
+#ifdef NUMA
+            if (numa_available() < 0) return 0;
+            int node = numa_node_of_cpu(sched_getcpu());
+            return (node < 0) ? 0 : node;
+#else
+            return 0;
+#endif
+        }
+
+        bool BindThreadToNumaNode(int node)
+        {
+#ifdef NUMA
+            if (numa_available() < 0) return false;
+            if (numa_run_on_node(node) != 0)
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Error calling numa_run_on_node for node %d.\n", node);
+                return false;
+            }
+            numa_set_preferred(node);
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        bool MapFile(const std::string& filePath, bool prefault, ByteArray& mapped)
+        {
+            int fd = open(filePath.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Cannot open file %s to map it.\n", filePath.c_str());
+                return false;
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0)
+            {
+                close(fd);
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Cannot map empty file %s.\n", filePath.c_str());
+                return false;
+            }
+            std::size_t length = (std::size_t)st.st_size;
+            void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | (prefault ? MAP_POPULATE : 0), fd, 0);
+            close(fd);
+            if (ptr == MAP_FAILED)
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Failed to map file %s, errno %d.\n", filePath.c_str(), errno);
+                return false;
+            }
+            mapped = ByteArray((std::uint8_t*)ptr, length, std::shared_ptr<std::uint8_t>((std::uint8_t*)ptr, [length](std::uint8_t* p) { munmap(p, length); }));
+            return true;
+        }
+
+        // One file of a ReadFilesParallel call; Read may be called from several threads at once.
+        class ParallelReadFile
+        {
+        public:
+            ~ParallelReadFile() { if (m_fd >= 0) close(m_fd); }
+
+            bool Open(const std::string& filePath, std::uint64_t& size)
+            {
+                // Probe one page, as some file systems accept O_DIRECT at open and only reject the reads.
+                m_fd = open(filePath.c_str(), O_RDONLY | O_DIRECT);
+                if (m_fd >= 0)
+                {
+                    void* probe = AllocateBuffer(PageSize);
+                    m_direct = (probe != nullptr && pread(m_fd, probe, PageSize, 0) >= 0);
+                    FreeBuffer(probe);
+                    if (!m_direct) close(m_fd);
+                }
+                if (!m_direct) m_fd = open(filePath.c_str(), O_RDONLY);
+
+                struct stat st;
+                if (m_fd < 0 || fstat(m_fd, &st) != 0) return false;
+                size = (std::uint64_t)st.st_size;
+                return true;
+            }
+
+            // Returns the bytes read, fewer than length only at the end of the file, or -1.
+            std::int64_t Read(char* buffer, std::size_t length, std::uint64_t offset)
+            {
+                std::size_t done = 0;
+                while (done < length)
+                {
+                    ssize_t n = pread(m_fd, buffer + done, length - done, offset + done);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n < 0) return -1;
+                    if (n == 0) break;
+                    done += n;
+                }
+                return (std::int64_t)done;
+            }
+
+            bool Direct() const { return m_direct; }
+
+            static void* AllocateBuffer(std::size_t size)
+            {
+                void* ptr = nullptr;
+                return (posix_memalign(&ptr, PageSize, size) == 0) ? ptr : nullptr;
+            }
+
+            static void FreeBuffer(void* ptr) { free(ptr); }
+
+        private:
+            int m_fd = -1;
+            bool m_direct = false;
+        };
+
         struct timespec AIOTimeout {0, 30000};
         void BatchReadFileAsync(std::vector<std::shared_ptr<Helper::DiskIO>>& handlers, AsyncReadRequest* readRequests, int num)
         {
+            if (!handlers.empty() && dynamic_cast<IOUringFileIO*>(handlers[0].get()) != nullptr) {
+                IOUringFileIO::BatchRead(handlers, readRequests, num);
+                return;
+            }
+
             std::vector<struct iocb> myiocbs(num);
             std::vector<std::vector<struct iocb*>> iocbs(handlers.size());
             std::vector<int> submitted(handlers.size(), 0);
@@ -122,6 +257,432 @@ namespace SPTAG {
                 }
             }
         }
+
+        int BatchReadFileSubmit(std::vector<std::shared_ptr<Helper::DiskIO>>& handlers, AsyncReadRequest* readRequests, int begin, int end)
+        {
+            if (begin >= end) return 0;
+            if (dynamic_cast<IOUringFileIO*>(handlers[0].get()) != nullptr) return IOUringFileIO::BatchSubmit(handlers, readRequests, begin, end);
+
+            int channel = readRequests[begin].m_status & 0xffff;
+            std::vector<struct iocb> myiocbs(end - begin);
+            std::vector<std::vector<struct iocb*>> iocbs(handlers.size());
+            memset(myiocbs.data(), 0, myiocbs.size() * sizeof(struct iocb));
+            for (int i = begin; i < end; i++) {
+                AsyncReadRequest* readRequest = &(readRequests[i]);
+                int fileid = (readRequest->m_status >> 16);
+
+                struct iocb* myiocb = &(myiocbs[i - begin]);
+                myiocb->aio_data = reinterpret_cast<uintptr_t>(readRequest);
+                myiocb->aio_lio_opcode = IOCB_CMD_PREAD;
+                myiocb->aio_fildes = ((AsyncFileIO*)(handlers[fileid].get()))->GetFileHandler();
+                myiocb->aio_buf = (std::uint64_t)(readRequest->m_buffer);
+                myiocb->aio_nbytes = readRequest->m_readSize;
+                myiocb->aio_offset = static_cast<std::int64_t>(readRequest->m_offset);
+                iocbs[fileid].emplace_back(myiocb);
+            }
+
+            int totalSubmitted = 0;
+            for (int i = 0; i < handlers.size(); i++) {
+                AsyncFileIO* handler = (AsyncFileIO*)(handlers[i].get());
+                std::size_t submitted = 0;
+                int curTry = 0, maxTry = 10;
+                while (submitted < iocbs[i].size() && curTry < maxTry) {
+                    int s = syscall(__NR_io_submit, handler->GetIOCP(channel), iocbs[i].size() - submitted, iocbs[i].data() + submitted);
+                    if (s > 0) {
+                        submitted += s;
+                        continue;
+                    }
+                    SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "fid:%d channel %d, to submit:%d, submitted:%s\n", i, channel, iocbs[i].size() - submitted, strerror(-s));
+                    usleep(AIOTimeout.tv_nsec / 1000);
+                    curTry++;
+                }
+                totalSubmitted += (int)submitted;
+            }
+            return totalSubmitted;
+        }
+
+        int BatchReadFilePoll(std::vector<std::shared_ptr<Helper::DiskIO>>& handlers, AsyncReadRequest* readRequests, int num, bool wait)
+        {
+            if (num <= 0) return 0;
+            if (dynamic_cast<IOUringFileIO*>(handlers[0].get()) != nullptr) return IOUringFileIO::BatchPoll(handlers, readRequests, num, wait);
+
+            int channel = readRequests[0].m_status & 0xffff;
+            struct timespec noWait {0, 0};
+            std::vector<struct io_event> events(num);
+            int totalDone = 0;
+            do {
+                for (int i = 0; i < handlers.size(); i++) {
+                    AsyncFileIO* handler = (AsyncFileIO*)(handlers[i].get());
+                    int d = syscall(__NR_io_getevents, handler->GetIOCP(channel), (wait && totalDone == 0) ? 1 : 0, num, events.data(), (wait && totalDone == 0) ? &AIOTimeout : &noWait);
+                    if (d < 0 && errno != EINTR && totalDone == 0) return -1;
+                    for (int r = 0; r < d; r++) {
+                        AsyncReadRequest* req = reinterpret_cast<AsyncReadRequest*>((events[r].data));
+                        if (nullptr != req)
+                        {
+                            req->m_success = (events[r].res >= 0);
+                            req->m_callback(true);
+                        }
+                    }
+                    if (d > 0) totalDone += d;
+                }
+            } while (wait && totalDone == 0);
+            return totalDone;
+        }
+
+        // Submission and completion rings of one io_uring instance, accessed through raw syscalls.
+        // Submissions are serialized by m_lock; completions are reaped by whoever holds it.
+        struct IOUringFileIO::Ring
+        {
+            int m_fd = -1;
+            bool m_sqPoll = false;
+            unsigned m_sqEntries = 0, m_cqEntries = 0;
+            unsigned *m_sqHead = nullptr, *m_sqTail = nullptr, *m_sqMask = nullptr, *m_sqFlags = nullptr, *m_sqArray = nullptr;
+            unsigned *m_cqHead = nullptr, *m_cqTail = nullptr, *m_cqMask = nullptr;
+            struct io_uring_sqe* m_sqes = nullptr;
+            struct io_uring_cqe* m_cqes = nullptr;
+            void* m_sqRing = MAP_FAILED;
+            void* m_cqRing = MAP_FAILED;
+            std::size_t m_sqRingSize = 0, m_cqRingSize = 0, m_sqesSize = 0;
+
+            // Reads queued in the SQ but not yet passed to io_uring_enter, and reads without a reaped completion.
+            unsigned m_toSubmit = 0, m_inflight = 0;
+
+            std::vector<struct iovec> m_buffers;
+            std::mutex m_lock;
+
+            ~Ring()
+            {
+                if (m_sqes != nullptr) munmap(m_sqes, m_sqesSize);
+                if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing) munmap(m_cqRing, m_cqRingSize);
+                if (m_sqRing != MAP_FAILED) munmap(m_sqRing, m_sqRingSize);
+                if (m_fd >= 0) close(m_fd);
+            }
+
+            bool Setup(unsigned entries, bool sqPoll)
+            {
+                struct io_uring_params params;
+                memset(&params, 0, sizeof(params));
+                if (sqPoll) {
+                    params.flags |= IORING_SETUP_SQPOLL;
+                    params.sq_thread_idle = 1000;
+                }
+                m_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+                if (m_fd < 0) return false;
+
+                m_sqPoll = sqPoll;
+                m_sqEntries = params.sq_entries;
+                m_cqEntries = params.cq_entries;
+                m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+                bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (singleMap) m_sqRingSize = m_cqRingSize = max(m_sqRingSize, m_cqRingSize);
+
+                m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+                if (m_sqRing == MAP_FAILED) return false;
+                m_cqRing = singleMap ? m_sqRing : mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+                if (m_cqRing == MAP_FAILED) return false;
+                m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+                void* sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+                if (sqes == MAP_FAILED) return false;
+                m_sqes = (struct io_uring_sqe*)sqes;
+
+                char* sq = (char*)m_sqRing;
+                m_sqHead = (unsigned*)(sq + params.sq_off.head);
+                m_sqTail = (unsigned*)(sq + params.sq_off.tail);
+                m_sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+                m_sqFlags = (unsigned*)(sq + params.sq_off.flags);
+                m_sqArray = (unsigned*)(sq + params.sq_off.array);
+                char* cq = (char*)m_cqRing;
+                m_cqHead = (unsigned*)(cq + params.cq_off.head);
+                m_cqTail = (unsigned*)(cq + params.cq_off.tail);
+                m_cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+                m_cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+                return true;
+            }
+
+            bool Register(unsigned opcode, void* arg, unsigned num)
+            {
+                return syscall(__NR_io_uring_register, m_fd, opcode, arg, num) >= 0;
+            }
+
+            // Queues a read of fixed file 0. Returns false when the SQ is full or the CQ could overflow.
+            bool PrepareRead(int i, AsyncReadRequest* req)
+            {
+                unsigned tail = *m_sqTail;
+                if (tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries || m_inflight >= m_cqEntries) return false;
+
+                unsigned idx = tail & *m_sqMask;
+                struct io_uring_sqe* sqe = &m_sqes[idx];
+                memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_READ;
+                if (i >= 0 && i < (int)m_buffers.size() && m_buffers[i].iov_base == req->m_buffer && req->m_readSize <= m_buffers[i].iov_len) {
+                    sqe->opcode = IORING_OP_READ_FIXED;
+                    sqe->buf_index = (std::uint16_t)i;
+                }
+                sqe->flags = IOSQE_FIXED_FILE;
+                sqe->fd = 0;
+                sqe->addr = (std::uint64_t)(req->m_buffer);
+                sqe->len = (std::uint32_t)(req->m_readSize);
+                sqe->off = req->m_offset;
+                sqe->user_data = reinterpret_cast<std::uint64_t>(req);
+                m_sqArray[idx] = idx;
+                __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+                m_toSubmit++;
+                m_inflight++;
+                return true;
+            }
+
+            // Passes queued reads to the kernel and, if waitNr > 0, blocks until that many completions are posted.
+            int Enter(unsigned waitNr)
+            {
+                unsigned flags = (waitNr > 0) ? IORING_ENTER_GETEVENTS : 0;
+                unsigned toSubmit = m_toSubmit;
+                if (m_sqPoll) {
+                    toSubmit = 0;
+                    m_toSubmit = 0;
+                    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+                    if (__atomic_load_n(m_sqFlags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) flags |= IORING_ENTER_SQ_WAKEUP;
+                }
+                if (toSubmit == 0 && flags == 0) return 0;
+
+                int ret = (int)syscall(__NR_io_uring_enter, m_fd, toSubmit, waitNr, flags, nullptr, 0);
+                if (ret < 0) return -errno;
+                if (!m_sqPoll) m_toSubmit -= min((unsigned)ret, m_toSubmit);
+                return ret;
+            }
+
+            // Moves reads that did not fit into the SQ earlier into the free slots.
+            void Flush()
+            {
+                std::size_t i = 0;
+                while (i < m_backlog.size() && PrepareRead(m_backlog[i].first, m_backlog[i].second)) i++;
+                m_backlog.erase(m_backlog.begin(), m_backlog.begin() + i);
+            }
+
+            static void Complete(AsyncReadRequest* req, int res)
+            {
+                req->m_success = (res >= 0);
+                if (req->m_success) req->m_callback(true);
+                else SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "io_uring read at offset %llu failed: %s\n", (unsigned long long)(req->m_offset), strerror(-res));
+            }
+
+            // Runs the callbacks of completed reads in [begin, end) and returns how many were completed.
+            // Completions of other requests sharing the ring are kept until their owner reaps them;
+            // a null range takes every completion.
+            unsigned Reap(AsyncReadRequest* begin, AsyncReadRequest* end)
+            {
+                unsigned completed = 0;
+                for (std::size_t i = 0; i < m_orphans.size();) {
+                    AsyncReadRequest* req = m_orphans[i].first;
+                    if (begin != nullptr && (req < begin || req >= end)) { i++; continue; }
+                    Complete(req, m_orphans[i].second);
+                    m_orphans[i] = m_orphans.back();
+                    m_orphans.pop_back();
+                    completed++;
+                }
+
+                unsigned head = *m_cqHead, reaped = 0;
+                unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+                while (head != tail) {
+                    struct io_uring_cqe* cqe = &m_cqes[head & *m_cqMask];
+                    AsyncReadRequest* req = reinterpret_cast<AsyncReadRequest*>(cqe->user_data);
+                    int res = cqe->res;
+                    __atomic_store_n(m_cqHead, ++head, __ATOMIC_RELEASE);
+                    reaped++;
+
+                    if (nullptr == req) continue;
+                    if (begin != nullptr && (req < begin || req >= end)) {
+                        m_orphans.emplace_back(req, res);
+                        continue;
+                    }
+                    Complete(req, res);
+                    completed++;
+                }
+                m_inflight -= reaped;
+                return completed;
+            }
+
+            std::vector<std::pair<int, AsyncReadRequest*>> m_backlog;
+            std::vector<std::pair<AsyncReadRequest*, int>> m_orphans;
+        };
+
+        IOUringFileIO::IOUringFileIO(bool sqPoll, DiskIOScenario scenario) : m_sqPoll(sqPoll), m_fileHandle(-1) {}
+
+        IOUringFileIO::~IOUringFileIO() { ShutDown(); }
+
+        bool IOUringFileIO::Initialize(const char* filePath, int openMode, std::uint64_t maxIOSize, std::uint32_t maxReadRetries, std::uint32_t maxWriteRetries, std::uint16_t threadPoolSize)
+        {
+            m_fileHandle = open(filePath, O_RDONLY | O_DIRECT);
+            if (m_fileHandle < 0) {
+                SPTAGLIB_LOG(LogLevel::LL_Error, "Failed to create file handle: %s\n", filePath);
+                return false;
+            }
+
+            m_rings.resize(max((int)threadPoolSize, 1));
+            for (auto& ring : m_rings) {
+                ring.reset(new Ring());
+                if (!ring->Setup((unsigned)max(maxIOSize, (std::uint64_t)1), m_sqPoll)) {
+                    SPTAGLIB_LOG(LogLevel::LL_Error, "Cannot setup io_uring: %s\n", strerror(errno));
+                    return false;
+                }
+                if (!ring->Register(IORING_REGISTER_FILES, &m_fileHandle, 1)) {
+                    SPTAGLIB_LOG(LogLevel::LL_Error, "Cannot register file to io_uring: %s\n", strerror(errno));
+                    return false;
+                }
+            }
+
+#ifndef BATCH_READ
+            m_shutdown = false;
+            for (int i = 0; i < (int)m_rings.size(); ++i)
+            {
+                m_ringThreads.emplace_back(std::thread(std::bind(&IOUringFileIO::ListenRing, this, i)));
+            }
+#endif
+            return true;
+        }
+
+        bool IOUringFileIO::RegisterBuffers(int channel, const std::vector<struct iovec>& p_buffers)
+        {
+            if (m_rings.empty()) return false;
+
+            Ring* ring = GetRing(channel);
+            std::lock_guard<std::mutex> lock(ring->m_lock);
+            if (!ring->m_buffers.empty()) {
+                ring->Register(IORING_UNREGISTER_BUFFERS, nullptr, 0);
+                ring->m_buffers.clear();
+            }
+            if (!ring->Register(IORING_REGISTER_BUFFERS, (void*)p_buffers.data(), (unsigned)p_buffers.size())) {
+                SPTAGLIB_LOG(LogLevel::LL_Warning, "Cannot register %d buffers to io_uring: %s\n", (int)p_buffers.size(), strerror(errno));
+                return false;
+            }
+            ring->m_buffers = p_buffers;
+            return true;
+        }
+
+        bool IOUringFileIO::ReadFileAsync(AsyncReadRequest& readRequest)
+        {
+            Ring* ring = GetRing(readRequest.m_status & 0xffff);
+            std::lock_guard<std::mutex> lock(ring->m_lock);
+            int curTry = 0, maxTry = 10;
+            while (curTry < maxTry && !ring->PrepareRead(-1, &readRequest)) {
+                ring->Enter(0);
+                usleep(AIOTimeout.tv_nsec / 1000);
+                curTry++;
+            }
+            if (curTry == maxTry) return false;
+            return ring->Enter(0) >= 0;
+        }
+
+        bool IOUringFileIO::BatchReadFile(AsyncReadRequest* readRequests, std::uint32_t requestCount)
+        {
+            std::vector<std::shared_ptr<Helper::DiskIO>> handlers(1, std::shared_ptr<Helper::DiskIO>(this, [](Helper::DiskIO*) {}));
+            for (std::uint32_t i = 0; i < requestCount; i++) readRequests[i].m_status &= 0xffff;
+            BatchRead(handlers, readRequests, (int)requestCount);
+            return true;
+        }
+
+        void IOUringFileIO::BatchRead(std::vector<std::shared_ptr<Helper::DiskIO>>& handlers, AsyncReadRequest* readRequests, int num)
+        {
+            if (num <= 0) return;
+
+            BatchSubmit(handlers, readRequests, 0, num);
+            int totalDone = 0;
+            while (totalDone < num) {
+                int done = BatchPoll(handlers, readRequests, num, true);
+                if (done <= 0) break;
+                totalDone += done;
+            }
+        }
+
+        int IOUringFileIO::BatchSubmit(std::vector<std::shared_ptr<Helper::DiskIO>>& handlers, AsyncReadRequest* readRequests, int begin, int end)
+        {
+            if (begin >= end) return 0;
+
+            int channel = readRequests[begin].m_status & 0xffff;
+            std::vector<std::vector<int>> pending(handlers.size());
+            for (int i = begin; i < end; i++) pending[readRequests[i].m_status >> 16].push_back(i);
+
+            for (std::size_t f = 0; f < pending.size(); f++) {
+                if (pending[f].empty()) continue;
+
+                Ring* ring = ((IOUringFileIO*)(handlers[f].get()))->GetRing(channel);
+                std::lock_guard<std::mutex> lock(ring->m_lock);
+                ring->Flush();
+                for (int i : pending[f]) {
+                    if (!ring->m_backlog.empty() || !ring->PrepareRead(i, readRequests + i)) ring->m_backlog.emplace_back(i, readRequests + i);
+                }
+                int ret = ring->Enter(0);
+                if (ret < 0 && ret != -EAGAIN && ret != -EBUSY && ret != -EINTR) {
+                    SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "fid:%d channel %d, io_uring submit failed: %s\n", (int)f, channel, strerror(-ret));
+                }
+            }
+            return end - begin;
+        }
+
+        int IOUringFileIO::BatchPoll(std::vector<std::shared_ptr<Helper::DiskIO>>& handlers, AsyncReadRequest* readRequests, int num, bool wait)
+        {
+            if (num <= 0) return 0;
+
+            int channel = readRequests[0].m_status & 0xffff;
+            int done = 0;
+            while (true) {
+                Ring* waitRing = nullptr;
+                for (std::size_t f = 0; f < handlers.size(); f++) {
+                    Ring* ring = ((IOUringFileIO*)(handlers[f].get()))->GetRing(channel);
+                    std::lock_guard<std::mutex> lock(ring->m_lock);
+                    ring->Flush();
+                    ring->Enter(0);
+                    done += ring->Reap(readRequests, readRequests + num);
+                    if (waitRing == nullptr && ring->m_inflight > 0) waitRing = ring;
+                }
+                if (done > 0 || !wait || waitRing == nullptr) return done;
+
+                std::lock_guard<std::mutex> lock(waitRing->m_lock);
+                if (waitRing->m_inflight > 0) {
+                    int ret = waitRing->Enter(1);
+                    if (ret < 0 && ret != -EINTR) {
+                        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "channel %d, io_uring wait failed: %s\n", channel, strerror(-ret));
+                        return -1;
+                    }
+                }
+                done += waitRing->Reap(readRequests, readRequests + num);
+                if (done > 0) return done;
+            }
+        }
+
+        void IOUringFileIO::ShutDown()
+        {
+#ifndef BATCH_READ
+            m_shutdown = true;
+            for (auto& th : m_ringThreads)
+            {
+                if (th.joinable())
+                {
+                    th.join();
+                }
+            }
+            m_ringThreads.clear();
+#endif
+            m_rings.clear();
+            if (m_fileHandle >= 0) close(m_fileHandle);
+            m_fileHandle = -1;
+        }
+
+#ifndef BATCH_READ
+        void IOUringFileIO::ListenRing(int i)
+        {
+            Ring* ring = m_rings[i].get();
+            while (!m_shutdown)
+            {
+                unsigned reaped = 0;
+                {
+                    std::lock_guard<std::mutex> lock(ring->m_lock);
+                    reaped = ring->Reap(nullptr, nullptr);
+                }
+                if (reaped == 0) usleep(AIOTimeout.tv_nsec / 1000);
+            }
+        }
+#endif
 #else
         ULONGLONG GetCpuMasks(WORD group, DWORD numCpus)
         {
@@ -175,6 +736,120 @@ namespace SPTAG {
             YieldProcessor();
         }
 
+        int GetNumaNodeCount()
+        {
+            ULONG highest = 0;
+            if (!GetNumaHighestNodeNumber(&highest)) return 1;
+            return (int)highest + 1;
+        }
+
+        int GetCurrentNumaNode()
+        {
+            PROCESSOR_NUMBER pn;
+            USHORT node = 0;
+            GetCurrentProcessorNumberEx(&pn);
+            if (!GetNumaProcessorNodeEx(&pn, &node)) return 0;
+            return (int)node;
+        }
+
+        bool BindThreadToNumaNode(int node)
+        {
+            GROUP_AFFINITY ga;
+            memset(&ga, 0, sizeof(ga));
+            if (!GetNumaNodeProcessorMaskEx((USHORT)node, &ga) || !SetThreadGroupAffinity(GetCurrentThread(), &ga, NULL))
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Failed to bind thread to NUMA node %d.\n", node);
+                return false;
+            }
+            return true;
+        }
+
+        bool MapFile(const std::string& filePath, bool prefault, ByteArray& mapped)
+        {
+            HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Cannot open file %s to map it.\n", filePath.c_str());
+                return false;
+            }
+            LARGE_INTEGER size;
+            HANDLE mapping = NULL;
+            if (GetFileSizeEx(file, &size) && size.QuadPart > 0) mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+            CloseHandle(file);
+            if (mapping == NULL)
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Failed to map file %s.\n", filePath.c_str());
+                return false;
+            }
+            void* ptr = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+            CloseHandle(mapping);
+            if (ptr == NULL)
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Failed to map a view of file %s.\n", filePath.c_str());
+                return false;
+            }
+            std::size_t length = (std::size_t)size.QuadPart;
+            if (prefault)
+            {
+                WIN32_MEMORY_RANGE_ENTRY range{ ptr, length };
+                PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+            }
+            mapped = ByteArray((std::uint8_t*)ptr, length, std::shared_ptr<std::uint8_t>((std::uint8_t*)ptr, [](std::uint8_t* p) { UnmapViewOfFile(p); }));
+            return true;
+        }
+
+        // One file of a ReadFilesParallel call; Read may be called from several threads at once.
+        class ParallelReadFile
+        {
+        public:
+            ~ParallelReadFile() { if (m_handle != INVALID_HANDLE_VALUE) CloseHandle(m_handle); }
+
+            bool Open(const std::string& filePath, std::uint64_t& size)
+            {
+                m_handle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING, NULL);
+                m_direct = (m_handle != INVALID_HANDLE_VALUE);
+                if (!m_direct) m_handle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+
+                LARGE_INTEGER fileSize;
+                if (m_handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_handle, &fileSize)) return false;
+                size = (std::uint64_t)fileSize.QuadPart;
+                return true;
+            }
+
+            // Returns the bytes read, fewer than length only at the end of the file, or -1.
+            std::int64_t Read(char* buffer, std::size_t length, std::uint64_t offset)
+            {
+                std::size_t done = 0;
+                while (done < length)
+                {
+                    OVERLAPPED ov;
+                    memset(&ov, 0, sizeof(ov));
+                    ov.Offset = (DWORD)(offset + done);
+                    ov.OffsetHigh = (DWORD)((offset + done) >> 32);
+                    ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+                    DWORD toRead = (length - done > (1UL << 30)) ? (1UL << 30) : (DWORD)(length - done), n = 0;
+                    BOOL ok = ReadFile(m_handle, buffer + done, toRead, NULL, &ov);
+                    if (ok || GetLastError() == ERROR_IO_PENDING) ok = GetOverlappedResult(m_handle, &ov, &n, TRUE);
+                    DWORD error = GetLastError();
+                    CloseHandle(ov.hEvent);
+                    if (!ok && error != ERROR_HANDLE_EOF) return -1;
+                    if (n == 0) break;
+                    done += n;
+                }
+                return (std::int64_t)done;
+            }
+
+            bool Direct() const { return m_direct; }
+
+            static void* AllocateBuffer(std::size_t size) { return _aligned_malloc(size, PageSize); }
+
+            static void FreeBuffer(void* ptr) { _aligned_free(ptr); }
+
+        private:
+            HANDLE m_handle = INVALID_HANDLE_VALUE;
+            bool m_direct = false;
+        };
+
         void BatchReadFileAsync(std::vector<std::shared_ptr<Helper::DiskIO>>& handlers, AsyncReadRequest* readRequests, int num)
         {
             if (handlers.size() == 1) {
@@ -198,5 +873,86 @@ namespace SPTAG {
             }
         }
 #endif
+
+        bool ReadFilesParallel(const std::vector<std::string>& filePaths, int threads, std::size_t chunkSize, std::vector<ByteArray>& contents)
+        {
+            struct FileState
+            {
+                ParallelReadFile m_file;
+                std::uint64_t m_size = 0;
+                std::uint64_t m_capacity = 0;
+                char* m_buffer = nullptr;
+                std::atomic<std::size_t> m_pendingChunks{ 0 };
+                std::chrono::steady_clock::time_point m_finish;
+            };
+
+            chunkSize = max(chunkSize & ~((std::size_t)PageSize - 1), (std::size_t)PageSize);
+            std::vector<std::unique_ptr<FileState>> files;
+            std::vector<std::pair<std::uint64_t, std::size_t>> chunks;
+            bool opened = true;
+            for (const std::string& path : filePaths)
+            {
+                files.emplace_back(new FileState());
+                FileState& state = *files.back();
+                if (!state.m_file.Open(path, state.m_size) ||
+                    (state.m_buffer = (char*)ParallelReadFile::AllocateBuffer(state.m_capacity = max(((state.m_size + PageSize - 1) >> PageSizeEx) << PageSizeEx, (std::uint64_t)PageSize))) == nullptr)
+                {
+                    SPTAGLIB_LOG(LogLevel::LL_Error, "Cannot open %s for a parallel read.\n", path.c_str());
+                    opened = false;
+                    break;
+                }
+                for (std::uint64_t offset = 0; offset < state.m_size; offset += chunkSize) chunks.emplace_back(offset, files.size() - 1);
+                state.m_pendingChunks = (std::size_t)((state.m_size + chunkSize - 1) / chunkSize);
+            }
+
+            // Ordering by offset interleaves the files, so all of them are in flight from the start.
+            std::sort(chunks.begin(), chunks.end());
+            std::atomic<std::size_t> nextChunk(0);
+            std::atomic<bool> failed(!opened);
+            auto start = std::chrono::steady_clock::now();
+            auto worker = [&]()
+            {
+                std::size_t i;
+                while (!failed && (i = nextChunk++) < chunks.size())
+                {
+                    FileState& state = *files[chunks[i].second];
+                    std::uint64_t offset = chunks[i].first;
+                    std::int64_t expected = (std::int64_t)min((std::uint64_t)chunkSize, state.m_size - offset);
+                    if (state.m_file.Read(state.m_buffer + offset, (std::size_t)min((std::uint64_t)chunkSize, state.m_capacity - offset), offset) < expected)
+                    {
+                        failed = true;
+                        break;
+                    }
+                    if (--state.m_pendingChunks == 0) state.m_finish = std::chrono::steady_clock::now();
+                }
+            };
+            std::vector<std::thread> workers;
+            for (int i = 1; i < threads && opened; i++) workers.emplace_back(worker);
+            worker();
+            for (auto& t : workers) t.join();
+
+            if (failed)
+            {
+                SPTAGLIB_LOG(LogLevel::LL_Error, "Parallel read of %zu files failed.\n", filePaths.size());
+                for (auto& state : files) ParallelReadFile::FreeBuffer(state->m_buffer);
+                return false;
+            }
+
+            contents.clear();
+            std::uint64_t totalBytes = 0;
+            for (std::size_t i = 0; i < files.size(); i++)
+            {
+                FileState& state = *files[i];
+                double seconds = (state.m_size == 0) ? 0 : std::chrono::duration<double>(state.m_finish - start).count();
+                SPTAGLIB_LOG(LogLevel::LL_Info, "Read %s: %llu bytes in %.3f s, %.1f MB/s%s.\n", filePaths[i].c_str(), (unsigned long long)state.m_size,
+                    seconds, (seconds > 0) ? state.m_size / seconds / (1 << 20) : 0.0, state.m_file.Direct() ? " unbuffered" : "");
+                totalBytes += state.m_size;
+                contents.emplace_back((std::uint8_t*)state.m_buffer, (std::size_t)state.m_size, std::shared_ptr<std::uint8_t>((std::uint8_t*)state.m_buffer, ParallelReadFile::FreeBuffer));
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            SPTAGLIB_LOG(LogLevel::LL_Info, "Read %zu files with %d threads: %llu bytes in %.3f s, %.1f MB/s.\n", files.size(), threads,
+                (unsigned long long)totalBytes, seconds, (seconds > 0) ? totalBytes / seconds / (1 << 20) : 0.0);
+            return true;
+        }
     }
 }
@@ -0,0 +1,209 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Helper/TaskScheduler.h"
+#include "inc/Core/VectorIndex.h"
+
+using namespace SPTAG;
+using namespace SPTAG::Helper;
+
+namespace
+{
+    // The worker that owns this thread, or -1 on threads the scheduler did not start.
+    thread_local int t_worker = -1;
+    thread_local TaskScheduler::Priority t_priority = TaskScheduler::Priority::Foreground;
+}
+
+
+struct TaskScheduler::Loop
+{
+    Loop(SizeType p_begin, SizeType p_end, SizeType p_grain, const std::function<void(SizeType)>& p_body, IAbortOperation* p_abort)
+        : m_next(p_begin), m_end(p_end), m_grain(p_grain), m_body(p_body), m_abort(p_abort), m_active(0)
+    {
+    }
+
+    // Claims chunks until none are left. A helper that only starts once the loop is over leaves without touching the body.
+    void Run()
+    {
+        m_active++;
+        while (true)
+        {
+            SizeType first = m_next.fetch_add(m_grain);
+            if (first >= m_end) break;
+            if (m_abort != nullptr && m_abort->ShouldAbort())
+            {
+                m_next = m_end;
+                break;
+            }
+
+            SizeType last = (first < m_end - m_grain) ? first + m_grain : m_end;
+            try
+            {
+                for (SizeType i = first; i < last; i++) m_body(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (!m_error) m_error = std::current_exception();
+                m_next = m_end;
+                break;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (--m_active == 0) m_cond.notify_all();
+    }
+
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_cond.wait(lock, [this] { return m_active == 0; });
+    }
+
+    std::atomic<SizeType> m_next;
+    const SizeType m_end;
+    const SizeType m_grain;
+    const std::function<void(SizeType)>& m_body;
+    IAbortOperation* m_abort;
+    std::atomic<int> m_active;
+    std::exception_ptr m_error;
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+};
+
+
+TaskScheduler&
+TaskScheduler::Instance()
+{
+    // Never destroyed: indexes freed during static destruction may still wait for their tasks.
+    static TaskScheduler* instance = new TaskScheduler(std::max<int>(2, (int)std::thread::hardware_concurrency()));
+    return *instance;
+}
+
+
+TaskScheduler::TaskScheduler(int p_workers)
+    : m_queued(0),
+      m_nextWorker(0),
+      m_backgroundRunning(0),
+      m_backgroundLimit(std::max<int>(1, p_workers / 2))
+{
+    for (int i = 0; i < p_workers; i++) m_workers.emplace_back(new Worker());
+    for (int i = 0; i < p_workers; i++) m_threads.emplace_back([this, i] { Run(i); });
+}
+
+
+void
+TaskScheduler::Submit(std::function<void()> p_task, Priority p_priority)
+{
+    if (p_priority == Priority::Background || t_priority == Priority::Background)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_background.push_back(std::move(p_task));
+        }
+        m_cond.notify_one();
+        return;
+    }
+
+    // Work queued from a worker stays on its own deque, where it is picked up newest first unless somebody steals it.
+    Worker& worker = *m_workers[(t_worker >= 0) ? t_worker : (int)(m_nextWorker++ % m_workers.size())];
+    {
+        std::lock_guard<std::mutex> lock(worker.m_lock);
+        worker.m_tasks.push_back(std::move(p_task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_queued++;
+    }
+    m_cond.notify_one();
+}
+
+
+void
+TaskScheduler::ParallelFor(SizeType p_begin, SizeType p_end, int p_threads, const std::function<void(SizeType)>& p_body, IAbortOperation* p_abort, SizeType p_grain)
+{
+    if (p_end <= p_begin) return;
+    if (p_grain < 1) p_grain = 1;
+
+    SizeType chunks = (p_end - p_begin - 1) / p_grain + 1;
+    int helpers = (int)std::min<SizeType>(chunks, (SizeType)std::min<int>(p_threads, NumberOfWorkers() + 1)) - 1;
+
+    std::shared_ptr<Loop> loop = std::make_shared<Loop>(p_begin, p_end, p_grain, p_body, p_abort);
+    for (int i = 0; i < helpers; i++) Submit([loop] { loop->Run(); });
+    loop->Run();
+    loop->Wait();
+    if (loop->m_error) std::rethrow_exception(loop->m_error);
+}
+
+
+bool
+TaskScheduler::PopForeground(int p_self, std::function<void()>& p_task)
+{
+    int count = (int)m_workers.size();
+    for (int i = 0; i < count; i++)
+    {
+        Worker& worker = *m_workers[(p_self + i) % count];
+        std::lock_guard<std::mutex> lock(worker.m_lock);
+        if (worker.m_tasks.empty()) continue;
+
+        if (i == 0)
+        {
+            p_task = std::move(worker.m_tasks.back());
+            worker.m_tasks.pop_back();
+        }
+        else
+        {
+            p_task = std::move(worker.m_tasks.front());
+            worker.m_tasks.pop_front();
+        }
+        m_queued--;
+        return true;
+    }
+    return false;
+}
+
+
+void
+TaskScheduler::Run(int p_self)
+{
+    t_worker = p_self;
+    std::function<void()> task;
+    while (true)
+    {
+        bool background = false;
+        if (!PopForeground(p_self, task))
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            if (m_queued > 0) continue;
+            if (m_background.empty() || m_backgroundRunning >= m_backgroundLimit)
+            {
+                m_cond.wait(lock);
+                continue;
+            }
+            task = std::move(m_background.front());
+            m_background.pop_front();
+            m_backgroundRunning++;
+            background = true;
+        }
+
+        t_priority = background ? Priority::Background : Priority::Foreground;
+        try
+        {
+            task();
+        }
+        catch (std::exception& e)
+        {
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "TaskScheduler: exception in task %s\n", e.what());
+        }
+        task = nullptr;
+
+        if (background)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_backgroundRunning--;
+            }
+            m_cond.notify_one();
+        }
+    }
+}
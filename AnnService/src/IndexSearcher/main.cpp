@@ -187,13 +187,15 @@ int Process(std::shared_ptr<SearcherOptions> options, VectorIndex& index)
             for (SizeType i = 0; i < numQuerys; i++) results[i].Reset();
 
             std::atomic_size_t queriesSent(0);
+            bool numaReplicas = (index.GetParameter("NumaReplicas") == "true");
             std::vector<std::thread> threads;
             threads.reserve(options->m_threadNum);
             auto batchstart = std::chrono::high_resolution_clock::now();
 
             for (std::uint32_t i = 0; i < options->m_threadNum; i++) { 
                 threads.emplace_back([&, i] {
-                    NumaStrategy ns = (index.GetIndexAlgoType() == IndexAlgoType::SPANN)? NumaStrategy::SCATTER: NumaStrategy::LOCAL; // Only for SPANN, we need to avoid IO threads overlap with search threads.
+                    // SPANN keeps IO threads apart from search threads, and NUMA replicas need search threads on every node.
+                    NumaStrategy ns = (index.GetIndexAlgoType() == IndexAlgoType::SPANN || numaReplicas)? NumaStrategy::SCATTER: NumaStrategy::LOCAL;
                     Helper::SetThreadAffinity(i, threads[i], ns, OrderStrategy::ASC);
 
                     size_t qid = 0;
@@ -116,7 +116,7 @@ int main(int argc, char* argv[])
             {
 #define DefineVectorValueType(Name, Type) \
                     case VectorValueType::Name: \
-                        quantizer.reset(new COMMON::PQQuantizer<Type>(options->m_quantizedDim, 256, (DimensionType)(options->m_dimension/options->m_quantizedDim), false, TrainPQQuantizer<Type>(options, set, quantized_vectors))); \
+                        quantizer.reset(new COMMON::PQQuantizer<Type>(options->m_quantizedDim, options->m_numCentroids, (DimensionType)(options->m_dimension/options->m_quantizedDim), false, TrainPQQuantizer<Type>(options, set, quantized_vectors))); \
                         break;
 
 #include "inc/Core/DefinitionList.h"
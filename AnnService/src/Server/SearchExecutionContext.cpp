@@ -11,8 +11,10 @@ using namespace SPTAG::Service;
 SearchExecutionContext::SearchExecutionContext(const std::shared_ptr<const ServiceSettings>& p_serviceSettings)
     : c_serviceSettings(p_serviceSettings),
       m_vectorDimension(0),
+      m_vectorCount(1),
       m_inputValueType(VectorValueType::Undefined),
       m_extractMetadata(false),
+      m_binaryQuery(false),
       m_resultNum(p_serviceSettings->m_defaultMaxResultNumber)
 {
 }
@@ -80,6 +82,12 @@ SearchExecutionContext::ExtractOption()
 ErrorCode
 SearchExecutionContext::ExtractVector(VectorValueType p_targetType)
 {
+    if (m_binaryQuery)
+    {
+        // Binary queries already carry the raw vector, which is only usable as is.
+        return (m_inputValueType == p_targetType) ? ErrorCode::Success : ErrorCode::Fail;
+    }
+
     if (!m_queryParser.GetVectorElements().empty())
     {
         switch (p_targetType)
@@ -122,6 +130,31 @@ SearchExecutionContext::ExtractVector(VectorValueType p_targetType)
 }
 
 
+ErrorCode
+SearchExecutionContext::SetBinaryQuery(Socket::RemoteBinaryQuery& p_query)
+{
+    SizeType vectorCount = p_query.VectorCount();
+    if (vectorCount <= 0)
+    {
+        return ErrorCode::Fail;
+    }
+
+    m_binaryQuery = true;
+    m_vectorCount = vectorCount;
+    m_indexNames.swap(p_query.m_indexNames);
+    m_vector = std::move(p_query.m_vector);
+    m_vectorDimension = p_query.m_dimension;
+    m_inputValueType = p_query.m_valueType;
+    m_extractMetadata = p_query.HasFlag(Socket::RemoteBinaryQuery::QueryFlag::ExtractMetadata);
+    if (p_query.m_resultNum > 0)
+    {
+        m_resultNum = static_cast<SizeType>(min(p_query.m_resultNum, Socket::RemoteBinaryQuery::MaxResultNum()));
+    }
+
+    return ErrorCode::Success;
+}
+
+
 const std::vector<std::string>&
 SearchExecutionContext::GetSelectedIndexNames() const
 {
@@ -166,6 +199,13 @@ SearchExecutionContext::GetVectorDimension() const
 }
 
 
+const SizeType
+SearchExecutionContext::GetVectorCount() const
+{
+    return m_vectorCount;
+}
+
+
 const std::vector<QueryParser::OptionPair>&
 SearchExecutionContext::GetOptions() const
 {
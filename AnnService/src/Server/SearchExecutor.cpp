@@ -12,7 +12,22 @@ SearchExecutor::SearchExecutor(std::string p_queryString,
                                const CallBack& p_callback)
     : m_callback(p_callback),
       c_serviceContext(std::move(p_serviceContext)),
-      m_queryString(std::move(p_queryString))
+      m_queryString(std::move(p_queryString)),
+      m_isBinaryQuery(false),
+      m_isBatchQuery(false)
+{
+}
+
+
+SearchExecutor::SearchExecutor(Socket::RemoteBinaryQuery p_query,
+                               bool p_batch,
+                               std::shared_ptr<ServiceContext> p_serviceContext,
+                               const CallBack& p_callback)
+    : m_callback(p_callback),
+      c_serviceContext(std::move(p_serviceContext)),
+      m_binaryQuery(std::move(p_query)),
+      m_isBinaryQuery(true),
+      m_isBatchQuery(p_batch)
 {
 }
 
@@ -38,12 +53,23 @@ SearchExecutor::ExecuteInternal()
 {
     m_executionContext.reset(new SearchExecutionContext(c_serviceContext->GetServiceSettings()));
 
-    if (m_executionContext->ParseQuery(m_queryString) != ErrorCode::Success) {
-        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Failed to parse query:%s!\n", m_queryString.c_str());
-        return;
+    if (m_isBinaryQuery)
+    {
+        if (m_executionContext->SetBinaryQuery(m_binaryQuery) != ErrorCode::Success
+            || (!m_isBatchQuery && m_executionContext->GetVectorCount() != 1)) {
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Invalid binary query!\n");
+            return;
+        }
     }
+    else
+    {
+        if (m_executionContext->ParseQuery(m_queryString) != ErrorCode::Success) {
+            SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Failed to parse query:%s!\n", m_queryString.c_str());
+            return;
+        }
 
-    m_executionContext->ExtractOption();
+        m_executionContext->ExtractOption();
+    }
 
     SelectIndex();
 
@@ -67,6 +93,46 @@ SearchExecutor::ExecuteInternal()
         return;
     } 
 
+    if (m_isBatchQuery)
+    {
+        SizeType vectorCount = m_executionContext->GetVectorCount();
+        std::size_t vectorSize = m_executionContext->GetVector().Length() / vectorCount;
+        std::vector<QueryResult> queries;
+        queries.reserve(vectorCount);
+        for (SizeType i = 0; i < vectorCount; ++i)
+        {
+            queries.emplace_back(m_executionContext->GetVector().Data() + i * vectorSize,
+                                 m_executionContext->GetResultNum(),
+                                 m_executionContext->GetExtractMetadata());
+        }
+
+        for (const auto& vectorIndex : m_selectedIndex)
+        {
+            if (vectorIndex->GetVectorValueType() != firstIndex->GetVectorValueType()
+                || vectorIndex->GetFeatureDim() != firstIndex->GetFeatureDim())
+            {
+                continue;
+            }
+
+            for (auto& query : queries)
+            {
+                query.Reset();
+            }
+
+            if (ErrorCode::Success != vectorIndex->SearchIndexBatch(queries.data(), vectorCount))
+            {
+                SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Failed to execute SearchIndexBatch!\n");
+            }
+
+            // Every vector keeps its slot so that clients can map results back by position.
+            for (auto& query : queries)
+            {
+                m_executionContext->AddResults(vectorIndex->GetIndexName(), query);
+            }
+        }
+        return;
+    }
+
     QueryResult query(m_executionContext->GetVector().Data(),
                       m_executionContext->GetResultNum(),
                       m_executionContext->GetExtractMetadata());
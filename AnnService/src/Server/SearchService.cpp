@@ -131,6 +131,16 @@ SearchService::RunSocketMode()
                         {
                             boost::asio::post(*m_threadPool, std::bind(&SearchService::SearchHanlder, this, p_srcID, std::move(p_packet)));
                         });
+    handlerMap->emplace(Socket::PacketType::BinarySearchRequest,
+                        [this](Socket::ConnectionID p_srcID, Socket::Packet p_packet)
+                        {
+                            boost::asio::post(*m_threadPool, std::bind(&SearchService::BinarySearchHanlder, this, p_srcID, std::move(p_packet)));
+                        });
+    handlerMap->emplace(Socket::PacketType::BatchSearchRequest,
+                        [this](Socket::ConnectionID p_srcID, Socket::Packet p_packet)
+                        {
+                            boost::asio::post(*m_threadPool, std::bind(&SearchService::BinarySearchHanlder, this, p_srcID, std::move(p_packet)));
+                        });
 
     m_socketServer.reset(new Socket::Server(m_serviceContext->GetServiceSettings()->m_listenAddr,
                                             m_serviceContext->GetServiceSettings()->m_listenPort,
@@ -242,12 +252,47 @@ SearchService::SearchHanlder(Socket::ConnectionID p_localConnectionID, Socket::P
 }
 
 
+void
+SearchService::BinarySearchHanlder(Socket::ConnectionID p_localConnectionID, Socket::Packet p_packet)
+{
+    if (p_packet.Header().m_bodyLength == 0)
+    {
+        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Empty package with body length equals 0!\n");
+        return;
+    }
+
+    if (Socket::c_invalidConnectionID == p_packet.Header().m_connectionID)
+    {
+        p_packet.Header().m_connectionID = p_localConnectionID;
+    }
+
+    // The query vector is read in place from the packet body, which the callback keeps alive.
+    Socket::RemoteBinaryQuery remoteQuery;
+    if (remoteQuery.Read(p_packet.Body(), p_packet.Header().m_bodyLength) == nullptr) {
+        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "majorVersion is not match or binary query exceeds packet body!\n");
+        return;
+    }
+
+    bool isBatch = (Socket::PacketType::BatchSearchRequest == p_packet.Header().m_packetType);
+    auto callback = std::bind(&SearchService::SearchHanlderCallback,
+                              this,
+                              std::placeholders::_1,
+                              std::move(p_packet));
+
+    SearchExecutor executor(std::move(remoteQuery),
+                            isBatch,
+                            m_serviceContext,
+                            callback);
+    executor.Execute();
+}
+
+
 void
 SearchService::SearchHanlderCallback(std::shared_ptr<SearchExecutionContext> p_exeContext,
                                      Socket::Packet p_srcPacket)
 {
     Socket::Packet ret;
-    ret.Header().m_packetType = Socket::PacketType::SearchResponse;
+    ret.Header().m_packetType = Socket::PacketTypeHelper::GetCrosspondingResponseType(p_srcPacket.Header().m_packetType);
     ret.Header().m_processStatus = Socket::PacketProcessStatus::Ok;
     ret.Header().m_connectionID = p_srcPacket.Header().m_connectionID;
     ret.Header().m_resourceID = p_srcPacket.Header().m_resourceID;
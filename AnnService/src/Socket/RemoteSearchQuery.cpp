@@ -60,6 +60,179 @@ RemoteQuery::Read(const std::uint8_t* p_buffer)
 }
 
 
+RemoteBinaryQuery::RemoteBinaryQuery()
+    : m_flags(static_cast<std::uint8_t>(QueryFlag::None)),
+      m_valueType(VectorValueType::Undefined),
+      m_dimension(0),
+      m_resultNum(0)
+{
+}
+
+
+std::size_t
+RemoteBinaryQuery::EstimateBufferSize() const
+{
+    std::size_t sum = 0;
+    sum += SimpleSerialization::EstimateBufferSize(MajorVersion());
+    sum += SimpleSerialization::EstimateBufferSize(MirrorVersion());
+    sum += SimpleSerialization::EstimateBufferSize(m_flags);
+    sum += SimpleSerialization::EstimateBufferSize(m_valueType);
+    sum += SimpleSerialization::EstimateBufferSize(m_dimension);
+    sum += SimpleSerialization::EstimateBufferSize(m_resultNum);
+
+    sum += sizeof(std::uint32_t);
+    for (const auto& indexName : m_indexNames)
+    {
+        sum += SimpleSerialization::EstimateBufferSize(indexName);
+    }
+
+    sum += SimpleSerialization::EstimateBufferSize(m_vector);
+
+    return sum;
+}
+
+
+std::uint8_t*
+RemoteBinaryQuery::Write(std::uint8_t* p_buffer) const
+{
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(MajorVersion(), p_buffer);
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(MirrorVersion(), p_buffer);
+
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(m_flags, p_buffer);
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(m_valueType, p_buffer);
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(m_dimension, p_buffer);
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(m_resultNum, p_buffer);
+
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(static_cast<std::uint32_t>(m_indexNames.size()), p_buffer);
+    for (const auto& indexName : m_indexNames)
+    {
+        p_buffer = SimpleSerialization::SimpleWriteBuffer(indexName, p_buffer);
+    }
+
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(m_vector, p_buffer);
+
+    return p_buffer;
+}
+
+
+const std::uint8_t*
+RemoteBinaryQuery::Read(const std::uint8_t* p_buffer, std::size_t p_bufferLength)
+{
+    const std::uint8_t* end = p_buffer + p_bufferLength;
+    auto fits = [&](std::size_t p_bytes) { return static_cast<std::size_t>(end - p_buffer) >= p_bytes; };
+
+    decltype(MajorVersion()) majorVer = 0;
+    decltype(MirrorVersion()) mirrorVer = 0;
+
+    if (!fits(sizeof(majorVer) + sizeof(mirrorVer)))
+    {
+        return nullptr;
+    }
+
+    p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, majorVer);
+    p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, mirrorVer);
+    if (majorVer != MajorVersion())
+    {
+        return nullptr;
+    }
+
+    std::uint32_t len = 0;
+    if (!fits(sizeof(m_flags) + sizeof(m_valueType) + sizeof(m_dimension) + sizeof(m_resultNum) + sizeof(len)))
+    {
+        return nullptr;
+    }
+
+    p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, m_flags);
+    p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, m_valueType);
+    p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, m_dimension);
+    p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, m_resultNum);
+    if (GetValueTypeSize(m_valueType) == 0)
+    {
+        return nullptr;
+    }
+
+    // Every name takes at least its length prefix, which bounds the count before anything is allocated.
+    p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, len);
+    if (!fits(static_cast<std::size_t>(len) * sizeof(std::uint32_t)))
+    {
+        return nullptr;
+    }
+
+    m_indexNames.resize(len);
+    for (auto& indexName : m_indexNames)
+    {
+        std::uint32_t nameLen = 0;
+        if (!fits(sizeof(nameLen)))
+        {
+            return nullptr;
+        }
+
+        SimpleSerialization::SimpleReadBuffer(p_buffer, nameLen);
+        if (!fits(sizeof(nameLen) + static_cast<std::size_t>(nameLen)))
+        {
+            return nullptr;
+        }
+
+        p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, indexName);
+    }
+
+    len = 0;
+    if (!fits(sizeof(len)))
+    {
+        return nullptr;
+    }
+
+    p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, len);
+    if (!fits(len))
+    {
+        return nullptr;
+    }
+
+    m_vector = ByteArray(const_cast<std::uint8_t*>(p_buffer), len, false);
+
+    return p_buffer + len;
+}
+
+
+bool
+RemoteBinaryQuery::HasFlag(QueryFlag p_flag) const
+{
+    return (m_flags & static_cast<std::uint8_t>(p_flag)) != 0;
+}
+
+
+void
+RemoteBinaryQuery::SetFlag(QueryFlag p_flag, bool p_value)
+{
+    if (p_value)
+    {
+        m_flags |= static_cast<std::uint8_t>(p_flag);
+    }
+    else
+    {
+        m_flags &= ~static_cast<std::uint8_t>(p_flag);
+    }
+}
+
+
+SizeType
+RemoteBinaryQuery::VectorCount() const
+{
+    if (VectorValueType::Undefined == m_valueType || m_dimension <= 0)
+    {
+        return 0;
+    }
+
+    std::size_t vectorSize = static_cast<std::size_t>(m_dimension) * GetValueTypeSize(m_valueType);
+    if (vectorSize == 0 || m_vector.Length() % vectorSize != 0)
+    {
+        return 0;
+    }
+
+    return static_cast<SizeType>(m_vector.Length() / vectorSize);
+}
+
+
 RemoteSearchResult::RemoteSearchResult()
     : m_status(ResultStatus::Timeout)
 {
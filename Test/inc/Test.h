@@ -5,3 +5,47 @@
 
 #include <iostream>
 #include <boost/test/unit_test.hpp>
+
+#include "inc/Core/VectorIndex.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Fixtures shared by the index tests.
+namespace TestUtils
+{
+    // p_num vectors of p_dim floats drawn uniformly from [-p_range, p_range).
+    inline std::vector<float> GenerateVectors(SPTAG::SizeType p_num, SPTAG::DimensionType p_dim, unsigned p_seed, float p_range = 100.0f)
+    {
+        std::mt19937 rg(p_seed);
+        std::uniform_real_distribution<float> dist(-p_range, p_range);
+        std::vector<float> vec((size_t)p_num * p_dim);
+        for (auto& v : vec) v = dist(rg);
+        return vec;
+    }
+
+    // The id and distance of the p_k results of each query, query after query. With p_withMeta the metadata of
+    // every result must be its id, as the tests that check it number their vectors that way.
+    inline std::vector<std::pair<SPTAG::SizeType, float>> SearchAll(std::shared_ptr<SPTAG::VectorIndex>& p_index, const std::vector<float>& p_queries,
+        SPTAG::DimensionType p_dim, int p_k, bool p_withMeta = false)
+    {
+        std::vector<std::pair<SPTAG::SizeType, float>> results;
+        for (size_t i = 0; i < p_queries.size(); i += p_dim)
+        {
+            SPTAG::QueryResult res(p_queries.data() + i, p_k, p_withMeta);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == p_index->SearchIndex(res));
+            for (int j = 0; j < p_k; j++)
+            {
+                SPTAG::SizeType vid = res.GetResult(j)->VID;
+                results.emplace_back(vid, res.GetResult(j)->Dist);
+                if (!p_withMeta || vid < 0) continue;
+                std::string meta((char*)res.GetMetadata(j).Data(), res.GetMetadata(j).Length());
+                BOOST_CHECK_EQUAL(meta, std::to_string(vid));
+            }
+        }
+        return results;
+    }
+}
@@ -0,0 +1,114 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    const SPTAG::DimensionType c_asyncIODim = 16;
+
+    std::shared_ptr<SPTAG::VectorIndex> BuildAsyncIOSPANN(const std::vector<float>& p_vec, SPTAG::SizeType p_num, const std::string& p_folder, bool p_useIOUring)
+    {
+        std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::SPANN, SPTAG::VectorValueType::Float);
+        vecIndex->SetParameter("IndexAlgoType", "BKT", "Base");
+        vecIndex->SetParameter("DistCalcMethod", "L2", "Base");
+        vecIndex->SetParameter("IndexDirectory", p_folder, "Base");
+
+        vecIndex->SetParameter("isExecute", "true", "SelectHead");
+        vecIndex->SetParameter("NumberOfThreads", "4", "SelectHead");
+        vecIndex->SetParameter("Ratio", "0.2", "SelectHead");
+
+        vecIndex->SetParameter("isExecute", "true", "BuildHead");
+        vecIndex->SetParameter("NumberOfThreads", "4", "BuildHead");
+
+        vecIndex->SetParameter("isExecute", "true", "BuildSSDIndex");
+        vecIndex->SetParameter("BuildSsdIndex", "true", "BuildSSDIndex");
+        vecIndex->SetParameter("NumberOfThreads", "4", "BuildSSDIndex");
+        vecIndex->SetParameter("PostingPageLimit", "12", "BuildSSDIndex");
+        vecIndex->SetParameter("SearchPostingPageLimit", "12", "BuildSSDIndex");
+        vecIndex->SetParameter("InternalResultNum", "32", "BuildSSDIndex");
+        vecIndex->SetParameter("SearchInternalResultNum", "32", "BuildSSDIndex");
+        vecIndex->SetParameter("UseIOUring", p_useIOUring ? "true" : "false", "BuildSSDIndex");
+
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(p_vec.data(), p_num, c_asyncIODim));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SaveIndex(p_folder));
+        return vecIndex;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(AsyncIOTest)
+
+BOOST_AUTO_TEST_CASE(IOUringSearchTest)
+{
+    SPTAG::SizeType n = 2000, q = 100;
+    std::mt19937 rg(5);
+    std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+    std::vector<float> vec((size_t)n * c_asyncIODim);
+    for (auto& v : vec) v = dist(rg);
+
+    BuildAsyncIOSPANN(vec, n, "testasyncio", true);
+
+    std::shared_ptr<SPTAG::VectorIndex> aio, uring;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testasyncio", uring));
+    BOOST_CHECK(uring != nullptr);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testasyncio", aio));
+    BOOST_CHECK(aio != nullptr);
+    aio->SetParameter("UseIOUring", "false", "BuildSSDIndex");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == aio->SaveIndex("testasyncio_aio"));
+    aio.reset();
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testasyncio_aio", aio));
+
+    // Both backends read the same postings, so results must agree.
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        SPTAG::QueryResult r1(vec.data() + (size_t)i * c_asyncIODim, 5, false), r2(vec.data() + (size_t)i * c_asyncIODim, 5, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == uring->SearchIndex(r1));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == aio->SearchIndex(r2));
+        BOOST_CHECK_EQUAL(r1.GetResult(0)->VID, i);
+        for (int j = 0; j < 5; j++) BOOST_CHECK_EQUAL(r1.GetResult(j)->VID, r2.GetResult(j)->VID);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(PipelinedSearchTest)
+{
+    SPTAG::SizeType n = 2000, q = 100;
+    std::mt19937 rg(9);
+    std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+    std::vector<float> vec((size_t)n * c_asyncIODim), query((size_t)q * c_asyncIODim);
+    for (auto& v : vec) v = dist(rg);
+    for (auto& v : query) v = dist(rg);
+
+    for (bool useIOUring : { false, true })
+    {
+        BuildAsyncIOSPANN(vec, n, "testpipeline", useIOUring);
+        std::shared_ptr<SPTAG::VectorIndex> vecIndex;
+        BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testpipeline", vecIndex));
+        BOOST_CHECK(vecIndex != nullptr);
+
+        std::vector<SPTAG::QueryResult> plain, pipelined;
+        for (SPTAG::SizeType i = 0; i < q; i++)
+        {
+            plain.emplace_back(query.data() + (size_t)i * c_asyncIODim, 10, false);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(plain.back()));
+        }
+
+        vecIndex->SetParameter("EnablePipelinedSearch", "true", "BuildSSDIndex");
+        vecIndex->SetParameter("PipelineStageCheck", "16", "BuildSSDIndex");
+        for (SPTAG::SizeType i = 0; i < q; i++)
+        {
+            pipelined.emplace_back(query.data() + (size_t)i * c_asyncIODim, 10, false);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(pipelined.back()));
+        }
+
+        // Pipelined search reads every posting the plain search reads, plus speculative ones.
+        for (SPTAG::SizeType i = 0; i < q; i++)
+            for (int j = 0; j < 10; j++)
+                BOOST_CHECK(pipelined[i].GetResult(j)->Dist <= plain[i].GetResult(j)->Dist + 1e-3f);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
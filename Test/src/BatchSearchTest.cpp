@@ -0,0 +1,70 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+
+#include <string>
+#include <vector>
+
+template <typename T>
+void BatchSearchCompare(SPTAG::IndexAlgoType algo, std::string distCalcMethod, int batchSize)
+{
+    SPTAG::SizeType n = 2000, q = 50;
+    SPTAG::DimensionType m = 10;
+    int k = 5;
+    std::vector<T> vec;
+    for (SPTAG::SizeType i = 0; i < n; i++) {
+        for (SPTAG::DimensionType j = 0; j < m; j++) {
+            vec.push_back((T)i);
+        }
+    }
+
+    std::vector<T> query;
+    for (SPTAG::SizeType i = 0; i < q; i++) {
+        for (SPTAG::DimensionType j = 0; j < m; j++) {
+            query.push_back((T)(i * 37 % n));
+        }
+    }
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
+    BOOST_CHECK(nullptr != vecIndex);
+    vecIndex->SetParameter("DistCalcMethod", distCalcMethod);
+    vecIndex->SetParameter("NumberOfThreads", "4");
+    vecIndex->SetParameter("BatchSearchSize", std::to_string(batchSize));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+
+    std::vector<SPTAG::BasicResult> batchResults(q * k);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(query.data(), q, k, false, batchResults.data()));
+
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        SPTAG::QueryResult res(query.data() + i * m, k, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(res));
+        for (int j = 0; j < k; j++)
+        {
+            BOOST_CHECK_EQUAL(res.GetResult(j)->VID, batchResults[i * k + j].VID);
+            BOOST_CHECK_CLOSE(res.GetResult(j)->Dist, batchResults[i * k + j].Dist, 1e-4);
+        }
+        BOOST_CHECK_EQUAL(batchResults[i * k].VID, i * 37 % n);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(BatchSearchTest)
+
+BOOST_AUTO_TEST_CASE(BKTTest)
+{
+    BatchSearchCompare<float>(SPTAG::IndexAlgoType::BKT, "L2", 8);
+    BatchSearchCompare<float>(SPTAG::IndexAlgoType::BKT, "L2", 1);
+}
+
+BOOST_AUTO_TEST_CASE(KDTTest)
+{
+    BatchSearchCompare<float>(SPTAG::IndexAlgoType::KDT, "L2", 8);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,120 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+#include "inc/Core/Common/CompactGraph.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    const SPTAG::DimensionType c_graphDim = 16;
+}
+
+BOOST_AUTO_TEST_SUITE(CompactGraphTest)
+
+BOOST_AUTO_TEST_CASE(RoundTripTest)
+{
+    SPTAG::SizeType n = 100000;
+    SPTAG::DimensionType cols = 8;
+    SPTAG::COMMON::Dataset<SPTAG::SizeType> graph(n, cols, 1024, n);
+    std::mt19937 rg(3);
+    for (SPTAG::SizeType i = 0; i < n; i++)
+    {
+        SPTAG::SizeType* row = graph[i];
+        int count = rg() % (cols + 1);
+        for (int j = 0; j < count; j++)
+        {
+            switch (rg() % 3)
+            {
+            case 0: row[j] = std::max(0, std::min(n - 1, i + (int)(rg() % 200) - 100)); break;
+            case 1: row[j] = std::max(0, std::min(n - 1, i + (int)(rg() % 60000) - 30000)); break;
+            default: row[j] = rg() % n; break;
+            }
+        }
+        if (count < cols && i % 5 == 0) row[cols - 1] = -2 - (SPTAG::SizeType)(rg() % 1000);
+    }
+
+    for (bool delta : { true, false })
+    {
+        SPTAG::COMMON::CompactGraph compact;
+        compact.Build(graph, delta);
+        BOOST_CHECK_EQUAL(compact.R(), n);
+        BOOST_CHECK(compact.MemorySize() < graph.BufferSize());
+
+        std::vector<SPTAG::SizeType> buffer;
+        for (SPTAG::SizeType i = 0; i < n; i++)
+        {
+            const SPTAG::SizeType* expect = graph[i];
+            const SPTAG::SizeType* row = compact.Decode(i, buffer);
+            BOOST_CHECK_EQUAL(row[cols - 1], expect[cols - 1]);
+            for (SPTAG::DimensionType j = 0; j < cols; j++)
+            {
+                BOOST_CHECK_EQUAL(row[j], expect[j]);
+                if (expect[j] < 0) break;
+            }
+        }
+
+        SPTAG::COMMON::Dataset<SPTAG::SizeType> expanded;
+        compact.Expand(expanded, 1024, n);
+        BOOST_CHECK_EQUAL(expanded.R(), n);
+        BOOST_CHECK_EQUAL(expanded.C(), cols);
+        for (SPTAG::SizeType i = 0; i < n; i++)
+        {
+            const SPTAG::SizeType* expect = graph[i];
+            for (SPTAG::DimensionType j = 0, end = 0; j < cols; j++)
+            {
+                if (expect[j] < 0) end = 1;
+                BOOST_CHECK_EQUAL(expanded[i][j], (end && j < cols - 1) ? -1 : expect[j]);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BKTSearchTest)
+{
+    SPTAG::SizeType n = 5000, q = 200;
+    int k = 10;
+    auto vec = TestUtils::GenerateVectors(n, c_graphDim, 5);
+    auto queries = TestUtils::GenerateVectors(q, c_graphDim, 9);
+
+    std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::Float);
+    index->SetParameter("DistCalcMethod", "L2");
+    index->SetParameter("NumberOfThreads", "4");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(vec.data(), n, c_graphDim));
+    auto expect = TestUtils::SearchAll(index, queries, c_graphDim, k);
+
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("CompactGraph", "true"));
+    BOOST_CHECK(expect == TestUtils::SearchAll(index, queries, c_graphDim, k));
+    BOOST_CHECK(SPTAG::ErrorCode::Fail == index->AddIndex(queries.data(), 1, c_graphDim, nullptr));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SaveIndex("testcompactgraph"));
+
+    std::string config;
+    std::vector<SPTAG::ByteArray> blobs;
+    auto sizes = index->CalculateBufferSize();
+    for (std::uint64_t size : *sizes) blobs.push_back(SPTAG::ByteArray::Alloc(size));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SaveIndex(config, blobs));
+    std::shared_ptr<SPTAG::VectorIndex> fromMemory;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex(config, blobs, fromMemory));
+    BOOST_CHECK(fromMemory != nullptr);
+    BOOST_CHECK(expect == TestUtils::SearchAll(fromMemory, queries, c_graphDim, k));
+
+    std::shared_ptr<SPTAG::VectorIndex> loaded;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testcompactgraph", loaded));
+    BOOST_CHECK(loaded != nullptr);
+    BOOST_CHECK(loaded->GetParameter("CompactGraph") == "true");
+    BOOST_CHECK(expect == TestUtils::SearchAll(loaded, queries, c_graphDim, k));
+
+    std::vector<SPTAG::BasicResult> batchResults((size_t)q * k);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == loaded->SearchIndex(queries.data(), q, k, false, batchResults.data()));
+    for (size_t i = 0; i < batchResults.size(); i++) BOOST_CHECK_EQUAL(batchResults[i].VID, expect[i].first);
+
+    BOOST_CHECK(SPTAG::ErrorCode::Success == loaded->SetParameter("CompactGraph", "false"));
+    BOOST_CHECK(expect == TestUtils::SearchAll(loaded, queries, c_graphDim, k));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == loaded->AddIndex(queries.data(), q, c_graphDim, nullptr));
+    BOOST_CHECK_EQUAL(loaded->GetNumSamples(), n + q);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
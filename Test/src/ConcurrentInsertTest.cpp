@@ -0,0 +1,73 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Every added vector is a fresh random one, so it has to come back as its own nearest neighbor.
+    void CheckInserted(std::shared_ptr<SPTAG::VectorIndex>& p_index, const std::vector<float>& p_vec, SPTAG::SizeType p_first, SPTAG::DimensionType p_dim)
+    {
+        SPTAG::SizeType num = (SPTAG::SizeType)(p_vec.size() / p_dim);
+        SPTAG::SizeType found = 0;
+        for (SPTAG::SizeType i = 0; i < num; i++)
+        {
+            SPTAG::QueryResult res(p_vec.data() + (size_t)i * p_dim, 10, false);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == p_index->SearchIndex(res));
+            if (res.GetResult(0)->VID == p_first + i) found++;
+        }
+        BOOST_CHECK_GE(found, num * 99 / 100);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(ConcurrentInsertTest)
+
+BOOST_AUTO_TEST_CASE(ParallelAddTest)
+{
+    SPTAG::SizeType n = 5000, m = 2000;
+    SPTAG::DimensionType dim = 32;
+    std::mt19937 rg(83);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> vec((size_t)n * dim), added((size_t)m * dim);
+    for (auto& v : vec) v = dist(rg);
+    for (auto& v : added) v = dist(rg);
+
+    std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::Float);
+    index->SetParameter("DistCalcMethod", "L2");
+    index->SetParameter("NumberOfThreads", "4");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("AddThreads", "4"));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(vec.data(), n, dim));
+
+    // One batch linked by several threads, then batches from several callers whose linking overlaps.
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->AddIndex(added.data(), m / 2, dim, nullptr));
+    std::vector<std::thread> callers;
+    SPTAG::SizeType perCaller = m / 8;
+    for (int t = 0; t < 4; t++)
+    {
+        callers.emplace_back([&, t]() {
+            BOOST_CHECK(SPTAG::ErrorCode::Success == index->AddIndex(added.data() + (size_t)(m / 2 + t * perCaller) * dim, perCaller, dim, nullptr));
+        });
+    }
+    for (auto& caller : callers) caller.join();
+    BOOST_CHECK_EQUAL(index->GetNumSamples(), n + m);
+    BOOST_CHECK(index->GetParameter("AddThreads") == "4");
+
+    // The callers got their ids in whatever order they took the lock, so check the serial batch by id and
+    // the rest by distance.
+    CheckInserted(index, std::vector<float>(added.begin(), added.begin() + (size_t)(m / 2) * dim), n, dim);
+    SPTAG::SizeType exact = 0;
+    for (SPTAG::SizeType i = m / 2; i < m; i++)
+    {
+        SPTAG::QueryResult res(added.data() + (size_t)i * dim, 1, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SearchIndex(res));
+        if (res.GetResult(0)->VID >= n + m / 2 && res.GetResult(0)->Dist < 1e-4f) exact++;
+    }
+    BOOST_CHECK_GE(exact, (m / 2) * 99 / 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,7 @@
 #include "inc/Core/Common/CommonUtils.h"
 
 #include <thread>
+#include <atomic>
 #include <unordered_set>
 #include <ctime>
 
@@ -122,6 +123,63 @@ void CTest(SPTAG::IndexAlgoType algo, std::string distCalcMethod)
     ConcurrentAddSearchSave<T>(algo, distCalcMethod, vecset, metaset, "testindices");
 }
 
+void ConcurrentFileMetadataReadAddSave(const std::string metaFile, const std::string metaIndexFile)
+{
+    SPTAG::SizeType n = 2000, added = 500;
+    {
+        std::vector<char> meta;
+        std::vector<std::uint64_t> metaoffset;
+        for (SPTAG::SizeType i = 0; i < n; i++) {
+            metaoffset.push_back((std::uint64_t)meta.size());
+            std::string a = std::to_string(i);
+            meta.insert(meta.end(), a.begin(), a.end());
+        }
+        metaoffset.push_back((std::uint64_t)meta.size());
+
+        SPTAG::MemMetadataSet metaset(
+            SPTAG::ByteArray((std::uint8_t*)meta.data(), meta.size() * sizeof(char), false),
+            SPTAG::ByteArray((std::uint8_t*)metaoffset.data(), metaoffset.size() * sizeof(std::uint64_t), false),
+            n);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == metaset.SaveMetadata(metaFile, metaIndexFile));
+    }
+
+    SPTAG::FileMetadataSet metaset(metaFile, metaIndexFile);
+    BOOST_CHECK_EQUAL(metaset.Count(), n);
+
+    std::atomic_bool stop(false);
+    std::atomic_int mismatches(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&]() {
+            while (!stop) {
+                SPTAG::SizeType count = metaset.Count();
+                for (SPTAG::SizeType i = 0; i < count; i++) {
+                    SPTAG::ByteArray b = metaset.GetMetadataCopy(i);
+                    if (std::string((char*)b.Data(), b.Length()) != std::to_string(i)) mismatches++;
+                }
+            }
+        });
+    }
+
+    for (SPTAG::SizeType i = n; i < n + added; i++) {
+        std::string a = std::to_string(i);
+        metaset.Add(SPTAG::ByteArray((std::uint8_t*)a.data(), a.length(), false));
+        if (i == n + added / 2) BOOST_CHECK(SPTAG::ErrorCode::Success == metaset.SaveMetadata(metaFile, metaIndexFile));
+    }
+    stop = true;
+    for (auto& t : readers) t.join();
+
+    BOOST_CHECK_EQUAL(mismatches.load(), 0);
+    BOOST_CHECK_EQUAL(metaset.Count(), n + added);
+    SPTAG::ByteArray last = metaset.GetMetadata(n + added - 1);
+    BOOST_CHECK(std::string((char*)last.Data(), last.Length()) == std::to_string(n + added - 1));
+
+    // A view keeps the mapping it points into alive across later saves, which replace that mapping.
+    SPTAG::ByteArray first = metaset.GetMetadata(0);
+    for (int i = 0; i < 3; i++) BOOST_CHECK(SPTAG::ErrorCode::Success == metaset.SaveMetadata(metaFile, metaIndexFile));
+    BOOST_CHECK(std::string((char*)first.Data(), first.Length()) == "0");
+}
+
 BOOST_AUTO_TEST_SUITE(ConcurrentTest)
 
 BOOST_AUTO_TEST_CASE(BKTTest)
@@ -134,4 +192,9 @@ BOOST_AUTO_TEST_CASE(KDTTest)
     CTest<float>(SPTAG::IndexAlgoType::KDT, "L2");
 }
 
+BOOST_AUTO_TEST_CASE(FileMetadataSetTest)
+{
+    ConcurrentFileMetadataReadAddSave("testmeta.bin", "testmetaindex.bin");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
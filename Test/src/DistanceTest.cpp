@@ -3,7 +3,9 @@
 
 #include <bitset>
 #include <ctime>
+#include <functional>
 #include <thread>
+#include <type_traits>
 #include <vector>
 #include "inc/Test.h"
 #include "inc/Core/Common/DistanceUtils.h"
@@ -92,6 +94,124 @@ BOOST_AUTO_TEST_CASE(TestDistanceComputation)
     test<std::int16_t>(32767);
 }
 
+BOOST_AUTO_TEST_CASE(TestVNNIDistanceComputation)
+{
+    if (!SPTAG::COMMON::InstructionSet::AVX512VNNI()) return;
+
+    // Lengths cover full 64-byte blocks, masked tails and short vectors.
+    for (SPTAG::DimensionType dimension : { 1, 17, 64, 100, 256, 1000 })
+    {
+        std::vector<std::int8_t> X(dimension), Y(dimension);
+        std::vector<std::uint8_t> U(dimension), V(dimension);
+        for (SPTAG::DimensionType i = 0; i < dimension; i++)
+        {
+            X[i] = (std::int8_t)(std::rand() % 256 - 128);
+            Y[i] = (std::int8_t)(std::rand() % 256 - 128);
+            U[i] = (std::uint8_t)(std::rand() % 256);
+            V[i] = (std::uint8_t)(std::rand() % 256);
+        }
+        BOOST_CHECK_CLOSE_FRACTION(ComputeL2Distance(X.data(), Y.data(), dimension), SPTAG::COMMON::DistanceUtils::ComputeL2Distance_AVX512VNNI(X.data(), Y.data(), dimension), 1e-5);
+        BOOST_CHECK_CLOSE_FRACTION(16129 - ComputeCosineDistance(X.data(), Y.data(), dimension), SPTAG::COMMON::DistanceUtils::ComputeCosineDistance_AVX512VNNI(X.data(), Y.data(), dimension), 1e-5);
+        BOOST_CHECK_CLOSE_FRACTION(ComputeL2Distance(U.data(), V.data(), dimension), SPTAG::COMMON::DistanceUtils::ComputeL2Distance_AVX512VNNI(U.data(), V.data(), dimension), 1e-5);
+        BOOST_CHECK_CLOSE_FRACTION(65025 - ComputeCosineDistance(U.data(), V.data(), dimension), SPTAG::COMMON::DistanceUtils::ComputeCosineDistance_AVX512VNNI(U.data(), V.data(), dimension), 1e-5);
+    }
+}
+
+template<typename T>
+void test_dispatch(int high) {
+    SPTAG::DimensionType dimension = 100;
+    std::vector<T> X(dimension), Y(dimension);
+    int low = std::is_signed<T>::value ? -high : 0;
+    for (SPTAG::DimensionType i = 0; i < dimension; i++) {
+        X[i] = random<T>(high, low);
+        Y[i] = random<T>(high, low);
+    }
+    std::function<float(const T*, const T*, SPTAG::DimensionType)> fallback = [](const T*, const T*, SPTAG::DimensionType) { return -1.0f; };
+    for (SPTAG::DistCalcMethod method : { SPTAG::DistCalcMethod::L2, SPTAG::DistCalcMethod::Cosine }) {
+        auto kernel = SPTAG::COMMON::DistanceCalcSelector<T>(method);
+        int calls = 0;
+        SPTAG::COMMON::DistanceDispatch<T>(kernel, fallback, [&](const auto& dist) {
+            calls++;
+            float expect = (std::is_same<std::decay_t<decltype(dist)>, decltype(fallback)>::value) ? -1.0f : kernel(X.data(), Y.data(), dimension);
+            BOOST_CHECK_EQUAL(dist(X.data(), Y.data(), dimension), expect);
+        });
+        BOOST_CHECK_EQUAL(calls, 1);
+
+        SPTAG::COMMON::DistanceDispatch<T>(nullptr, fallback, [&](const auto& dist) {
+            calls++;
+            BOOST_CHECK_EQUAL(dist(X.data(), Y.data(), dimension), -1.0f);
+        });
+        BOOST_CHECK_EQUAL(calls, 2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TestDistanceDispatch)
+{
+    test_dispatch<float>(1);
+    test_dispatch<std::int8_t>(127);
+    test_dispatch<std::uint8_t>(255);
+    test_dispatch<std::int16_t>(32767);
+}
+
+BOOST_AUTO_TEST_CASE(TestFixedDimensionComputation)
+{
+    if (!SPTAG::COMMON::InstructionSet::AVX()) return;
+
+    for (SPTAG::DimensionType dimension : { 64, 96, 100, 128, 256, 384, 512, 768, 1024 })
+    {
+        std::vector<float> X(dimension), Y(dimension);
+        for (SPTAG::DimensionType i = 0; i < dimension; i++)
+        {
+            X[i] = random<float>(1, -1);
+            Y[i] = random<float>(1, -1);
+        }
+        auto l2 = SPTAG::COMMON::DistanceCalcSelector<float>(SPTAG::DistCalcMethod::L2, dimension);
+        auto cosine = SPTAG::COMMON::DistanceCalcSelector<float>(SPTAG::DistCalcMethod::Cosine, dimension);
+        BOOST_CHECK(l2 != SPTAG::COMMON::DistanceCalcSelector<float>(SPTAG::DistCalcMethod::L2));
+        BOOST_CHECK(cosine != SPTAG::COMMON::DistanceCalcSelector<float>(SPTAG::DistCalcMethod::Cosine));
+        BOOST_CHECK_CLOSE_FRACTION(ComputeL2Distance(X.data(), Y.data(), dimension), l2(X.data(), Y.data(), dimension), 1e-5);
+        BOOST_CHECK_SMALL(1 - ComputeCosineDistance(X.data(), Y.data(), dimension) - cosine(X.data(), Y.data(), dimension), 1e-3f);
+    }
+    BOOST_CHECK(SPTAG::COMMON::DistanceCalcSelector<float>(SPTAG::DistCalcMethod::L2, 101) == SPTAG::COMMON::DistanceCalcSelector<float>(SPTAG::DistCalcMethod::L2));
+}
+
+BOOST_AUTO_TEST_CASE(TestFixedDimensionPerformance)
+{
+    if (!SPTAG::COMMON::InstructionSet::AVX()) return;
+
+    std::cout << "Testing FixedDimensionPerformance..." << std::endl;
+    for (SPTAG::DimensionType dimension : { 64, 96, 100, 128, 256, 384, 512, 768, 1024 })
+    {
+        // Keep the base vectors cache resident (128KB) so the kernels rather than memory are measured.
+        const SPTAG::SizeType size = 32768 / dimension;
+        const int rounds = 1000000 / size;
+        std::vector<float> X((size_t)size * dimension), Y(dimension);
+        for (auto& x : X) x = random<float>(1, -1);
+        for (auto& y : Y) y = random<float>(1, -1);
+
+        for (SPTAG::DistCalcMethod method : { SPTAG::DistCalcMethod::L2, SPTAG::DistCalcMethod::Cosine })
+        {
+            double elapsed[2];
+            float sum[2] = { 0, 0 };
+            SPTAG::COMMON::DistanceCalcReturn<float> kernels[2] = {
+                SPTAG::COMMON::DistanceCalcSelector<float>(method),
+                SPTAG::COMMON::DistanceCalcSelector<float>(method, dimension) };
+            for (int k = 0; k < 2; k++)
+            {
+                double start = omp_get_wtime();
+                for (int r = 0; r < rounds; r++)
+                    for (SPTAG::SizeType i = 0; i < size; i++)
+                        sum[k] += kernels[k](X.data() + (size_t)i * dimension, Y.data(), dimension);
+                elapsed[k] = omp_get_wtime() - start;
+            }
+            BOOST_CHECK_CLOSE_FRACTION(sum[0], sum[1], 1e-3);
+            std::cout << (method == SPTAG::DistCalcMethod::L2 ? "L2" : "Cosine") << " dimension " << dimension
+                << ": generic " << elapsed[0] * 1e9 / rounds / size << " ns, fixed " << elapsed[1] * 1e9 / rounds / size
+                << " ns, speedup " << elapsed[0] / elapsed[1] << "x" << std::endl;
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(TestDistanceComputationPerformance)
 {
     std::vector<SPTAG::DimensionType> dimensions{128, 256, 512, 1024};
@@ -0,0 +1,176 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const SPTAG::DimensionType c_reorderDim = 16;
+
+    std::shared_ptr<SPTAG::MetadataSet> NumberedMetadata(SPTAG::SizeType p_begin, SPTAG::SizeType p_end)
+    {
+        std::shared_ptr<SPTAG::MetadataSet> metaset(new SPTAG::MemMetadataSet(1024, 1024 * 1024, 10));
+        for (SPTAG::SizeType i = p_begin; i < p_end; i++)
+        {
+            std::string s = std::to_string(i);
+            SPTAG::ByteArray meta = SPTAG::ByteArray::Alloc(s.size());
+            std::memcpy(meta.Data(), s.data(), s.size());
+            metaset->Add(meta);
+        }
+        return metaset;
+    }
+
+    // Ids may have changed, so every vector is found through the input position its metadata names.
+    void CheckByMeta(std::shared_ptr<SPTAG::VectorIndex>& p_index, const std::vector<float>& p_vec)
+    {
+        for (SPTAG::SizeType i = 0; i < p_index->GetNumSamples(); i++)
+        {
+            if (!p_index->ContainSample(i)) continue;
+            SPTAG::ByteArray meta = p_index->GetMetadata(i);
+            SPTAG::SizeType input = std::stoi(std::string((char*)meta.Data(), meta.Length()));
+            BOOST_CHECK(std::memcmp(p_index->GetSample(i), p_vec.data() + (size_t)input * c_reorderDim, sizeof(float) * c_reorderDim) == 0);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(GraphReorderTest)
+
+BOOST_AUTO_TEST_CASE(BKTReorderTest)
+{
+    SPTAG::SizeType n = 5000, q = 200, deleted = 20;
+    int k = 10;
+    auto vec = TestUtils::GenerateVectors(n, c_reorderDim, 21);
+    auto queries = TestUtils::GenerateVectors(q, c_reorderDim, 23);
+
+    std::vector<char> meta;
+    std::vector<std::uint64_t> offsets;
+    for (SPTAG::SizeType i = 0; i < n; i++)
+    {
+        offsets.push_back(meta.size());
+        std::string s = std::to_string(i);
+        meta.insert(meta.end(), s.begin(), s.end());
+    }
+    offsets.push_back(meta.size());
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(float) * vec.size(), false), SPTAG::VectorValueType::Float, c_reorderDim, n));
+    std::shared_ptr<SPTAG::MetadataSet> metaset(new SPTAG::MemMetadataSet(
+        SPTAG::ByteArray((std::uint8_t*)meta.data(), meta.size(), false),
+        SPTAG::ByteArray((std::uint8_t*)offsets.data(), offsets.size() * sizeof(std::uint64_t), false), n));
+
+    std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::Float);
+    index->SetParameter("DistCalcMethod", "L2");
+    index->SetParameter("NumberOfThreads", "4");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(vecset, metaset, true));
+    for (SPTAG::SizeType i = 0; i < deleted; i++) BOOST_CHECK(SPTAG::ErrorCode::Success == index->DeleteIndex(i));
+    auto expect = TestUtils::SearchAll(index, queries, c_reorderDim, k, true);
+
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("ReorderGraph", "true"));
+    BOOST_CHECK(expect == TestUtils::SearchAll(index, queries, c_reorderDim, k, true));
+    for (SPTAG::SizeType i = 0; i < n; i += 97)
+    {
+        BOOST_CHECK(std::memcmp(index->GetSample(i), vec.data() + (size_t)i * c_reorderDim, sizeof(float) * c_reorderDim) == 0);
+        BOOST_CHECK_EQUAL(index->ContainSample(i), i >= deleted);
+    }
+
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->DeleteIndex(SPTAG::ByteArray((std::uint8_t*)"4321", 4, false)));
+    BOOST_CHECK(!index->ContainSample(4321));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SaveIndex("testgraphreorder"));
+
+    std::shared_ptr<SPTAG::VectorIndex> loaded;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testgraphreorder", loaded));
+    BOOST_CHECK(loaded != nullptr);
+    BOOST_CHECK(loaded->GetParameter("ReorderGraph") == "true");
+    BOOST_CHECK(!loaded->ContainSample(4321) && !loaded->ContainSample(0) && loaded->ContainSample(deleted));
+    BOOST_CHECK(SPTAG::ErrorCode::VectorNotFound == loaded->DeleteIndex(4321));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == loaded->DeleteIndex(1234));
+    auto afterDelete = TestUtils::SearchAll(loaded, queries, c_reorderDim, k, true);
+    for (auto& res : afterDelete) BOOST_CHECK(res.first != 4321 && res.first != 1234 && (res.first < 0 || res.first >= deleted));
+
+    std::string config;
+    std::vector<SPTAG::ByteArray> blobs;
+    auto sizes = loaded->CalculateBufferSize();
+    for (std::uint64_t size : *sizes) blobs.push_back(SPTAG::ByteArray::Alloc(size));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == loaded->SaveIndex(config, blobs));
+    std::shared_ptr<SPTAG::VectorIndex> fromMemory;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex(config, blobs, fromMemory));
+    BOOST_CHECK(fromMemory != nullptr);
+    BOOST_CHECK(afterDelete == TestUtils::SearchAll(fromMemory, queries, c_reorderDim, k, true));
+
+    BOOST_CHECK(SPTAG::ErrorCode::Success == loaded->SetParameter("CompactGraph", "true"));
+    BOOST_CHECK(afterDelete == TestUtils::SearchAll(loaded, queries, c_reorderDim, k, true));
+
+    BOOST_CHECK(SPTAG::ErrorCode::Success == loaded->SetParameter("ReorderGraph", "false"));
+    BOOST_CHECK(afterDelete == TestUtils::SearchAll(loaded, queries, c_reorderDim, k, true));
+    BOOST_CHECK(std::memcmp(loaded->GetSample(n - 1), vec.data() + (size_t)(n - 1) * c_reorderDim, sizeof(float) * c_reorderDim) == 0);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == loaded->SetParameter("CompactGraph", "false"));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == loaded->AddIndex(queries.data(), q, c_reorderDim, nullptr));
+    BOOST_CHECK_EQUAL(loaded->GetNumSamples(), n + q);
+}
+
+BOOST_AUTO_TEST_CASE(BKTReorderWriteTest)
+{
+    SPTAG::SizeType n = 2000, q = 100, deleted = 30;
+    int k = 10;
+    auto vec = TestUtils::GenerateVectors(n + q, c_reorderDim, 31);
+
+    std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::Float);
+    index->SetParameter("DistCalcMethod", "L2");
+    index->SetParameter("NumberOfThreads", "4");
+    index->SetParameter("ReorderGraph", "true");
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(float) * n * c_reorderDim, false), SPTAG::VectorValueType::Float, c_reorderDim, n));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(vecset, NumberedMetadata(0, n), true));
+
+    // Added vectors keep the ids they are given, next to the reordered ones.
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->AddIndex(vec.data() + (size_t)n * c_reorderDim, q, c_reorderDim, NumberedMetadata(n, n + q), true));
+    BOOST_CHECK_EQUAL(index->GetNumSamples(), n + q);
+    std::vector<float> added(vec.begin() + (size_t)n * c_reorderDim, vec.end());
+    auto found = TestUtils::SearchAll(index, added, c_reorderDim, k, true);
+    for (SPTAG::SizeType i = 0; i < q; i++) BOOST_CHECK_EQUAL(found[(size_t)i * k].first, n + i);
+    CheckByMeta(index, vec);
+
+    for (SPTAG::SizeType i = 0; i < deleted; i++) BOOST_CHECK(SPTAG::ErrorCode::Success == index->DeleteIndex(i * 37));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->DeleteIndex(n + 1));
+
+    // Enough deletes for a save to refine into the files, in place and from a snapshot.
+    index->SetParameter("DeletePercentageForRefine", "0.01");
+    for (std::string online : { "false", "true" })
+    {
+        index->SetParameter("OnlineRefine", online);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SaveIndex("testgraphreorderwrite"));
+        std::shared_ptr<SPTAG::VectorIndex> loaded;
+        BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testgraphreorderwrite", loaded));
+        BOOST_REQUIRE(loaded != nullptr);
+        BOOST_CHECK_EQUAL(loaded->GetNumSamples(), n + q - deleted - 1);
+        CheckByMeta(loaded, vec);
+    }
+
+    std::shared_ptr<SPTAG::VectorIndex> refined;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->RefineIndex(refined));
+    BOOST_REQUIRE(refined != nullptr);
+    BOOST_CHECK_EQUAL(refined->GetNumSamples(), n + q - deleted - 1);
+    CheckByMeta(refined, vec);
+
+    std::vector<SPTAG::SizeType> idMap;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->CompactIndex(idMap));
+    BOOST_REQUIRE_EQUAL((SPTAG::SizeType)idMap.size(), n + q);
+    BOOST_CHECK_EQUAL(index->GetNumSamples(), n + q - deleted - 1);
+    for (SPTAG::SizeType i = 0; i < n + q; i++)
+    {
+        bool gone = (i < deleted * 37 && i % 37 == 0) || i == n + 1;
+        BOOST_CHECK_EQUAL(idMap[i] < 0, gone);
+        if (gone) continue;
+        SPTAG::ByteArray meta = index->GetMetadata(idMap[i]);
+        BOOST_CHECK_EQUAL(std::string((char*)meta.Data(), meta.Length()), std::to_string(i));
+    }
+    CheckByMeta(index, vec);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->AddIndex(vec.data(), 1, c_reorderDim, NumberedMetadata(0, 1), true));
+    CheckByMeta(index, vec);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,99 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+#include "inc/Core/Common/Dataset.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    std::uint64_t AllocatedBytes()
+    {
+        auto& stats = SPTAG::COMMON::PageAllocator::GetStats();
+        return (stats.m_pages1GB.load() << 30) + (stats.m_pages2MB.load() << 21) + stats.m_transparentBytes.load() + stats.m_regularBytes.load();
+    }
+
+    // Each query is a copy of the vector with the same id, so it has to come back first.
+    void CheckHugePageIndex(std::shared_ptr<SPTAG::VectorIndex>& p_index, const std::vector<float>& p_vec, SPTAG::SizeType p_num, SPTAG::DimensionType p_dim)
+    {
+        for (SPTAG::SizeType i = 0; i < p_num; i++)
+        {
+            SPTAG::QueryResult res(p_vec.data() + (size_t)i * p_dim, 10, false);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == p_index->SearchIndex(res));
+            BOOST_CHECK_EQUAL(res.GetResult(0)->VID, i);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(HugePageTest)
+
+BOOST_AUTO_TEST_CASE(PageAllocatorTest)
+{
+    std::uint64_t before = AllocatedBytes();
+    for (SPTAG::HugePagePolicy policy : { SPTAG::HugePagePolicy::None, SPTAG::HugePagePolicy::Transparent, SPTAG::HugePagePolicy::Huge2MB, SPTAG::HugePagePolicy::Huge1GB })
+    {
+        // Small blocks always come from the heap; large ones fall back until some kind of page is available.
+        for (std::size_t size : { (std::size_t)1000, (std::size_t)5 << 20 })
+        {
+            std::uint8_t* ptr = (std::uint8_t*)SPTAG::COMMON::PageAllocator::Allocate(size, policy);
+            BOOST_REQUIRE(ptr != nullptr);
+            BOOST_CHECK_EQUAL((std::uintptr_t)ptr % 32, 0);
+            BOOST_CHECK_GE(AllocatedBytes(), before + size);
+            for (std::size_t i = 0; i < size; i += 4096) ptr[i] = (std::uint8_t)i;
+            ptr[size - 1] = 1;
+            SPTAG::COMMON::PageAllocator::Free(ptr);
+            BOOST_CHECK_EQUAL(AllocatedBytes(), before);
+        }
+    }
+    SPTAG::COMMON::PageAllocator::Free(nullptr);
+    SPTAG::COMMON::PageAllocator::LogStats();
+
+    SPTAG::COMMON::Dataset<float> data;
+    data.SetHugePages(SPTAG::HugePagePolicy::Transparent);
+    data.Initialize(1000, 1024, 1024, 4096);
+    BOOST_CHECK(data.HugePages() == SPTAG::HugePagePolicy::Transparent);
+    std::vector<float> row(1024, 1.0f);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == data.AddBatch(row.data(), 1));
+    BOOST_CHECK_EQUAL(data[1000][1023], 1.0f);
+    data.Clear();
+    BOOST_CHECK_EQUAL(AllocatedBytes(), before);
+}
+
+BOOST_AUTO_TEST_CASE(IndexHugePageTest)
+{
+    SPTAG::SizeType n = 10000, q = 20;
+    SPTAG::DimensionType dim = 64;
+    std::mt19937 rg(41);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> vec((size_t)n * dim), queries((size_t)q * dim);
+    for (auto& v : vec) v = dist(rg);
+    for (auto& v : queries) v = dist(rg);
+
+    for (SPTAG::IndexAlgoType algo : { SPTAG::IndexAlgoType::BKT, SPTAG::IndexAlgoType::KDT })
+    {
+        for (const char* policy : { "None", "Transparent", "Huge2MB" })
+        {
+            std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::VectorValueType::Float);
+            index->SetParameter("DistCalcMethod", "L2");
+            index->SetParameter("NumberOfThreads", "4");
+            BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("HugePages", policy));
+            BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(vec.data(), n, dim));
+
+            CheckHugePageIndex(index, vec, q, dim);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == index->AddIndex(queries.data(), q, dim, nullptr));
+
+            BOOST_CHECK(SPTAG::ErrorCode::Success == index->SaveIndex("testhugepage"));
+            std::shared_ptr<SPTAG::VectorIndex> loaded;
+            BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testhugepage", loaded));
+            BOOST_REQUIRE(loaded != nullptr);
+            BOOST_CHECK(loaded->GetParameter("HugePages") == policy);
+            BOOST_CHECK_EQUAL(loaded->GetNumSamples(), n + q);
+            CheckHugePageIndex(loaded, vec, q, dim);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
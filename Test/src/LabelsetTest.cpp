@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/Common.h"
+#include "inc/Core/Common/Labelset.h"
+
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(LabelsetTest)
+
+BOOST_AUTO_TEST_CASE(InsertAndMaskTest)
+{
+    SPTAG::COMMON::Labelset labels;
+    labels.Initialize(200, 128, 1000, SPTAG::COMMON::Labelset::InvalidIDBehavior::AlwaysContains);
+
+    BOOST_CHECK(labels.Insert(3));
+    BOOST_CHECK(!labels.Insert(3));
+    BOOST_CHECK(labels.Insert(64));
+    BOOST_CHECK(labels.Insert(199));
+    BOOST_CHECK_EQUAL(labels.Count(), 3);
+    BOOST_CHECK(labels.Contains(3) && labels.Contains(64) && labels.Contains(199));
+    BOOST_CHECK(!labels.Contains(4) && !labels.Contains(63));
+    BOOST_CHECK(labels.Contains(200));
+
+    std::vector<SPTAG::SizeType> keys = { 0, 3, 64, 65, 199, 500 };
+    BOOST_CHECK_EQUAL(labels.ContainsMask(keys.data(), (int)keys.size()), 0b110110ULL);
+
+    std::vector<SPTAG::SizeType> full(SPTAG::COMMON::Labelset::c_maskKeys, 4);
+    full.back() = 199;
+    BOOST_CHECK_EQUAL(labels.ContainsMask(full.data(), (int)full.size()), 1ULL << 63);
+
+    BOOST_CHECK(SPTAG::ErrorCode::Success == labels.AddBatch(300));
+    BOOST_CHECK_EQUAL(labels.R(), 500);
+    BOOST_CHECK(!labels.Contains(200) && !labels.Contains(499));
+    BOOST_CHECK(labels.Insert(450));
+
+    labels.SetR(180);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == labels.AddBatch(320));
+    BOOST_CHECK(!labels.Contains(199) && !labels.Contains(450));
+    BOOST_CHECK(labels.Contains(64));
+}
+
+BOOST_AUTO_TEST_CASE(LegacyFormatTest)
+{
+    SPTAG::SizeType n = 1000;
+    {
+        SPTAG::COMMON::Dataset<std::int8_t> legacy(n, 1, 1024, n);
+        for (SPTAG::SizeType i = 0; i < n; i += 7) *legacy[i] = 1;
+        auto ptr = SPTAG::f_createIO();
+        BOOST_CHECK(ptr != nullptr && ptr->Initialize("testlabels.bin", std::ios::binary | std::ios::out));
+        SPTAG::SizeType deleted = (n + 6) / 7;
+        BOOST_CHECK(ptr->WriteBinary(sizeof(SPTAG::SizeType), (char*)&deleted) == sizeof(SPTAG::SizeType));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == legacy.Save(ptr));
+    }
+
+    SPTAG::COMMON::Labelset labels;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == labels.Load(std::string("testlabels.bin"), 1024, n));
+    BOOST_CHECK_EQUAL(labels.R(), n);
+    BOOST_CHECK_EQUAL(labels.Count(), (n + 6) / 7);
+    for (SPTAG::SizeType i = 0; i < n; i++) BOOST_CHECK_EQUAL(labels.Contains(i), i % 7 == 0);
+
+    BOOST_CHECK(SPTAG::ErrorCode::Success == labels.Save(std::string("testlabels2.bin")));
+    {
+        auto ptr = SPTAG::f_createIO();
+        BOOST_CHECK(ptr != nullptr && ptr->Initialize("testlabels2.bin", std::ios::binary | std::ios::in));
+        SPTAG::SizeType deleted;
+        BOOST_CHECK(ptr->ReadBinary(sizeof(SPTAG::SizeType), (char*)&deleted) == sizeof(SPTAG::SizeType));
+        SPTAG::COMMON::Dataset<std::int8_t> legacy;
+        BOOST_CHECK(SPTAG::ErrorCode::Success == legacy.Load(ptr, 1024, n));
+        BOOST_CHECK_EQUAL(deleted, (n + 6) / 7);
+        for (SPTAG::SizeType i = 0; i < n; i++) BOOST_CHECK_EQUAL(*legacy[i] == 1, i % 7 == 0);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
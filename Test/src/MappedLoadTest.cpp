@@ -0,0 +1,67 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(MappedLoadTest)
+
+BOOST_AUTO_TEST_CASE(MappedIndexTest)
+{
+    SPTAG::SizeType n = 3000, q = 50;
+    SPTAG::DimensionType dim = 32;
+    int k = 10;
+    auto vec = TestUtils::GenerateVectors(n, dim, 61, 1.0f);
+    auto queries = TestUtils::GenerateVectors(q, dim, 62, 1.0f);
+
+    for (SPTAG::IndexAlgoType algo : { SPTAG::IndexAlgoType::BKT, SPTAG::IndexAlgoType::KDT })
+    {
+        std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::VectorValueType::Float);
+        index->SetParameter("DistCalcMethod", "L2");
+        index->SetParameter("NumberOfThreads", "4");
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(vec.data(), n, dim));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->DeleteIndex(0));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("MapIndexFiles", "true"));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("PrefaultIndexFiles", "true"));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SaveIndex("testmappedload"));
+        auto expect = TestUtils::SearchAll(index, queries, dim, k);
+
+        // Two loads of one folder share the mapped files and search like the index they were saved from.
+        std::shared_ptr<SPTAG::VectorIndex> mapped, other;
+        BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testmappedload", mapped));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testmappedload", other));
+        BOOST_REQUIRE(mapped != nullptr && other != nullptr);
+        BOOST_CHECK(mapped->GetParameter("MapIndexFiles") == "true");
+        BOOST_CHECK_EQUAL(mapped->GetNumDeleted(), 1);
+        BOOST_CHECK(expect == TestUtils::SearchAll(mapped, queries, dim, k));
+        BOOST_CHECK(expect == TestUtils::SearchAll(other, queries, dim, k));
+
+        // Adds rewrite neighbor lists of mapped rows; the writes stay private to the index that makes them.
+        BOOST_CHECK(SPTAG::ErrorCode::Success == mapped->AddIndex(queries.data(), q, dim, nullptr));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == mapped->DeleteIndex(1));
+        for (SPTAG::SizeType i = 0; i < q; i++)
+        {
+            SPTAG::QueryResult res(queries.data() + (size_t)i * dim, 1, false);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == mapped->SearchIndex(res));
+            BOOST_CHECK_EQUAL(res.GetResult(0)->VID, n + i);
+        }
+        BOOST_CHECK(expect == TestUtils::SearchAll(other, queries, dim, k));
+
+        // Saving over the folder the index is mapped from keeps the loaded data intact.
+        auto updated = TestUtils::SearchAll(mapped, queries, dim, k);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == mapped->SaveIndex("testmappedload"));
+        BOOST_CHECK(updated == TestUtils::SearchAll(mapped, queries, dim, k));
+        BOOST_CHECK(expect == TestUtils::SearchAll(other, queries, dim, k));
+
+        std::shared_ptr<SPTAG::VectorIndex> reloaded;
+        BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testmappedload", reloaded));
+        BOOST_REQUIRE(reloaded != nullptr);
+        BOOST_CHECK_EQUAL(reloaded->GetNumSamples(), n + q);
+        BOOST_CHECK_EQUAL(reloaded->GetNumDeleted(), 2);
+        BOOST_CHECK(updated == TestUtils::SearchAll(reloaded, queries, dim, k));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,106 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const SPTAG::DimensionType c_replicaDim = 16;
+}
+
+BOOST_AUTO_TEST_SUITE(NumaReplicaTest)
+
+BOOST_AUTO_TEST_CASE(BKTNumaReplicaTest)
+{
+    SPTAG::SizeType n = 3000, q = 100;
+    int k = 10;
+    auto vec = TestUtils::GenerateVectors(n, c_replicaDim, 31);
+    auto queries = TestUtils::GenerateVectors(q, c_replicaDim, 33);
+
+    std::vector<char> meta;
+    std::vector<std::uint64_t> offsets;
+    for (SPTAG::SizeType i = 0; i < n; i++)
+    {
+        offsets.push_back(meta.size());
+        std::string s = std::to_string(i);
+        meta.insert(meta.end(), s.begin(), s.end());
+    }
+    offsets.push_back(meta.size());
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(float) * vec.size(), false), SPTAG::VectorValueType::Float, c_replicaDim, n));
+    std::shared_ptr<SPTAG::MetadataSet> metaset(new SPTAG::MemMetadataSet(
+        SPTAG::ByteArray((std::uint8_t*)meta.data(), meta.size(), false),
+        SPTAG::ByteArray((std::uint8_t*)offsets.data(), offsets.size() * sizeof(std::uint64_t), false), n));
+
+    std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::Float);
+    index->SetParameter("DistCalcMethod", "L2");
+    index->SetParameter("NumberOfThreads", "4");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(vecset, metaset));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("ReorderGraph", "true"));
+    auto expect = TestUtils::SearchAll(index, queries, c_replicaDim, k, true);
+
+    // Searches from any thread go through the copy of their node and see the same index.
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("NumaReplicas", "true"));
+    BOOST_CHECK(expect == TestUtils::SearchAll(index, queries, c_replicaDim, k, true));
+    std::vector<std::pair<SPTAG::SizeType, float>> fromThread;
+    std::thread([&]() { fromThread = TestUtils::SearchAll(index, queries, c_replicaDim, k, true); }).join();
+    BOOST_CHECK(expect == fromThread);
+
+    // Search settings reach the copies.
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("MaxCheck", "64"));
+    auto narrow = TestUtils::SearchAll(index, queries, c_replicaDim, k, true);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("NumaReplicas", "false"));
+    BOOST_CHECK(narrow == TestUtils::SearchAll(index, queries, c_replicaDim, k, true));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("MaxCheck", "8192"));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("NumaReplicas", "true"));
+
+    // Batched searches go through the copies as well.
+    std::vector<SPTAG::QueryResult> batch;
+    for (SPTAG::SizeType i = 0; i < q; i++) batch.emplace_back(queries.data() + (size_t)i * c_replicaDim, k, true);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SearchIndexBatch(batch.data(), (int)q));
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        BOOST_CHECK_EQUAL(batch[i].GetResult(0)->VID, expect[(size_t)i * k].first);
+        BOOST_CHECK(batch[i].GetMetadata(0).Length() > 0);
+    }
+
+    // Dropping and copying the replicas again under running searches never hands them a freed copy.
+    std::vector<float> head(queries.begin(), queries.begin() + 10 * c_replicaDim);
+    std::vector<std::pair<SPTAG::SizeType, float>> prefix(expect.begin(), expect.begin() + 10 * k);
+    std::atomic<bool> done(false);
+    std::atomic<int> mismatches(0);
+    std::vector<std::thread> searchers;
+    for (int t = 0; t < 3; t++)
+    {
+        searchers.emplace_back([&]() {
+            while (!done) if (prefix != TestUtils::SearchAll(index, head, c_replicaDim, k, true)) mismatches++;
+        });
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("NumaReplicas", (i % 2 == 0) ? "false" : "true"));
+    }
+    done = true;
+    for (auto& searcher : searchers) searcher.join();
+    BOOST_CHECK_EQUAL(mismatches.load(), 0);
+
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SaveIndex("testnumareplica"));
+    std::shared_ptr<SPTAG::VectorIndex> loaded;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testnumareplica", loaded));
+    BOOST_REQUIRE(loaded != nullptr);
+    BOOST_CHECK(loaded->GetParameter("NumaReplicas") == "true");
+    BOOST_CHECK(expect == TestUtils::SearchAll(loaded, queries, c_replicaDim, k, true));
+
+    // A delete is not copied, so the searches go back to the original index and never return the deleted vector.
+    SPTAG::SizeType removed = expect[0].first;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->DeleteIndex(removed));
+    for (auto& res : TestUtils::SearchAll(index, queries, c_replicaDim, k, true)) BOOST_CHECK(res.first != removed);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,175 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+
+#include <atomic>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // The decimal ids as metadata, with room to add more to the set once an index owns it.
+    std::shared_ptr<SPTAG::MetadataSet> IDMetadata(SPTAG::SizeType p_begin, SPTAG::SizeType p_end)
+    {
+        std::string meta;
+        std::vector<std::uint64_t> offsets(1, 0);
+        for (SPTAG::SizeType i = p_begin; i < p_end; i++)
+        {
+            meta += std::to_string(i);
+            offsets.push_back(meta.size());
+        }
+        SPTAG::ByteArray metaBytes = SPTAG::ByteArray::Alloc(meta.size());
+        std::memcpy(metaBytes.Data(), meta.data(), meta.size());
+        SPTAG::ByteArray offsetBytes = SPTAG::ByteArray::Alloc(offsets.size() * sizeof(std::uint64_t));
+        std::memcpy(offsetBytes.Data(), offsets.data(), offsets.size() * sizeof(std::uint64_t));
+        return std::make_shared<SPTAG::MemMetadataSet>(metaBytes, offsetBytes, p_end - p_begin, 1024, 1 << 20, 8);
+    }
+
+    // Every surviving vector keeps its data, metadata and delete state under its new id.
+    void CheckCompacted(std::shared_ptr<SPTAG::VectorIndex>& p_index, const std::vector<float>& p_vec, const std::vector<SPTAG::SizeType>& p_idMap,
+        const std::vector<bool>& p_deleted, SPTAG::DimensionType p_dim)
+    {
+        SPTAG::SizeType live = 0, found = 0;
+        for (SPTAG::SizeType id = 0; id < (SPTAG::SizeType)p_idMap.size(); id++)
+        {
+            SPTAG::SizeType newID = p_idMap[id];
+            if (newID < 0)
+            {
+                BOOST_CHECK(p_deleted[id]);
+                continue;
+            }
+            BOOST_CHECK(std::memcmp(p_index->GetSample(newID), p_vec.data() + (size_t)id * p_dim, sizeof(float) * p_dim) == 0);
+            SPTAG::ByteArray meta = p_index->GetMetadata(newID);
+            BOOST_CHECK(std::string((char*)meta.Data(), meta.Length()) == std::to_string(id));
+            BOOST_CHECK_EQUAL(p_index->ContainSample(newID), !p_deleted[id]);
+            if (p_deleted[id]) continue;
+
+            live++;
+            SPTAG::QueryResult res(p_vec.data() + (size_t)id * p_dim, 1, false);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == p_index->SearchIndex(res));
+            if (res.GetResult(0)->VID == newID) found++;
+        }
+        BOOST_CHECK_GE(found, live * 98 / 100);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(OnlineCompactionTest)
+
+BOOST_AUTO_TEST_CASE(CompactWhileUpdatingTest)
+{
+    SPTAG::SizeType n = 2000, m = 1000;
+    SPTAG::DimensionType dim = 32;
+    std::mt19937 rg(89);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> vec((size_t)(n + m) * dim);
+    for (auto& v : vec) v = dist(rg);
+
+    std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::Float);
+    index->SetParameter("DistCalcMethod", "L2");
+    index->SetParameter("NumberOfThreads", "4");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(std::make_shared<SPTAG::BasicVectorSet>(SPTAG::ByteArray((std::uint8_t*)vec.data(), (size_t)n * dim * sizeof(float), false),
+        SPTAG::VectorValueType::Float, dim, n), IDMetadata(0, n), true));
+
+    std::vector<bool> deleted(n + m, false);
+    for (SPTAG::SizeType i = 0; i < n; i += 2)
+    {
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->DeleteIndex(i));
+        deleted[i] = true;
+    }
+
+    // Adds, deletes and searches keep going for as long as the compaction runs.
+    std::atomic<bool> done(false);
+    std::atomic<SPTAG::SizeType> added(0);
+    std::thread adder([&]() {
+        for (SPTAG::SizeType begin = n; begin < n + m && !done; begin += 50)
+        {
+            BOOST_CHECK(SPTAG::ErrorCode::Success == index->AddIndex(vec.data() + (size_t)begin * dim, 50, dim, IDMetadata(begin, begin + 50), true));
+            added = begin + 50 - n;
+        }
+    });
+    // Vectors below the compacted size never move, so these ids stay valid across the swap.
+    std::thread deleter([&]() {
+        for (SPTAG::SizeType i = 1; i < n / 3 && !done; i += 8)
+        {
+            deleted[i] = true;
+            BOOST_CHECK(SPTAG::ErrorCode::Success == index->DeleteIndex(i));
+        }
+    });
+    std::thread searcher([&]() {
+        while (!done)
+        {
+            SPTAG::QueryResult res(vec.data() + (size_t)(rg() % n) * dim, 10, true);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == index->SearchIndex(res));
+        }
+    });
+
+    std::vector<SPTAG::SizeType> idMap;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->CompactIndex(idMap));
+    done = true;
+    adder.join();
+    deleter.join();
+    searcher.join();
+
+    // Adds that came after the swap extend the map by their position.
+    SPTAG::SizeType total = n + added;
+    BOOST_REQUIRE_LE((SPTAG::SizeType)idMap.size(), total);
+    for (SPTAG::SizeType id = (SPTAG::SizeType)idMap.size(), next = index->GetNumSamples() - (total - id); id < total; id++) idMap.push_back(next++);
+    BOOST_CHECK_LE(index->GetNumSamples(), total - n / 2);
+    CheckCompacted(index, vec, idMap, deleted, dim);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->CompactIndex(idMap));
+}
+
+BOOST_AUTO_TEST_CASE(OnlineRefineOnSaveTest)
+{
+    SPTAG::SizeType n = 3000;
+    SPTAG::DimensionType dim = 32;
+    std::mt19937 rg(97);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> vec((size_t)n * dim);
+    for (auto& v : vec) v = dist(rg);
+
+    std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::Float);
+    index->SetParameter("DistCalcMethod", "L2");
+    index->SetParameter("NumberOfThreads", "4");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("OnlineRefine", "true"));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(std::make_shared<SPTAG::BasicVectorSet>(SPTAG::ByteArray((std::uint8_t*)vec.data(), (size_t)n * dim * sizeof(float), false),
+        SPTAG::VectorValueType::Float, dim, n), IDMetadata(0, n), true));
+    std::vector<bool> deleted(n, false);
+    for (SPTAG::SizeType i = 0; i < n; i += 3)
+    {
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->DeleteIndex(i));
+        deleted[i] = true;
+    }
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("DeletePercentageForRefine", "0.2"));
+    BOOST_CHECK(index->NeedRefine());
+
+    // Only the saved copy is refined: the index it is called on keeps its ids and its deletes.
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SaveIndex("testonlinerefine"));
+    BOOST_CHECK_EQUAL(index->GetNumSamples(), n);
+    BOOST_CHECK_EQUAL(index->GetNumDeleted(), (n + 2) / 3);
+    BOOST_CHECK(index->NeedRefine());
+    for (SPTAG::SizeType i = 1; i < n; i += 3)
+    {
+        SPTAG::ByteArray meta = index->GetMetadata(i);
+        BOOST_CHECK_EQUAL(std::string((char*)meta.Data(), meta.Length()), std::to_string(i));
+    }
+
+    std::shared_ptr<SPTAG::VectorIndex> loaded;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testonlinerefine", loaded));
+    BOOST_REQUIRE(loaded != nullptr);
+    BOOST_CHECK_EQUAL(loaded->GetNumSamples(), n - (n + 2) / 3);
+    std::vector<SPTAG::SizeType> idMap(n, -1);
+    for (SPTAG::SizeType i = 0; i < loaded->GetNumSamples(); i++)
+    {
+        SPTAG::ByteArray meta = loaded->GetMetadata(i);
+        idMap[std::stoi(std::string((char*)meta.Data(), meta.Length()))] = i;
+    }
+    CheckCompacted(loaded, vec, idMap, deleted, dim);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
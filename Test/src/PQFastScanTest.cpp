@@ -0,0 +1,146 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+#include "inc/Core/Common/PQQuantizer.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace
+{
+    const SPTAG::DimensionType c_dimPerSubvector = 2;
+
+    std::shared_ptr<SPTAG::COMMON::PQQuantizer<float>> CreatePQ4(SPTAG::DimensionType p_numSubvectors, const std::vector<float>& p_vec)
+    {
+        // Centroids are taken from the data, which is enough to exercise the tables.
+        SPTAG::DimensionType dim = p_numSubvectors * c_dimPerSubvector;
+        auto codebooks = std::make_unique<float[]>(p_numSubvectors * 16 * c_dimPerSubvector);
+        for (SPTAG::DimensionType i = 0; i < p_numSubvectors; i++)
+            for (int j = 0; j < 16; j++)
+                for (SPTAG::DimensionType d = 0; d < c_dimPerSubvector; d++)
+                    codebooks[(i * 16 + j) * c_dimPerSubvector + d] = p_vec[(size_t)j * dim + i * c_dimPerSubvector + d];
+        return std::make_shared<SPTAG::COMMON::PQQuantizer<float>>(p_numSubvectors, 16, c_dimPerSubvector, false, std::move(codebooks));
+    }
+
+}
+
+BOOST_AUTO_TEST_SUITE(PQFastScanTest)
+
+BOOST_AUTO_TEST_CASE(FastScanKernelTest)
+{
+    std::mt19937 rg(5);
+    for (SPTAG::DimensionType numPairs : { 1, 3, 8, 33, 128 })
+    {
+        std::vector<std::uint8_t> lut(numPairs * 32), block(numPairs * 32);
+        for (auto& v : lut) v = (std::uint8_t)(rg() % 256);
+        for (auto& v : block) v = (std::uint8_t)(rg() % 256);
+
+        std::uint16_t expect[32], sums[32];
+        SPTAG::COMMON::DistanceUtils::ComputePQ4FastScan(lut.data(), block.data(), numPairs, expect);
+        for (int j = 0; j < 32; j++)
+        {
+            int sum = 0;
+            for (SPTAG::DimensionType p = 0; p < numPairs; p++)
+            {
+                std::uint8_t code = block[p * 32 + j];
+                sum += lut[p * 32 + (code & 0x0f)] + lut[p * 32 + 16 + (code >> 4)];
+            }
+            BOOST_CHECK_EQUAL(expect[j], sum);
+        }
+
+        if (SPTAG::COMMON::InstructionSet::AVX2())
+        {
+            SPTAG::COMMON::DistanceUtils::ComputePQ4FastScan_AVX(lut.data(), block.data(), numPairs, sums);
+            BOOST_CHECK(std::equal(expect, expect + 32, sums));
+        }
+        if (SPTAG::COMMON::InstructionSet::AVX512())
+        {
+            SPTAG::COMMON::DistanceUtils::ComputePQ4FastScan_AVX512(lut.data(), block.data(), numPairs, sums);
+            BOOST_CHECK(std::equal(expect, expect + 32, sums));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FastScanDistanceTest)
+{
+    SPTAG::SizeType n = 100;
+    for (SPTAG::DimensionType numSubvectors : { 15, 16, 64 })
+    {
+        SPTAG::DimensionType dim = numSubvectors * c_dimPerSubvector;
+        auto vec = TestUtils::GenerateVectors(n, dim, 3, 10.0f);
+        auto quantizer = CreatePQ4(numSubvectors, vec);
+
+        std::vector<std::uint8_t> codes((size_t)n * numSubvectors);
+        std::vector<const std::uint8_t*> pointers(n);
+        for (SPTAG::SizeType i = 0; i < n; i++)
+        {
+            quantizer->QuantizeVector(vec.data() + (size_t)i * dim, codes.data() + (size_t)i * numSubvectors, false);
+            pointers[i] = codes.data() + (size_t)i * numSubvectors;
+        }
+
+        BOOST_CHECK(!quantizer->FastScanEnabled());
+        quantizer->SetEnableADC(true);
+        BOOST_CHECK(quantizer->FastScanEnabled());
+
+        auto query = TestUtils::GenerateVectors(1, dim, 4, 10.0f);
+        std::vector<std::uint8_t> target(quantizer->QuantizeSize());
+        quantizer->QuantizeVector(query.data(), target.data());
+
+        // Each table entry is rounded to half a step of the shared uint8 scale.
+        float step;
+        std::memcpy(&step, target.data() + sizeof(float) * numSubvectors * 16 + (numSubvectors + 1) / 2 * 32, sizeof(float));
+        std::vector<float> dists(n);
+        quantizer->L2DistanceBatch(target.data(), pointers.data(), n, dists.data());
+        for (SPTAG::SizeType i = 0; i < n; i++)
+        {
+            BOOST_CHECK_SMALL(dists[i] - quantizer->L2Distance(target.data(), pointers[i]), numSubvectors * step / 2 + 1e-2f);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BKTFastScanTest)
+{
+    SPTAG::SizeType n = 2000, q = 50;
+    SPTAG::DimensionType numSubvectors = 16, dim = numSubvectors * c_dimPerSubvector;
+    int k = 10;
+    auto vec = TestUtils::GenerateVectors(n, dim, 21, 10.0f);
+    auto queries = TestUtils::GenerateVectors(q, dim, 22, 10.0f);
+    auto quantizer = CreatePQ4(numSubvectors, vec);
+
+    SPTAG::ByteArray codes = SPTAG::ByteArray::Alloc((size_t)n * numSubvectors);
+    for (SPTAG::SizeType i = 0; i < n; i++) quantizer->QuantizeVector(vec.data() + (size_t)i * dim, codes.Data() + (size_t)i * numSubvectors, false);
+
+    std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::UInt8);
+    index->SetQuantizer(quantizer);
+    index->SetParameter("DistCalcMethod", "L2");
+    index->SetParameter("NumberOfThreads", "4");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(std::make_shared<SPTAG::BasicVectorSet>(codes, SPTAG::VectorValueType::UInt8, numSubvectors, n), nullptr));
+    index->SetQuantizerADC(true);
+
+    // The search scores codes with the uint8 tables; the truth is the exact float ADC distance.
+    std::vector<std::uint8_t> target(quantizer->QuantizeSize());
+    int hits = 0;
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        const float* query = queries.data() + (size_t)i * dim;
+        quantizer->QuantizeVector(query, target.data());
+        std::vector<std::pair<float, SPTAG::SizeType>> truth;
+        for (SPTAG::SizeType j = 0; j < n; j++) truth.emplace_back(quantizer->L2Distance(target.data(), codes.Data() + (size_t)j * numSubvectors), j);
+        std::partial_sort(truth.begin(), truth.begin() + k, truth.end());
+        std::set<SPTAG::SizeType> expect;
+        for (int j = 0; j < k; j++) expect.insert(truth[j].second);
+
+        SPTAG::QueryResult res(query, k, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SearchIndex(res));
+        for (int j = 0; j < k; j++) hits += (int)expect.count(res.GetResult(j)->VID);
+    }
+    float recall = (float)hits / (q * k);
+    BOOST_TEST_MESSAGE("PQ4 fast scan recall@" << k << ": " << recall);
+    BOOST_CHECK_GT(recall, 0.8f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,86 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+#include "inc/Helper/AsyncFileReader.h"
+
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(ParallelLoadTest)
+
+BOOST_AUTO_TEST_CASE(ReadFilesParallelTest)
+{
+    // Sizes around the page and chunk boundaries, read with chunks of three pages.
+    std::mt19937 rg(71);
+    std::vector<std::string> paths;
+    std::vector<std::vector<char>> expect;
+    for (size_t size : { (size_t)1, (size_t)4096, (size_t)5000, (size_t)12288, (size_t)3 * 1024 * 1024 + 17 })
+    {
+        paths.push_back("testparallelread" + std::to_string(paths.size()) + ".bin");
+        expect.emplace_back(size);
+        for (auto& c : expect.back()) c = (char)(rg() & 0xff);
+        std::ofstream out(paths.back(), std::ios::binary);
+        out.write(expect.back().data(), size);
+    }
+
+    for (int threads : { 1, 4 })
+    {
+        std::vector<SPTAG::ByteArray> contents;
+        BOOST_REQUIRE(SPTAG::Helper::ReadFilesParallel(paths, threads, 3 * 4096, contents));
+        BOOST_REQUIRE_EQUAL(contents.size(), paths.size());
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            BOOST_CHECK_EQUAL(contents[i].Length(), expect[i].size());
+            BOOST_CHECK_EQUAL((std::uintptr_t)contents[i].Data() % 4096, 0);
+            BOOST_CHECK(std::equal(expect[i].begin(), expect[i].end(), (const char*)contents[i].Data()));
+        }
+    }
+
+    std::vector<SPTAG::ByteArray> contents;
+    paths.push_back("testparallelreadmissing.bin");
+    BOOST_CHECK(!SPTAG::Helper::ReadFilesParallel(paths, 4, 4096, contents));
+}
+
+BOOST_AUTO_TEST_CASE(ParallelLoadIndexTest)
+{
+    SPTAG::SizeType n = 3000, q = 50;
+    SPTAG::DimensionType dim = 32;
+    int k = 10;
+    auto vec = TestUtils::GenerateVectors(n, dim, 73, 1.0f);
+    auto queries = TestUtils::GenerateVectors(q, dim, 74, 1.0f);
+
+    for (SPTAG::IndexAlgoType algo : { SPTAG::IndexAlgoType::BKT, SPTAG::IndexAlgoType::KDT })
+    {
+        std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::VectorValueType::Float);
+        index->SetParameter("DistCalcMethod", "L2");
+        index->SetParameter("NumberOfThreads", "4");
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(vec.data(), n, dim));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->DeleteIndex(0));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("LoadThreads", "4"));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("LoadChunkMB", "1"));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SaveIndex("testparallelload"));
+        auto expect = TestUtils::SearchAll(index, queries, dim, k);
+
+        std::shared_ptr<SPTAG::VectorIndex> loaded;
+        BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testparallelload", loaded));
+        BOOST_REQUIRE(loaded != nullptr);
+        BOOST_CHECK(loaded->GetParameter("LoadThreads") == "4");
+        BOOST_CHECK_EQUAL(loaded->GetNumDeleted(), 1);
+        BOOST_CHECK(expect == TestUtils::SearchAll(loaded, queries, dim, k));
+
+        // The loaded index keeps working as a regular one.
+        BOOST_CHECK(SPTAG::ErrorCode::Success == loaded->AddIndex(queries.data(), q, dim, nullptr));
+        BOOST_CHECK_EQUAL(loaded->GetNumSamples(), n + q);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == loaded->SaveIndex("testparallelload"));
+        std::shared_ptr<SPTAG::VectorIndex> reloaded;
+        BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testparallelload", reloaded));
+        BOOST_REQUIRE(reloaded != nullptr);
+        BOOST_CHECK(TestUtils::SearchAll(loaded, queries, dim, k) == TestUtils::SearchAll(reloaded, queries, dim, k));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,131 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+#include "inc/Core/SPANN/Index.h"
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const SPTAG::DimensionType c_updateDim = 16;
+
+    std::shared_ptr<SPTAG::VectorIndex> BuildUpdatableSPANN(const std::vector<float>& p_vec, SPTAG::SizeType p_num, const std::string& p_folder)
+    {
+        std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::SPANN, SPTAG::VectorValueType::Float);
+        vecIndex->SetParameter("IndexAlgoType", "BKT", "Base");
+        vecIndex->SetParameter("DistCalcMethod", "L2", "Base");
+        vecIndex->SetParameter("IndexDirectory", p_folder, "Base");
+
+        vecIndex->SetParameter("isExecute", "true", "SelectHead");
+        vecIndex->SetParameter("NumberOfThreads", "4", "SelectHead");
+        vecIndex->SetParameter("Ratio", "0.2", "SelectHead");
+
+        vecIndex->SetParameter("isExecute", "true", "BuildHead");
+        vecIndex->SetParameter("NumberOfThreads", "4", "BuildHead");
+
+        vecIndex->SetParameter("isExecute", "true", "BuildSSDIndex");
+        vecIndex->SetParameter("BuildSsdIndex", "true", "BuildSSDIndex");
+        vecIndex->SetParameter("NumberOfThreads", "4", "BuildSSDIndex");
+        vecIndex->SetParameter("PostingPageLimit", "12", "BuildSSDIndex");
+        vecIndex->SetParameter("SearchPostingPageLimit", "12", "BuildSSDIndex");
+        vecIndex->SetParameter("InternalResultNum", "32", "BuildSSDIndex");
+        vecIndex->SetParameter("SearchInternalResultNum", "32", "BuildSSDIndex");
+
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(p_vec.data(), p_num, c_updateDim));
+        return vecIndex;
+    }
+
+    int CountNearestHits(std::shared_ptr<SPTAG::VectorIndex>& p_index, const std::vector<float>& p_vec, SPTAG::SizeType p_begin, SPTAG::SizeType p_num)
+    {
+        int hits = 0;
+        for (SPTAG::SizeType i = 0; i < p_num; i++)
+        {
+            SPTAG::QueryResult res(p_vec.data() + (size_t)i * c_updateDim, 5, false);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == p_index->SearchIndex(res));
+            if (res.GetResult(0)->VID == p_begin + i) hits++;
+        }
+        return hits;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(SPANNUpdateTest)
+
+BOOST_AUTO_TEST_CASE(AddDeleteTest)
+{
+    SPTAG::SizeType n = 2000, added = 200;
+    auto base = TestUtils::GenerateVectors(n, c_updateDim, 7);
+    auto fresh = TestUtils::GenerateVectors(added, c_updateDim, 11);
+
+    auto vecIndex = BuildUpdatableSPANN(base, n, "testspannupdate");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->AddIndex(fresh.data(), added, c_updateDim, nullptr));
+    BOOST_CHECK_EQUAL(vecIndex->GetNumSamples(), n + added);
+    BOOST_CHECK(CountNearestHits(vecIndex, fresh, n, added) >= added * 9 / 10);
+
+    for (SPTAG::SizeType i = 0; i < added; i += 2) BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->DeleteIndex(n + i));
+    BOOST_CHECK(SPTAG::ErrorCode::VectorNotFound == vecIndex->DeleteIndex(n));
+    BOOST_CHECK_EQUAL(vecIndex->GetNumDeleted(), added / 2);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->DeleteIndex(base.data(), 10));
+    BOOST_CHECK_EQUAL(vecIndex->GetNumDeleted(), added / 2 + 10);
+
+    for (SPTAG::SizeType i = 0; i < added; i++)
+    {
+        SPTAG::QueryResult res(fresh.data() + (size_t)i * c_updateDim, 5, false);
+        vecIndex->SearchIndex(res);
+        for (int j = 0; j < 5; j++) BOOST_CHECK(res.GetResult(j)->VID < 0 || !(res.GetResult(j)->VID >= n && (res.GetResult(j)->VID - n) % 2 == 0));
+    }
+    for (SPTAG::SizeType i = 0; i < 10; i++) BOOST_CHECK(!vecIndex->ContainSample(i));
+
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SaveIndex("testspannupdate"));
+    vecIndex.reset();
+
+    std::shared_ptr<SPTAG::VectorIndex> loaded;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testspannupdate", loaded));
+    BOOST_CHECK(loaded != nullptr);
+    BOOST_CHECK_EQUAL(loaded->GetNumSamples(), n + added);
+    BOOST_CHECK_EQUAL(loaded->GetNumDeleted(), added / 2 + 10);
+    BOOST_CHECK(!loaded->ContainSample(n) && loaded->ContainSample(n + 1));
+
+    std::vector<float> kept;
+    for (SPTAG::SizeType i = 1; i < added; i += 2) kept.insert(kept.end(), fresh.begin() + (size_t)i * c_updateDim, fresh.begin() + (size_t)(i + 1) * c_updateDim);
+    int hits = 0;
+    for (SPTAG::SizeType i = 0; i < added / 2; i++)
+    {
+        SPTAG::QueryResult res(kept.data() + (size_t)i * c_updateDim, 5, false);
+        loaded->SearchIndex(res);
+        if (res.GetResult(0)->VID == n + 2 * i + 1) hits++;
+    }
+    BOOST_CHECK(hits >= added / 2 * 9 / 10);
+}
+
+BOOST_AUTO_TEST_CASE(SplitTest)
+{
+    SPTAG::SizeType n = 2000, added = 400;
+    auto base = TestUtils::GenerateVectors(n, c_updateDim, 13);
+
+    // New vectors crowd around a single point so that its postings have to split.
+    std::vector<float> fresh((size_t)added * c_updateDim);
+    std::mt19937 rg(17);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    for (size_t i = 0; i < fresh.size(); i++) fresh[i] = base[i % c_updateDim] + noise(rg);
+
+    auto vecIndex = BuildUpdatableSPANN(base, n, "testspannsplit");
+    auto spann = std::dynamic_pointer_cast<SPTAG::SPANN::Index<float>>(vecIndex);
+    BOOST_CHECK(spann != nullptr);
+    SPTAG::SizeType heads = spann->GetMemoryIndex()->GetNumSamples();
+
+    vecIndex->SetParameter("PostingVectorLimit", "20", "BuildSSDIndex");
+    for (SPTAG::SizeType i = 0; i < added; i += 50)
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->AddIndex(fresh.data() + (size_t)i * c_updateDim, 50, c_updateDim, nullptr));
+
+    for (int retry = 0; retry < 100 && spann->GetMemoryIndex()->GetNumSamples() == heads; retry++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_CHECK(spann->GetMemoryIndex()->GetNumSamples() > heads);
+    BOOST_CHECK(CountNearestHits(vecIndex, fresh, n, added) >= added * 8 / 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,190 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+#include "inc/Core/Common/ScalarQuantizer.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+namespace
+{
+    const SPTAG::DimensionType c_sqDim = 24;
+
+    float L2(const float* pX, const float* pY)
+    {
+        float diff = 0;
+        for (SPTAG::DimensionType d = 0; d < c_sqDim; d++) diff += (pX[d] - pY[d]) * (pX[d] - pY[d]);
+        return diff;
+    }
+
+    float Recall(std::shared_ptr<SPTAG::VectorIndex>& p_index, const std::vector<float>& p_vec, const std::vector<float>& p_queries, int p_k)
+    {
+        SPTAG::SizeType n = (SPTAG::SizeType)(p_vec.size() / c_sqDim), q = (SPTAG::SizeType)(p_queries.size() / c_sqDim);
+        int hits = 0;
+        for (SPTAG::SizeType i = 0; i < q; i++)
+        {
+            const float* query = p_queries.data() + (size_t)i * c_sqDim;
+            std::vector<std::pair<float, SPTAG::SizeType>> truth;
+            for (SPTAG::SizeType j = 0; j < n; j++) truth.emplace_back(L2(query, p_vec.data() + (size_t)j * c_sqDim), j);
+            std::partial_sort(truth.begin(), truth.begin() + p_k, truth.end());
+            std::set<SPTAG::SizeType> expect;
+            for (int j = 0; j < p_k; j++) expect.insert(truth[j].second);
+
+            SPTAG::QueryResult res(query, p_k, false);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == p_index->SearchIndex(res));
+            for (int j = 0; j < p_k; j++) hits += (int)expect.count(res.GetResult(j)->VID);
+        }
+        return (float)hits / (q * p_k);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(ScalarQuantizerTest)
+
+BOOST_AUTO_TEST_CASE(QuantizeReconstructTest)
+{
+    SPTAG::SizeType n = 500;
+    auto vec = TestUtils::GenerateVectors(n, c_sqDim, 7, 10.0f);
+    for (int bits : { 8, 4 })
+    {
+        auto quantizer = SPTAG::COMMON::ScalarQuantizer<float>::Train(vec.data(), n, c_sqDim, bits);
+        BOOST_REQUIRE(quantizer != nullptr);
+        BOOST_CHECK_EQUAL(quantizer->GetNumSubvectors(), bits == 8 ? c_sqDim : c_sqDim / 2);
+
+        // Every dimension spans about 20 units, so a value is off by at most half a quantization step.
+        float step = 20.0f / ((1 << bits) - 1);
+        std::vector<std::uint8_t> code(quantizer->GetNumSubvectors()), other(quantizer->GetNumSubvectors());
+        std::vector<float> rec(c_sqDim), otherRec(c_sqDim);
+        for (SPTAG::SizeType i = 0; i + 1 < n; i += 50)
+        {
+            quantizer->QuantizeVector(vec.data() + (size_t)i * c_sqDim, code.data(), false);
+            quantizer->ReconstructVector(code.data(), rec.data());
+            for (SPTAG::DimensionType d = 0; d < c_sqDim; d++) BOOST_CHECK_SMALL(rec[d] - vec[(size_t)i * c_sqDim + d], step / 2 + 1e-4f);
+
+            quantizer->QuantizeVector(vec.data() + (size_t)(i + 1) * c_sqDim, other.data(), false);
+            quantizer->ReconstructVector(other.data(), otherRec.data());
+            BOOST_CHECK_CLOSE_FRACTION(quantizer->L2Distance(code.data(), other.data()), L2(rec.data(), otherRec.data()), 1e-3);
+
+            quantizer->SetEnableADC(true);
+            std::vector<std::uint8_t> query(quantizer->QuantizeSize());
+            quantizer->QuantizeVector(vec.data() + (size_t)(i + 1) * c_sqDim, query.data());
+            BOOST_CHECK_CLOSE_FRACTION(quantizer->L2Distance(query.data(), code.data()), L2(vec.data() + (size_t)(i + 1) * c_sqDim, rec.data()), 1e-3);
+            quantizer->SetEnableADC(false);
+        }
+
+        auto out = SPTAG::f_createIO();
+        BOOST_REQUIRE(out != nullptr && out->Initialize("testsq.bin", std::ios::binary | std::ios::out));
+        BOOST_CHECK(SPTAG::ErrorCode::Success == quantizer->SaveQuantizer(out));
+        out->ShutDown();
+
+        auto in = SPTAG::f_createIO();
+        BOOST_REQUIRE(in != nullptr && in->Initialize("testsq.bin", std::ios::binary | std::ios::in));
+        auto loaded = SPTAG::COMMON::IQuantizer::LoadIQuantizer(in);
+        BOOST_REQUIRE(loaded != nullptr);
+        BOOST_CHECK(loaded->GetQuantizerType() == SPTAG::QuantizerType::ScalarQuantizer);
+        BOOST_CHECK_EQUAL(loaded->BufferSize(), quantizer->BufferSize());
+        loaded->ReconstructVector(code.data(), otherRec.data());
+        BOOST_CHECK(rec == otherRec);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BKTScalarQuantizerTest)
+{
+    SPTAG::SizeType n = 2000, q = 50;
+    int k = 10;
+    auto vec = TestUtils::GenerateVectors(n, c_sqDim, 11, 10.0f);
+    auto queries = TestUtils::GenerateVectors(q, c_sqDim, 13, 10.0f);
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(float) * vec.size(), false), SPTAG::VectorValueType::Float, c_sqDim, n));
+
+    std::shared_ptr<SPTAG::VectorIndex> floatIndex = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::Float);
+    floatIndex->SetParameter("ScalarQuantizerBits", "8");
+    BOOST_CHECK(SPTAG::ErrorCode::Success != floatIndex->BuildIndex(std::shared_ptr<SPTAG::VectorSet>(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray::Alloc(c_sqDim), SPTAG::VectorValueType::Int8, c_sqDim, 1)), nullptr));
+
+    for (int bits : { 8, 4 })
+    {
+        std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::UInt8);
+        index->SetParameter("DistCalcMethod", "L2");
+        index->SetParameter("NumberOfThreads", "4");
+        BOOST_CHECK(SPTAG::ErrorCode::Success != index->BuildIndex(vecset, nullptr));
+
+        index->SetParameter("ScalarQuantizerBits", std::to_string(bits));
+        index->SetParameter("RerankCandidates", "50");
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(vecset, nullptr));
+        BOOST_CHECK_EQUAL(index->GetFeatureDim(), bits == 8 ? c_sqDim : c_sqDim / 2);
+        BOOST_CHECK(index->GetQuantizer() != nullptr);
+        float reranked = Recall(index, vec, queries, k);
+        BOOST_CHECK_GT(reranked, 0.9f);
+
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SaveIndex("testsqindex"));
+        std::shared_ptr<SPTAG::VectorIndex> loaded;
+        BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testsqindex", loaded));
+        BOOST_REQUIRE(loaded != nullptr);
+        BOOST_CHECK_EQUAL(Recall(loaded, vec, queries, k), reranked);
+
+        BOOST_CHECK(SPTAG::ErrorCode::Success == loaded->SetParameter("ReorderGraph", "true"));
+        BOOST_CHECK_EQUAL(Recall(loaded, vec, queries, k), reranked);
+
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("RerankCandidates", "0"));
+        float quantized = Recall(index, vec, queries, k);
+        BOOST_CHECK_GE(reranked, quantized);
+        BOOST_TEST_MESSAGE("SQ" << bits << " recall@" << k << ": " << quantized << " on codes, " << reranked << " reranked");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BKTScalarQuantizerWriteTest)
+{
+    SPTAG::SizeType n = 2000, extra = 200, q = 50, deleted = 100;
+    int k = 10;
+    auto vec = TestUtils::GenerateVectors(n + extra, c_sqDim, 17, 10.0f);
+    auto queries = TestUtils::GenerateVectors(q, c_sqDim, 19, 10.0f);
+
+    std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::UInt8);
+    index->SetParameter("DistCalcMethod", "L2");
+    index->SetParameter("NumberOfThreads", "4");
+    index->SetParameter("ScalarQuantizerBits", "8");
+    index->SetParameter("RerankCandidates", "50");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(std::shared_ptr<SPTAG::VectorSet>(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(float) * n * c_sqDim, false), SPTAG::VectorValueType::Float, c_sqDim, n)), nullptr));
+
+    // Full-precision adds are encoded by the trained quantizer and keep their rows for reranking.
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->AddIndex(std::shared_ptr<SPTAG::VectorSet>(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data() + sizeof(float) * n * c_sqDim, sizeof(float) * extra * c_sqDim, false), SPTAG::VectorValueType::Float, c_sqDim, extra)), nullptr));
+    BOOST_CHECK_EQUAL(index->GetNumSamples(), n + extra);
+    BOOST_CHECK_GT(Recall(index, vec, queries, k), 0.9f);
+
+    for (SPTAG::SizeType i = 0; i < deleted; i++) BOOST_CHECK(SPTAG::ErrorCode::Success == index->DeleteIndex(i * 20));
+    index->SetParameter("DeletePercentageForRefine", "0.01");
+    BOOST_CHECK(index->NeedRefine());
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SaveIndex("testsqwrite"));
+    std::shared_ptr<SPTAG::VectorIndex> loaded;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testsqwrite", loaded));
+    BOOST_REQUIRE(loaded != nullptr);
+    BOOST_CHECK_EQUAL(loaded->GetNumSamples(), n + extra - deleted);
+
+    // Compaction fills the holes the same way the refine on save did, so its map serves both.
+    std::vector<SPTAG::SizeType> idMap;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->CompactIndex(idMap));
+    BOOST_REQUIRE_EQUAL((SPTAG::SizeType)idMap.size(), n + extra);
+    std::vector<float> remaining((size_t)(n + extra - deleted) * c_sqDim);
+    for (SPTAG::SizeType i = 0; i < n + extra; i++)
+    {
+        if (idMap[i] >= 0) std::copy(vec.begin() + (size_t)i * c_sqDim, vec.begin() + (size_t)(i + 1) * c_sqDim, remaining.begin() + (size_t)idMap[i] * c_sqDim);
+    }
+    BOOST_CHECK_GT(Recall(index, remaining, queries, k), 0.9f);
+    BOOST_CHECK_GT(Recall(loaded, remaining, queries, k), 0.9f);
+
+    // Codes added on their own keep their reconstruction as the full-precision row.
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->AddIndex(index->GetSample(0), 1, index->GetFeatureDim(), nullptr));
+    BOOST_CHECK_EQUAL(index->GetNumSamples(), n + extra - deleted + 1);
+
+    std::shared_ptr<SPTAG::VectorIndex> plain = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::UInt8);
+    plain->SetParameter("RerankCandidates", "50");
+    BOOST_CHECK(SPTAG::ErrorCode::Fail == plain->AddIndex(std::shared_ptr<SPTAG::VectorSet>(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(float) * c_sqDim, false), SPTAG::VectorValueType::Float, c_sqDim, 1)), nullptr));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,98 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+#include "inc/Helper/TaskScheduler.h"
+#include "inc/Helper/ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+    // Asks to stop once the loop body has run p_limit times.
+    class CountingAbort : public SPTAG::IAbortOperation
+    {
+    public:
+        CountingAbort(std::atomic<int>& p_calls, int p_limit) : m_calls(p_calls), m_limit(p_limit) {}
+
+        virtual bool ShouldAbort() { return m_calls >= m_limit; }
+
+    private:
+        std::atomic<int>& m_calls;
+        int m_limit;
+    };
+
+    class CountJob : public SPTAG::Helper::ThreadPool::Job
+    {
+    public:
+        CountJob(std::atomic<int>& p_done) : m_done(p_done) {}
+
+        void exec(SPTAG::IAbortOperation* p_abort)
+        {
+            std::atomic<int> sum(0);
+            SPTAG::Helper::TaskScheduler::Instance().ParallelFor(0, 100, 4, [&](SPTAG::SizeType i) { sum += (int)i; }, p_abort);
+            if (sum == 4950) m_done++;
+        }
+
+    private:
+        std::atomic<int>& m_done;
+    };
+}
+
+BOOST_AUTO_TEST_SUITE(TaskSchedulerTest)
+
+BOOST_AUTO_TEST_CASE(ThreadBudgetTest)
+{
+    std::atomic<int> active(0), peak(0), calls(0);
+    SPTAG::Helper::TaskScheduler::Instance().ParallelFor(0, 2000, 3, [&](SPTAG::SizeType) {
+        int now = ++active;
+        int seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now));
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        calls++;
+        active--;
+    });
+    BOOST_CHECK_EQUAL(calls.load(), 2000);
+    BOOST_CHECK_LE(peak.load(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(NestedLoopTest)
+{
+    // Every outer iteration waits for an inner loop, which must not starve the workers the outer loop holds.
+    std::atomic<std::int64_t> sum(0);
+    SPTAG::Helper::TaskScheduler::Instance().ParallelFor(0, 64, 8, [&](SPTAG::SizeType i) {
+        SPTAG::Helper::TaskScheduler::Instance().ParallelFor(0, 1000, 8, [&](SPTAG::SizeType j) { sum += j; }, nullptr, 16);
+    });
+    BOOST_CHECK_EQUAL(sum.load(), 64 * (std::int64_t)499500);
+}
+
+BOOST_AUTO_TEST_CASE(AbortAndExceptionTest)
+{
+    std::atomic<int> calls(0);
+    CountingAbort abort(calls, 100);
+    SPTAG::Helper::TaskScheduler::Instance().ParallelFor(0, 100000, 4, [&](SPTAG::SizeType) { calls++; }, &abort, 10);
+    BOOST_CHECK_GE(calls.load(), 100);
+    BOOST_CHECK_LT(calls.load(), 100000);
+
+    BOOST_CHECK_THROW(SPTAG::Helper::TaskScheduler::Instance().ParallelFor(0, 1000, 4, [](SPTAG::SizeType i) {
+        if (i == 500) throw std::runtime_error("failed");
+    }), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(ThreadPoolTest)
+{
+    std::atomic<int> done(0);
+    {
+        SPTAG::Helper::ThreadPool pool;
+        pool.init(2);
+        for (int i = 0; i < 20; i++) pool.add(new CountJob(done));
+        for (int i = 0; i < 1000 && done < 20; i++) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_CHECK_EQUAL(done.load(), 20);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,121 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+#include "inc/Core/Common/EpochManager.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Searches for random base vectors until told to stop and counts the ones that find themselves.
+    void SearchUntil(std::shared_ptr<SPTAG::VectorIndex>& p_index, const std::vector<float>& p_vec, SPTAG::SizeType p_num, SPTAG::DimensionType p_dim,
+        std::atomic<bool>& p_done, std::atomic<int>& p_searched, std::atomic<int>& p_found, unsigned p_seed)
+    {
+        std::mt19937 rg(p_seed);
+        while (!p_done)
+        {
+            SPTAG::SizeType id = (SPTAG::SizeType)(rg() % p_num);
+            SPTAG::QueryResult res(p_vec.data() + (size_t)id * p_dim, 5, false);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == p_index->SearchIndex(res));
+            p_searched++;
+            if (res.GetResult(0)->Dist < 1e-4f) p_found++;
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(TreeSnapshotTest)
+
+BOOST_AUTO_TEST_CASE(SearchDuringRebuildTest)
+{
+    SPTAG::SizeType n = 2000, m = 1500;
+    SPTAG::DimensionType dim = 32;
+    std::mt19937 rg(101);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> vec((size_t)(n + m) * dim);
+    for (auto& v : vec) v = dist(rg);
+
+    std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(SPTAG::IndexAlgoType::BKT, SPTAG::VectorValueType::Float);
+    index->SetParameter("DistCalcMethod", "L2");
+    index->SetParameter("NumberOfThreads", "4");
+    index->SetParameter("AddCountForRebuild", "200");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(vec.data(), n, dim));
+
+    // Every few batches the adds cross AddCountForRebuild, so the trees are republished under the searches.
+    std::atomic<bool> done(false);
+    std::atomic<int> searched(0), found(0);
+    std::vector<std::thread> searchers;
+    for (unsigned t = 0; t < 3; t++)
+    {
+        searchers.emplace_back([&, t]() { SearchUntil(index, vec, n, dim, done, searched, found, 7 + t); });
+    }
+    for (SPTAG::SizeType begin = n; begin < n + m; begin += 50)
+    {
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->AddIndex(vec.data() + (size_t)begin * dim, 50, dim, nullptr));
+    }
+    // Switching the layout rewrites the index in place, which still has to wait for the searches.
+    BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("ReorderGraph", "true"));
+    done = true;
+    for (auto& searcher : searchers) searcher.join();
+
+    BOOST_CHECK_EQUAL(index->GetNumSamples(), n + m);
+    BOOST_CHECK_GE(found, searched * 98 / 100);
+    SPTAG::SizeType exact = 0;
+    for (SPTAG::SizeType i = n; i < n + m; i++)
+    {
+        SPTAG::QueryResult res(vec.data() + (size_t)i * dim, 1, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SearchIndex(res));
+        if (res.GetResult(0)->VID == i) exact++;
+    }
+    BOOST_CHECK_GE(exact, m * 98 / 100);
+}
+
+BOOST_AUTO_TEST_CASE(ReadUnderLockTest)
+{
+    SPTAG::COMMON::EpochManager epoch;
+    std::atomic<bool> entered(false);
+    std::thread reader;
+    {
+        std::lock_guard<SPTAG::COMMON::EpochManager> lock(epoch);
+
+        // The writer holding the lock can take a read view of what it is changing without waiting on itself.
+        int token = epoch.Enter();
+        epoch.Leave(token);
+
+        reader = std::thread([&]() {
+            int t = epoch.Enter();
+            entered = true;
+            epoch.Leave(t);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        BOOST_CHECK(!entered);
+    }
+    reader.join();
+    BOOST_CHECK(entered);
+
+    // Readers on other threads are still drained by the next writer.
+    int token = epoch.Enter();
+    std::atomic<bool> locked(false);
+    std::thread writer([&]() {
+        std::lock_guard<SPTAG::COMMON::EpochManager> lock(epoch);
+        locked = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_CHECK(!locked);
+
+    // A read nested in one the writer is waiting for goes through instead of queueing behind the writer.
+    int nested = epoch.Enter();
+    epoch.Leave(nested);
+    BOOST_CHECK(!locked);
+    epoch.Leave(token);
+    writer.join();
+    BOOST_CHECK(locked);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,122 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Test.h"
+#include "inc/Core/VectorIndex.h"
+#include "inc/Core/Common/WorkSpace.h"
+
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    std::shared_ptr<SPTAG::VectorIndex> BuildVisitedSetIndex(SPTAG::IndexAlgoType p_algo, const std::vector<float>& p_vec, SPTAG::DimensionType p_dim, const char* p_visitedSet)
+    {
+        std::shared_ptr<SPTAG::VectorIndex> index = SPTAG::VectorIndex::CreateInstance(p_algo, SPTAG::VectorValueType::Float);
+        index->SetParameter("DistCalcMethod", "L2");
+        index->SetParameter("NumberOfThreads", "2");
+        index->SetParameter("VisitedSet", p_visitedSet);
+        SPTAG::SizeType n = (SPTAG::SizeType)(p_vec.size() / p_dim);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->BuildIndex(p_vec.data(), n, p_dim));
+        return index;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(VisitedSetTest)
+
+BOOST_AUTO_TEST_CASE(EpochPosVectorTest)
+{
+    SPTAG::COMMON::EpochPosVector visited;
+    visited.Init(100);
+    BOOST_CHECK(!visited.CheckAndSet(5));
+    BOOST_CHECK(visited.CheckAndSet(5));
+    BOOST_CHECK(!visited.CheckAndSet(99));
+
+    // Ids past the initial size grow the array and keep the marks of the current search.
+    BOOST_CHECK(!visited.CheckAndSet(250));
+    BOOST_CHECK(visited.CheckAndSet(250));
+    BOOST_CHECK(visited.CheckAndSet(5));
+    BOOST_CHECK_GE(visited.Size(), 251);
+
+    // Run past the uint16 epoch so the stamps are reset once.
+    for (int i = 0; i < 70000; i++)
+    {
+        visited.clear();
+        BOOST_REQUIRE(!visited.CheckAndSet(i % 251));
+        BOOST_REQUIRE(visited.CheckAndSet(i % 251));
+    }
+    visited.clear();
+    for (SPTAG::SizeType i = 0; i < visited.Size(); i++) BOOST_REQUIRE(!visited.CheckAndSet(i));
+}
+
+BOOST_AUTO_TEST_CASE(VisitedPosVectorSelectTest)
+{
+    int maxCheck = 1024, exp = 2;
+    SPTAG::SizeType limit = SPTAG::COMMON::VisitedPosVector::c_epochRowsPerHashSlot * SPTAG::COMMON::OptHashPosVector::PoolSize(maxCheck, exp);
+
+    SPTAG::COMMON::VisitedPosVector visited;
+    visited.Init(maxCheck, exp, limit);
+    BOOST_CHECK(visited.UseEpoch());
+    visited.Init(maxCheck, exp, limit + 1);
+    BOOST_CHECK(!visited.UseEpoch());
+    visited.Init(maxCheck, exp, 0);
+    BOOST_CHECK(!visited.UseEpoch());
+    visited.Init(maxCheck, exp, 100, SPTAG::VisitedSetType::Hash);
+    BOOST_CHECK(!visited.UseEpoch());
+    visited.Init(maxCheck, exp, limit + 1, SPTAG::VisitedSetType::Epoch);
+    BOOST_CHECK(visited.UseEpoch());
+    BOOST_CHECK_EQUAL(visited.MaxCheck(), maxCheck);
+    BOOST_CHECK_EQUAL(visited.HashTableExponent(), exp);
+
+    SPTAG::COMMON::WorkSpace space;
+    space.Initialize(maxCheck, exp, 1000);
+    SPTAG::COMMON::WorkSpace copy(space);
+    BOOST_CHECK(copy.nodeCheckStatus.UseEpoch());
+    BOOST_CHECK_EQUAL(copy.nodeCheckStatus.Rows(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(IndexVisitedSetTest)
+{
+    SPTAG::SizeType n = 2000, q = 20;
+    SPTAG::DimensionType dim = 16;
+    int k = 10;
+    std::mt19937 rg(17);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> vec((size_t)n * dim), queries((size_t)q * dim);
+    for (auto& v : vec) v = dist(rg);
+    for (auto& v : queries) v = dist(rg);
+
+    for (SPTAG::IndexAlgoType algo : { SPTAG::IndexAlgoType::BKT, SPTAG::IndexAlgoType::KDT })
+    {
+        auto index = BuildVisitedSetIndex(algo, vec, dim, "Epoch");
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SaveIndex("testvisitedset"));
+
+        // Both visited sets are exact, so the searches walk the same nodes. Each index is searched from a fresh
+        // thread since the thread-local workspace of an earlier search would keep its visited set.
+        std::vector<SPTAG::QueryResult> hashRes, epochRes;
+        for (SPTAG::SizeType i = 0; i < q; i++)
+        {
+            hashRes.emplace_back(queries.data() + (size_t)i * dim, k, false);
+            epochRes.emplace_back(queries.data() + (size_t)i * dim, k, false);
+        }
+        std::thread([&]() { for (auto& res : epochRes) BOOST_CHECK(SPTAG::ErrorCode::Success == index->SearchIndex(res)); }).join();
+        BOOST_CHECK(SPTAG::ErrorCode::Success == index->SetParameter("VisitedSet", "Hash"));
+        std::thread([&]() { for (auto& res : hashRes) BOOST_CHECK(SPTAG::ErrorCode::Success == index->SearchIndex(res)); }).join();
+        for (SPTAG::SizeType i = 0; i < q; i++)
+        {
+            for (int j = 0; j < k; j++)
+            {
+                BOOST_CHECK_EQUAL(hashRes[i].GetResult(j)->VID, epochRes[i].GetResult(j)->VID);
+                BOOST_CHECK_EQUAL(hashRes[i].GetResult(j)->Dist, epochRes[i].GetResult(j)->Dist);
+            }
+        }
+
+        std::shared_ptr<SPTAG::VectorIndex> loaded;
+        BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testvisitedset", loaded));
+        BOOST_REQUIRE(loaded != nullptr);
+        BOOST_CHECK(loaded->GetParameter("VisitedSet") == "Epoch");
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
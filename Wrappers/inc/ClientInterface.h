@@ -25,8 +25,13 @@ public:
 
     void ClearSearchParam();
 
+    void SetBinaryProtocol(bool p_enable);
+
     std::shared_ptr<RemoteSearchResult> Search(ByteArray p_data, int p_resultNum, const char* p_valueType, bool p_withMetaData);
 
+    // p_data holds p_vectorCount vectors back to back. Results come back index-major, one list per vector.
+    std::shared_ptr<RemoteSearchResult> BatchSearch(ByteArray p_data, int p_vectorCount, int p_resultNum, const char* p_valueType, bool p_withMetaData);
+
     bool IsConnected() const;
 
 private:
@@ -35,6 +40,14 @@ private:
                                   bool p_extractMetadata,
                                   SPTAG::VectorValueType p_valueType);
 
+    SPTAG::Socket::RemoteBinaryQuery CreateBinarySearchQuery(const ByteArray& p_data,
+                                                             int p_vectorCount,
+                                                             int p_resultNum,
+                                                             bool p_extractMetadata,
+                                                             SPTAG::VectorValueType p_valueType);
+
+    std::shared_ptr<RemoteSearchResult> SendSearchPacket(SPTAG::Socket::Packet p_packet);
+
     SPTAG::Socket::PacketHandlerMapPtr GetHandlerMap();
 
     void SearchResponseHanlder(SPTAG::Socket::ConnectionID p_localConnectionID,
@@ -58,6 +71,8 @@ private:
     std::unordered_map<std::string, std::string> m_params;
 
     std::mutex m_paramMutex;
+
+    std::atomic_bool m_binaryProtocol;
 };
 
 #endif // _SPTAG_PW_CLIENTINTERFACE_H_
@@ -10,9 +10,26 @@
 #include <boost/asio.hpp>
 
 
+namespace
+{
+
+template<typename Query>
+void
+FillSearchPacket(SPTAG::Socket::Packet& p_packet, SPTAG::Socket::PacketType p_type, const Query& p_query)
+{
+    p_packet.Header().m_packetType = p_type;
+    p_packet.Header().m_bodyLength = static_cast<std::uint32_t>(p_query.EstimateBufferSize());
+    p_packet.AllocateBuffer(p_packet.Header().m_bodyLength);
+    p_query.Write(p_packet.Body());
+}
+
+} // namespace
+
+
 AnnClient::AnnClient(const char* p_serverAddr, const char* p_serverPort)
     : m_connectionID(SPTAG::Socket::c_invalidConnectionID),
-      m_timeoutInMilliseconds(9000)
+      m_timeoutInMilliseconds(9000),
+      m_binaryProtocol(false)
 {
     using namespace SPTAG;
 
@@ -101,76 +118,116 @@ AnnClient::ClearSearchParam()
 }
 
 
+void
+AnnClient::SetBinaryProtocol(bool p_enable)
+{
+    m_binaryProtocol = p_enable;
+}
+
+
 std::shared_ptr<RemoteSearchResult>
 AnnClient::Search(ByteArray p_data, int p_resultNum, const char* p_valueType, bool p_withMetaData)
 {
     using namespace SPTAG;
 
-    SPTAG::Socket::RemoteSearchResult ret;
-
     SPTAG::VectorValueType valueType = SPTAG::VectorValueType::Undefined;
     SPTAG::Helper::Convert::ConvertStringTo<SPTAG::VectorValueType>(p_valueType, valueType);
 
     if (Socket::c_invalidConnectionID != m_connectionID && SPTAG::VectorValueType::Undefined != valueType)
     {
+        Socket::Packet packet;
+        if (m_binaryProtocol)
+        {
+            FillSearchPacket(packet, Socket::PacketType::BinarySearchRequest, CreateBinarySearchQuery(p_data, 1, p_resultNum, p_withMetaData, valueType));
+        }
+        else
+        {
+            Socket::RemoteQuery query;
+            query.m_queryString = CreateSearchQuery(p_data, p_resultNum, p_withMetaData, valueType);
+            FillSearchPacket(packet, Socket::PacketType::SearchRequest, query);
+        }
 
-        auto signal = std::make_shared<Helper::Concurrent::WaitSignal>(1);
+        return SendSearchPacket(std::move(packet));
+    }
 
-        auto callback = [&ret, signal](RemoteSearchResult p_result)
-        {
-            if (RemoteSearchResult::ResultStatus::Success == p_result.m_status)
-            {
-                ret = std::move(p_result);
-            }
+    SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Error connection or data type!");
+    return std::make_shared<RemoteSearchResult>();
+}
+
+
+std::shared_ptr<RemoteSearchResult>
+AnnClient::BatchSearch(ByteArray p_data, int p_vectorCount, int p_resultNum, const char* p_valueType, bool p_withMetaData)
+{
+    using namespace SPTAG;
+
+    SPTAG::VectorValueType valueType = SPTAG::VectorValueType::Undefined;
+    SPTAG::Helper::Convert::ConvertStringTo<SPTAG::VectorValueType>(p_valueType, valueType);
+
+    if (Socket::c_invalidConnectionID != m_connectionID && SPTAG::VectorValueType::Undefined != valueType
+        && p_vectorCount > 0 && p_data.Length() % (p_vectorCount * GetValueTypeSize(valueType)) == 0)
+    {
+        Socket::Packet packet;
+        FillSearchPacket(packet, Socket::PacketType::BatchSearchRequest, CreateBinarySearchQuery(p_data, p_vectorCount, p_resultNum, p_withMetaData, valueType));
+        return SendSearchPacket(std::move(packet));
+    }
+
+    SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Error connection, data type or vector count!");
+    return std::make_shared<RemoteSearchResult>();
+}
+
+
+std::shared_ptr<RemoteSearchResult>
+AnnClient::SendSearchPacket(SPTAG::Socket::Packet p_packet)
+{
+    using namespace SPTAG;
+
+    SPTAG::Socket::RemoteSearchResult ret;
 
-            signal->FinishOne();
-        };
+    auto signal = std::make_shared<Helper::Concurrent::WaitSignal>(1);
 
-        auto timeoutCallback = [this](std::shared_ptr<Callback> p_callback)
+    auto callback = [&ret, signal](RemoteSearchResult p_result)
+    {
+        if (RemoteSearchResult::ResultStatus::Success == p_result.m_status)
         {
-            if (nullptr != p_callback)
-            {
-                RemoteSearchResult result;
-                result.m_status = RemoteSearchResult::ResultStatus::Timeout;
+            ret = std::move(p_result);
+        }
 
-                (*p_callback)(std::move(result));
-            }
-        };
+        signal->FinishOne();
+    };
 
-        auto connectCallback = [callback, this](bool p_connectSucc)
+    auto timeoutCallback = [this](std::shared_ptr<Callback> p_callback)
+    {
+        if (nullptr != p_callback)
         {
-            if (!p_connectSucc)
-            {
-                RemoteSearchResult result;
-                result.m_status = RemoteSearchResult::ResultStatus::FailedNetwork;
+            RemoteSearchResult result;
+            result.m_status = RemoteSearchResult::ResultStatus::Timeout;
 
-                callback(std::move(result));
-            }
-        };
+            (*p_callback)(std::move(result));
+        }
+    };
 
-        Socket::Packet packet;
-        packet.Header().m_connectionID = Socket::c_invalidConnectionID;
-        packet.Header().m_packetType = Socket::PacketType::SearchRequest;
-        packet.Header().m_processStatus = Socket::PacketProcessStatus::Ok;
-        packet.Header().m_resourceID = m_callbackManager.Add(std::make_shared<Callback>(std::move(callback)),
-            m_timeoutInMilliseconds,
-            std::move(timeoutCallback));
+    auto connectCallback = [callback, this](bool p_connectSucc)
+    {
+        if (!p_connectSucc)
+        {
+            RemoteSearchResult result;
+            result.m_status = RemoteSearchResult::ResultStatus::FailedNetwork;
 
-        Socket::RemoteQuery query;
-        query.m_queryString = CreateSearchQuery(p_data, p_resultNum, p_withMetaData, valueType);
+            callback(std::move(result));
+        }
+    };
 
-        packet.Header().m_bodyLength = static_cast<std::uint32_t>(query.EstimateBufferSize());
-        packet.AllocateBuffer(packet.Header().m_bodyLength);
-        query.Write(packet.Body());
-        packet.Header().WriteBuffer(packet.HeaderBuffer());
+    p_packet.Header().m_connectionID = Socket::c_invalidConnectionID;
+    p_packet.Header().m_processStatus = Socket::PacketProcessStatus::Ok;
+    p_packet.Header().m_resourceID = m_callbackManager.Add(std::make_shared<Callback>(std::move(callback)),
+        m_timeoutInMilliseconds,
+        std::move(timeoutCallback));
+    p_packet.Header().WriteBuffer(p_packet.HeaderBuffer());
 
-        m_socketClient->SendPacket(m_connectionID, std::move(packet), connectCallback);
+    m_socketClient->SendPacket(m_connectionID, std::move(p_packet), connectCallback);
+
+    signal->Wait();
 
-        signal->Wait();
-    }
-    else {
-        SPTAGLIB_LOG(Helper::LogLevel::LL_Error, "Error connection or data type!");
-    }
     return std::make_shared<RemoteSearchResult>(ret);
 }
 
@@ -193,6 +250,16 @@ AnnClient::GetHandlerMap()
                                   this,
                                   std::placeholders::_1,
                                   std::placeholders::_2));
+    handlerMap->emplace(Socket::PacketType::BinarySearchResponse,
+                        std::bind(&AnnClient::SearchResponseHanlder,
+                                  this,
+                                  std::placeholders::_1,
+                                  std::placeholders::_2));
+    handlerMap->emplace(Socket::PacketType::BatchSearchResponse,
+                        std::bind(&AnnClient::SearchResponseHanlder,
+                                  this,
+                                  std::placeholders::_1,
+                                  std::placeholders::_2));
 
     return handlerMap;
 }
@@ -253,3 +320,39 @@ AnnClient::CreateSearchQuery(const ByteArray& p_data,
     return out.str();
 }
 
+
+SPTAG::Socket::RemoteBinaryQuery
+AnnClient::CreateBinarySearchQuery(const ByteArray& p_data,
+                                   int p_vectorCount,
+                                   int p_resultNum,
+                                   bool p_extractMetadata,
+                                   SPTAG::VectorValueType p_valueType)
+{
+    using namespace SPTAG;
+
+    Socket::RemoteBinaryQuery query;
+    query.m_valueType = p_valueType;
+    query.m_dimension = static_cast<DimensionType>(p_data.Length() / p_vectorCount / GetValueTypeSize(p_valueType));
+    query.m_resultNum = static_cast<std::uint32_t>(p_resultNum);
+    query.SetFlag(Socket::RemoteBinaryQuery::QueryFlag::ExtractMetadata, p_extractMetadata);
+    query.m_vector = p_data;
+
+    // Only the index names are carried over; other search params have no binary field.
+    {
+        std::lock_guard<std::mutex> guard(m_paramMutex);
+        auto iter = m_params.find("indexname");
+        if (iter != m_params.end())
+        {
+            std::size_t begin = 0;
+            while (begin <= iter->second.size())
+            {
+                std::size_t end = iter->second.find(',', begin);
+                if (end == std::string::npos) end = iter->second.size();
+                if (end > begin) query.m_indexNames.emplace_back(iter->second, begin, end - begin);
+                begin = end + 1;
+            }
+        }
+    }
+
+    return query;
+}